@@ -0,0 +1,200 @@
+// Time taken by an analysis reading the ntuple of a run, from csv and from a column table (see ColumnTable.hh).
+//
+// The cell ntuple of CPOP, with the columns of TargetedAlphaTherapy/output/output.root (one row per nucleus
+// crossed by a primary: particle name, emission organelle, entrance and exit energies, cell, event, source
+// cell, then one EndOfRun row per cell and thread holding the doses fEdepn, fEdepc and fEdep_sph), is written
+// in csv by nbThread threads, then converted into a column table as at the end of a run (/cpop/output/format
+// columns). The analysis, the energy deposited by the primaries and the dose of the nuclei per cell, is then
+// done by parsing the csv files and by mapping the table, and the results are compared. The exit code is 1 if
+// they differ, or if the summaries of the threads were not summed into a single row per cell.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
+// CPOP headers
+#include <cReader/zupply.hpp>
+
+#include "ColumnTable.hh"
+#include "OutputMerger.hh"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double Seconds(Clock::time_point start) {
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+double Megabytes(const std::string& filename) {
+	struct stat status{};
+	return ::stat(filename.c_str(), &status) == 0 ? status.st_size/(1024.*1024.) : 0.;
+}
+
+/// Energy deposited by the primaries in the nuclei of each cell and dose of the nuclei of each cell
+struct Analysis {
+	std::vector<double> deposited;
+	std::vector<double> dose;
+
+	explicit Analysis(std::size_t nCell): deposited(nCell, 0.), dose(nCell, 0.) {}
+
+	bool operator==(const Analysis& other) const {
+		auto const close = [](const std::vector<double>& a, const std::vector<double>& b) {
+			for(std::size_t i = 0; i < a.size(); ++i)
+				if(std::abs(a[i] - b[i]) > 1e-9*(1. + std::abs(a[i])))
+					return false;
+			return true;
+		};
+		return close(deposited, other.deposited) && close(dose, other.dose);
+	}
+};
+
+const char* const Particles[] = {"alpha", "e-", "proton", "gamma"};
+const char* const Organelles[] = {"nucleus", "cytoplasm"};
+
+/// csv ntuple of a thread, with the commented header of the csv output of the analysis
+void WriteCsv(const std::string& filename, unsigned thread, long nbRow, std::size_t nCell, std::mt19937_64& random) {
+	std::ofstream out(filename);
+	out << "#class tools::wcsv::ntuple\n#title cell\n#separator 44\n#vector_separator 59\n"
+		<< "#column std::string nameParticle\n#column std::string Organelle_emission\n#column double Ei\n"
+		<< "#column double Ef\n#column double ID_Cell\n#column double eventID\n#column double Cellule_D_Emission\n"
+		<< "#column double fEdepn\n#column double fEdepc\n#column double fEdep_sph\n#column double indice_if_diffusion\n";
+	out << std::setprecision(17);
+	std::uniform_int_distribution<std::size_t> cell(0, nCell - 1);
+	std::uniform_real_distribution<double> energy(0., 5.);
+	for(long row = 0; row < nbRow; ++row) {
+		double const entrance = energy(random);
+		out << Particles[row%4] << ',' << Organelles[row%2] << ',' << entrance << ',' << entrance*0.5 << ',' << cell(random)
+			<< ',' << row/4 + thread*nbRow << ',' << cell(random) << ",0,0,0," << row%2 << '\n';
+	}
+	for(std::size_t c = 0; c < nCell; ++c)
+		out << "EndOfRun,EndOfRun,0,0," << c << ",0,0," << energy(random) << ',' << energy(random) << ',' << energy(random) << ",2\n";
+}
+
+/// Analysis of the csv files
+Analysis ReadCsv(const std::vector<std::string>& files, std::size_t nCell) {
+	Analysis analysis(nCell);
+	for(auto const& file: files) {
+		std::ifstream in(file);
+		std::string line;
+		while(std::getline(in, line)) {
+			if(line.empty() || line[0] == '#')
+				continue;
+			std::istringstream row(line);
+			std::string particle;
+			std::string value;
+			std::getline(row, particle, ',');
+			std::getline(row, value, ',');  // emission organelle
+			double values[9];
+			for(double& v: values) {
+				std::getline(row, value, ',');
+				v = std::strtod(value.c_str(), nullptr);
+			}
+			auto const cell = static_cast<std::size_t>(values[2]);
+			if(particle == "EndOfRun")
+				analysis.dose[cell] += values[5];
+			else
+				analysis.deposited[cell] += values[0] - values[1];
+		}
+	}
+	return analysis;
+}
+
+/// Analysis of the mapped column table, counting its summaries in summaries
+Analysis ReadColumns(const std::string& file, std::size_t nCell, std::size_t& summaries) {
+	Analysis analysis(nCell);
+	Common::MappedColumnTable const table(file, false);
+	std::size_t const particle = table.Find("nameParticle");
+	auto const* names = table.values<std::uint32_t>(particle);
+	auto const* entrance = table.values<double>(table.Find("Ei"));
+	auto const* exit = table.values<double>(table.Find("Ef"));
+	auto const* cells = table.values<double>(table.Find("ID_Cell"));
+	auto const* dose = table.values<double>(table.Find("fEdepn"));
+	std::size_t const summary = table.Code(particle, "EndOfRun");
+	summaries = 0;
+	for(std::size_t row = 0; row < table.rowCount(); ++row) {
+		auto const cell = static_cast<std::size_t>(cells[row]);
+		if(names[row] == summary) {
+			analysis.dose[cell] += dose[row];
+			++summaries;
+		} else
+			analysis.deposited[cell] += entrance[row] - exit[row];
+	}
+	return analysis;
+}
+
+}
+
+int main(int argc, char** argv) {
+	zz::cfg::ArgParser argparser;
+
+	std::string output;
+	argparser.add_opt_value('o', "output", output, std::string("columnsBenchmark.csv"), "output file of the run", "file");
+	int nbThread = 4;
+	argparser.add_opt_value('t', "thread", nbThread, 4, "number of threads of the run", "int");
+	long nbRow = 500000;
+	argparser.add_opt_value('r', "row", nbRow, 500000L, "event rows per thread", "long");
+	long nbCell = 1000;
+	argparser.add_opt_value('c', "cell", nbCell, 1000L, "number of cells", "long");
+
+	argparser.parse(argc, argv);
+
+	if(argparser.count_error() > 0) {
+		std::cout << argparser.get_error() << std::endl;
+		std::cout << argparser.get_help() << std::endl;
+		return 1;
+	}
+
+	auto const nCell = static_cast<std::size_t>(nbCell);
+	std::mt19937_64 random(42);
+	std::vector<std::string> files;
+	double csvSize = 0.;
+	for(int thread = 0; thread < nbThread; ++thread) {
+		std::string const ntupleFile = output.substr(0, output.rfind('.')) + "_nt_cpop.csv";
+		files.push_back(Common::OutputMerger::ThreadFileName(ntupleFile, thread));
+		WriteCsv(files.back(), static_cast<unsigned>(thread), nbRow, nCell, random);
+		csvSize += Megabytes(files.back());
+	}
+
+	auto start = Clock::now();
+	auto const tables = Common::OutputMerger::WriteColumns(files, output);
+	double const conversion = Seconds(start);
+	double const columnsSize = Megabytes(tables.front());
+
+	start = Clock::now();
+	Analysis const csv = ReadCsv(files, nCell);
+	double const csvTime = Seconds(start);
+
+	start = Clock::now();
+	std::size_t summaries = 0;
+	Analysis const columns = ReadColumns(tables.front(), nCell, summaries);
+	double const columnsTime = Seconds(start);
+
+	std::cout << nbThread << " threads, " << nbRow << " rows per thread, " << nCell << " cells" << std::endl;
+	std::cout << "conversion " << conversion << " s" << std::endl;
+	std::cout << std::setw(8) << "format" << std::setw(12) << "size (MB)" << std::setw(14) << "analysis (s)" << std::endl;
+	std::cout << std::setw(8) << "csv" << std::setw(12) << csvSize << std::setw(14) << csvTime << std::endl;
+	std::cout << std::setw(8) << "columns" << std::setw(12) << columnsSize << std::setw(14) << columnsTime << std::endl;
+
+	for(auto const& file: files)
+		std::remove(file.c_str());
+	for(auto const& table: tables)
+		std::remove(table.c_str());
+
+	bool const summed = summaries == nCell;
+	if(!summed)
+		std::cout << "SUMMARIES NOT SUMMED: " << summaries << " EndOfRun rows for " << nCell << " cells" << std::endl;
+	bool const passed = csv == columns;
+	std::cout << (passed ? "same analysis" : "ANALYSES DIFFER") << std::endl;
+	return passed && summed ? 0 : 1;
+}
@@ -0,0 +1,287 @@
+// Figure of merit of the energy scored in a few observed cells, analog and with the weight window of the
+// radiation examples (see ImportanceMap.hh and ImportanceSampling.hh).
+//
+// The transport is a toy standing in for Geant4, so that the benchmark runs without it: particles go in
+// straight lines between interactions, exponentially distributed, where they deposit a fraction of their
+// energy and change direction. Two cases bracket the examples: gammas, emitted uniformly in the spheroid,
+// of mean free path larger than the spheroid, scattered isotropically (UniformRadiation), and electrons,
+// emitted from the membranes of a tenth of the cells, of mean free path much smaller than a cell, slowly
+// deflected (NanoparticleRadiation). The cells are on a jittered lattice filling the spheroid, nCell per
+// region are observed as /cpop/importance/observe does, and the same events are run analog, then with the
+// weight window applied at the end of every step. The figure of merit is 1/(R^2 T), R^2 being the mean
+// squared relative error of the energy per event of the observed cells reached and T the time of the run.
+// The exit code is 1 if the mean energies of the observed cells of the two runs differ by more than 5
+// standard deviations.
+
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// CPOP headers
+#include <cReader/zupply.hpp>
+
+#include "CellLocator.hh"
+#include "ImportanceMap.hh"
+#include "CellExportMesh.hh"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Point = std::array<double, 3>;
+
+double Seconds(Clock::time_point start) {
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+/// Transport of a case, lengths in um and energies relative to the energy of the source
+struct Transport {
+	double meanFreePath;
+	double depositFraction;  // of the energy, at each interaction
+	double deflection;       // 0 keeps the direction, large values scatter isotropically
+	double cutoff;           // energy below which the particle deposits all its energy
+	bool membraneSource;     // emitted from the membranes of the source cells, uniformly in the spheroid otherwise
+};
+
+struct Particle {
+	Point position;
+	Point direction;
+	double energy;
+	double weight;
+};
+
+/// Cells of radius cellRadius on a jittered cubic lattice filling a sphere of spheroidRadius
+struct Population {
+	std::vector<double> x, y, z, radius;
+	double spheroidRadius;
+
+	Population(double spheroidRadius_, double cellRadius, std::mt19937_64& random): spheroidRadius(spheroidRadius_) {
+		std::uniform_real_distribution<double> jitter(-0.1*cellRadius, 0.1*cellRadius);
+		double const spacing = 2.2*cellRadius;
+		int const n = static_cast<int>(spheroidRadius/spacing);
+		for(int i = -n; i <= n; ++i)
+			for(int j = -n; j <= n; ++j)
+				for(int k = -n; k <= n; ++k) {
+					Point const c{i*spacing + jitter(random), j*spacing + jitter(random), k*spacing + jitter(random)};
+					if(std::hypot(c[0], c[1], c[2]) + cellRadius > spheroidRadius)
+						continue;
+					x.push_back(c[0]);
+					y.push_back(c[1]);
+					z.push_back(c[2]);
+					radius.push_back(cellRadius);
+				}
+	}
+
+	[[nodiscard]] Common::CellArrays cells() const {
+		Common::CellArrays cells;
+		cells.count = x.size();
+		cells.x = x.data();
+		cells.y = y.data();
+		cells.z = z.data();
+		cells.radius = radius.data();
+		return cells;
+	}
+};
+
+Point Isotropic(std::mt19937_64& random) {
+	std::uniform_real_distribution<double> uniform(-1., 1.);
+	double const cosTheta = uniform(random);
+	double const phi = M_PI*uniform(random);
+	double const sinTheta = std::sqrt(1. - cosTheta*cosTheta);
+	return {sinTheta*std::cos(phi), sinTheta*std::sin(phi), cosTheta};
+}
+
+/// Energy per event of the observed cells
+struct Tally {
+	std::vector<double> sum;
+	std::vector<double> sum2;
+	std::vector<double> event;
+
+	explicit Tally(std::size_t observed): sum(observed, 0.), sum2(observed, 0.), event(observed, 0.) {}
+
+	void EndEvent() {
+		for(std::size_t i = 0; i < event.size(); ++i) {
+			sum[i] += event[i];
+			sum2[i] += event[i]*event[i];
+			event[i] = 0.;
+		}
+	}
+};
+
+struct Result {
+	double seconds;
+	double relativeError2;
+	std::size_t reached;
+	double total;     // mean energy per event of all the observed cells
+	double totalSd;   // its standard deviation
+	long steps;
+};
+
+/// Run nbEvent events, with the weight window of map if it is enabled
+Result Run(const Population& population, const Common::CellLocator& locator, const std::vector<int>& slot,
+	std::size_t observed, const std::vector<std::size_t>& sources, const Transport& transport,
+	const Common::ImportanceMap& map, long nbEvent, std::uint64_t seed)
+{
+	std::mt19937_64 random(seed);
+	std::uniform_real_distribution<double> uniform(0., 1.);
+	Tally tally(observed);
+	double total = 0.;
+	double total2 = 0.;
+	long steps = 0;
+	std::vector<Particle> stack;
+	std::size_t hint = Common::CellLocator::None;
+
+	auto const start = Clock::now();
+	for(long e = 0; e < nbEvent; ++e) {
+		Particle source{{0., 0., 0.}, Isotropic(random), 1., 1.};
+		if(transport.membraneSource) {
+			std::size_t const cell = sources[static_cast<std::size_t>(uniform(random)*sources.size())];
+			Point const normal = Isotropic(random);
+			double const r = population.radius[cell];
+			source.position = {population.x[cell] + r*normal[0], population.y[cell] + r*normal[1], population.z[cell] + r*normal[2]};
+		} else {
+			do {
+				for(auto& c: source.position)
+					c = population.spheroidRadius*(2.*uniform(random) - 1.);
+			} while(std::hypot(source.position[0], source.position[1], source.position[2]) > population.spheroidRadius);
+		}
+		stack.push_back(source);
+
+		while(!stack.empty()) {
+			Particle p = stack.back();
+			stack.pop_back();
+			for(;;) {
+				++steps;
+				double const length = -transport.meanFreePath*std::log(1. - uniform(random));
+				for(int axis = 0; axis < 3; ++axis)
+					p.position[axis] += length*p.direction[axis];
+				if(std::hypot(p.position[0], p.position[1], p.position[2]) > population.spheroidRadius)
+					break;
+
+				double deposit = transport.depositFraction*p.energy;
+				p.energy -= deposit;
+				bool const absorbed = p.energy < transport.cutoff;
+				if(absorbed)
+					deposit += p.energy;
+				std::size_t const cell = locator.Locate(p.position, hint);
+				if(cell != Common::CellLocator::None && slot[cell] >= 0)
+					tally.event[slot[cell]] += deposit*p.weight;
+				if(absorbed)
+					break;
+
+				Point const kick = Isotropic(random);
+				double norm = 0.;
+				for(int axis = 0; axis < 3; ++axis) {
+					p.direction[axis] += transport.deflection*kick[axis];
+					norm += p.direction[axis]*p.direction[axis];
+				}
+				for(auto& d: p.direction)
+					d /= std::sqrt(norm);
+
+				// weight window at the end of the step
+				if(map.enabled()) {
+					auto const outcome = Common::WeightWindow::Apply(p.weight, map.Importance(p.position), uniform(random));
+					if(outcome.count == 0)
+						break;
+					p.weight = outcome.weight;
+					for(int copy = 1; copy < outcome.count; ++copy)
+						stack.push_back(p);
+				}
+			}
+		}
+
+		double eventTotal = 0.;
+		for(double const energy: tally.event)
+			eventTotal += energy;
+		total += eventTotal;
+		total2 += eventTotal*eventTotal;
+		tally.EndEvent();
+	}
+
+	Result result{Seconds(start), 0., 0, total/nbEvent, 0., steps};
+	double const variance = std::max(0., total2/nbEvent - result.total*result.total)/(nbEvent - 1);
+	result.totalSd = std::sqrt(variance);
+	for(std::size_t i = 0; i < observed; ++i) {
+		if(!(tally.sum[i] > 0.))
+			continue;
+		double const mean = tally.sum[i]/nbEvent;
+		double const cellVariance = std::max(0., tally.sum2[i]/nbEvent - mean*mean)/(nbEvent - 1);
+		result.relativeError2 += cellVariance/(mean*mean);
+		++result.reached;
+	}
+	if(result.reached > 0)
+		result.relativeError2 /= result.reached;
+	return result;
+}
+
+}
+
+int main(int argc, char** argv) {
+	zz::cfg::ArgParser argparser;
+
+	std::string particle;
+	argparser.add_opt_value('p', "particle", particle, std::string("gamma"), "transport case, gamma or electron", "name");
+	long nbEvent = 200000;
+	argparser.add_opt_value('e', "event", nbEvent, 200000L, "events of each run", "long");
+	long nbCell = 10;
+	argparser.add_opt_value('c', "cell", nbCell, 10L, "observed cells per region", "long");
+	int levels = 4;
+	argparser.add_opt_value('l', "levels", levels, 4, "zones of importance around the observed cells", "int");
+	double zoneWidth = 5.;
+	argparser.add_opt_value('w', "width", zoneWidth, 5., "width of a zone (um)", "double");
+
+	argparser.parse(argc, argv);
+
+	if(argparser.count_error() > 0 || (particle != "gamma" && particle != "electron")) {
+		std::cout << argparser.get_error() << std::endl;
+		std::cout << argparser.get_help() << std::endl;
+		return 1;
+	}
+
+	Transport const transport = particle == "gamma" ? Transport{300., 0.3, 10., 0.01, false} : Transport{1., 0.05, 0.3, 0.05, true};
+
+	std::mt19937_64 random(42);
+	Population const population(95., 5., random);
+	auto const cells = population.cells();
+	Common::CellLocator const locator(cells, {}, 1.);
+
+	double const center[3] = {0., 0., 0.};
+	auto const regions = Common::CellRegions(cells, center, population.spheroidRadius, 0.25, 0.75);
+	auto const observed = Common::SampleCellsPerRegion(regions, static_cast<std::size_t>(nbCell), 1);
+	std::vector<int> slot(cells.count, -1);
+	std::vector<Common::ImportanceMap::Point> centers;
+	std::vector<double> radii;
+	for(std::size_t k = 0; k < observed.size(); ++k) {
+		slot[observed[k]] = static_cast<int>(k);
+		centers.push_back(locator.center(observed[k]));
+		radii.push_back(locator.radius(observed[k]));
+	}
+	std::vector<std::size_t> sources;
+	for(std::size_t i = 0; i < cells.count; i += 10)
+		sources.push_back(i);
+
+	Common::ImportanceMap const analogMap;
+	Common::ImportanceMap const map(centers, radii, zoneWidth, levels);
+	Result const analog = Run(population, locator, slot, observed.size(), sources, transport, analogMap, nbEvent, 7);
+	Result const biased = Run(population, locator, slot, observed.size(), sources, transport, map, nbEvent, 7);
+
+	std::cout << particle << ": " << cells.count << " cells, " << observed.size() << " observed, " << nbEvent << " events, "
+		<< levels << " zones of " << zoneWidth << " um" << std::endl;
+	std::cout << std::setw(8) << "run" << std::setw(10) << "time (s)" << std::setw(12) << "steps" << std::setw(10) << "reached"
+		<< std::setw(12) << "R^2" << std::setw(14) << "FOM (1/s)" << std::setw(14) << "energy" << std::endl;
+	for(auto const& [name, result]: {std::make_pair("analog", analog), std::make_pair("biased", biased)})
+		std::cout << std::setw(8) << name << std::setw(10) << result.seconds << std::setw(12) << result.steps << std::setw(10)
+			<< result.reached << std::setw(12) << result.relativeError2 << std::setw(14)
+			<< 1./(result.relativeError2*result.seconds) << std::setw(14) << result.total << std::endl;
+
+	double const gain = analog.relativeError2*analog.seconds/(biased.relativeError2*biased.seconds);
+	std::cout << "figure of merit gain " << gain << std::endl;
+
+	double const deviation = std::abs(analog.total - biased.total)/std::hypot(analog.totalSd, biased.totalSd);
+	bool const passed = deviation < 5.;
+	std::cout << (passed ? "same mean energy" : "MEAN ENERGIES DIFFER") << " (" << deviation << " standard deviations)" << std::endl;
+	return passed ? 0 : 1;
+}
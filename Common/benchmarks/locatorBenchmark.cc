@@ -0,0 +1,177 @@
+// Lookups per second of the point-in-cell locator (see CellLocator.hh).
+//
+// The points are the steps of straight tracks of a given step length crossing the population, as
+// the steps of the tracking, or points drawn uniformly in its bounding box. Each set is located by
+// a brute force search over the cells (on the first points only), by the grid alone, and by the grid
+// with the hint of the previous step, on one thread then on nbThread threads (one hint per thread).
+// The results of the grid and of the hint are checked against the brute force and against each other.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+// CPOP headers
+#include <cReader/zupply.hpp>
+
+#include "CellLocator.hh"
+#include "ParallelFor.hh"
+#include "PopulationBinary.hh"
+#include "PopulationXml.hh"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Point = Common::CellLocator::Point;
+
+double Seconds(Clock::time_point start) {
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+std::size_t BruteForce(const Common::CellArrays& cells, const Point& p) {
+	std::size_t found = Common::CellLocator::None;
+	double best = 0.;
+	for(std::size_t i = 0; i < cells.count; ++i) {
+		double const dx = p[0] - cells.x[i];
+		double const dy = p[1] - cells.y[i];
+		double const dz = p[2] - cells.z[i];
+		double const power = dx*dx + dy*dy + dz*dz - cells.radius[i]*cells.radius[i];
+		if(power < 0. && (found == Common::CellLocator::None || power < best)) {
+			found = i;
+			best = power;
+		}
+	}
+	return found;
+}
+
+/// Locate every point, the hint being kept along the chunk of each thread
+std::vector<std::size_t> LocateAll(const Common::CellLocator& locator, const std::vector<Point>& points, unsigned nThread, bool hint, double& time) {
+	std::vector<std::size_t> cells(points.size());
+	auto const start = Clock::now();
+	Common::ParallelFor(points.size(), nThread, [&](std::size_t begin, std::size_t end, unsigned) {
+		std::size_t previous = Common::CellLocator::None;
+		for(std::size_t i = begin; i < end; ++i)
+			cells[i] = hint ? locator.Locate(points[i], previous) : locator.Locate(points[i]);
+	});
+	time = Seconds(start);
+	return cells;
+}
+
+}
+
+int main(int argc, char** argv) {
+	zz::cfg::ArgParser argparser;
+
+	std::string input;
+	argparser.add_opt_value('i', "input", input, std::string(""), "population file (xml or binary)", "file").require();
+	int nbThread = 0;
+	argparser.add_opt_value('t', "thread", nbThread, 0, "number of threads (0 for all of them)", "int");
+	long nbLookup = 10000000;
+	argparser.add_opt_value('n', "lookup", nbLookup, 10000000L, "number of lookups per set", "long");
+	double stepLength = 1.;
+	argparser.add_opt_value('s', "step", stepLength, 1., "step length of the tracks (population unit)", "double");
+	long nbBrute = 10000;
+	argparser.add_opt_value('b', "brute", nbBrute, 10000L, "lookups checked by brute force", "long");
+
+	argparser.parse(argc, argv);
+
+	if(argparser.count_error() > 0) {
+		std::cout << argparser.get_error() << std::endl;
+		std::cout << argparser.get_help() << std::endl;
+		return 1;
+	}
+
+	Common::PopulationData population;
+	if(Common::IsPopulationBinary(input))
+		population = Common::MappedPopulation(input).toData();
+	else
+		population = Common::ReadPopulationXml(input);
+	auto const cells = Common::MakeCellArrays(population);
+	auto const nucleusRadius = Common::CellLocator::NucleusRadii(cells.count, population.nucleusOffset.data(), population.nucleusRadius.data());
+
+	auto start = Clock::now();
+	Common::CellLocator const locator(cells, nucleusRadius, 1.);
+	std::cout << cells.count << " cells, locator built in " << Seconds(start) << " s" << std::endl;
+
+	// bounding box of the cells
+	Point lo{cells.x[0], cells.y[0], cells.z[0]};
+	Point hi = lo;
+	for(std::size_t i = 0; i < cells.count; ++i) {
+		Point const c{cells.x[i], cells.y[i], cells.z[i]};
+		for(int axis = 0; axis < 3; ++axis) {
+			lo[axis] = std::min(lo[axis], c[axis] - cells.radius[i]);
+			hi[axis] = std::max(hi[axis], c[axis] + cells.radius[i]);
+		}
+	}
+
+	std::mt19937_64 generator(42);
+	std::uniform_real_distribution<double> uniform(0., 1.);
+	std::normal_distribution<double> normal;
+	auto const inBox = [&]() {
+		Point p{};
+		for(int axis = 0; axis < 3; ++axis)
+			p[axis] = lo[axis] + uniform(generator)*(hi[axis] - lo[axis]);
+		return p;
+	};
+
+	std::vector<Point> tracks;
+	tracks.reserve(nbLookup);
+	while(static_cast<long>(tracks.size()) < nbLookup) {
+		Point p = inBox();
+		Point direction{normal(generator), normal(generator), normal(generator)};
+		double const norm = std::sqrt(direction[0]*direction[0] + direction[1]*direction[1] + direction[2]*direction[2]);
+		auto const inside = [&]() {
+			for(int axis = 0; axis < 3; ++axis)
+				if(p[axis] < lo[axis] || p[axis] > hi[axis])
+					return false;
+			return true;
+		};
+		for(; inside() && static_cast<long>(tracks.size()) < nbLookup; tracks.push_back(p))
+			for(int axis = 0; axis < 3; ++axis)
+				p[axis] += direction[axis]/norm*stepLength;
+	}
+
+	std::vector<Point> random(nbLookup);
+	for(auto& p: random)
+		p = inBox();
+
+	unsigned const maxThread = Common::ResolveThreadCount(nbThread);
+	std::cout << std::setw(8) << "points" << std::setw(14) << "method" << std::setw(10) << "nbThread"
+		<< std::setw(16) << "lookups/s" << std::setw(12) << "in cells" << std::setw(12) << "identical" << std::endl;
+
+	for(auto const* set: {&tracks, &random}) {
+		auto const& points = *set;
+		std::string const name = set == &tracks ? "tracks" : "random";
+
+		std::size_t const nbChecked = std::min<std::size_t>(points.size(), std::max(0L, nbBrute));
+		std::vector<std::size_t> brute(nbChecked);
+		start = Clock::now();
+		for(std::size_t i = 0; i < nbChecked; ++i)
+			brute[i] = BruteForce(cells, points[i]);
+		if(nbChecked > 0)
+			std::cout << std::setw(8) << name << std::setw(14) << "brute force" << std::setw(10) << 1
+				<< std::setw(16) << nbChecked/Seconds(start) << std::endl;
+
+		std::vector<std::size_t> reference;
+		for(bool const hint: {false, true}) {
+			for(unsigned const nThread: {1u, maxThread}) {
+				double time = 0.;
+				auto const located = LocateAll(locator, points, nThread, hint, time);
+				if(reference.empty())
+					reference = located;
+
+				bool identical = located == reference;
+				for(std::size_t i = 0; i < nbChecked; ++i)
+					identical = identical && located[i] == brute[i];
+				std::size_t const inCells = points.size() - std::count(std::begin(located), std::end(located), Common::CellLocator::None);
+
+				std::cout << std::setw(8) << name << std::setw(14) << (hint ? "grid + hint" : "grid") << std::setw(10) << nThread
+					<< std::setw(16) << points.size()/time << std::setw(12) << inCells << std::setw(12) << (identical ? "yes" : "NO") << std::endl;
+				if(maxThread == 1)
+					break;
+			}
+		}
+	}
+}
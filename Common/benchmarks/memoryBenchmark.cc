@@ -0,0 +1,114 @@
+// Resident memory added per worker by the scoring of the cells (see MemoryReport.hh and CellDoseScorer.hh).
+//
+// The population is read and its locator built once, as by the master of a run, then workers are added
+// up to nbThread, doubling their number: each one gets its own tally and scores nbStep steps, located
+// with the shared locator, in events of 100 steps. The tallies are kept, so that the resident memory after
+// each step is that of a run on as many workers, the Geant4 and CPOP state of the workers apart. The memory
+// added per worker is the slope of the resident memory against the number of workers.
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+// CPOP headers
+#include <cReader/zupply.hpp>
+
+#include "CellDoseScorer.hh"
+#include "CellLocator.hh"
+#include "MemoryReport.hh"
+#include "ParallelFor.hh"
+#include "PopulationBinary.hh"
+#include "PopulationXml.hh"
+
+namespace {
+
+constexpr double MB = 1024.*1024.;
+
+constexpr long StepsPerEvent = 100;
+
+}
+
+int main(int argc, char** argv) {
+	zz::cfg::ArgParser argparser;
+
+	std::string input;
+	argparser.add_opt_value('i', "input", input, std::string(""), "population file (xml or binary)", "file").require();
+	int nbThread = 64;
+	argparser.add_opt_value('t', "thread", nbThread, 64, "largest number of workers", "int");
+	long nbStep = 1000000;
+	argparser.add_opt_value('n', "step", nbStep, 1000000L, "steps scored per worker", "long");
+
+	argparser.parse(argc, argv);
+
+	if(argparser.count_error() > 0) {
+		std::cout << argparser.get_error() << std::endl;
+		std::cout << argparser.get_help() << std::endl;
+		return 1;
+	}
+
+	double const initial = Common::ReadMemoryUsage().resident;
+
+	Common::PopulationData population;
+	if(Common::IsPopulationBinary(input))
+		population = Common::MappedPopulation(input).toData();
+	else
+		population = Common::ReadPopulationXml(input);
+	auto const cells = Common::MakeCellArrays(population);
+	Common::CellLocator const locator(cells, Common::CellLocator::NucleusRadii(cells.count, population.nucleusOffset.data(),
+		population.nucleusRadius.data()), 1.);
+	double const shared = Common::ReadMemoryUsage().resident;
+
+	// bounding box of the cells
+	Common::CellLocator::Point lo{cells.x[0], cells.y[0], cells.z[0]};
+	Common::CellLocator::Point hi = lo;
+	for(std::size_t i = 0; i < cells.count; ++i) {
+		Common::CellLocator::Point const c{cells.x[i], cells.y[i], cells.z[i]};
+		for(int axis = 0; axis < 3; ++axis) {
+			lo[axis] = std::min(lo[axis], c[axis] - cells.radius[i]);
+			hi[axis] = std::max(hi[axis], c[axis] + cells.radius[i]);
+		}
+	}
+
+	std::cout << cells.count << " cells, population and locator " << (shared - initial)/MB << " MB" << std::endl;
+	std::cout << std::setw(10) << "workers" << std::setw(14) << "resident (MB)" << std::setw(12) << "added (MB)"
+		<< std::setw(18) << "per worker (MB)" << std::endl;
+
+	std::vector<std::unique_ptr<Common::CellDoseTally>> tallies;
+	for(int workers = 1;; workers = std::min(2*workers, nbThread)) {
+		std::size_t const first = tallies.size();
+		while(tallies.size() < static_cast<std::size_t>(workers))
+			tallies.push_back(std::make_unique<Common::CellDoseTally>());
+
+		// the new workers score concurrently, as those of a run
+		Common::ParallelFor(tallies.size() - first, Common::ResolveThreadCount(0), [&](std::size_t begin, std::size_t end, unsigned) {
+			for(std::size_t t = first + begin; t < first + end; ++t) {
+				auto& tally = *tallies[t];
+				tally.Resize(locator.size());
+				std::mt19937_64 generator(t);
+				std::uniform_real_distribution<double> uniform(0., 1.);
+				for(long step = 0; step < nbStep; ++step) {
+					if(step%StepsPerEvent == 0) {
+						tally.EndEvent();
+						tally.event = step/StepsPerEvent;
+					}
+					Common::CellLocator::Point p{};
+					for(int axis = 0; axis < 3; ++axis)
+						p[axis] = lo[axis] + uniform(generator)*(hi[axis] - lo[axis]);
+					std::size_t const cell = locator.Locate(p, tally.hint);
+					if(cell != Common::CellLocator::None)
+						tally.Deposit(cell, locator.InNucleus(cell, p), 1.);
+				}
+				tally.EndEvent();
+			}
+		});
+
+		double const resident = Common::ReadMemoryUsage().resident;
+		std::cout << std::setw(10) << workers << std::setw(14) << resident/MB << std::setw(12) << (resident - shared)/MB
+			<< std::setw(18) << (resident - shared)/MB/workers << std::endl;
+		if(workers >= nbThread)
+			break;
+	}
+}
@@ -0,0 +1,74 @@
+// Scaling of the export mesher (see CellExportMesh.hh) with the number of threads.
+//
+// The population (CPOP xml or binary) is meshed with 1 to nbThread threads; for each run it prints
+// the wall time, the speedup over one thread and whether the vertices are bit identical to the
+// single threaded mesh of the same mesher (CPOP's Round_Cell_Tesselation is neither run nor compared).
+
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+// CPOP headers
+#include <cReader/zupply.hpp>
+
+#include "ParallelFor.hh"
+#include "PopulationBinary.hh"
+#include "PopulationXml.hh"
+#include "CellExportMesh.hh"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double Seconds(Clock::time_point start) {
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+}
+
+int main(int argc, char** argv) {
+	zz::cfg::ArgParser argparser;
+
+	std::string input;
+	argparser.add_opt_value('i', "input", input, std::string(""), "population file (xml or binary)", "file").require();
+	int nbThread = 0;
+	argparser.add_opt_value('t', "thread", nbThread, 0, "maximum number of threads (0 for all of them)", "int");
+	int nbFacet = 50;
+	argparser.add_opt_value('f', "facet", nbFacet, 50, "maximum number of facets per cell", "int");
+
+	argparser.parse(argc, argv);
+
+	if(argparser.count_error() > 0) {
+		std::cout << argparser.get_error() << std::endl;
+		std::cout << argparser.get_help() << std::endl;
+		return 1;
+	}
+
+	Common::PopulationData population;
+	if(Common::IsPopulationBinary(input))
+		population = Common::MappedPopulation(input).toData();
+	else
+		population = Common::ReadPopulationXml(input);
+	auto const cells = Common::MakeCellArrays(population);
+
+	std::cout << cells.count << " cells" << std::endl;
+	std::cout << std::setw(10) << "nbThread" << std::setw(12) << "mesh (s)" << std::setw(10) << "speedup" << std::setw(12) << "identical" << std::endl;
+
+	std::vector<double> reference;
+	double referenceTime = 0.;
+	for(unsigned nThread = 1; nThread <= Common::ResolveThreadCount(nbThread); ++nThread) {
+		auto const start = Clock::now();
+		auto const vertices = Common::CellExportMesh(cells, nbFacet, static_cast<int>(nThread)).MeshAll();
+		double const time = Seconds(start);
+
+		if(nThread == 1) {
+			reference = vertices;
+			referenceTime = time;
+		}
+		bool const identical = std::memcmp(reference.data(), vertices.data(), vertices.size()*sizeof(double)) == 0;
+
+		std::cout << std::setw(10) << nThread << std::setw(12) << time << std::setw(10) << referenceTime/time
+			<< std::setw(12) << (identical ? "yes" : "NO") << std::endl;
+	}
+}
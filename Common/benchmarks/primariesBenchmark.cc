@@ -0,0 +1,201 @@
+// Time taken to record and to replay the primaries of a run, as text and as primary records (see PrimaryRecords.hh).
+//
+// nbThread threads generate nbEvent events each, of nbPrimary primaries, and record them: as text, one line per
+// primary written to a shared file under a lock, and through a PrimaryRecordWriter. The primaries of every event
+// are then replayed: the text file is parsed and the events looked up by line, the records file is mapped and
+// the events looked up in its index. The sums of the replayed values are compared, the exit code is 1 if they differ.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+
+// CPOP headers
+#include <cReader/zupply.hpp>
+
+#include "PrimaryRecords.hh"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double Seconds(Clock::time_point start) {
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+double Megabytes(const std::string& filename) {
+	struct stat status{};
+	return ::stat(filename.c_str(), &status) == 0 ? status.st_size/(1024.*1024.) : 0.;
+}
+
+/// Primaries of an event of a thread, the same for every format
+void Generate(std::int64_t event, int nbPrimary, std::vector<Common::PrimaryRecords::Record>& records) {
+	std::mt19937_64 random(static_cast<std::uint64_t>(event));
+	std::uniform_real_distribution<double> uniform(-1., 1.);
+	records.clear();
+	Common::PrimaryRecords::Record record{};
+	for(int p = 0; p < nbPrimary; ++p) {
+		record.position[0] = 100.*uniform(random);
+		record.position[1] = 100.*uniform(random);
+		record.position[2] = 100.*uniform(random);
+		double const z = uniform(random);
+		double const phi = M_PI*uniform(random);
+		double const r = std::sqrt(1. - z*z);
+		record.direction[0] = r*std::cos(phi);
+		record.direction[1] = r*std::sin(phi);
+		record.direction[2] = z;
+		record.energy = 5. + uniform(random);
+		record.event = event;
+		record.pdg = 1000020040;
+		record.vertex = static_cast<std::uint32_t>(p);
+		records.push_back(record);
+	}
+}
+
+/// Sum of the values of the primaries replayed
+double Sum(const Common::PrimaryRecords::Record& record) {
+	return record.position[0] + record.position[1] + record.position[2] + record.direction[0] + record.direction[1]
+		+ record.direction[2] + record.energy;
+}
+
+template<typename Record>
+void RunThreads(int nbThread, const Record& record) {
+	std::vector<std::thread> threads;
+	for(int thread = 0; thread < nbThread; ++thread)
+		threads.emplace_back(record, thread);
+	for(auto& thread: threads)
+		thread.join();
+}
+
+}
+
+int main(int argc, char** argv) {
+	zz::cfg::ArgParser argparser;
+
+	std::string output;
+	argparser.add_opt_value('o', "output", output, std::string("primariesBenchmark"), "stem of the files recorded", "file");
+	int nbThread = 4;
+	argparser.add_opt_value('t', "thread", nbThread, 4, "number of threads of the run", "int");
+	long nbEvent = 250000;
+	argparser.add_opt_value('e', "event", nbEvent, 250000L, "events per thread", "long");
+	int nbPrimary = 3;
+	argparser.add_opt_value('p', "primary", nbPrimary, 3, "primaries per event", "int");
+
+	argparser.parse(argc, argv);
+
+	if(argparser.count_error() > 0) {
+		std::cout << argparser.get_error() << std::endl;
+		std::cout << argparser.get_help() << std::endl;
+		return 1;
+	}
+
+	std::string const textFile = output + ".txt";
+	std::string const recordsFile = output + Common::PrimaryRecords::Extension;
+	std::int64_t const nbEvents = static_cast<std::int64_t>(nbThread)*nbEvent;
+
+	// record as text, the events of the threads interleaved in the file
+	auto start = Clock::now();
+	{
+		std::FILE* file = std::fopen(textFile.c_str(), "w");
+		std::mutex mutex;
+		RunThreads(nbThread, [&](int thread) {
+			std::vector<Common::PrimaryRecords::Record> records;
+			char line[256];
+			for(long e = 0; e < nbEvent; ++e) {
+				std::int64_t const event = thread*nbEvent + e;
+				Generate(event, nbPrimary, records);
+				std::lock_guard<std::mutex> lock(mutex);
+				for(auto const& r: records) {
+					std::snprintf(line, sizeof(line), "%lld %.17g %.17g %.17g %.17g %.17g %.17g %.17g\n", static_cast<long long>(event),
+						r.position[0], r.position[1], r.position[2], r.direction[0], r.direction[1], r.direction[2], r.energy);
+					std::fputs(line, file);
+				}
+			}
+		});
+		std::fclose(file);
+	}
+	double const textRecord = Seconds(start);
+
+	// record as primary records
+	start = Clock::now();
+	{
+		Common::PrimaryRecordWriter writer(recordsFile);
+		RunThreads(nbThread, [&](int thread) {
+			auto& buffer = writer.NewBuffer();
+			std::vector<Common::PrimaryRecords::Record> records;
+			for(long e = 0; e < nbEvent; ++e) {
+				std::int64_t const event = thread*nbEvent + e;
+				Generate(event, nbPrimary, records);
+				buffer.AddEvent(event, records.data(), records.size());
+			}
+		});
+		writer.Close();
+	}
+	double const recordsRecord = Seconds(start);
+
+	// replay the text: parse it, then look the events up
+	start = Clock::now();
+	double textSum = 0.;
+	{
+		std::vector<Common::PrimaryRecords::Record> records;
+		std::vector<std::size_t> first(static_cast<std::size_t>(nbEvents) + 1, 0);
+		std::ifstream in(textFile);
+		std::string line;
+		while(std::getline(in, line)) {
+			char* cursor = &line[0];
+			Common::PrimaryRecords::Record record{};
+			record.event = std::strtoll(cursor, &cursor, 10);
+			for(double* value: {&record.position[0], &record.position[1], &record.position[2], &record.direction[0],
+				&record.direction[1], &record.direction[2], &record.energy})
+				*value = std::strtod(cursor, &cursor);
+			records.push_back(record);
+			++first[static_cast<std::size_t>(record.event) + 1];
+		}
+		// the lines of an event are contiguous, but the events are not in order
+		for(std::size_t e = 1; e < first.size(); ++e)
+			first[e] += first[e - 1];
+		std::vector<Common::PrimaryRecords::Record> byEvent(records.size());
+		std::vector<std::size_t> next(first.begin(), first.end() - 1);
+		for(auto const& record: records)
+			byEvent[next[static_cast<std::size_t>(record.event)]++] = record;
+		for(std::int64_t event = 0; event < nbEvents; ++event)
+			for(std::size_t r = first[event]; r < first[event + 1]; ++r)
+				textSum += Sum(byEvent[r]);
+	}
+	double const textReplay = Seconds(start);
+
+	// replay the records: map them, then look the events up
+	start = Clock::now();
+	double recordsSum = 0.;
+	{
+		Common::MappedPrimaryRecords const records(recordsFile);
+		for(std::int64_t event = 0; event < nbEvents; ++event) {
+			auto const span = records.Find(event);
+			for(std::size_t r = 0; r < span.count; ++r)
+				recordsSum += Sum(span.records[r]);
+		}
+	}
+	double const recordsReplay = Seconds(start);
+
+	std::cout << nbThread << " threads, " << nbEvent << " events per thread, " << nbPrimary << " primaries per event" << std::endl;
+	std::cout << std::setw(8) << "format" << std::setw(12) << "size (MB)" << std::setw(12) << "record (s)" << std::setw(12) << "replay (s)" << std::endl;
+	std::cout << std::setw(8) << "text" << std::setw(12) << Megabytes(textFile) << std::setw(12) << textRecord << std::setw(12) << textReplay << std::endl;
+	std::cout << std::setw(8) << "records" << std::setw(12) << Megabytes(recordsFile) << std::setw(12) << recordsRecord << std::setw(12) << recordsReplay << std::endl;
+
+	std::remove(textFile.c_str());
+	std::remove(recordsFile.c_str());
+
+	bool const passed = std::abs(textSum - recordsSum) <= 1e-9*(1. + std::abs(textSum));
+	std::cout << (passed ? "same primaries" : "PRIMARIES DIFFER") << std::endl;
+	return passed ? 0 : 1;
+}
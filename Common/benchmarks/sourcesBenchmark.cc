@@ -0,0 +1,255 @@
+// Time of the placement of the sources of /cpop/source/init, serial with rejection against the parallel
+// rejection free placement of the radiation examples (see SourcePlacement.hh).
+//
+// The cells are on a jittered lattice filling a spheroid, with a nucleus of half their radius. The serial
+// placement draws each source as a loop over the sources would: a labelled cell of its region drawn again
+// while it is full, then a point of the bounding cube of the cell drawn again until it falls in the
+// organelle (the membranes being drawn as directions of the unit cube normalised). The parallel placement
+// runs on 1, 2, 4... up to nbThread threads. The placements of every number of threads must be identical,
+// every source must be in its organelle, and the sources of each region and of each cell must be those
+// asked for: the exit code is 1 otherwise.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// CPOP headers
+#include <cReader/zupply.hpp>
+
+#include "ParallelFor.hh"
+#include "CellExportMesh.hh"
+#include "SourcePlacement.hh"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double Seconds(Clock::time_point start) {
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+/// Cells of radius cellRadius on a jittered cubic lattice filling a sphere of spheroidRadius
+struct Population {
+	std::vector<double> x, y, z, radius, nucleus;
+	double spheroidRadius;
+
+	Population(double spheroidRadius_, double cellRadius, std::mt19937_64& random): spheroidRadius(spheroidRadius_) {
+		std::uniform_real_distribution<double> jitter(-0.1*cellRadius, 0.1*cellRadius);
+		double const spacing = 2.2*cellRadius;
+		int const n = static_cast<int>(spheroidRadius/spacing);
+		for(int i = -n; i <= n; ++i)
+			for(int j = -n; j <= n; ++j)
+				for(int k = -n; k <= n; ++k) {
+					double const c[3] = {i*spacing + jitter(random), j*spacing + jitter(random), k*spacing + jitter(random)};
+					if(std::hypot(c[0], c[1], c[2]) + cellRadius > spheroidRadius)
+						continue;
+					x.push_back(c[0]);
+					y.push_back(c[1]);
+					z.push_back(c[2]);
+					radius.push_back(cellRadius);
+					nucleus.push_back(0.5*cellRadius);
+				}
+	}
+
+	[[nodiscard]] Common::CellArrays cells() const {
+		Common::CellArrays cells;
+		cells.count = x.size();
+		cells.x = x.data();
+		cells.y = y.data();
+		cells.z = z.data();
+		cells.radius = radius.data();
+		return cells;
+	}
+};
+
+/// Placement of a loop over the sources, with rejection
+std::vector<Common::PlacedSource> PlaceSerial(const Population& population, const std::vector<std::uint8_t>& regions,
+	const Common::SourceSettings& settings, std::uint64_t seed)
+{
+	std::mt19937_64 random(seed);
+	std::uniform_real_distribution<double> uniform(0., 1.);
+	std::vector<std::uint64_t> counts(regions.size(), 0);
+	std::vector<Common::PlacedSource> sources;
+
+	double organelle[4];
+	double sum = 0.;
+	for(int k = 0; k < 4; ++k)
+		organelle[k] = sum += settings.distributionInCell[k];
+
+	for(std::uint8_t region = 0; region < 3; ++region) {
+		std::vector<std::size_t> cells;
+		for(std::size_t i = 0; i < regions.size(); ++i)
+			if(regions[i] == region)
+				cells.push_back(i);
+		std::shuffle(cells.begin(), cells.end(), random);
+		cells.resize(static_cast<std::size_t>(std::llround(settings.cellLabelingPercentagePerRegion[region]/100.*cells.size())));
+
+		for(std::uint64_t s = 0; s < settings.distributionInRegion[region]; ++s) {
+			std::size_t cell;
+			do {
+				cell = cells[static_cast<std::size_t>(uniform(random)*cells.size())];
+			} while(counts[cell] >= settings.maxSourcesPerCell[region]);
+			++counts[cell];
+
+			double const r = population.radius[cell];
+			double const rn = population.nucleus[cell];
+			double const o = uniform(random)*sum;
+			double p[3];
+			double d;
+			for(;;) {
+				for(double& c: p)
+					c = r*(2.*uniform(random) - 1.);
+				d = std::hypot(p[0], p[1], p[2]);
+				if(d > r || d == 0.)
+					continue;
+				if(o < organelle[0] || (o >= organelle[1] && o < organelle[2])) {
+					// on a membrane
+					double const scale = (o < organelle[0] ? r : rn)/d;
+					for(double& c: p)
+						c *= scale;
+					break;
+				}
+				if((o < organelle[1]) == (d < rn))
+					break;
+			}
+			Common::PlacedSource source{};
+			source.position[0] = static_cast<float>(population.x[cell] + p[0]);
+			source.position[1] = static_cast<float>(population.y[cell] + p[1]);
+			source.position[2] = static_cast<float>(population.z[cell] + p[2]);
+			source.cell = static_cast<std::uint32_t>(cell);
+			sources.push_back(source);
+		}
+	}
+	return sources;
+}
+
+/// Number of errors of the placement: sources outside their cell, their organelle or the limits of settings
+std::size_t Check(const Population& population, const std::vector<std::uint8_t>& regions, const Common::SourceSettings& settings,
+	const std::vector<Common::PlacedSource>& sources)
+{
+	std::size_t errors = 0;
+	std::vector<std::uint64_t> perCell(regions.size(), 0);
+	std::array<std::uint64_t, 3> perRegion{0, 0, 0};
+	bool const nucleusOnly = settings.distributionInCell[0] == 0. && settings.distributionInCell[2] == 0. && settings.distributionInCell[3] == 0.;
+	for(auto const& source: sources) {
+		std::size_t const cell = source.cell;
+		++perCell[cell];
+		++perRegion[regions[cell]];
+		double const d = std::hypot(source.position[0] - population.x[cell], source.position[1] - population.y[cell],
+			source.position[2] - population.z[cell]);
+		double const tolerance = 1e-4*population.radius[cell];
+		if(d > population.radius[cell] + tolerance || (nucleusOnly && d > population.nucleus[cell] + tolerance))
+			++errors;
+	}
+	for(int region = 0; region < 3; ++region)
+		if(perRegion[region] != settings.distributionInRegion[region])
+			++errors;
+	for(std::size_t i = 0; i < regions.size(); ++i)
+		if(perCell[i] > settings.maxSourcesPerCell[regions[i]])
+			++errors;
+	return errors;
+}
+
+}
+
+int main(int argc, char** argv) {
+	zz::cfg::ArgParser argparser;
+
+	int nbThread = 0;
+	argparser.add_opt_value('t', "thread", nbThread, 0, "number of threads (0 for all of them)", "int");
+	double spheroidRadius = 400.;
+	argparser.add_opt_value('r', "radius", spheroidRadius, 400., "radius of the spheroid (um), the cells being of 5 um", "double");
+	long nbSource = 10000000;
+	argparser.add_opt_value('s', "source", nbSource, 10000000L, "total number of sources, split evenly over the regions", "long");
+	long maxPerCell = 0;
+	argparser.add_opt_value('m', "max", maxPerCell, 0L, "maximum number of sources per cell (0 for no limit)", "long");
+	double labelling = 50.;
+	argparser.add_opt_value('l', "labelling", labelling, 50., "percentage of labelled cells in each region", "double");
+	std::string inCell;
+	argparser.add_opt_value('d', "distribution", inCell, std::string("0.25 0.25 0.25 0.25"),
+		"distribution in the cell: membrane nucleus nucleusMembrane cytoplasm", "\"m n nm c\"");
+
+	argparser.parse(argc, argv);
+
+	Common::SourceSettings settings;
+	std::istringstream distribution(inCell);
+	for(double& p: settings.distributionInCell)
+		distribution >> p;
+	if(argparser.count_error() > 0 || !distribution || nbSource < 0) {
+		std::cout << argparser.get_error() << std::endl;
+		std::cout << argparser.get_help() << std::endl;
+		return 1;
+	}
+
+	std::mt19937_64 random(42);
+	Population const population(spheroidRadius, 5., random);
+	auto const cells = population.cells();
+	double const center[3] = {0., 0., 0.};
+	auto const regions = Common::CellRegions(cells, center, population.spheroidRadius, 0.25, 0.75);
+
+	for(int region = 0; region < 3; ++region) {
+		settings.distributionInRegion[region] = static_cast<std::uint64_t>(nbSource)*(region + 1)/3 - static_cast<std::uint64_t>(nbSource)*region/3;
+		settings.maxSourcesPerCell[region] = maxPerCell > 0 ? static_cast<std::uint64_t>(maxPerCell) : Common::SourceSettings::NoLimit;
+		settings.cellLabelingPercentagePerRegion[region] = labelling;
+	}
+
+	std::cout << cells.count << " cells, " << nbSource << " sources" << std::endl;
+	std::cout << std::setw(12) << "placement" << std::setw(10) << "threads" << std::setw(12) << "time (s)"
+		<< std::setw(16) << "sources/s" << std::setw(10) << "errors" << std::endl;
+	auto const print = [&](const char* name, unsigned threads, double seconds, std::size_t errors) {
+		std::cout << std::setw(12) << name << std::setw(10) << threads << std::setw(12) << seconds << std::setw(16)
+			<< nbSource/seconds << std::setw(10) << errors << std::endl;
+	};
+
+	bool passed = true;
+	try {
+		// the samplers are built once for the population
+		auto start = Clock::now();
+		Common::SourcePlacement const placement(cells, population.nucleus, regions);
+		double const samplerTime = Seconds(start);
+		// throws if the labelled cells cannot hold the sources, which the serial loop would draw forever
+		(void)placement.Counts(settings);
+
+		start = Clock::now();
+		auto const serial = PlaceSerial(population, regions, settings, 7);
+		double const serialTime = Seconds(start);
+		std::size_t errors = Check(population, regions, settings, serial);
+		print("serial", 1, serialTime, errors);
+
+		std::vector<Common::PlacedSource> reference;
+		unsigned const maxThread = Common::ResolveThreadCount(nbThread);
+		double best = serialTime;
+		for(unsigned threads = 1;; threads = std::min(2*threads, maxThread)) {
+			start = Clock::now();
+			auto const sources = placement.Place(settings, static_cast<int>(threads));
+			double const time = Seconds(start);
+			errors = Check(population, regions, settings, sources);
+			if(reference.empty())
+				reference = sources;
+			else if(sources.size() != reference.size()
+				|| std::memcmp(sources.data(), reference.data(), sources.size()*sizeof(Common::PlacedSource)) != 0)
+				++errors;
+			print("parallel", threads, time, errors);
+			passed = passed && errors == 0;
+			best = std::min(best, time);
+			if(threads == maxThread)
+				break;
+		}
+		std::cout << "samplers built in " << samplerTime << " s, speedup " << serialTime/best << std::endl;
+		passed = passed && reference.size() == static_cast<std::size_t>(nbSource);
+	} catch(const std::exception& e) {
+		std::cout << e.what() << std::endl;
+		return 1;
+	}
+
+	std::cout << (passed ? "same placement on every number of threads" : "PLACEMENT ERRORS") << std::endl;
+	return passed ? 0 : 1;
+}
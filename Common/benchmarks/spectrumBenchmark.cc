@@ -0,0 +1,247 @@
+// Samples per second of the energy spectra of the primaries (see Spectrum.hh and AliasTable.hh).
+//
+// Each spectrum file is sampled by the alias table and by the binary search of its cumulative
+// intensities. The counts of each sampler per line or bin are compared with the intensities of
+// the file by a chi-square test, and the mean energies of both samplers with the one of the file.
+//
+// The energies drawn by CPOP itself are those of primaries recorded by /cpop/primaries/record in
+// a run without /cpop/primaries/spectrum (-r, the primaries of a source being selected by their
+// PDG code with -p). They are tested against the file the same way, and against the energies of
+// the alias table by a two-sample chi-square test. The time of CPOP's draw, spent within the
+// generation of the primaries, is printed by the runs of the examples (see PrimarySpectra.hh).
+//
+// The exit code is 1 if a test fails (p-value below 0.001 or a sampled energy outside of its bin).
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// CPOP headers
+#include <cReader/zupply.hpp>
+
+#include "PrimaryRecords.hh"
+#include "Spectrum.hh"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double Seconds(Clock::time_point start) {
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+/// Upper tail of the chi-square distribution of dof degrees of freedom (Wilson-Hilferty)
+double ChiSquarePValue(double chi2, std::size_t dof) {
+	double const k = static_cast<double>(dof);
+	double const z = (std::cbrt(chi2/k) - (1. - 2./(9.*k)))/std::sqrt(2./(9.*k));
+	return 0.5*std::erfc(z/std::sqrt(2.));
+}
+
+struct Result {
+	double rate;
+	double mean;
+	double chi2;
+	std::size_t dof;
+	double pValue;
+	std::size_t outside;
+	std::vector<long> counts;  // per row of the spectrum
+};
+
+/// Draw nbSample energies with sample(u1, u2), the rate being stored in rate
+template<class Sampler>
+std::vector<double> Draw(long nbSample, Sampler sample, double& rate) {
+	std::mt19937_64 generator(42);
+	std::uniform_real_distribution<double> uniform(0., 1.);
+
+	// the draws are timed apart from the counts, whose search would dominate
+	std::vector<double> energies(nbSample);
+	auto const start = Clock::now();
+	for(auto& energy: energies) {
+		double const u1 = uniform(generator);
+		double const u2 = uniform(generator);
+		energy = sample(u1, u2);
+	}
+	rate = nbSample/Seconds(start);
+	return energies;
+}
+
+/// Count the energies per row of the spectrum and test them against its intensities
+Result Test(const Common::Spectrum& spectrum, const std::vector<double>& energies) {
+	Result result{};
+	double const nbSample = energies.size();
+
+	// row of each energy: the last one whose low bound is below it
+	std::vector<double> lows(spectrum.size());
+	for(std::size_t i = 0; i < spectrum.size(); ++i)
+		lows[i] = spectrum.low(i);
+	result.counts.assign(spectrum.size(), 0);
+	for(double const energy: energies) {
+		auto const found = std::upper_bound(std::begin(lows), std::end(lows), energy);
+		std::size_t const i = found == std::begin(lows) ? 0 : found - std::begin(lows) - 1;
+		if(energy < spectrum.low(i) || energy > spectrum.high(i))
+			++result.outside;
+		++result.counts[i];
+		result.mean += energy/nbSample;
+	}
+
+	// rows expected less than 5 times are pooled
+	double pooledExpected = 0.;
+	double pooledCount = 0.;
+	std::size_t nbClass = 0;
+	for(std::size_t i = 0; i < spectrum.size(); ++i) {
+		double const expected = spectrum.probabilities()[i]*nbSample;
+		if(expected < 5.) {
+			pooledExpected += expected;
+			pooledCount += result.counts[i];
+			continue;
+		}
+		result.chi2 += (result.counts[i] - expected)*(result.counts[i] - expected)/expected;
+		++nbClass;
+	}
+	if(pooledExpected > 0.) {
+		result.chi2 += (pooledCount - pooledExpected)*(pooledCount - pooledExpected)/pooledExpected;
+		++nbClass;
+	}
+	result.dof = std::max<std::size_t>(nbClass, 2) - 1;
+	result.pValue = ChiSquarePValue(result.chi2, result.dof);
+	return result;
+}
+
+/// Two-sample chi-square test of the counts per row of two samplers, in result (chi2, dof, pValue)
+void TestSamples(const Result& a, const Result& b, Result& result) {
+	double na = 0., nb = 0.;
+	for(std::size_t i = 0; i < a.counts.size(); ++i) {
+		na += a.counts[i];
+		nb += b.counts[i];
+	}
+	double const ka = std::sqrt(nb/na);
+	double const kb = std::sqrt(na/nb);
+
+	// rows counted less than 10 times by both samplers are pooled
+	double pooledA = 0., pooledB = 0.;
+	std::size_t nbClass = 0;
+	result.chi2 = 0.;
+	auto const add = [&](double countA, double countB) {
+		result.chi2 += (ka*countA - kb*countB)*(ka*countA - kb*countB)/(countA + countB);
+		++nbClass;
+	};
+	for(std::size_t i = 0; i < a.counts.size(); ++i) {
+		if(a.counts[i] + b.counts[i] < 10) {
+			pooledA += a.counts[i];
+			pooledB += b.counts[i];
+			continue;
+		}
+		add(a.counts[i], b.counts[i]);
+	}
+	if(pooledA + pooledB > 0.)
+		add(pooledA, pooledB);
+	result.dof = std::max<std::size_t>(nbClass, 2) - 1;
+	result.pValue = ChiSquarePValue(result.chi2, result.dof);
+}
+
+/// Energies of the primaries of a records file having the PDG code pdg (all if 0)
+std::vector<double> RecordedEnergies(const std::string& filename, int pdg) {
+	Common::MappedPrimaryRecords const records(filename);
+	std::vector<double> energies;
+	for(std::size_t i = 0; i < records.recordCount(); ++i)
+		if(pdg == 0 || records.records()[i].pdg == pdg)
+			energies.push_back(records.records()[i].energy);
+	if(energies.empty())
+		throw std::runtime_error("no primary of PDG code " + std::to_string(pdg) + " in " + filename);
+	return energies;
+}
+
+}
+
+int main(int argc, char** argv) {
+	zz::cfg::ArgParser argparser;
+
+	std::string inputs;
+	argparser.add_opt_value('i', "input", inputs, std::string(""), "spectrum files, separated by spaces", "files").require();
+	std::string modeName = "auto";
+	argparser.add_opt_value('m', "mode", modeName, std::string("auto"), "auto, lines or histogram", "string");
+	long nbSample = 10000000;
+	argparser.add_opt_value('n', "sample", nbSample, 10000000L, "number of samples per sampler", "long");
+	std::string recordsFile;
+	argparser.add_opt_value('r', "records", recordsFile, std::string(""), "primaries recorded by CPOP without /cpop/primaries/spectrum (single spectrum)", "file");
+	int pdg = 0;
+	argparser.add_opt_value('p', "pdg", pdg, 0, "PDG code of the recorded primaries of the source (0 for all)", "int");
+
+	argparser.parse(argc, argv);
+
+	Common::Spectrum::Mode mode;
+	if(argparser.count_error() > 0 || !Common::Spectrum::ParseMode(modeName, mode) || nbSample <= 0) {
+		std::cout << argparser.get_error() << std::endl;
+		std::cout << argparser.get_help() << std::endl;
+		return 1;
+	}
+
+	std::cout << std::setw(28) << "spectrum" << std::setw(8) << "rows" << std::setw(12) << "sampler"
+		<< std::setw(16) << "samples/s" << std::setw(14) << "mean (MeV)" << std::setw(14) << "chi2/dof"
+		<< std::setw(12) << "p-value" << std::setw(10) << "outside" << std::endl;
+
+	bool passed = true;
+	std::istringstream filenames(inputs);
+	std::size_t nbSpectrum = 0;
+	for(std::string filename; filenames >> filename; ++nbSpectrum) {
+		if(nbSpectrum > 0 && !recordsFile.empty()) {
+			std::cout << "the recorded primaries are compared with a single spectrum" << std::endl;
+			return 1;
+		}
+		auto const spectrum = Common::Spectrum::Read(filename, mode);
+		double expectedMean = 0.;
+		for(std::size_t i = 0; i < spectrum.size(); ++i)
+			expectedMean += spectrum.probabilities()[i]*(spectrum.low(i) + spectrum.high(i))/2.;
+
+		std::string const name = filename.substr(filename.find_last_of('/') + 1);
+		std::string const rows = std::to_string(spectrum.size()) + (spectrum.histogram() ? "h" : "l");
+		std::cout << std::setw(28) << name << std::setw(8) << rows << std::setw(12) << "file"
+			<< std::setw(16) << "" << std::setw(14) << expectedMean << std::endl;
+
+		auto const print = [&](const std::string& sampler, const Result& result, bool withMean) {
+			passed = passed && result.pValue >= 1e-3 && result.outside == 0;
+			std::cout << std::setw(28) << name << std::setw(8) << rows << std::setw(12) << sampler;
+			if(result.rate > 0.)
+				std::cout << std::setw(16) << result.rate;
+			else
+				std::cout << std::setw(16) << "";
+			if(withMean)
+				std::cout << std::setw(14) << result.mean;
+			else
+				std::cout << std::setw(14) << "";
+			std::cout << std::setw(14) << result.chi2/result.dof << std::setw(12) << result.pValue << std::setw(10) << result.outside << std::endl;
+		};
+
+		double rate = 0.;
+		Result search = Test(spectrum, Draw(nbSample, [&](double u1, double u2) { return spectrum.SampleInverse(u1, u2); }, rate));
+		search.rate = rate;
+		print("search", search, true);
+		Result alias = Test(spectrum, Draw(nbSample, [&](double u1, double u2) { return spectrum.Sample(u1, u2); }, rate));
+		alias.rate = rate;
+		print("alias", alias, true);
+
+		if(!recordsFile.empty()) {
+			try {
+				Result cpop = Test(spectrum, RecordedEnergies(recordsFile, pdg));
+				print("cpop", cpop, true);
+				// CPOP's draw against the alias table replacing it
+				Result versus{};
+				TestSamples(alias, cpop, versus);
+				print("alias/cpop", versus, false);
+			} catch(const std::exception& e) {
+				std::cout << e.what() << std::endl;
+				return 1;
+			}
+		}
+	}
+
+	std::cout << (passed ? "samplers consistent with the spectra" : "SAMPLERS NOT CONSISTENT WITH THE SPECTRA") << std::endl;
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,181 @@
+// Time spent by the threads of a run writing their records (see AsyncWriter.hh).
+//
+// nbThread threads emulate the events of a run: each event takes some work (the tracking), then
+// formats rows (the records of the event). The rows are written either by the threads themselves,
+// to a file shared under a mutex (the writes on the path of the events), or by an AsyncWriter,
+// with the Block and the Drop policies. The time the threads spend writing (or waiting for a free
+// slot) is reported with the counters of the writer, and the files are checked to hold the rows of
+// every thread in order (Block) or a subset of them (Drop).
+
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+// CPOP headers
+#include <cReader/zupply.hpp>
+
+#include "AsyncWriter.hh"
+#include "ParallelFor.hh"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double Seconds(Clock::time_point start) {
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+/// Work of the tracking of an event, about n floating point operations
+double Track(long n, double seed) {
+	double x = seed;
+	for(long i = 0; i < n; ++i)
+		x = x*0.999999 + 1e-7;
+	return x;
+}
+
+/// Append the rows of an event of a thread, the row index being the third column, value the result of its tracking
+void FormatEvent(std::string& rows, unsigned thread, long event, long nbRow, long& row, double value) {
+	char line[96];
+	for(long r = 0; r < nbRow; ++r, ++row) {
+		int const size = std::snprintf(line, sizeof(line), "%u,%ld,%ld,%.9g\n", thread, event, row, value*r);
+		rows.append(line, static_cast<std::size_t>(size));
+	}
+}
+
+/// Rows of each thread in the file, false if those of a thread are not in order
+bool Check(const std::string& filename, unsigned nThread, std::vector<long>& rows) {
+	rows.assign(nThread, 0);
+	std::vector<long> last(nThread, -1);
+	std::ifstream file(filename);
+	bool ordered = true;
+	for(std::string line; std::getline(file, line);) {
+		unsigned thread = 0;
+		long event = 0;
+		long row = 0;
+		if(std::sscanf(line.c_str(), "%u,%ld,%ld", &thread, &event, &row) != 3 || thread >= nThread)
+			return false;
+		ordered = ordered && row > last[thread];
+		last[thread] = row;
+		++rows[thread];
+	}
+	return ordered;
+}
+
+}
+
+int main(int argc, char** argv) {
+	zz::cfg::ArgParser argparser;
+
+	std::string output;
+	argparser.add_opt_value('o', "output", output, std::string("writerBenchmark.csv"), "file written", "file");
+	int nbThread = 0;
+	argparser.add_opt_value('t', "thread", nbThread, 0, "number of threads (0 for all of them)", "int");
+	long nbEvent = 20000;
+	argparser.add_opt_value('e', "event", nbEvent, 20000L, "events per thread", "long");
+	long nbRow = 200;
+	argparser.add_opt_value('r', "row", nbRow, 200L, "rows per event", "long");
+	long work = 20000;
+	argparser.add_opt_value('w', "work", work, 20000L, "operations of the tracking of an event", "long");
+	long batchBytes = 64*1024;
+	argparser.add_opt_value('b', "batch", batchBytes, 65536L, "bytes per batch", "long");
+	int capacity = 64;
+	argparser.add_opt_value('c', "capacity", capacity, 64, "batches queued per thread", "int");
+
+	argparser.parse(argc, argv);
+
+	if(argparser.count_error() > 0) {
+		std::cout << argparser.get_error() << std::endl;
+		std::cout << argparser.get_help() << std::endl;
+		return 1;
+	}
+
+	unsigned const nThread = Common::ResolveThreadCount(nbThread);
+	std::cout << nThread << " threads, " << nbEvent << " events of " << nbRow << " rows per thread" << std::endl;
+	std::cout << std::setw(8) << "writer" << std::setw(12) << "run (s)" << std::setw(14) << "writing (s)" << std::setw(12) << "MB/s"
+		<< std::setw(10) << "maxDepth" << std::setw(10) << "stalls" << std::setw(10) << "dropped" << std::setw(10) << "rows" << std::endl;
+
+	bool passed = true;
+	for(std::string const writer: {"direct", "block", "drop"}) {
+		std::atomic<std::uint64_t> writingNanoseconds{0};
+		std::atomic<std::uint64_t> bytes{0};
+		Common::AsyncWriter::Stats stats;
+		double run = 0.;
+
+		auto const emulate = [&](auto&& write) {
+			auto const start = Clock::now();
+			Common::ParallelFor(nThread, nThread, [&](std::size_t begin, std::size_t end, unsigned) {
+				for(auto thread = static_cast<unsigned>(begin); thread < end; ++thread) {
+					std::string rows;
+					long row = 0;
+					double x = thread;
+					std::uint64_t waited = 0;
+					for(long event = 0; event < nbEvent; ++event) {
+						x = Track(work, x);
+						FormatEvent(rows, thread, event, nbRow, row, x);
+						if(static_cast<long>(rows.size()) >= batchBytes || event + 1 == nbEvent) {
+							bytes += rows.size();
+							auto const writeStart = Clock::now();
+							write(thread, rows);
+							waited += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - writeStart).count();
+							rows.clear();
+						}
+					}
+					writingNanoseconds += waited;
+				}
+			});
+			run = Seconds(start);
+		};
+
+		if(writer == "direct") {
+			std::FILE* file = std::fopen(output.c_str(), "wb");
+			if(!file) {
+				std::cerr << "cannot write " << output << std::endl;
+				return 1;
+			}
+			std::mutex mutex;
+			emulate([&](unsigned, std::string& rows) {
+				std::lock_guard<std::mutex> lock(mutex);
+				std::fwrite(rows.data(), 1, rows.size(), file);
+				std::fflush(file);
+			});
+			std::fclose(file);
+		} else {
+			auto const policy = writer == "block" ? Common::AsyncWriter::Policy::Block : Common::AsyncWriter::Policy::Drop;
+			Common::AsyncWriter asyncWriter(output, static_cast<std::size_t>(capacity), policy);
+			std::vector<Common::AsyncWriter::Producer*> producers;
+			for(unsigned thread = 0; thread < nThread; ++thread)
+				producers.push_back(&asyncWriter.NewProducer());
+			emulate([&](unsigned thread, std::string& rows) {
+				producers[thread]->Push(std::move(rows));
+			});
+			passed = asyncWriter.Close() && passed;
+			stats = asyncWriter.stats();
+		}
+
+		std::vector<long> rows;
+		bool const ordered = Check(output, nThread, rows);
+		long total = 0;
+		bool complete = true;
+		for(long const count: rows) {
+			total += count;
+			complete = complete && count == nbEvent*nbRow;
+		}
+		passed = passed && ordered && (writer == "drop" || complete);
+
+		std::cout << std::setw(8) << writer << std::setw(12) << run << std::setw(14) << writingNanoseconds*1e-9/nThread
+			<< std::setw(12) << bytes/(1024.*1024.)/run << std::setw(10) << stats.maxDepth << std::setw(10) << stats.stalls
+			<< std::setw(10) << stats.dropped << std::setw(10) << total << std::endl;
+	}
+	std::remove(output.c_str());
+
+	std::cout << (passed ? "rows written in order" : "ROWS MISSING OR OUT OF ORDER") << std::endl;
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,87 @@
+/// \file AliasTable.hh
+/// \brief Definition of the Common::AliasTable class
+
+#ifndef COMMON_ALIAS_TABLE_HH
+#define COMMON_ALIAS_TABLE_HH
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+namespace Common {
+
+/// AliasTable class
+///
+/// Walker's alias method, built with Vose's algorithm: samples the index i with a
+/// probability proportional to weights[i] in constant time, whatever the number of
+/// weights. Every index owns a slot of width 1/n, split between itself (probability)
+/// and its alias. Read only once built, so thread safe.
+
+class AliasTable {
+public:
+	AliasTable() = default;
+
+	/// Throws std::invalid_argument if the weights are empty, negative or all null
+	explicit AliasTable(const std::vector<double>& weights) {
+		std::size_t const n = weights.size();
+		double sum = 0.;
+		for(double const weight: weights) {
+			if(!(weight >= 0.))
+				throw std::invalid_argument("alias table: negative weight");
+			sum += weight;
+		}
+		if(n == 0 || !(sum > 0.))
+			throw std::invalid_argument("alias table: no weight");
+
+		fProbability.resize(n);
+		fAlias.resize(n);
+		std::vector<double> scaled(n);
+		std::vector<std::size_t> small;
+		std::vector<std::size_t> large;
+		for(std::size_t i = 0; i < n; ++i) {
+			scaled[i] = weights[i]*n/sum;
+			(scaled[i] < 1. ? small : large).push_back(i);
+		}
+
+		// each small slot is filled up by a large one, which gives it what it lacks
+		while(!small.empty() && !large.empty()) {
+			std::size_t const s = small.back();
+			small.pop_back();
+			std::size_t const l = large.back();
+			fProbability[s] = scaled[s];
+			fAlias[s] = l;
+			scaled[l] -= 1. - scaled[s];
+			if(scaled[l] < 1.) {
+				large.pop_back();
+				small.push_back(l);
+			}
+		}
+		// what is left is 1 up to rounding
+		for(std::size_t const i: large) {
+			fProbability[i] = 1.;
+			fAlias[i] = i;
+		}
+		for(std::size_t const i: small) {
+			fProbability[i] = 1.;
+			fAlias[i] = i;
+		}
+	}
+
+	/// Index for a uniform number u in [0, 1)
+	[[nodiscard]] std::size_t Sample(double u) const {
+		double const x = u*fProbability.size();
+		std::size_t const i = std::min(static_cast<std::size_t>(x), fProbability.size() - 1);
+		return x - i < fProbability[i] ? i : fAlias[i];
+	}
+
+	[[nodiscard]] std::size_t size() const { return fProbability.size(); }
+
+private:
+	std::vector<double> fProbability;
+	std::vector<std::size_t> fAlias;
+};
+
+}
+
+#endif
@@ -0,0 +1,111 @@
+/// \file AsyncWriter.hh
+/// \brief Definition of the Common::AsyncWriter class
+
+#ifndef COMMON_ASYNC_WRITER_HH
+#define COMMON_ASYNC_WRITER_HH
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Common {
+
+/// AsyncWriter class
+///
+/// Writes to a file the batches of rows handed over by the threads of a run, from a thread
+/// of its own which owns the file: the threads format their rows, then push them to their
+/// Producer, a bounded lock-free queue (one producer, the writer as only consumer), and go
+/// on tracking while the writer does the I/O. The batches of a producer are written in
+/// order, those of different producers interleaved.
+///
+/// When a queue is full (the writer is behind), the producer follows the policy:
+///  - Block : wait for a free slot, the time waited being counted as stall time;
+///  - Drop  : drop the batch, counted as dropped.
+///
+/// Close (or the destructor) writes what is queued and stops the writer.
+
+class AsyncWriter {
+public:
+	enum class Policy { Block, Drop };
+
+	/// Counters of the producers, summed
+	struct Stats {
+		std::uint64_t batches{0};     // batches pushed
+		std::uint64_t bytes{0};       // bytes pushed
+		std::uint64_t dropped{0};     // batches dropped (Drop policy)
+		std::uint64_t stalls{0};      // pushes which found the queue full
+		double stallTime{0.};         // s waited for a free slot (Block policy)
+		std::size_t maxDepth{0};      // most batches found queued by a push
+	};
+
+	/// Queue of the batches of one thread
+	class Producer {
+	public:
+		Producer(std::size_t capacity, Policy policy);
+
+		/// Hand batch over to the writer (moved from), following the policy if the queue is full
+		void Push(std::string&& batch);
+
+		/// Next batch in order for the writer, false if the queue is empty
+		bool Pop(std::string& batch);
+
+		[[nodiscard]] Stats stats() const;
+
+	private:
+		std::vector<std::string> fSlots;
+		std::size_t fMask;
+		Policy fPolicy;
+		// fHead written by the producer only, fTail by the writer only
+		alignas(64) std::atomic<std::size_t> fHead{0};
+		alignas(64) std::atomic<std::size_t> fTail{0};
+
+		// counters, written by the producer only
+		alignas(64) std::atomic<std::uint64_t> fBatches{0};
+		std::atomic<std::uint64_t> fBytes{0};
+		std::atomic<std::uint64_t> fDropped{0};
+		std::atomic<std::uint64_t> fStalls{0};
+		std::atomic<std::uint64_t> fStallNanoseconds{0};
+		std::atomic<std::size_t> fMaxDepth{0};
+	};
+
+	/// Write to filename (truncated), with queues of capacity batches (rounded up to a power of 2),
+	/// throws std::runtime_error if filename cannot be written
+	AsyncWriter(const std::string& filename, std::size_t capacity = 64, Policy policy = Policy::Block);
+	~AsyncWriter();
+
+	AsyncWriter(const AsyncWriter&) = delete;
+	AsyncWriter& operator=(const AsyncWriter&) = delete;
+
+	/// Queue of a new thread, owned by the writer (thread safe)
+	Producer& NewProducer();
+
+	/// Write the batches queued and stop the writer, false if a write failed
+	bool Close();
+
+	[[nodiscard]] Stats stats() const;
+	[[nodiscard]] const std::string& filename() const { return fFilename; }
+
+private:
+	void Run();
+	bool Drain(const std::vector<Producer*>& producers);
+
+	std::string fFilename;
+	std::size_t fCapacity;
+	Policy fPolicy;
+	std::FILE* fFile{nullptr};
+	bool fFailed{false};
+
+	mutable std::mutex fMutex;
+	std::vector<std::unique_ptr<Producer>> fProducers;
+	std::atomic<bool> fStop{false};
+	std::thread fThread;
+};
+
+}
+
+#endif
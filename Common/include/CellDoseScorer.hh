@@ -0,0 +1,189 @@
+/// \file CellDoseScorer.hh
+/// \brief Definition of the Common::CellDoseScorer class
+
+#ifndef COMMON_CELL_DOSE_SCORER_HH
+#define COMMON_CELL_DOSE_SCORER_HH
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <G4UImessenger.hh>
+#include <G4UIcmdWithABool.hh>
+#include <G4UIcmdWithADoubleAndUnit.hh>
+#include <G4UIcmdWithAString.hh>
+#include <G4UIdirectory.hh>
+#include <G4VUserActionInitialization.hh>
+
+#include "AsyncWriter.hh"
+#include "CellLocator.hh"
+
+class G4Step;
+
+namespace Common {
+
+class CellGeometry;
+class PopulationLoader;
+
+/// Energy deposited in the cells by the steps of one thread
+///
+/// Dense arrays indexed by the cell index of the population (not its id), so that a
+/// deposit is an array update and the end of run reduction a sum of arrays. The deposits
+/// of the current event are kept apart to add their squares to the sums of squares
+/// (uncertainties over the events) when the event ends: only the cells touched by the
+/// event have an entry, found from the cell by eventSlot. This is all the memory a worker
+/// adds for the scoring, the population and its locator being shared by the threads.
+/// When the events are recorded, the entries of each event are formatted as rows when it
+/// ends, and handed over to the writer of the records by batches.
+struct CellDoseTally {
+	/// Deposits of the current event in a cell
+	struct EventDeposit {
+		std::uint32_t cell;
+		double cellEnergy;
+		double nucleusEnergy;
+	};
+
+	std::vector<double> nucleusEnergy;
+	std::vector<double> cellEnergy;
+	std::vector<double> nucleusEnergy2;
+	std::vector<double> cellEnergy2;
+	std::vector<std::uint64_t> hits;
+
+	std::vector<std::uint32_t> eventSlot;  // 1 + index in touched of the cell, 0 if not touched
+	std::vector<EventDeposit> touched;
+	long event{-1};
+	std::size_t hint{CellLocator::None};  // cell of the previous step (see CellLocator)
+
+	std::unique_ptr<CellDoseTally> lookup;  // the same steps given to the cells by the locator, when compared
+	double comparedEnergy{0.};  // energy of the steps scored by volume and by the locator
+	double movedEnergy{0.};  // part of it the locator gives to another cell or compartment
+
+	AsyncWriter::Producer* records{nullptr};  // queue of the event records, if written
+	const std::uint64_t* recordIds{nullptr};  // ids of the cells in the records
+	std::string recordRows;  // rows not handed over yet
+
+	void Resize(std::size_t cellCount);
+	void Deposit(std::size_t cell, bool nucleus, double energy);
+	void EndEvent();
+	void Reset();
+	/// Hand the rows left over to the writer and detach from it
+	void FlushRecords();
+};
+
+/// CellDoseScorer class
+///
+/// Scores the energy deposited in every cell and in its nucleus from the steps of the
+/// simulation, in place of one output row per step: each thread adds the deposits of its
+/// steps to its own CellDoseTally, and the tallies are summed once at the end of the run
+/// into a table of one row per cell, <output>.cellDose.csv for /analysis/setFileName output:
+///
+///     # events <n>
+///     cellId,nucleusEnergy,cellEnergy,hits,nucleusEnergy2,cellEnergy2
+///
+/// the energies in MeV, the sums of squares over the events in MeV^2, hits the number of
+/// steps depositing energy in the cell. The energies are weighted by the weights of the
+/// particles, which are 1 unless the transport is biased (see Common::ImportanceSampling). The energies of every event in every cell it reaches
+/// can also be recorded, in <output>.cellEvents.csv:
+///
+///     event,cellId,nucleusEnergy,cellEnergy
+///
+/// The rows are formatted by the workers and written by a thread of their own (see
+/// Common::AsyncWriter), so that their I/O stays off the tracking; the counters of the writer
+/// (queue depth, stall time, dropped batches) are printed at the end of the run. The ntuples
+/// filled by CPOP (/cpop/population/eventInfo) do not go through the writer, the workers still
+/// filling and writing them. A step is given to the cell containing its middle
+/// (see Common::CellLocator) or, when the cells are placed as volumes (Common::CellGeometry,
+/// of the same population), to the cell of its volume. The volumes can then be compared with the
+/// lookup: every step is also given to a cell by the Common::CellLocator, in a second table of the same
+/// steps, <output>.cellDoseLookup.csv, and the share of the energy the two give to a different cell,
+/// or to the nucleus in one and the cytoplasm in the other, is printed at the end of the run. Both
+/// tables scoring the same steps, their differences are those of the geometries alone.
+///
+///  - /cpop/scoring/population f      : population scored, xml or binary, the one of
+///    /cpop/population/inputBinary by default
+///  - /cpop/scoring/populationUnit l  : length unit of the population file (um by default)
+///  - /cpop/scoring/cellDose b        : score the cells (false by default), after the population
+///  - /cpop/scoring/eventRecords b    : also record the energies per event (false by default)
+///  - /cpop/scoring/recordPolicy p    : block (default) or drop the batches of records when the
+///    writer is behind
+///  - /cpop/scoring/compareLookup b   : with the cells placed as volumes, also score the steps with
+///    the lookup (false by default)
+///
+/// The actions of the workers are wrapped (Wrap) so that their stepping action also
+/// scores, and EndOfRun is called on the master after each run (see Common::CreateRunManager).
+
+class CellDoseScorer: public G4UImessenger
+{
+public:
+	CellDoseScorer();
+
+	void SetNewValue(G4UIcommand* command, G4String newValue) override;
+
+	/// Population of /cpop/population/inputBinary
+	void SetPopulationLoader(const PopulationLoader& loader) { fLoader = &loader; }
+
+	/// Cells placed as volumes, if any
+	void SetCellGeometry(const CellGeometry& geometry) { fGeometry = &geometry; }
+
+	/// Actions building those of actions plus the scoring, takes the ownership of actions
+	G4VUserActionInitialization* Wrap(G4VUserActionInitialization* actions);
+
+	/// Score the step of a worker
+	void Score(CellDoseTally& tally, long event, const G4Step& step) const;
+
+	/// Tally of a new worker, owned by the scorer
+	CellDoseTally& NewTally();
+
+	/// Sum the tallies of the threads, write the table and reset them, for a run of nEvent (master)
+	void EndOfRun(int nEvent);
+
+	/// Sum the tables of runs of the same population (the shards of a run) into output,
+	/// throws std::runtime_error on failure
+	static void MergeFiles(const std::vector<std::string>& inputs, const std::string& output);
+
+	[[nodiscard]] bool enabled() const { return fEnabled; }
+
+	/// Cells scored, in Geant4 length units, and their ids
+	[[nodiscard]] const CellLocator& locator() const { return fLocator; }
+	[[nodiscard]] const std::vector<std::uint64_t>& ids() const { return fIds; }
+
+	/// Sums of the threads of the last run (master, after EndOfRun)
+	[[nodiscard]] const CellDoseTally& total() const { return fTotal; }
+
+private:
+	void BuildLocator();
+	void OpenRecords(CellDoseTally& tally) const;
+	void ScoreLookup(CellDoseTally& tally, long event, const G4Step& step, std::size_t cell, bool nucleus, double energy) const;
+	static void Write(const std::string& filename, long nEvent, const std::vector<std::uint64_t>& ids, const CellDoseTally& total);
+
+	bool fEnabled{false};
+	bool fEventRecords{false};
+	bool fCompareLookup{false};
+	AsyncWriter::Policy fRecordPolicy{AsyncWriter::Policy::Block};
+	std::string fPopulationFile;
+	double fUnit;
+	const PopulationLoader* fLoader{nullptr};
+	const CellGeometry* fGeometry{nullptr};
+	std::vector<std::uint64_t> fIds;
+	CellLocator fLocator;
+
+	mutable std::mutex fMutex;
+	std::vector<std::unique_ptr<CellDoseTally>> fTallies;
+	CellDoseTally fTotal;
+	CellDoseTally fLookupTotal;
+	mutable std::unique_ptr<AsyncWriter> fRecordWriter;
+
+	G4UIdirectory fDirectory;
+	G4UIcmdWithABool fCellDoseCmd;
+	G4UIcmdWithAString fPopulationCmd;
+	G4UIcmdWithADoubleAndUnit fPopulationUnitCmd;
+	G4UIcmdWithABool fEventRecordsCmd;
+	G4UIcmdWithAString fRecordPolicyCmd;
+	G4UIcmdWithABool fCompareLookupCmd;
+};
+
+}
+
+#endif
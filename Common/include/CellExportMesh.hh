@@ -0,0 +1,117 @@
+/// \file CellExportMesh.hh
+/// \brief Definition of the Common::CellExportMesh class
+
+#ifndef COMMON_CELL_EXPORT_MESH_HH
+#define COMMON_CELL_EXPORT_MESH_HH
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "UniformGrid.hh"
+
+namespace Common {
+
+class MappedPopulation;
+struct PopulationData;
+
+/// Read only view over the cells to mesh (structure of arrays)
+struct CellArrays {
+	std::size_t count{0};
+	const double* x{nullptr};
+	const double* y{nullptr};
+	const double* z{nullptr};
+	const double* radius{nullptr};
+	const std::uint64_t* id{nullptr};  // optional, the index of the cell if nullptr
+};
+
+/// Cells of a mapped binary population or of a population loaded in memory
+CellArrays MakeCellArrays(const MappedPopulation& population);
+CellArrays MakeCellArrays(const PopulationData& population);
+
+/// Region of each cell, as the /cpop/population/internalRatio and intermediaryRatio commands define them:
+/// 0 (necrosis) up to internalRatio*radius from the center, 1 (intermediary) up to intermediaryRatio*radius, 2 (external) beyond
+std::vector<std::uint8_t> CellRegions(const CellArrays& cells, const double center[3], double radius, double internalRatio, double intermediaryRatio);
+
+/// CellExportMesh class
+///
+/// Approximate mesh of a population for the exports, separate from CPOP's Round_Cell_Tesselation:
+/// every cell is a sphere of its membrane radius clipped by the power (Laguerre) planes
+/// it shares with the cells it overlaps. It approximates the CPOP mesh without reproducing
+/// it (its facets are not those of Round_Cell_Tesselation) and does not replace it: CPOP still
+/// builds its own tessellation at /cpop/population/init, serially, and its init time is unchanged.
+/// It is used for the visualisation and the exports (/cpop/population/exportMesh, meshEngine = export
+/// of GeneratePopulation), and for the volumes of Common::CellGeometry.
+///
+/// All the cells share the same triangulated unit sphere (at most
+/// maxNumberOfFacetPerCell facets), each vertex being pushed along its direction
+/// up to the membrane or to the closest clipping plane. A cell only reads the
+/// input and writes its own vertices, so the cells are meshed concurrently and
+/// the result does not depend on the number of threads (it is the same on 1 thread and on
+/// more, it is not compared with the serial mesh of CPOP).
+///
+/// Nothing is meshed at construction: the cells are meshed on request, by
+/// batches, so that a whole population can be exported without holding its mesh.
+
+class CellExportMesh {
+public:
+	using Facet = std::array<std::uint32_t, 3>;
+
+	/// Cells meshed together by ForEachBatch and the exporters
+	static constexpr std::size_t DefaultBatchSize = 4096;
+
+	/// cells must outlive the mesh, nbThread <= 0 uses every hardware thread
+	CellExportMesh(const CellArrays& cells, int maxNumberOfFacetPerCell, int nbThread = 1);
+
+	/// Facets per cell keeping the whole population under facetBudget facets (0 for no budget)
+	static int FacetsPerCellForBudget(std::size_t nbCell, std::size_t facetBudget, int maxNumberOfFacetPerCell);
+
+	[[nodiscard]] std::size_t cellCount() const { return fCells.count; }
+	[[nodiscard]] std::size_t vertexPerCell() const { return fDirections.size(); }
+	[[nodiscard]] const CellArrays& cells() const { return fCells; }
+
+	/// Facets of every cell, indices in [0, vertexPerCell()) oriented outward
+	[[nodiscard]] const std::vector<Facet>& facets() const { return fFacets; }
+
+	/// Mesh the cells [first, last): 3*vertexPerCell() coordinates per cell
+	void MeshCells(std::size_t first, std::size_t last, double* vertices) const;
+
+	/// Mesh every cell, cells in input order
+	[[nodiscard]] std::vector<double> MeshAll() const;
+
+	/// Call fn(first, last, vertices) for consecutive batches of cells in input order
+	template<typename Fn>
+	void ForEachBatch(Fn&& fn, std::size_t batchSize = DefaultBatchSize) const {
+		std::vector<double> vertices;
+		for(std::size_t first = 0; first < cellCount(); first += batchSize) {
+			std::size_t const last = std::min(cellCount(), first + batchSize);
+			vertices.resize(3*(last - first)*vertexPerCell());
+			MeshCells(first, last, vertices.data());
+			fn(first, last, static_cast<const double*>(vertices.data()));
+		}
+	}
+
+	/// Whole population as a single ASCII OFF file, cells in input order
+	void ExportOff(const std::string& filename) const;
+
+	/// Whole population as a single binary PLY file, cells in input order.
+	/// Every face has the cell_id of its cell and, if regions is given, its region
+	void ExportPly(const std::string& filename, const std::uint8_t* regions = nullptr) const;
+
+private:
+	void BuildTemplate(int maxNumberOfFacetPerCell);
+
+	CellArrays fCells;
+	unsigned fNbThread;
+	UniformGrid fGrid;
+
+	std::vector<std::array<double, 3>> fDirections;
+	std::vector<Facet> fFacets;
+};
+
+}
+
+#endif
@@ -0,0 +1,81 @@
+/// \file CellGeometry.hh
+/// \brief Definition of the Common::CellGeometry class
+
+#ifndef COMMON_CELL_GEOMETRY_HH
+#define COMMON_CELL_GEOMETRY_HH
+
+#include <string>
+
+#include <G4UImessenger.hh>
+#include <G4UIcmdWithABool.hh>
+#include <G4UIcmdWithADoubleAndUnit.hh>
+#include <G4UIcmdWithAString.hh>
+#include <G4UIcmdWithAnInteger.hh>
+#include <G4UIdirectory.hh>
+
+class G4LogicalVolume;
+class G4Region;
+
+namespace Common {
+
+class PopulationLoader;
+
+/// CellGeometry class
+///
+/// Places the cells and the nuclei of the population as Geant4 volumes in the world, so that
+/// the navigator (and its smart voxelisation) finds the cell of each step, and so that physics
+/// can be set per region. Every cell is a G4TessellatedSolid of its Common::CellExportMesh mesh,
+/// which keeps the cells from overlapping, and contains its nucleus, a G4Orb at its center
+/// (shrunk if needed to stay inside the clipped cell). Both are placed with the index of the
+/// cell in the population as copy number. The cells are in the region Cells, the nuclei in
+/// the region Nuclei.
+///
+///  - /cpop/geometry/cells b           : place the cells (false by default, a world of water only)
+///  - /cpop/geometry/population f      : population placed, xml or binary, the one of
+///    /cpop/population/inputBinary by default
+///  - /cpop/geometry/populationUnit l  : length unit of the population file (um by default)
+///  - /cpop/geometry/facets n          : maximum number of facets per cell (50 by default)
+///  - /cpop/geometry/material m        : material of the cells and nuclei (G4_WATER by default)
+///
+/// Place is called by the detector construction. Common::CellDoseScorer then scores the
+/// steps by volume rather than with its Common::CellLocator, with which they can be compared
+/// (/cpop/scoring/compareLookup).
+
+class CellGeometry: public G4UImessenger
+{
+public:
+	CellGeometry();
+
+	void SetNewValue(G4UIcommand* command, G4String newValue) override;
+
+	/// Population of /cpop/population/inputBinary
+	void SetPopulationLoader(const PopulationLoader& loader) { fLoader = &loader; }
+
+	/// Place the cells in world if /cpop/geometry/cells is set
+	void Place(G4LogicalVolume* world);
+
+	/// Regions of the placed cells and nuclei, nullptr if the cells are not placed
+	[[nodiscard]] const G4Region* cellRegion() const { return fCellRegion; }
+	[[nodiscard]] const G4Region* nucleusRegion() const { return fNucleusRegion; }
+
+private:
+	bool fEnabled{false};
+	std::string fPopulationFile;
+	double fUnit;
+	int fFacets{50};
+	std::string fMaterial{"G4_WATER"};
+	const PopulationLoader* fLoader{nullptr};
+	G4Region* fCellRegion{nullptr};
+	G4Region* fNucleusRegion{nullptr};
+
+	G4UIdirectory fDirectory;
+	G4UIcmdWithABool fCellsCmd;
+	G4UIcmdWithAString fPopulationCmd;
+	G4UIcmdWithADoubleAndUnit fPopulationUnitCmd;
+	G4UIcmdWithAnInteger fFacetsCmd;
+	G4UIcmdWithAString fMaterialCmd;
+};
+
+}
+
+#endif
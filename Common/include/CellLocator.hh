@@ -0,0 +1,77 @@
+/// \file CellLocator.hh
+/// \brief Definition of the Common::CellLocator class
+
+#ifndef COMMON_CELL_LOCATOR_HH
+#define COMMON_CELL_LOCATOR_HH
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "CellExportMesh.hh"
+#include "UniformGrid.hh"
+
+namespace Common {
+
+/// CellLocator class
+///
+/// Finds the cell containing a point: the cell whose membrane sphere contains it or,
+/// where spheres overlap, the one with the smallest power distance |p - center|^2 - radius^2,
+/// which is the cell the power planes of Common::CellExportMesh give the point to.
+/// The nucleus of a cell is a sphere at its center. Read only once built, so thread safe.
+///
+/// The cells are sorted in a uniform grid of cubes of the largest radius, so that a lookup
+/// only tests the cells of the 27 cubes around the point. Successive lookups along a track
+/// mostly fall in the same cell: given the cell of the previous lookup (a hint kept by the
+/// thread), only this cell and the cells overlapping it are tested while the point stays in it.
+///
+/// It is used by the scoring of this repository only (Common::CellDoseScorer, and
+/// Common::ImportanceSampling through it): CPOP finds the cells of its own ntuples (stepInfo, eventInfo) with
+/// its own search, which it does not let the examples replace and which this locator does not speed up.
+
+class CellLocator {
+public:
+	using Point = std::array<double, 3>;
+
+	static constexpr std::size_t None = std::numeric_limits<std::size_t>::max();
+
+	CellLocator() = default;
+
+	/// Cells and radius of their nucleus (0 for none), scaled by unit (population length to query length)
+	CellLocator(const CellArrays& cells, const std::vector<double>& nucleusRadius, double unit);
+
+	/// Index of the cell containing p, None if p is outside every cell
+	[[nodiscard]] std::size_t Locate(const Point& p) const;
+
+	/// Same as Locate(p), starting from hint, the result of the previous lookup of the thread, updated
+	[[nodiscard]] std::size_t Locate(const Point& p, std::size_t& hint) const;
+
+	/// True if p is in the nucleus of the cell i
+	[[nodiscard]] bool InNucleus(std::size_t i, const Point& p) const;
+
+	[[nodiscard]] std::size_t size() const { return fCenters.size(); }
+
+	/// Center and membrane radius of the cell i, in the query length unit
+	[[nodiscard]] const Point& center(std::size_t i) const { return fCenters[i]; }
+	[[nodiscard]] double radius(std::size_t i) const { return std::sqrt(fRadius2[i]); }
+
+	/// Radius of the first nucleus of each cell, 0 for cells without nucleus
+	static std::vector<double> NucleusRadii(std::size_t cellCount, const std::uint64_t* nucleusOffset, const double* nucleusRadius);
+
+private:
+	[[nodiscard]] double Distance2(std::size_t i, const Point& p) const;
+
+	std::vector<Point> fCenters;
+	std::vector<double> fRadius2;
+	std::vector<double> fNucleusRadius2;
+	UniformGrid fGrid;
+	std::vector<std::size_t> fOverlapStart;  // cells overlapping i are fOverlap[fOverlapStart[i], fOverlapStart[i+1])
+	std::vector<std::size_t> fOverlap;
+};
+
+}
+
+#endif
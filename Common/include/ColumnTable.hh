@@ -0,0 +1,226 @@
+/// \file ColumnTable.hh
+/// \brief Definition of the column table format (Common::ColumnTableBuilder, Common::MappedColumnTable)
+
+#ifndef COMMON_COLUMN_TABLE_HH
+#define COMMON_COLUMN_TABLE_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/// Column table format
+///
+/// A typed, columnar alternative to the ntuples of the analysis (ROOT or csv files), one
+/// file per table. The file is made of a fixed size header, a directory of the columns,
+/// then 64 bytes aligned blocks: the values of each column (one array per column), and for
+/// the text columns their dictionary. A text column stores the code of its value in every
+/// row (std::uint32_t), the dictionary the text of each code, so that a text repeated in
+/// every row (the particle name, EndOfRun) is stored once. Once the file is memory mapped,
+/// every column can be used in place, nothing is parsed.
+///
+///  header | columns | values of column 0 | dictionary of column 0 | values of column 1 | ...
+///
+/// A dictionary of n texts is std::uint64_t offsets[n+1] followed by the characters, the
+/// text i being [offsets[i], offsets[i+1]) of the characters (not null terminated).
+/// The header stores a checksum of all the bytes following it, as the binary population.
+
+namespace Common {
+
+namespace ColumnTable {
+
+constexpr char Magic[8] = {'C', 'P', 'O', 'P', 'C', 'O', 'L', '\0'};
+constexpr std::uint32_t Version = 1;
+constexpr std::uint32_t ByteOrderMark = 0x01020304;
+constexpr std::size_t BlockAlignment = 64;
+constexpr std::size_t NameSize = 48;
+constexpr const char* Extension = ".cpopc";
+/// Column of the shard of the rows of the shards of a run merged together (-1 for the summaries)
+constexpr const char* ShardColumn = "shard";
+
+/// Type of the values of a column
+enum Type: std::uint32_t {
+	Int32 = 0,  // std::int32_t
+	Int64,      // std::int64_t
+	Float,      // float
+	Double,     // double
+	Text,       // std::uint32_t, code in the dictionary of the column
+	TypeCount
+};
+
+struct BlockEntry {
+	std::uint64_t offset;
+	std::uint64_t size;
+};
+
+struct Column {
+	char name[NameSize];       // null terminated
+	std::uint32_t type;
+	std::uint32_t textCount;   // texts in the dictionary (Text columns)
+	BlockEntry values;
+	BlockEntry dictionary;     // empty if the column is not a Text column
+};
+
+struct Header {
+	char magic[8];
+	std::uint32_t version;
+	std::uint32_t byteOrder;
+	std::uint64_t rowCount;
+	std::uint64_t columnCount;
+	std::uint64_t checksum;   // FNV-1a of every byte following the header
+	BlockEntry columns;       // Column[columnCount]
+};
+
+/// Size in bytes of a value of type
+std::size_t TypeSize(Type type);
+
+/// Name of type (int32, int64, float, double, text)
+const char* TypeName(Type type);
+
+/// True for the Float and Double columns
+inline bool IsReal(Type type) { return type == Float || type == Double; }
+
+/// True for the real columns summed when the summaries of threads or shards are merged: the doses
+/// and deposited energies, whose names start with dose or edep whatever the case, after the f of
+/// the CPOP members (edep, Edep, fEdepn, fEdepc, fEdep_sph...). The other columns identify a summary.
+bool IsAdditive(const std::string& name, Type type);
+
+/// Type of the columns of values T
+template<typename T> struct TypeOf;
+template<> struct TypeOf<std::int32_t> { static constexpr Type value = Int32; };
+template<> struct TypeOf<std::int64_t> { static constexpr Type value = Int64; };
+template<> struct TypeOf<float> { static constexpr Type value = Float; };
+template<> struct TypeOf<double> { static constexpr Type value = Double; };
+template<> struct TypeOf<std::uint32_t> { static constexpr Type value = Text; };
+
+}
+
+/// ColumnTableBuilder
+///
+/// Table filled row by row, then written in the column table format. The values of a row
+/// are set column by column, then the row is added by EndRow. The rows whose text
+/// columns hold summaryMarker (the per-cell summaries written at the end of a run, see
+/// Common::OutputMerger) are not added but summed: the rows having the same values in all
+/// the columns but the additive ones (ColumnTable::IsAdditive) become a single row whose
+/// additive values are the sums, written after the other rows. The rows of the threads (or of the
+/// shards) of a run can so be added in turn, as the ROOT files of its threads are merged. The
+/// shard column (ColumnTable::ShardColumn) does not identify a summary, which has the shard -1.
+
+class ColumnTableBuilder {
+public:
+	explicit ColumnTableBuilder(std::string summaryMarker = "EndOfRun");
+
+	/// Add a column, before any row, returns its index
+	std::size_t AddColumn(const std::string& name, ColumnTable::Type type);
+
+	/// Value of column in the current row (integer or real value of a numeric column, text of a Text column)
+	void SetInteger(std::size_t column, std::int64_t value);
+	void SetReal(std::size_t column, double value);
+	void SetText(std::size_t column, std::string_view value);
+
+	/// Add the current row (its columns not set are 0, or the empty text)
+	void EndRow();
+
+	/// Write the table, throws std::runtime_error on failure
+	void Write(const std::string& filename) const;
+
+	[[nodiscard]] std::size_t columnCount() const { return fColumns.size(); }
+	[[nodiscard]] const std::string& name(std::size_t column) const { return fColumns[column].name; }
+	[[nodiscard]] ColumnTable::Type type(std::size_t column) const { return fColumns[column].type; }
+	/// Rows added and summaries
+	[[nodiscard]] std::size_t rowCount() const { return fRowCount + fSummaries.size(); }
+
+private:
+	struct ColumnData {
+		std::string name;
+		ColumnTable::Type type;
+		std::vector<unsigned char> values;
+		std::vector<std::string> texts;
+		std::unordered_map<std::string, std::uint32_t> codes;
+	};
+
+	/// Value of a column in the current row, the code of a text being an integer
+	union Value {
+		std::int64_t integer;
+		double real;
+	};
+
+	std::uint32_t Code(ColumnData& column, std::string_view text);
+	void Append(ColumnData& column, const Value& value) const;
+
+	std::string fSummaryMarker;
+	std::vector<ColumnData> fColumns;
+	std::vector<Value> fRow;
+	std::vector<bool> fAdditive;  // columns summed in the summaries
+	std::size_t fShardColumn{static_cast<std::size_t>(-1)};
+	std::size_t fRowCount{0};
+
+	// values of the first row of each summary, its reals being the sums
+	std::vector<std::vector<Value>> fSummaries;
+	std::unordered_map<std::string, std::size_t> fSummaryIndex;
+};
+
+/// MappedColumnTable
+///
+/// Read only view of a column table file. The file is memory mapped, the accessors return
+/// pointers inside the mapping: nothing is copied nor parsed. The view can be shared
+/// between threads.
+
+class MappedColumnTable {
+public:
+	static constexpr std::size_t None = static_cast<std::size_t>(-1);
+
+	/// Map the file, check its header and, if verify is true, its checksum.
+	/// Throws std::runtime_error if the file is not a valid column table.
+	explicit MappedColumnTable(const std::string& filename, bool verify = true);
+	~MappedColumnTable();
+
+	MappedColumnTable(const MappedColumnTable&) = delete;
+	MappedColumnTable& operator=(const MappedColumnTable&) = delete;
+
+	[[nodiscard]] const std::string& filename() const { return fFilename; }
+	[[nodiscard]] std::size_t rowCount() const { return fHeader->rowCount; }
+	[[nodiscard]] std::size_t columnCount() const { return fHeader->columnCount; }
+
+	[[nodiscard]] std::string name(std::size_t column) const { return fColumns[column].name; }
+	[[nodiscard]] ColumnTable::Type type(std::size_t column) const { return static_cast<ColumnTable::Type>(fColumns[column].type); }
+
+	/// Index of the column name, None if the table has no such column
+	[[nodiscard]] std::size_t Find(const std::string& name) const;
+
+	/// Values of column, T being the type of the column (std::uint32_t codes for a Text column),
+	/// throws std::runtime_error if it is not
+	template<typename T>
+	[[nodiscard]] const T* values(std::size_t column) const {
+		CheckType(column, ColumnTable::TypeOf<T>::value);
+		return reinterpret_cast<const T*>(fData + fColumns[column].values.offset);
+	}
+
+	/// Value of a numeric column in row, converted to double
+	[[nodiscard]] double real(std::size_t column, std::size_t row) const;
+
+	/// Texts of the dictionary of a Text column
+	[[nodiscard]] std::size_t textCount(std::size_t column) const { return fColumns[column].textCount; }
+	[[nodiscard]] std::string_view text(std::size_t column, std::uint32_t code) const;
+
+	/// Code of value in the dictionary of a Text column, None if it is not in the column
+	[[nodiscard]] std::size_t Code(std::size_t column, std::string_view value) const;
+
+private:
+	void CheckType(std::size_t column, ColumnTable::Type type) const;
+
+	std::string fFilename;
+	const unsigned char* fData{nullptr};
+	std::size_t fSize{0};
+	const ColumnTable::Header* fHeader{nullptr};
+	const ColumnTable::Column* fColumns{nullptr};
+};
+
+/// Tell if a file starts with the column table magic number
+bool IsColumnTable(const std::string& filename);
+
+}
+
+#endif
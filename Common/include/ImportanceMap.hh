@@ -0,0 +1,102 @@
+/// \file ImportanceMap.hh
+/// \brief Definition of the Common::ImportanceMap class and of the weight window
+
+#ifndef COMMON_IMPORTANCE_MAP_HH
+#define COMMON_IMPORTANCE_MAP_HH
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "UniformGrid.hh"
+
+namespace Common {
+
+/// ImportanceMap class
+///
+/// Importance of the points of space for the scoring of a few observed cells: the space
+/// around the observed cells is split in zones of a given width by the distance to the
+/// membrane of the nearest of them, zone 0 holding the cells themselves and the points
+/// closer than the width, zone k the points between k and k+1 widths away. The importance
+/// halves from a zone to the next one outward: 1 in the zone 0, 2^-k in the zone k < levels,
+/// 2^-levels from levels widths away. Only the observed cells less than levels widths away
+/// can give a point its zone, so they are sorted in a uniform grid of cubes of that reach.
+/// Read only once built, so thread safe.
+
+class ImportanceMap {
+public:
+	using Point = std::array<double, 3>;
+
+	ImportanceMap() = default;
+
+	/// Observed cells of centers and radii, zones of zoneWidth (same length unit), levels zones around them
+	ImportanceMap(const std::vector<Point>& centers, const std::vector<double>& radii, double zoneWidth, int levels);
+
+	/// Zone of p, in [0, levels], levels for the points beyond the last zone
+	[[nodiscard]] int Zone(const Point& p) const;
+
+	/// Importance of p, a power of 2 in [2^-levels, 1]
+	[[nodiscard]] double Importance(const Point& p) const {
+		return fImportance[Zone(p)];
+	}
+
+	/// False if there is no zone of importance below 1, every point having an importance of 1
+	[[nodiscard]] bool enabled() const { return fLevels > 0 && !fCenters.empty(); }
+
+	[[nodiscard]] int levels() const { return fLevels; }
+	[[nodiscard]] std::size_t size() const { return fCenters.size(); }
+
+private:
+	std::vector<Point> fCenters;
+	std::vector<double> fRadii;
+	double fZoneWidth{1.};
+	int fLevels{0};
+	std::vector<double> fImportance;  // of each zone
+	UniformGrid fGrid;
+};
+
+/// Weight window
+///
+/// Keeps the weight of a particle close to 1/importance at its position, the target weight
+/// being 1 in the observed cells: a particle lighter than the target weight divided by Ratio
+/// plays Russian roulette and survives with the target weight, with the probability of its
+/// weight over it, and a particle heavier than Ratio times the target weight is split into
+/// particles of about the target weight (at most MaxSplit). The primaries (of weight 1)
+/// emitted away from the observed cells are thus rouletted at the end of their first step,
+/// the survivors being split back as they approach the cells. The expected weight is kept,
+/// so that the scores weighted by the particles stay unbiased.
+namespace WeightWindow {
+
+constexpr double Ratio = 2.;
+constexpr int MaxSplit = 64;
+
+/// Particles replacing one of weight at a point of importance: count of weight each
+/// (count 0 if killed by the roulette, 1 with its weight if it is kept as it is)
+struct Outcome {
+	int count;
+	double weight;
+};
+
+/// Outcome for a particle of weight at importance, u uniform in [0, 1) being drawn for the roulette
+inline Outcome Apply(double weight, double importance, double u) {
+	double const target = 1./importance;
+	if(weight > Ratio*target) {
+		double const split = weight/target + 0.5;
+		int const count = split >= MaxSplit ? MaxSplit : static_cast<int>(split);
+		return {count, weight/count};
+	}
+	if(weight < target/Ratio)
+		return u*target < weight ? Outcome{1, target} : Outcome{0, 0.};
+	return {1, weight};
+}
+
+}
+
+/// Indices of perRegion cells drawn in each region (all the cells of a region having fewer),
+/// the same for the same seed, regions[i] being the region of the cell i (see CellRegions)
+std::vector<std::size_t> SampleCellsPerRegion(const std::vector<std::uint8_t>& regions, std::size_t perRegion, std::uint64_t seed);
+
+}
+
+#endif
@@ -0,0 +1,114 @@
+/// \file ImportanceSampling.hh
+/// \brief Definition of the Common::ImportanceSampling class
+
+#ifndef COMMON_IMPORTANCE_SAMPLING_HH
+#define COMMON_IMPORTANCE_SAMPLING_HH
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <G4UImessenger.hh>
+#include <G4UIcmdWithABool.hh>
+#include <G4UIcmdWithADoubleAndUnit.hh>
+#include <G4UIcmdWithAString.hh>
+#include <G4UIcmdWithAnInteger.hh>
+#include <G4UIcommand.hh>
+#include <G4UIdirectory.hh>
+#include <G4VUserActionInitialization.hh>
+
+#include "ImportanceMap.hh"
+
+class G4Step;
+
+namespace Common {
+
+class CellDoseScorer;
+
+/// ImportanceSampling class
+///
+/// Weight window variance reduction toward a few observed cells, the counterpart of
+/// /cpop/population/sampling for the cell doses of Common::CellDoseScorer: the particles
+/// are split when they get closer to the observed cells and play Russian roulette when
+/// they move away from them (see Common::ImportanceMap and Common::WeightWindow), so that
+/// the tracking time goes to the particles reaching the observed cells. The energies scored
+/// by Common::CellDoseScorer are weighted by the weights of the particles; the ntuples of
+/// CPOP are not, so that the biasing is refused (std::runtime_error) while CPOP fills them
+/// (/cpop/population/stepInfo or eventInfo), and an error is printed after a biased run if
+/// they were turned on after it started.
+///
+///  - /cpop/importance/observe n [s]       : observe n cells per region (all of a smaller region),
+///    drawn with the seed s (1 by default), after /cpop/scoring/cellDose
+///  - /cpop/importance/regionRatios i e    : internalRatio and intermediaryRatio defining the regions
+///    of the cells, those of /cpop/population/internalRatio and intermediaryRatio by default
+///  - /cpop/importance/neutral b           : also split and roulette the neutral particles (false by
+///    default: on the benchmark geometry, the photons lose more time to the copies than they gain)
+///  - /cpop/importance/levels n            : number of zones around the observed cells, the importance
+///    halving from a zone to the next one outward (0 by default: no biasing)
+///  - /cpop/importance/zoneWidth l         : width of a zone (10 um by default)
+///  - /cpop/importance/report f            : also append a row per run to the CSV file f
+///
+///     levels,zoneWidthUm,events,seconds,observed,reached,relativeError2,figureOfMerit
+///
+/// The observed cells are those of the population scored, their regions being given by the
+/// distance of the cells to the center of the population, relative to the largest distance.
+/// They are drawn by /cpop/importance/observe, independently of the cells sampled by
+/// /cpop/population/sampling for the outputs of CPOP.
+/// After each run, the figure of merit 1/(R^2 T) of the observed cells is printed, R^2 being
+/// the mean over the observed cells reached of the squared relative error of the energy deposited
+/// in their nucleus (in the whole cell if none reached the nucleus) per event, and T the duration of the
+/// run: a run with levels 0 gives the reference of the same cells, the ratio of the figures of
+/// merit being the gain of the biasing.
+///
+/// The actions of the workers are wrapped (Wrap) so that their stepping action applies the
+/// weight window at the end of each step, after calling the one it replaces: the copies of a
+/// particle split are secondaries of its step, its track being their parent, and EndOfRun is
+/// called on the master after each run, after the one of the scorer (see Common::CreateRunManager).
+
+class ImportanceSampling: public G4UImessenger
+{
+public:
+	explicit ImportanceSampling(const CellDoseScorer& scorer);
+
+	void SetNewValue(G4UIcommand* command, G4String newValue) override;
+
+	/// Actions building those of actions plus the weight window, takes the ownership of actions
+	G4VUserActionInitialization* Wrap(G4VUserActionInitialization* actions);
+
+	/// Apply the weight window to the particle of a step of a worker, adding the copies to the
+	/// secondaries of step
+	void Apply(const G4Step& step) const;
+
+	/// Report the figure of merit of the observed cells for a run of nEvent lasting seconds (master)
+	void EndOfRun(int nEvent, double seconds) const;
+
+	[[nodiscard]] bool enabled() const { return fMap.enabled(); }
+
+private:
+	void Build();
+
+	const CellDoseScorer& fScorer;
+	std::size_t fPerRegion{0};
+	std::uint64_t fSeed{1};
+	double fInternalRatio{0.};
+	double fIntermediaryRatio{0.};
+	bool fRegionRatiosSet{false};
+	bool fNeutral{false};
+	int fLevels{0};
+	double fZoneWidth;
+	std::string fReportFile;
+	std::vector<std::size_t> fObserved;  // cell indices of the scorer
+	ImportanceMap fMap;
+
+	G4UIdirectory fDirectory;
+	G4UIcommand fObserveCmd;
+	G4UIcommand fRegionRatiosCmd;
+	G4UIcmdWithABool fNeutralCmd;
+	G4UIcmdWithAnInteger fLevelsCmd;
+	G4UIcmdWithADoubleAndUnit fZoneWidthCmd;
+	G4UIcmdWithAString fReportCmd;
+};
+
+}
+
+#endif
@@ -0,0 +1,68 @@
+/// \file MacroWorker.hh
+/// \brief Definition of the Common::MacroWorker class
+
+#ifndef COMMON_MACRO_WORKER_HH
+#define COMMON_MACRO_WORKER_HH
+
+#include <cstddef>
+#include <map>
+#include <string>
+
+class G4UImanager;
+
+namespace Common {
+
+/// MacroWorker class
+///
+/// Runs many jobs against a single initialised population and physics. The
+/// initialisation macro (population, physics, /run/initialize) is executed once,
+/// then each job macro only defines its sources, output and /run/beamOn.
+///
+/// The macros are executed line by line, so that the sources they add are known. Before each job:
+///  - the sources added by the initialisation macro and the previous jobs are disabled: totalParticle 0
+///    for a uniform source, totalSource 0 and distributionInRegion 0 0 0 for a distribution (a job using
+///    distributions places them again with /cpop/source/init). A job adding a source which already exists
+///    reuses it instead. The job fails if a source cannot be disabled;
+///  - the output file is named after the job macro (run_gamma.mac writes run_gamma.root),
+///    unless the job sets its own with /analysis/setFileName.
+/// The scores are reset by every /run/beamOn, the random engine is not reseeded
+/// (use /random/setSeeds in the jobs for results independent of their order).
+/// The sources added by a macro run with /control/execute from another one are not known.
+///
+/// The jobs can be given at once, or read from a file or a FIFO, one macro per line:
+///   mkfifo jobs && uniformRadiation -m init.mac --jobs-from jobs &
+///   echo run_gamma.mac > jobs
+///   echo exit > jobs
+
+class MacroWorker {
+public:
+	explicit MacroWorker(G4UImanager* manager);
+
+	/// Execute the initialisation macro, throws if it fails
+	void Initialise(const std::string& macro);
+
+	/// Execute a job macro, false if one of its commands failed (the job is then stopped)
+	bool Run(const std::string& macro);
+
+	/// Run the jobs listed in filename until it ends, or until an "exit" line for a FIFO
+	/// (the FIFO is reopened to wait for new jobs). Returns the number of failed jobs
+	std::size_t Serve(const std::string& filename);
+
+	[[nodiscard]] std::size_t jobs() const { return fJobs; }
+
+private:
+	enum class SourceType { Uniform, Distribution };
+
+	/// Execute the commands of macro, false if one of them failed
+	bool Execute(const std::string& macro);
+	bool Reset(const std::string& macro);
+	bool Apply(const std::string& command);
+
+	G4UImanager* fManager;
+	std::map<std::string, SourceType> fSources;
+	std::size_t fJobs{0};
+};
+
+}
+
+#endif
@@ -0,0 +1,59 @@
+/// \file MemoryReport.hh
+/// \brief Definition of the Common::MemoryReport class
+
+#ifndef COMMON_MEMORY_REPORT_HH
+#define COMMON_MEMORY_REPORT_HH
+
+#include <string>
+
+#include <G4UImessenger.hh>
+#include <G4UIcmdWithAString.hh>
+#include <G4UIdirectory.hh>
+
+namespace Common {
+
+/// Memory of the process, in bytes (0 if unknown)
+struct MemoryUsage {
+	double resident{0.};  // resident set size (RSS)
+	double peak{0.};      // largest resident set size since the process started
+};
+
+/// Memory of the process, from /proc/self/status (peak only from getrusage elsewhere)
+MemoryUsage ReadMemoryUsage();
+
+/// MemoryReport class
+///
+/// Prints the resident memory of the process after each run, to size the nodes for a
+/// number of threads. The population (cpop::Population, Common::PopulationLoader and its
+/// mesh, the locator of Common::CellDoseScorer) and the spectra of Common::PrimarySpectra
+/// are built once by the master and read by every worker, the geometry and physics tables
+/// being shared by Geant4: a worker only adds its own Geant4 state, its scoring tally and
+/// its random engine. The memory added by a thread is the slope of the resident memory
+/// against the number of threads, for the same macro:
+///
+///  - /cpop/memory/report f : also append a row per run to the CSV file f
+///
+///     threads,events,residentMB,peakMB
+///
+/// EndOfRun is called on the master after each run (see Common::CreateRunManager).
+
+class MemoryReport: public G4UImessenger
+{
+public:
+	MemoryReport();
+
+	void SetNewValue(G4UIcommand* command, G4String newValue) override;
+
+	/// Report the memory after a run of nEvent on nThreads (master)
+	void EndOfRun(int nEvent, int nThreads) const;
+
+private:
+	std::string fFilename;
+
+	G4UIdirectory fDirectory;
+	G4UIcmdWithAString fReportCmd;
+};
+
+}
+
+#endif
@@ -0,0 +1,91 @@
+/// \file OutputMerger.hh
+/// \brief Definition of the Common::OutputMerger class
+
+#ifndef COMMON_OUTPUT_MERGER_HH
+#define COMMON_OUTPUT_MERGER_HH
+
+#include <string>
+#include <vector>
+
+#include <G4UImessenger.hh>
+#include <G4UIcmdWithABool.hh>
+#include <G4UIcmdWithAString.hh>
+#include <G4UIdirectory.hh>
+
+namespace Common {
+
+/// OutputMerger class
+///
+/// Merges the ROOT files written by the threads of a run (output_t0.root,
+/// output_t1.root... for /analysis/setFileName output) into the single file
+/// output.root, at the end of the run, instead of running hadd afterwards.
+///
+/// The files are merged by pairs concurrently, then the results by pairs... (a
+/// tree reduction, log2(threads) levels). In each tree, the event rows are
+/// concatenated while the per-cell summaries written by every thread at the end
+/// of the run (rows whose particle name is EndOfRun) are summed: the rows having
+/// the same values in every column but the additive ones (the cell ids, and the
+/// other columns which are not doses) become a single row whose additive columns
+/// (the doses, see ColumnTable::IsAdditive) are the sums. Histograms are added.
+/// The event rows are in the order of the threads (t0, t1...), as with hadd, so that
+/// thread files without summaries give the same trees as hadd.
+///
+///  - /cpop/output/merge b           : merge the thread files (true by default)
+///  - /cpop/output/keepThreadFiles b : keep the thread files once merged (false by default)
+///  - /cpop/output/format f          : analysis (default), columns or both
+///
+/// Requires ROOT (COMMON_WITH_ROOT), without it the thread files are left as they are.
+///
+/// With the columns format, the ntuples of the run are then written as column tables
+/// (see ColumnTable.hh), one file per ntuple, output.<ntuple>.cpopc, in place of the files
+/// of the analysis (kept with both): those of ROOT (the merged file, or the thread files if
+/// they are not merged) or those of csv (output_nt_<ntuple>_t<i>.csv, for /analysis/setFileName
+/// output.csv, which do not need ROOT). The rows of the threads are concatenated and their
+/// summaries summed, as when they are merged. The histograms, and the vector columns of
+/// the ntuples, are not written as columns.
+
+class OutputMerger: public G4UImessenger
+{
+public:
+	OutputMerger();
+
+	void SetNewValue(G4UIcommand* command, G4String newValue) override;
+
+	/// Merge the files of the nThreads threads of the run which just ended, then write their column tables
+	void Merge(int nThreads) const;
+
+	/// Merge the files inputs into output, throws std::runtime_error on failure. If shards is true,
+	/// the inputs are shards of a run (ShardFileName), whose rows get their shard in a column
+	/// (ColumnTable::ShardColumn, -1 for the summaries): the events of every shard are numbered from 0.
+	static void MergeFiles(const std::vector<std::string>& inputs, const std::string& output, unsigned nThreads, bool shards = false);
+
+	/// File written by the thread threadId for the output file name set by /analysis/setFileName
+	static std::string ThreadFileName(const std::string& fileName, int threadId);
+
+	/// Write the ntuples of inputs (ROOT files, csv ntuple files or column tables, matched by
+	/// ntuple name) as column tables named after output, returns the files written, throws
+	/// std::runtime_error on failure. The rows of shards get their shard as with MergeFiles.
+	static std::vector<std::string> WriteColumns(const std::vector<std::string>& inputs, const std::string& output, bool shards = false);
+
+	/// Column table of the ntuple table for the output file name fileName
+	static std::string ColumnFileName(const std::string& fileName, const std::string& table);
+
+private:
+	enum class Format { Analysis, Columns, Both };
+
+	bool MergeThreadFiles(const std::string& fileName, int nThreads) const;
+	void ConvertToColumns(const std::string& fileName, int nThreads, bool merged) const;
+
+	bool fMerge{true};
+	bool fKeepThreadFiles{false};
+	Format fFormat{Format::Analysis};
+
+	G4UIdirectory fDirectory;
+	G4UIcmdWithABool fMergeCmd;
+	G4UIcmdWithABool fKeepThreadFilesCmd;
+	G4UIcmdWithAString fFormatCmd;
+};
+
+}
+
+#endif
@@ -0,0 +1,125 @@
+/// \file ParallelFor.hh
+/// \brief Definition of the Common::ParallelFor helper and the Common::WorkerPool class
+
+#ifndef COMMON_PARALLEL_FOR_HH
+#define COMMON_PARALLEL_FOR_HH
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Common {
+
+/// Number of cores this process may use: the CPUs of its affinity mask, bounded by the
+/// CPU quota of its cgroup (v1 or v2) as set by containers and batch schedulers
+unsigned AvailableCores();
+
+/// Number of threads to use: requested if > 0, the number of available cores otherwise
+inline unsigned ResolveThreadCount(int requested) {
+	if(requested > 0)
+		return static_cast<unsigned>(requested);
+	return AvailableCores();
+}
+
+/// Split [0, n) in nThread contiguous chunks and call fn(begin, end, chunk) on each of them concurrently.
+///
+/// The chunks only depend on n and nThread, and the calling thread processes the first one.
+/// The first exception thrown by fn is rethrown once every chunk is done.
+template<typename Fn>
+void ParallelFor(std::size_t n, unsigned nThread, Fn&& fn) {
+	nThread = static_cast<unsigned>(std::max<std::size_t>(1, std::min<std::size_t>(nThread, n)));
+	if(nThread == 1) {
+		fn(std::size_t{0}, n, 0u);
+		return;
+	}
+
+	std::vector<std::exception_ptr> errors(nThread);
+	auto run = [&](unsigned chunk) {
+		std::size_t const begin = n*chunk/nThread;
+		std::size_t const end = n*(chunk+1)/nThread;
+		try {
+			fn(begin, end, chunk);
+		} catch(...) {
+			errors[chunk] = std::current_exception();
+		}
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(nThread-1);
+	for(unsigned chunk = 1; chunk < nThread; ++chunk)
+		threads.emplace_back(run, chunk);
+	run(0);
+	for(auto& thread: threads)
+		thread.join();
+
+	for(auto const& error: errors)
+		if(error)
+			std::rethrow_exception(error);
+}
+
+/// Call fn(i, worker) for every i in [0, n) on nThread workers, the indices being handed out by blocks of grain.
+///
+/// Balances the load when the cost per index varies; fn must only write data owned by i
+/// (or by the worker) for the result to be independent of the scheduling.
+template<typename Fn>
+void ParallelForEach(std::size_t n, unsigned nThread, std::size_t grain, Fn&& fn) {
+	grain = std::max<std::size_t>(1, grain);
+	std::atomic<std::size_t> next{0};
+	ParallelFor(std::min<std::size_t>(nThread, (n + grain - 1)/grain), nThread, [&](std::size_t, std::size_t, unsigned worker) {
+		for(std::size_t begin = next.fetch_add(grain); begin < n; begin = next.fetch_add(grain))
+			for(std::size_t i = begin; i < std::min(n, begin + grain); ++i)
+				fn(i, worker);
+	});
+}
+
+/// WorkerPool class
+///
+/// Threads created once and reused by every call of For, for the loops run many times in a row
+/// (as the steps of a relaxation) whose iterations are too short to pay for new threads each time.
+/// For splits [0, n) as ParallelFor does, so that both give the same chunks for the same n and size().
+
+class WorkerPool {
+public:
+	using ChunkFn = std::function<void(std::size_t begin, std::size_t end, unsigned chunk)>;
+
+	/// nThread threads, the calling thread of For being the first one
+	explicit WorkerPool(unsigned nThread);
+	~WorkerPool();
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	[[nodiscard]] unsigned size() const { return fSize; }
+
+	/// ParallelFor(n, size(), fn) on the threads of the pool
+	void For(std::size_t n, const ChunkFn& fn);
+
+private:
+	void Work(unsigned chunk);
+	void RunChunk(unsigned chunk);
+
+	unsigned fSize;
+	std::vector<std::thread> fThreads;
+
+	std::mutex fMutex;
+	std::condition_variable fStart;
+	std::condition_variable fDone;
+	const ChunkFn* fFn{nullptr};
+	std::size_t fN{0};
+	unsigned fChunks{0};
+	unsigned fPending{0};              // chunks of the current call not done by the workers yet
+	std::uint64_t fGeneration{0};      // calls of For, a worker starts when it changes
+	bool fStop{false};
+	std::vector<std::exception_ptr> fErrors;
+};
+
+}
+
+#endif
@@ -0,0 +1,87 @@
+/// \file PhaseReport.hh
+/// \brief Definition of the Common::PhaseReport class
+
+#ifndef COMMON_PHASE_REPORT_HH
+#define COMMON_PHASE_REPORT_HH
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Common {
+
+/// PhaseReport class
+///
+/// Wall time, CPU time (every thread of the process), resident memory and item
+/// counts of the successive phases of a program, written as a JSON report:
+///
+///   PhaseReport report;
+///   {
+///     auto phase = report.Start("relaxation");
+///     ...
+///     phase.Count("steps", nbStep);
+///   }
+///   report.WriteJson("population.xml.report.json");
+///
+/// A phase ends when its Phase object is destroyed. An optional trace records
+/// one row of values per iteration of a phase (relaxation steps for example).
+
+class PhaseReport {
+public:
+	struct Record {
+		std::string name;
+		double wallTime{0.};    // s
+		double cpuTime{0.};     // s, user + system
+		long rss{0};            // kiB, resident memory at the end of the phase
+		long peakRss{0};        // kiB, peak resident memory of the process at the end of the phase
+		std::vector<std::pair<std::string, std::uint64_t>> counts;
+	};
+
+	class Phase {
+	public:
+		Phase(PhaseReport& report, std::string name);
+		~Phase();
+		Phase(const Phase&) = delete;
+		Phase& operator=(const Phase&) = delete;
+		Phase(Phase&& other) noexcept;
+		Phase& operator=(Phase&&) = delete;
+
+		/// Number of items processed by the phase (cells, steps...)
+		void Count(const std::string& item, std::uint64_t count);
+
+	private:
+		PhaseReport* fReport;
+		Record fRecord;
+		std::chrono::steady_clock::time_point fStart;
+		double fCpuStart;
+	};
+
+	[[nodiscard]] Phase Start(const std::string& name) { return Phase(*this, name); }
+
+	/// Trace of the iterations of a phase: column names, then one row per iteration
+	void EnableTrace(const std::string& name, std::vector<std::string> columns);
+	[[nodiscard]] bool tracing() const { return !fTraceColumns.empty(); }
+	void Trace(std::vector<double> row);
+
+	[[nodiscard]] const std::vector<Record>& records() const { return fRecords; }
+
+	/// Write the report, and the trace if enabled, atomically
+	void WriteJson(const std::string& filename) const;
+
+	/// CPU time used so far by the process (s), resident and peak resident memory (kiB)
+	static double CpuTime();
+	static long Rss();
+	static long PeakRss();
+
+private:
+	std::vector<Record> fRecords;
+	std::string fTraceName;
+	std::vector<std::string> fTraceColumns;
+	std::vector<std::vector<double>> fTrace;
+};
+
+}
+
+#endif
@@ -0,0 +1,178 @@
+/// \file PopulationBinary.hh
+/// \brief Definition of the binary population format (Common::PopulationData, Common::MappedPopulation)
+
+#ifndef COMMON_POPULATION_BINARY_HH
+#define COMMON_POPULATION_BINARY_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// Binary population format
+///
+/// A compact, versioned alternative to the CPOP_SAVE xml written by IO::CPOP::save.
+/// The file is made of a fixed size header followed by 64 bytes aligned blocks,
+/// one block per attribute (structure of arrays). Every block can be used in place
+/// once the file is memory mapped, no parsing is required.
+///
+///  header | cell ids | x | y | z | membrane radii | masses | ... | cell properties
+///
+/// The header stores the spheroid delimitation and a checksum of all the blocks.
+
+namespace Common {
+
+namespace PopulationBinary {
+
+constexpr char Magic[8] = {'C', 'P', 'O', 'P', 'B', 'I', 'N', '\0'};
+constexpr std::uint32_t Version = 1;
+constexpr std::uint32_t ByteOrderMark = 0x01020304;
+constexpr std::size_t BlockAlignment = 64;
+constexpr const char* Extension = ".cpopb";
+
+/// Identifier of the blocks, their order is the order in the file
+enum Block: std::uint32_t {
+	CellId = 0,          // std::uint64_t[cellCount]
+	PositionX,           // double[cellCount]
+	PositionY,           // double[cellCount]
+	PositionZ,           // double[cellCount]
+	MembraneRadius,      // double[cellCount]
+	Mass,                // double[cellCount]
+	CellPropertiesId,    // std::uint32_t[cellCount]
+	LifeCycle,           // std::uint32_t[cellCount]
+	NucleusOffset,       // std::uint64_t[cellCount+1], nuclei of cell i are [offset[i], offset[i+1])
+	NucleusRadius,       // double[nucleusCount]
+	NucleusPositionType, // std::uint32_t[nucleusCount]
+	NucleusType,         // std::uint32_t[nucleusCount]
+	ContainedAgent,      // std::uint64_t[containedCount], agents of the simulated sub environment
+	EnvironmentName,     // char[]
+	SubEnvironmentName,  // char[]
+	CellProperties,      // char[], raw content of the ALL_CELL_PROPERTIES xml node
+	Count
+};
+
+struct BlockEntry {
+	std::uint64_t offset;
+	std::uint64_t size;
+};
+
+struct Header {
+	char magic[8];
+	std::uint32_t version;
+	std::uint32_t byteOrder;
+	std::uint64_t cellCount;
+	std::uint64_t nucleusCount;
+	std::uint64_t containedCount;
+	double internalRadius;
+	double externalRadius;
+	double center[3];
+	std::uint64_t checksum;   // FNV-1a of every byte following the header
+	BlockEntry blocks[Block::Count];
+};
+
+/// 64 bits FNV-1a hash, can be chained by giving the previous hash as seed
+std::uint64_t checksum(const void* data, std::size_t size, std::uint64_t seed = 0xcbf29ce484222325ULL);
+
+}
+
+/// PopulationData
+///
+/// In memory copy of a population, used to write a binary file and by the xml converter.
+
+struct PopulationData {
+	std::string environmentName{"main Environment"};
+	std::string subEnvironmentName{"MySimulatedSubEnv"};
+
+	// SpheresSDelimitation
+	double internalRadius{0.};
+	double externalRadius{0.};
+	double center[3]{0., 0., 0.};
+
+	std::vector<std::uint64_t> cellId;
+	std::vector<double> positionX;
+	std::vector<double> positionY;
+	std::vector<double> positionZ;
+	std::vector<double> membraneRadius;
+	std::vector<double> mass;
+	std::vector<std::uint32_t> cellPropertiesId;
+	std::vector<std::uint32_t> lifeCycle;
+
+	std::vector<std::uint64_t> nucleusOffset{0};
+	std::vector<double> nucleusRadius;
+	std::vector<std::uint32_t> nucleusPositionType;
+	std::vector<std::uint32_t> nucleusType;
+
+	std::vector<std::uint64_t> containedAgent;
+
+	std::string cellProperties;
+
+	[[nodiscard]] std::size_t cellCount() const { return cellId.size(); }
+	[[nodiscard]] std::size_t nucleusCount() const { return nucleusRadius.size(); }
+};
+
+/// Write a population in the binary format, throws std::runtime_error on failure
+void WritePopulationBinary(const PopulationData& population, const std::string& filename);
+
+/// MappedPopulation
+///
+/// Read only view of a binary population file. The file is memory mapped, the
+/// accessors return pointers inside the mapping: nothing is copied nor parsed.
+/// The view can be shared between threads.
+
+class MappedPopulation {
+public:
+	/// Map the file, check its header and, if verify is true, its checksum.
+	/// Throws std::runtime_error if the file is not a valid population.
+	explicit MappedPopulation(const std::string& filename, bool verify = true);
+	~MappedPopulation();
+
+	MappedPopulation(const MappedPopulation&) = delete;
+	MappedPopulation& operator=(const MappedPopulation&) = delete;
+
+	[[nodiscard]] const std::string& filename() const { return fFilename; }
+	[[nodiscard]] const PopulationBinary::Header& header() const { return *fHeader; }
+
+	[[nodiscard]] std::size_t cellCount() const { return fHeader->cellCount; }
+	[[nodiscard]] std::size_t nucleusCount() const { return fHeader->nucleusCount; }
+	[[nodiscard]] std::size_t containedCount() const { return fHeader->containedCount; }
+
+	[[nodiscard]] const std::uint64_t* cellId() const { return block<std::uint64_t>(PopulationBinary::CellId); }
+	[[nodiscard]] const double* positionX() const { return block<double>(PopulationBinary::PositionX); }
+	[[nodiscard]] const double* positionY() const { return block<double>(PopulationBinary::PositionY); }
+	[[nodiscard]] const double* positionZ() const { return block<double>(PopulationBinary::PositionZ); }
+	[[nodiscard]] const double* membraneRadius() const { return block<double>(PopulationBinary::MembraneRadius); }
+	[[nodiscard]] const double* mass() const { return block<double>(PopulationBinary::Mass); }
+	[[nodiscard]] const std::uint32_t* cellPropertiesId() const { return block<std::uint32_t>(PopulationBinary::CellPropertiesId); }
+	[[nodiscard]] const std::uint32_t* lifeCycle() const { return block<std::uint32_t>(PopulationBinary::LifeCycle); }
+	[[nodiscard]] const std::uint64_t* nucleusOffset() const { return block<std::uint64_t>(PopulationBinary::NucleusOffset); }
+	[[nodiscard]] const double* nucleusRadius() const { return block<double>(PopulationBinary::NucleusRadius); }
+	[[nodiscard]] const std::uint32_t* nucleusPositionType() const { return block<std::uint32_t>(PopulationBinary::NucleusPositionType); }
+	[[nodiscard]] const std::uint32_t* nucleusType() const { return block<std::uint32_t>(PopulationBinary::NucleusType); }
+	[[nodiscard]] const std::uint64_t* containedAgent() const { return block<std::uint64_t>(PopulationBinary::ContainedAgent); }
+
+	[[nodiscard]] std::string environmentName() const { return text(PopulationBinary::EnvironmentName); }
+	[[nodiscard]] std::string subEnvironmentName() const { return text(PopulationBinary::SubEnvironmentName); }
+	[[nodiscard]] std::string cellProperties() const { return text(PopulationBinary::CellProperties); }
+
+	/// Copy the mapped population, used to convert it back to xml
+	[[nodiscard]] PopulationData toData() const;
+
+private:
+	template<typename T>
+	[[nodiscard]] const T* block(PopulationBinary::Block id) const {
+		return reinterpret_cast<const T*>(fData + fHeader->blocks[id].offset);
+	}
+	[[nodiscard]] std::string text(PopulationBinary::Block id) const;
+
+	std::string fFilename;
+	const unsigned char* fData{nullptr};
+	std::size_t fSize{0};
+	const PopulationBinary::Header* fHeader{nullptr};
+};
+
+/// Tell if a file starts with the binary population magic number
+bool IsPopulationBinary(const std::string& filename);
+
+}
+
+#endif
@@ -0,0 +1,86 @@
+/// \file PopulationLoader.hh
+/// \brief Definition of the Common::PopulationLoader class
+
+#ifndef COMMON_POPULATION_LOADER_HH
+#define COMMON_POPULATION_LOADER_HH
+
+#include <memory>
+#include <string>
+
+#include <G4UImessenger.hh>
+#include <G4UIcmdWithAString.hh>
+#include <G4UIcmdWithAnInteger.hh>
+#include <G4UIcommand.hh>
+
+#include "PopulationBinary.hh"
+#include "CellExportMesh.hh"
+
+namespace Common {
+
+/// PopulationLoader class
+///
+/// Adds the /cpop/population/inputBinary command, the binary counterpart of
+/// /cpop/population/input. The file is memory mapped and kept alive for the whole
+/// run, so that the code of this repository (scoring, locator, mesh, cell geometry,
+/// sources) reads the cells without parsing anything.
+///
+/// cpop::Population is not part of this repository and only reads the CPOP_SAVE xml:
+/// it is given a xml regenerated once from the mapping, with every digit of the binary,
+/// and still parses it at each load. The binary format gives no load time gain: CPOP
+/// parses as much xml as with /cpop/population/input, only the loads of this repository
+/// are shortened. The xml is cached next to the binary
+/// file, or in the temporary directory when the directory of the binary is read only:
+///  - /cpop/population/xmlCache d : directory of the cached xml instead, before inputBinary
+///
+/// The mapped cells can also be tesselated by Common::CellExportMesh, an approximate mesh of this
+/// repository, CPOP building its own at /cpop/population/init anyway:
+///  - /cpop/population/meshThreads n : threads of the mesher (0 for all of them)
+///  - /cpop/population/meshFacets n  : maximum number of facets per cell
+///  - /cpop/population/meshFacetBudget n : maximum number of facets of an exported mesh (0 for no limit),
+///    the cells being meshed coarser when needed
+///  - /cpop/population/meshRegionRatios i e : internalRatio and intermediaryRatio used to tag the cells
+///    of a PLY export with their region (same meaning as the CPOP commands)
+///  - /cpop/population/exportMesh f  : mesh the population and stream it to f, binary PLY if f ends
+///    with .ply (with the cell_id and region of every face), ASCII OFF otherwise
+
+class PopulationLoader: public G4UImessenger
+{
+public:
+	PopulationLoader();
+
+	void SetNewValue(G4UIcommand* command, G4String newValue) override;
+
+	/// Mapped population, nullptr if /cpop/population/inputBinary has not been used
+	[[nodiscard]] const MappedPopulation* population() const { return fPopulation.get(); }
+
+	/// Mesh of the mapped population, built on first use
+	const CellExportMesh& mesh();
+
+	/// Ratios of /cpop/population/internalRatio and intermediaryRatio, the current values of the
+	/// CPOP commands, false if CPOP does not give them
+	static bool RegionRatios(double& internalRatio, double& intermediaryRatio);
+
+private:
+	void ExportMesh(const std::string& filename) const;
+
+	std::unique_ptr<MappedPopulation> fPopulation;
+	std::string fXmlCacheDirectory;
+	std::unique_ptr<CellExportMesh> fMesh;
+	int fMeshThreads{0};
+	int fMeshFacets{50};
+	long fMeshFacetBudget{0};
+	double fInternalRatio{0.01};
+	double fIntermediaryRatio{0.52};
+
+	G4UIcmdWithAString fInputBinaryCmd;
+	G4UIcmdWithAString fXmlCacheCmd;
+	G4UIcmdWithAnInteger fMeshThreadsCmd;
+	G4UIcmdWithAnInteger fMeshFacetsCmd;
+	G4UIcmdWithAnInteger fMeshFacetBudgetCmd;
+	G4UIcommand fMeshRegionRatiosCmd;
+	G4UIcmdWithAString fExportMeshCmd;
+};
+
+}
+
+#endif
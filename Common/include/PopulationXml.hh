@@ -0,0 +1,32 @@
+/// \file PopulationXml.hh
+/// \brief Conversion between the CPOP_SAVE xml and the binary population format
+
+#ifndef COMMON_POPULATION_XML_HH
+#define COMMON_POPULATION_XML_HH
+
+#include <string>
+
+#include "PopulationBinary.hh"
+
+/// Reader/writer of the CPOP_SAVE xml produced by IO::CPOP::save
+///
+/// Only the layout written by CPOP for a SpheresSDelimitation sub environment is
+/// supported (which is what GeneratePopulation produces). The ALL_CELL_PROPERTIES
+/// node is kept verbatim so that a xml -> binary -> xml round trip gives back the
+/// same file. All functions throw std::runtime_error on malformed input.
+
+namespace Common {
+
+PopulationData ReadPopulationXml(const std::string& filename);
+/// Numbers written with precision significant digits, 6 as CPOP does by default, 17 to keep every bit
+void WritePopulationXml(const PopulationData& population, const std::string& filename, int precision = 6);
+
+/// Population of a binary file, or of a xml one otherwise
+PopulationData ReadPopulation(const std::string& filename);
+
+void ConvertXmlToBinary(const std::string& xmlFilename, const std::string& binaryFilename);
+void ConvertBinaryToXml(const std::string& binaryFilename, const std::string& xmlFilename);
+
+}
+
+#endif
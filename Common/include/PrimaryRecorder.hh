@@ -0,0 +1,99 @@
+/// \file PrimaryRecorder.hh
+/// \brief Definition of the Common::PrimaryRecorder class
+
+#ifndef COMMON_PRIMARY_RECORDER_HH
+#define COMMON_PRIMARY_RECORDER_HH
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <G4UImessenger.hh>
+#include <G4UIcmdWithAString.hh>
+#include <G4UIcommand.hh>
+#include <G4VUserActionInitialization.hh>
+
+#include "PrimaryRecords.hh"
+#include "Shard.hh"
+
+class G4Event;
+
+namespace Common {
+
+/// PrimaryRecorder class
+///
+/// Records the primaries of the events in the binary primary records format, and replays
+/// them, in place of the text of /cpop/population/writeInfoPrimariesTxt and
+/// /cpop/source/usePositionsDirectionsTxt (see PrimaryRecords.hh, the converter
+/// convertPrimaries writing them as text and back):
+///
+///  - /cpop/primaries/record f        : record the primaries of the events of the next runs in
+///    f (none to stop), each run writing the file again
+///  - /cpop/primaries/replay f [m] [e] : give the primaries of each event the positions and
+///    directions of the primaries recorded for the same event in f (none to stop), m being
+///    same (default) or opposite, the directions being reversed, as the SamePositions_SameDirections
+///    and SamePositions_OppositeDirections methods; their energies too if e is true (false by default)
+///
+/// The files of a shard have its suffix (ShardFileName): each shard records and replays its own
+/// primaries, its events being numbered from 0.
+///
+/// The primary generator actions of the workers are wrapped (Wrap): the primaries are
+/// generated by the wrapped action, then replayed, then recorded. Each worker records the
+/// primaries of its events in a buffer of its own, written as a chunk when full (see
+/// Common::PrimaryRecordWriter), and the file is completed by EndOfRun, on the master after
+/// each run (see Common::CreateRunManager). The replayed file is mapped once by the master
+/// and read by all the workers, which look their events up in its index. The events without
+/// records keep their primaries as generated, and are counted at the end of the run.
+
+class PrimaryRecorder: public G4UImessenger
+{
+public:
+	/// State of a worker
+	struct Slot {
+		PrimaryRecordWriter::Buffer* buffer{nullptr};
+		std::vector<PrimaryRecords::Record> records;
+	};
+
+	explicit PrimaryRecorder(const Shard& shard = Shard());
+
+	void SetNewValue(G4UIcommand* command, G4String newValue) override;
+
+	/// Actions building those of actions with their primaries replayed and recorded, takes
+	/// the ownership of actions
+	G4VUserActionInitialization* Wrap(G4VUserActionInitialization* actions);
+
+	/// Slot of a new worker, owned by the recorder
+	Slot& NewSlot();
+
+	/// Replay then record the primaries of event (worker)
+	void Process(G4Event& event, Slot& slot) const;
+
+	/// Complete the file recorded and report the events replayed, for the run which just ended (master)
+	void EndOfRun();
+
+private:
+	void Replay(G4Event& event) const;
+	void Record(const G4Event& event, Slot& slot) const;
+
+	Shard fShard;
+	std::string fRecordFile;
+	std::unique_ptr<MappedPrimaryRecords> fReplay;
+	bool fOpposite{false};
+	bool fReplayEnergies{false};
+
+	mutable std::mutex fMutex;
+	std::vector<std::unique_ptr<Slot>> fSlots;
+	mutable std::unique_ptr<PrimaryRecordWriter> fWriter;
+	mutable std::atomic<long> fReplayed{0};
+	mutable std::atomic<long> fMissing{0};
+	mutable std::atomic<long> fMismatched{0};
+
+	G4UIcmdWithAString fRecordCmd;
+	G4UIcommand fReplayCmd;
+};
+
+}
+
+#endif
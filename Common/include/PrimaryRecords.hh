@@ -0,0 +1,190 @@
+/// \file PrimaryRecords.hh
+/// \brief Definition of the primary records format (Common::PrimaryRecordWriter, Common::MappedPrimaryRecords)
+
+#ifndef COMMON_PRIMARY_RECORDS_HH
+#define COMMON_PRIMARY_RECORDS_HH
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// Primary records format
+///
+/// A binary alternative to the text written by /cpop/population/writeInfoPrimariesTxt:
+/// one fixed size record per primary particle (position, direction, kinetic energy,
+/// particle and event), the records of an event being contiguous. The records are written
+/// by chunks, each thread appending the chunks of its events as they fill, so that they
+/// are in the order of the chunks, not of the events: an index of the events, sorted by
+/// event id, follows them and gives the records of any event.
+///
+///  header | records (chunks of the threads) | event index
+///
+/// The header is written last, by Close: a file whose writing did not end has no valid
+/// header. The records and the index can be used in place once the file is memory mapped.
+
+namespace Common {
+
+namespace PrimaryRecords {
+
+constexpr char Magic[8] = {'C', 'P', 'O', 'P', 'P', 'R', 'I', 'M'};
+constexpr std::uint32_t Version = 1;
+constexpr std::uint32_t ByteOrderMark = 0x01020304;
+constexpr std::size_t BlockAlignment = 64;
+constexpr const char* Extension = ".cpopp";
+
+/// Primary particle, in mm and MeV
+struct Record {
+	double position[3];   // of its vertex
+	double direction[3];  // unit momentum direction
+	double energy;        // kinetic energy
+	std::int64_t event;
+	std::int32_t pdg;     // PDG code of the particle
+	std::uint32_t vertex; // index of its vertex in the event
+};
+
+/// Records of an event, records [first, first+count)
+struct EventEntry {
+	std::int64_t event;
+	std::uint64_t first;
+	std::uint64_t count;
+};
+
+struct Header {
+	char magic[8];
+	std::uint32_t version;
+	std::uint32_t byteOrder;
+	std::uint64_t recordCount;
+	std::uint64_t eventCount;
+	std::uint64_t chunkCount;
+	std::uint64_t recordsOffset;  // Record[recordCount]
+	std::uint64_t indexOffset;    // EventEntry[eventCount], sorted by event
+};
+
+}
+
+/// PrimaryRecordWriter
+///
+/// Writes primary records from several threads. Each thread gets a Buffer (NewBuffer),
+/// adds the primaries of its events to it, and the buffer writes them as a chunk once it
+/// holds chunkRecords records: the place of the chunk in the file is reserved under a
+/// lock, then the chunk is written there without it (pwrite), so that the threads do not
+/// wait on each other's writes. Close writes the buffers left, the index and the header.
+
+class PrimaryRecordWriter {
+public:
+	/// Records of a thread not written yet
+	class Buffer {
+	public:
+		Buffer(PrimaryRecordWriter& writer, std::size_t chunkRecords);
+
+		/// Add the count primaries of event, written as a chunk when the buffer is full
+		void AddEvent(std::int64_t event, const PrimaryRecords::Record* records, std::size_t count);
+
+		/// Write the records of the buffer
+		void Flush();
+
+	private:
+		friend class PrimaryRecordWriter;
+
+		PrimaryRecordWriter& fWriter;
+		std::size_t fChunkRecords;
+		std::vector<PrimaryRecords::Record> fRecords;
+		std::vector<PrimaryRecords::EventEntry> fEvents;  // first relative to the buffer until written
+		std::vector<PrimaryRecords::EventEntry> fWritten; // events of the chunks written
+	};
+
+	/// Write to filename (truncated), by chunks of chunkRecords records,
+	/// throws std::runtime_error if filename cannot be written
+	explicit PrimaryRecordWriter(const std::string& filename, std::size_t chunkRecords = 4096);
+	~PrimaryRecordWriter();
+
+	PrimaryRecordWriter(const PrimaryRecordWriter&) = delete;
+	PrimaryRecordWriter& operator=(const PrimaryRecordWriter&) = delete;
+
+	/// Buffer of a new thread, owned by the writer (thread safe)
+	Buffer& NewBuffer();
+
+	/// Write the buffers left, the index and the header, throws std::runtime_error if an event
+	/// is given twice or on a write failure; the buffers must not be used any more
+	void Close();
+
+	[[nodiscard]] const std::string& filename() const { return fFilename; }
+	[[nodiscard]] std::uint64_t recordCount() const { return fRecordCount; }
+
+private:
+	/// Reserve the place of count records, returns the index of the first one
+	std::uint64_t Reserve(std::size_t count);
+	void WriteAt(const void* data, std::size_t size, std::uint64_t offset);
+
+	std::string fFilename;
+	std::size_t fChunkRecords;
+	int fFile{-1};
+	std::atomic<bool> fFailed{false};
+
+	std::mutex fMutex;
+	std::uint64_t fRecordCount{0};
+	std::uint64_t fChunkCount{0};
+	std::vector<std::unique_ptr<Buffer>> fBuffers;
+};
+
+/// MappedPrimaryRecords
+///
+/// Read only view of a primary records file. The file is memory mapped, the records of an
+/// event are found by a binary search in the index and returned in place: nothing is
+/// copied nor parsed. The view can be shared between threads.
+
+class MappedPrimaryRecords {
+public:
+	/// Records of an event
+	struct Span {
+		const PrimaryRecords::Record* records{nullptr};
+		std::size_t count{0};
+	};
+
+	/// Map the file and check its header and index.
+	/// Throws std::runtime_error if the file is not a valid primary records file.
+	explicit MappedPrimaryRecords(const std::string& filename);
+	~MappedPrimaryRecords();
+
+	MappedPrimaryRecords(const MappedPrimaryRecords&) = delete;
+	MappedPrimaryRecords& operator=(const MappedPrimaryRecords&) = delete;
+
+	[[nodiscard]] const std::string& filename() const { return fFilename; }
+	[[nodiscard]] std::size_t recordCount() const { return fHeader->recordCount; }
+	[[nodiscard]] std::size_t eventCount() const { return fHeader->eventCount; }
+
+	/// Records in the file order and events sorted by id
+	[[nodiscard]] const PrimaryRecords::Record* records() const { return fRecords; }
+	[[nodiscard]] const PrimaryRecords::EventEntry* events() const { return fEvents; }
+
+	/// Records of event, empty if it has none
+	[[nodiscard]] Span Find(std::int64_t event) const;
+
+private:
+	std::string fFilename;
+	const unsigned char* fData{nullptr};
+	std::size_t fSize{0};
+	const PrimaryRecords::Header* fHeader{nullptr};
+	const PrimaryRecords::Record* fRecords{nullptr};
+	const PrimaryRecords::EventEntry* fEvents{nullptr};
+};
+
+/// Tell if a file starts with the primary records magic number
+bool IsPrimaryRecords(const std::string& filename);
+
+/// Write the records of a file as text, one primary per line in the order of the events:
+/// x y z dx dy dz E (mm, MeV), preceded by the event and the PDG code if withEvents is true.
+/// Throws std::runtime_error on failure.
+void ConvertPrimaryRecordsToText(const std::string& input, const std::string& output, bool withEvents);
+
+/// Write the primaries of a text file (as written by ConvertPrimaryRecordsToText) as records,
+/// one event per line if the lines have no event. Throws std::runtime_error on failure.
+void ConvertTextToPrimaryRecords(const std::string& input, const std::string& output);
+
+}
+
+#endif
@@ -0,0 +1,95 @@
+/// \file PrimarySpectra.hh
+/// \brief Definition of the Common::PrimarySpectra class
+
+#ifndef COMMON_PRIMARY_SPECTRA_HH
+#define COMMON_PRIMARY_SPECTRA_HH
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <G4UImessenger.hh>
+#include <G4UIcommand.hh>
+#include <G4UIdirectory.hh>
+#include <G4VUserActionInitialization.hh>
+
+#include "Spectrum.hh"
+
+class G4Event;
+
+namespace Common {
+
+/// PrimarySpectra class
+///
+/// Draws the kinetic energy of the primaries from spectrum files with Common::Spectrum,
+/// in constant time per primary whatever the number of rows of the spectrum:
+///
+///  - /cpop/primaries/spectrum s f [m] [p] : energies of the primaries of the CPOP source s drawn
+///    from the spectrum file f (format of /cpop/source/<name>/spectrum), m being auto (default),
+///    lines or histogram (see Common::Spectrum). The primaries of the source are those of its
+///    particle p, the current value of /cpop/source/<s>/particle by default. A source given
+///    again replaces its spectrum.
+///
+/// The events do not tell which source emitted them: the spectrum of a source applies to the
+/// primaries of its particle, so that two sources with a spectrum cannot have the same
+/// particle (std::runtime_error), and the primaries of another source of the same particle
+/// are drawn from it as well.
+///
+/// The spectra are read once by the master and shared read only by the workers, whose
+/// primary generator actions are wrapped (Wrap): the primaries are generated by the wrapped
+/// action (positions, directions), then the energy of those of a source with a spectrum is
+/// drawn again, the energy given by the CPOP source being replaced. CPOP still draws its own
+/// energies, so their time is not saved, and the text of /cpop/population/writeInfoPrimariesTxt,
+/// written by CPOP, keeps them: /cpop/primaries/record records the energies drawn here. The
+/// spectra must not be changed during a run.
+///
+/// The wrapped actions are timed: after each run, EndOfRun prints the mean time per event of the
+/// generation by CPOP (positions, directions and energies of its primaries, which bounds the time
+/// of its own draw) and the mean time per primary of the energies drawn again here.
+
+class PrimarySpectra: public G4UImessenger
+{
+public:
+	PrimarySpectra();
+
+	void SetNewValue(G4UIcommand* command, G4String newValue) override;
+
+	/// Actions building those of actions with the energies of their primaries drawn from
+	/// the spectra, takes the ownership of actions
+	G4VUserActionInitialization* Wrap(G4VUserActionInitialization* actions);
+
+	/// Draw the energies of the primaries of event having a spectrum, returns their number (worker)
+	std::size_t Sample(G4Event& event) const;
+
+	/// Add the time of the generation of an event by the wrapped action and the time of the
+	/// draw of its nDrawn energies, in seconds (worker)
+	void AddTimes(double generation, double sampling, std::size_t nDrawn) const;
+
+	/// Print the times of the primaries of the run which just ended, then reset them (master)
+	void EndOfRun() const;
+
+	[[nodiscard]] bool empty() const { return fSpectra.empty(); }
+
+private:
+	struct SourceSpectrum {
+		std::string source;
+		std::string particle;
+		Spectrum spectrum;
+	};
+
+	std::vector<SourceSpectrum> fSpectra;
+
+	// times of the run, in ns
+	mutable std::atomic<std::uint64_t> fEvents{0};
+	mutable std::atomic<std::uint64_t> fGenerationTime{0};
+	mutable std::atomic<std::uint64_t> fDrawn{0};
+	mutable std::atomic<std::uint64_t> fSamplingTime{0};
+
+	G4UIdirectory fDirectory;
+	G4UIcommand fSpectrumCmd;
+};
+
+}
+
+#endif
@@ -0,0 +1,53 @@
+/// \file RunManager.hh
+/// \brief Definition of the Common::CreateRunManager function
+
+#ifndef COMMON_RUN_MANAGER_HH
+#define COMMON_RUN_MANAGER_HH
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include <G4RunManager.hh>
+
+#include "Shard.hh"
+
+namespace Common {
+
+/// Run managers of the radiation examples (-r option):
+///  - serial  : G4RunManager, a single thread;
+///  - mt      : G4MTRunManager, the events are handed out to the threads by chunks;
+///  - tasking : G4TaskRunManager, the chunks are tasks of a thread pool with work stealing,
+///              which keeps every core busy until the end of runs with heavy-tailed events.
+///
+/// The multithreaded ones time each run: the events per chunk (/run/eventModulo) of the
+/// next run are sized so that a chunk takes about ChunkDuration seconds on a thread, from
+/// the cost per event measured, while keeping at least ChunksPerThread chunks per thread
+/// so that the threads finish together. The first run uses the Geant4 default
+/// (sqrt(events/threads)). A chunk size set with /run/eventModulo takes precedence.
+/// Every run prints its throughput (events/s), then calls endOfRun with the number of events,
+/// of threads and the duration of the run in seconds (see Common::MemoryReport,
+/// Common::OutputMerger, Common::CellDoseScorer and Common::ImportanceSampling).
+/// The runs of a shard (see Common::Shard) write to the file of /analysis/setFileName with
+/// the suffix of the shard.
+enum class RunManagerType { Serial, MT, Tasking };
+
+constexpr double ChunkDuration = 0.1;  // s
+constexpr int ChunksPerThread = 8;
+
+/// Parse a run manager name (case insensitive), false if unknown
+bool ParseRunManagerType(const std::string& name, RunManagerType& type);
+
+/// nThreads > 0 threads, the available cores if < 0 (see AvailableCores), the Geant4 default if 0
+/// (G4FORCENUMBEROFTHREADS or /run/numberOfThreads, 2 otherwise)
+std::unique_ptr<G4RunManager> CreateRunManager(
+	RunManagerType type, int nThreads, std::function<void(int nEvent, int nThreads, double seconds)> endOfRun = nullptr,
+	const Shard& shard = Shard()
+);
+
+/// Events per chunk for a run of nEvent on nThreads, the cost of an event on a thread being eventCost (s)
+int EventChunk(long nEvent, int nThreads, double eventCost);
+
+}
+
+#endif
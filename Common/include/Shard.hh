@@ -0,0 +1,57 @@
+/// \file Shard.hh
+/// \brief Definition of the Common::Shard struct
+
+#ifndef COMMON_SHARD_HH
+#define COMMON_SHARD_HH
+
+#include <string>
+#include <vector>
+
+namespace Common {
+
+/// Shard of a radiation run split over processes (--shard i/N option of the examples)
+///
+/// Every shard runs the same macro, with its own random streams and output files, so
+/// that N shards simulate N times the events of the macro: the shards of a run are the
+/// disjoint slices of a run N times larger, and are merged into it by mergeShards.
+///  - the seeds of the random engines (ShardEngine) of the shard i are given by ShardSeed,
+///    a bijection of (i, engine): the shard 0 has the seeds of a run without --shard, and
+///    no two engines of any shards have the same seed. They only depend on i, so that a
+///    shard is reproducible and a run can be extended by adding shards;
+///  - the output file of /analysis/setFileName gets the suffix _shard<i>of<N> before its
+///    extension (ShardFileName), as do the files derived from it (thread files, cell doses)
+///    and those of /cpop/primaries/record and /cpop/primaries/replay (see PrimaryRecorder).
+///    Every shard numbers its events from 0: mergeShards adds the shard of each row to the
+///    merged ntuples (column shard, -1 for the summaries of the whole run).
+struct Shard {
+	unsigned index{0};
+	unsigned count{1};
+
+	/// True if the run is split (--shard given)
+	[[nodiscard]] bool split() const { return count > 1 || index > 0; }
+};
+
+/// Random engines of the examples
+enum class ShardEngine: unsigned {
+	Geant4 = 0, // G4Random
+	CPOP = 1    // RandomEngineManager of CPOP
+};
+
+/// Parse "i/N" with i < N <= 2^30, false if malformed
+bool ParseShard(const std::string& text, Shard& shard);
+
+/// Seed (31 bits) of engine for the shard index
+long ShardSeed(ShardEngine engine, unsigned index);
+
+/// fileName with the suffix of shard before its extension, unchanged if the run is not split
+std::string ShardFileName(const std::string& fileName, const Shard& shard);
+
+/// Shard of a file named by ShardFileName, false if it has no shard suffix
+bool ParseShardFileName(const std::string& fileName, Shard& shard);
+
+/// Check that files are the N shards of a run, once each, throws std::runtime_error otherwise
+void CheckShardFiles(const std::vector<std::string>& files);
+
+}
+
+#endif
@@ -0,0 +1,93 @@
+/// \file SourcePlacement.hh
+/// \brief Definition of the Common::SourcePlacement class
+
+#ifndef COMMON_SOURCE_PLACEMENT_HH
+#define COMMON_SOURCE_PLACEMENT_HH
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "CellExportMesh.hh"
+
+namespace Common {
+
+/// Source placed in a cell, its position in the length unit of the cells
+struct PlacedSource {
+	float position[3];
+	std::uint32_t cell;  // index of the cell
+};
+
+/// Placement of the sources, with the meaning of the CPOP commands of the same names
+struct SourceSettings {
+	static constexpr std::uint64_t NoLimit = std::numeric_limits<std::uint64_t>::max();
+
+	std::array<std::uint64_t, 3> distributionInRegion{0, 0, 0};  // sources of the necrosis, intermediary and external regions
+	std::array<double, 4> distributionInCell{0., 1., 0., 0.};   // cell membrane, nucleus, nucleus membrane, cytoplasm
+	std::array<std::uint64_t, 3> maxSourcesPerCell{NoLimit, NoLimit, NoLimit};  // per region
+	std::array<double, 3> cellLabelingPercentagePerRegion{100., 100., 100.};
+	std::uint64_t seed{1};
+};
+
+/// SourcePlacement class
+///
+/// Places the sources of a population as /cpop/source/init does: the sources of each
+/// region are spread over the labelled cells of the region (a percentage of its cells),
+/// at most maxSourcesPerCell in a cell, and each source is put in an organelle of its cell
+/// drawn from distributionInCell: on the membrane of the cell, in its nucleus, on the
+/// membrane of its nucleus or in its cytoplasm. The cells are spheres with a spherical
+/// nucleus at their center, as for Common::CellLocator.
+///
+/// Nothing is rejected: the sampler of a cell, built once for the population, draws a point
+/// of an organelle directly from its radii (uniform in a ball or a shell, on a sphere). The
+/// placement is done in three passes:
+///  - the labelled cells of each region are the cells of the smallest keys, a hash of the
+///    seed and of the cell;
+///  - the number of sources of each labelled cell is drawn from the multinomial distribution
+///    of the sources of its region over them, by binomial splits of the range of the cells,
+///    the sources above the limit of a cell being drawn again over the cells below it;
+///  - the positions are drawn by the threads, cell by cell, each cell from a random stream
+///    of its own (a hash of the seed and of the cell) and into its own slots of the array.
+/// The result only depends on the population, the settings and the seed, not on the number
+/// of threads. The sources are sorted by cell.
+
+class SourcePlacement {
+public:
+	SourcePlacement() = default;
+
+	/// Samplers of the cells, nucleusRadius[i] being the radius of the nucleus of the cell i
+	/// (0 for none) and regions[i] its region (see CellRegions), in the length unit of cells
+	SourcePlacement(const CellArrays& cells, const std::vector<double>& nucleusRadius, std::vector<std::uint8_t> regions);
+
+	/// Place the sources of settings on nThread threads (0 for all the cores).
+	/// Throws std::invalid_argument if the labelled cells of a region cannot hold its sources.
+	[[nodiscard]] std::vector<PlacedSource> Place(const SourceSettings& settings, int nThread) const;
+
+	/// Number of sources of each cell for settings (the first passes of Place)
+	[[nodiscard]] std::vector<std::uint64_t> Counts(const SourceSettings& settings) const;
+
+	[[nodiscard]] std::size_t size() const { return fSamplers.size(); }
+
+private:
+	/// Radii of the organelles of a cell
+	struct CellSampler {
+		double center[3];
+		double membrane;
+		double nucleus;
+		double nucleus3;   // nucleus^3
+		double membrane3;  // membrane^3
+	};
+
+	std::vector<CellSampler> fSamplers;
+	std::vector<std::uint8_t> fRegions;
+};
+
+/// Index of the source emitting the event, for count sources emitting particlesPerSource events each:
+/// the sources are visited in a scrambled order, so that a run of fewer events spreads over the cells
+std::size_t SourceOfEvent(std::uint64_t event, std::uint64_t particlesPerSource, std::size_t count);
+
+}
+
+#endif
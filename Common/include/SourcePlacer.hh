@@ -0,0 +1,126 @@
+/// \file SourcePlacer.hh
+/// \brief Definition of the Common::SourcePlacer class
+
+#ifndef COMMON_SOURCE_PLACER_HH
+#define COMMON_SOURCE_PLACER_HH
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <G4UImessenger.hh>
+#include <G4UIcmdWithADoubleAndUnit.hh>
+#include <G4UIcmdWithAString.hh>
+#include <G4UIcmdWithAnInteger.hh>
+#include <G4UIcmdWithoutParameter.hh>
+#include <G4UIcommand.hh>
+#include <G4UIdirectory.hh>
+#include <G4VUserActionInitialization.hh>
+
+#include "SourcePlacement.hh"
+
+class G4Event;
+
+namespace Common {
+
+class PopulationLoader;
+
+/// SourcePlacer class
+///
+/// Places the sources of a distribution in the cells of the population in parallel, in place of
+/// the serial placement of /cpop/source/init (see Common::SourcePlacement), and emits the
+/// primaries of the events from them. The commands have the meaning of those of a CPOP
+/// distribution of the same names:
+///
+///  - /cpop/sources/population f                       : population of the sources, xml or binary, the
+///    one of /cpop/population/inputBinary by default
+///  - /cpop/sources/populationUnit l                   : length unit of the population file (um by default)
+///  - /cpop/sources/regionRatios i e                   : internalRatio and intermediaryRatio defining the regions
+///    of the cells, those of /cpop/population/internalRatio and intermediaryRatio by default
+///  - /cpop/sources/totalSource n                      : number of sources, the sum of distributionInRegion
+///  - /cpop/sources/distributionInRegion n i e         : sources of the necrosis, intermediary and external regions
+///  - /cpop/sources/distributionInCell m n nm c        : proportions of the sources on the cell membrane, in the
+///    nucleus, on the nucleus membrane and in the cytoplasm (0 1 0 0 by default)
+///  - /cpop/sources/maxSourcesPerCell n i e            : maximum number of sources in a cell of each region (no limit by default)
+///  - /cpop/sources/cellLabelingPercentagePerRegion n i e : percentage of labelled cells of each region (100 by default)
+///  - /cpop/sources/particlesPerSource n               : events emitted from each source (1 by default)
+///  - /cpop/sources/seed s                             : seed of the placement (1 by default)
+///  - /cpop/sources/threads n                          : threads of the placement (0, the default, for all the cores)
+///  - /cpop/sources/init                               : place the sources, which the next runs emit from
+///  - /cpop/sources/clear                              : emit from the sources of CPOP again
+///
+/// The samplers of the cells are built once for the population, the regions and the
+/// population being read again only when they change, so that /cpop/sources/init can be
+/// repeated with other settings between runs. The sources are kept as one array of 16 bytes
+/// per source, written by the master at init and only read by the workers during the runs.
+///
+/// The primary generator actions of the workers are wrapped (Wrap): the primaries are
+/// generated by the wrapped action (particle, energy and direction of the CPOP source), then
+/// every vertex of the event is moved to its source, SourceOfEvent(event id, particlesPerSource):
+/// a worker finds the source of its event without a lock nor a shared counter, and a run of
+/// totalSource x particlesPerSource events emits particlesPerSource events from each source.
+///
+/// The CPOP source still has to be initialized by /cpop/source/init, which places its own
+/// sources serially at its totalSource: the time to the first event is not shortened, only the
+/// placement of the sources emitted from is repeatable and parallel. The positions of CPOP
+/// (writeInfoPrimariesTxt, the sources and labelled cells of its outputs) are those of its own
+/// placement and not the sources emitted from, which /cpop/primaries/record records.
+
+class SourcePlacer: public G4UImessenger
+{
+public:
+	SourcePlacer();
+
+	void SetNewValue(G4UIcommand* command, G4String newValue) override;
+
+	/// Population of /cpop/population/inputBinary
+	void SetPopulationLoader(const PopulationLoader& loader) { fLoader = &loader; }
+
+	/// Actions building those of actions with their primaries emitted from the sources, takes
+	/// the ownership of actions
+	G4VUserActionInitialization* Wrap(G4VUserActionInitialization* actions);
+
+	/// Move the vertices of event to its source (worker)
+	void Emit(G4Event& event) const;
+
+	/// Sources placed by the last /cpop/sources/init, in the length unit of the population
+	[[nodiscard]] const std::vector<PlacedSource>& sources() const { return fSources; }
+
+private:
+	void BuildSamplers();
+	void Init();
+
+	std::string fPopulationFile;
+	double fUnit;
+	const PopulationLoader* fLoader{nullptr};
+	double fInternalRatio{0.};  // ratios of the samplers
+	double fIntermediaryRatio{0.};
+	bool fRegionRatiosSet{false};
+	std::uint64_t fTotalSource{0};
+	SourceSettings fSettings;
+	std::uint64_t fParticlesPerSource{1};
+	int fThreads{0};
+
+	std::unique_ptr<SourcePlacement> fPlacement;  // samplers of the cells, built at the first init
+	std::vector<PlacedSource> fSources;
+
+	G4UIdirectory fDirectory;
+	G4UIcmdWithAString fPopulationCmd;
+	G4UIcmdWithADoubleAndUnit fPopulationUnitCmd;
+	G4UIcommand fRegionRatiosCmd;
+	G4UIcmdWithAnInteger fTotalSourceCmd;
+	G4UIcommand fDistributionInRegionCmd;
+	G4UIcommand fDistributionInCellCmd;
+	G4UIcommand fMaxSourcesPerCellCmd;
+	G4UIcommand fLabelingCmd;
+	G4UIcmdWithAnInteger fParticlesPerSourceCmd;
+	G4UIcmdWithAnInteger fSeedCmd;
+	G4UIcmdWithAnInteger fThreadsCmd;
+	G4UIcmdWithoutParameter fInitCmd;
+	G4UIcmdWithoutParameter fClearCmd;
+};
+
+}
+
+#endif
@@ -0,0 +1,76 @@
+/// \file Spectrum.hh
+/// \brief Definition of the Common::Spectrum class
+
+#ifndef COMMON_SPECTRUM_HH
+#define COMMON_SPECTRUM_HH
+
+#include <string>
+#include <vector>
+
+#include "AliasTable.hh"
+
+namespace Common {
+
+/// Spectrum class
+///
+/// Energy spectrum of a source, in the format of /cpop/source/<name>/spectrum:
+///
+///     <count> <type> <energy>
+///     <energy> <intensity>
+///     ...
+///
+/// (count rows, energies in MeV). The spectrum is either a set of lines, each
+/// energy being emitted as is, or a histogram whose energies are the centers of
+/// its bins, the energy being drawn uniformly inside the bin. The bins are bounded
+/// by the middles of consecutive centers. Auto takes evenly spaced energies (at
+/// least 3) as a histogram, anything else as lines.
+///
+/// A row is chosen in constant time with a Common::AliasTable. Read only once
+/// built, so thread safe.
+
+class Spectrum {
+public:
+	enum class Mode { Auto, Lines, Histogram };
+
+	Spectrum() = default;
+
+	/// Throws std::invalid_argument if the intensities are not valid (see AliasTable)
+	Spectrum(std::vector<double> energies, std::vector<double> intensities, Mode mode = Mode::Auto);
+
+	/// Read a spectrum file, throws std::runtime_error on malformed input
+	static Spectrum Read(const std::string& filename, Mode mode = Mode::Auto);
+
+	/// Parse a mode name (case insensitive), false if unknown
+	static bool ParseMode(const std::string& name, Mode& mode);
+
+	/// Energy (MeV) for two uniform numbers in [0, 1), the second one only used by histograms
+	[[nodiscard]] double Sample(double u1, double u2) const {
+		std::size_t const i = fTable.Sample(u1);
+		return fHistogram ? fLow[i] + u2*(fHigh[i] - fLow[i]) : fEnergies[i];
+	}
+
+	/// Same distribution as Sample, by a binary search of the cumulative intensities (reference)
+	[[nodiscard]] double SampleInverse(double u1, double u2) const;
+
+	[[nodiscard]] bool histogram() const { return fHistogram; }
+	[[nodiscard]] std::size_t size() const { return fEnergies.size(); }
+	[[nodiscard]] const std::vector<double>& energies() const { return fEnergies; }
+	[[nodiscard]] const std::vector<double>& probabilities() const { return fProbabilities; }
+
+	/// Bounds of the bin i of a histogram, [energies()[i], energies()[i]] for a line
+	[[nodiscard]] double low(std::size_t i) const { return fHistogram ? fLow[i] : fEnergies[i]; }
+	[[nodiscard]] double high(std::size_t i) const { return fHistogram ? fHigh[i] : fEnergies[i]; }
+
+private:
+	bool fHistogram{false};
+	std::vector<double> fEnergies;  // sorted
+	std::vector<double> fProbabilities;
+	std::vector<double> fCumulative;
+	std::vector<double> fLow;
+	std::vector<double> fHigh;
+	AliasTable fTable;
+};
+
+}
+
+#endif
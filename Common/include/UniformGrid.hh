@@ -0,0 +1,102 @@
+/// \file UniformGrid.hh
+/// \brief Definition of the Common::UniformGrid class
+
+#ifndef COMMON_UNIFORM_GRID_HH
+#define COMMON_UNIFORM_GRID_HH
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace Common {
+
+/// UniformGrid class
+///
+/// Cell list over a set of points: the bounding box of the points is split in
+/// cubes of a given size and the points are sorted by cube. With a cube size
+/// greater or equal to an interaction distance, every point interacting with p
+/// is in one of the 27 cubes around p. Read only once built, so thread safe.
+
+class UniformGrid {
+public:
+	using Point = std::array<double, 3>;
+
+	UniformGrid() = default;
+
+	/// position(i) gives the point i, for i in [0, count)
+	template<typename PositionFn>
+	UniformGrid(std::size_t count, PositionFn&& position, double cubeSize) {
+		Build(count, position, cubeSize);
+	}
+
+	template<typename PositionFn>
+	void Build(std::size_t count, PositionFn&& position, double cubeSize) {
+		fCubeSize = cubeSize > 0. ? cubeSize : 1.;
+
+		for(int axis = 0; axis < 3; ++axis) {
+			double lo = count == 0 ? 0. : position(0)[axis];
+			double hi = lo;
+			for(std::size_t i = 1; i < count; ++i) {
+				lo = std::min(lo, position(i)[axis]);
+				hi = std::max(hi, position(i)[axis]);
+			}
+			fOrigin[axis] = lo;
+			fDim[axis] = static_cast<long>((hi - lo)/fCubeSize) + 1;
+		}
+
+		// counting sort of the points by cube, the order inside a cube is the input order
+		std::vector<long> key(count);
+		fStart.assign(fDim[0]*fDim[1]*fDim[2] + 1, 0);
+		for(std::size_t i = 0; i < count; ++i) {
+			key[i] = Key(Coordinates(position(i)));
+			++fStart[key[i]+1];
+		}
+		for(std::size_t k = 1; k < fStart.size(); ++k)
+			fStart[k] += fStart[k-1];
+
+		fSorted.resize(count);
+		std::vector<std::size_t> next(fStart.begin(), fStart.end()-1);
+		for(std::size_t i = 0; i < count; ++i)
+			fSorted[next[key[i]]++] = i;
+	}
+
+	/// Call fn(i) for every point i in the 27 cubes around p (p itself included if it is a point)
+	template<typename Fn>
+	void ForEachCandidate(const Point& p, Fn&& fn) const {
+		if(fSorted.empty())
+			return;
+		auto const c = Coordinates(p);
+		for(long x = std::max(0L, c[0]-1); x <= std::min(fDim[0]-1, c[0]+1); ++x)
+			for(long y = std::max(0L, c[1]-1); y <= std::min(fDim[1]-1, c[1]+1); ++y)
+				for(long z = std::max(0L, c[2]-1); z <= std::min(fDim[2]-1, c[2]+1); ++z) {
+					long const k = Key({x, y, z});
+					for(std::size_t s = fStart[k]; s < fStart[k+1]; ++s)
+						fn(fSorted[s]);
+				}
+	}
+
+	[[nodiscard]] double cubeSize() const { return fCubeSize; }
+
+private:
+	[[nodiscard]] std::array<long, 3> Coordinates(const Point& p) const {
+		std::array<long, 3> c{};
+		for(int axis = 0; axis < 3; ++axis)
+			c[axis] = std::clamp(static_cast<long>((p[axis] - fOrigin[axis])/fCubeSize), 0L, fDim[axis]-1);
+		return c;
+	}
+
+	[[nodiscard]] long Key(const std::array<long, 3>& c) const {
+		return (c[0]*fDim[1] + c[1])*fDim[2] + c[2];
+	}
+
+	double fCubeSize{1.};
+	double fOrigin[3]{};
+	long fDim[3]{1, 1, 1};
+	std::vector<std::size_t> fStart;  // points of the cube k are fSorted[fStart[k], fStart[k+1])
+	std::vector<std::size_t> fSorted;
+};
+
+}
+
+#endif
@@ -0,0 +1,186 @@
+/// \file AsyncWriter.cc
+/// \brief Implementation of the Common::AsyncWriter class
+
+#include "AsyncWriter.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+namespace Common {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/// Time the writer sleeps when every queue is empty
+constexpr std::chrono::microseconds IdleSleep{200};
+
+std::size_t PowerOfTwo(std::size_t n) {
+	std::size_t power = 2;
+	while(power < n)
+		power *= 2;
+	return power;
+}
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+AsyncWriter::Producer::Producer(std::size_t capacity, Policy policy):
+	fSlots(PowerOfTwo(capacity)),
+	fMask(fSlots.size() - 1),
+	fPolicy(policy)
+{
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void AsyncWriter::Producer::Push(std::string&& batch) {
+	std::size_t const head = fHead.load(std::memory_order_relaxed);
+	std::size_t tail = fTail.load(std::memory_order_acquire);
+	std::size_t const depth = head - tail;
+	if(depth > fMaxDepth.load(std::memory_order_relaxed))
+		fMaxDepth.store(depth, std::memory_order_relaxed);
+
+	if(depth == fSlots.size()) {
+		fStalls.fetch_add(1, std::memory_order_relaxed);
+		if(fPolicy == Policy::Drop) {
+			fDropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		auto const start = Clock::now();
+		while(head - tail == fSlots.size()) {
+			std::this_thread::yield();
+			tail = fTail.load(std::memory_order_acquire);
+		}
+		auto const waited = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+		fStallNanoseconds.fetch_add(static_cast<std::uint64_t>(waited), std::memory_order_relaxed);
+	}
+
+	fBytes.fetch_add(batch.size(), std::memory_order_relaxed);
+	fBatches.fetch_add(1, std::memory_order_relaxed);
+	fSlots[head & fMask] = std::move(batch);
+	fHead.store(head + 1, std::memory_order_release);
+	// the slot was taken from the writer: give the producer an empty string back
+	batch.clear();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+bool AsyncWriter::Producer::Pop(std::string& batch) {
+	std::size_t const tail = fTail.load(std::memory_order_relaxed);
+	if(tail == fHead.load(std::memory_order_acquire))
+		return false;
+	batch.swap(fSlots[tail & fMask]);
+	fTail.store(tail + 1, std::memory_order_release);
+	return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+AsyncWriter::Stats AsyncWriter::Producer::stats() const {
+	Stats stats;
+	stats.batches = fBatches.load(std::memory_order_relaxed);
+	stats.bytes = fBytes.load(std::memory_order_relaxed);
+	stats.dropped = fDropped.load(std::memory_order_relaxed);
+	stats.stalls = fStalls.load(std::memory_order_relaxed);
+	stats.stallTime = fStallNanoseconds.load(std::memory_order_relaxed)*1e-9;
+	stats.maxDepth = fMaxDepth.load(std::memory_order_relaxed);
+	return stats;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+AsyncWriter::AsyncWriter(const std::string& filename, std::size_t capacity, Policy policy):
+	fFilename(filename),
+	fCapacity(capacity),
+	fPolicy(policy),
+	fFile(std::fopen(filename.c_str(), "wb"))
+{
+	if(!fFile)
+		throw std::runtime_error("cannot write " + filename);
+	fThread = std::thread(&AsyncWriter::Run, this);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+AsyncWriter::~AsyncWriter() {
+	Close();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+AsyncWriter::Producer& AsyncWriter::NewProducer() {
+	std::lock_guard<std::mutex> lock(fMutex);
+	fProducers.push_back(std::make_unique<Producer>(fCapacity, fPolicy));
+	return *fProducers.back();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+bool AsyncWriter::Close() {
+	if(fThread.joinable()) {
+		fStop.store(true, std::memory_order_release);
+		fThread.join();
+	}
+	if(fFile) {
+		fFailed = std::fclose(fFile) != 0 || fFailed;
+		fFile = nullptr;
+	}
+	return !fFailed;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+AsyncWriter::Stats AsyncWriter::stats() const {
+	std::lock_guard<std::mutex> lock(fMutex);
+	Stats total;
+	for(auto const& producer: fProducers) {
+		auto const stats = producer->stats();
+		total.batches += stats.batches;
+		total.bytes += stats.bytes;
+		total.dropped += stats.dropped;
+		total.stalls += stats.stalls;
+		total.stallTime += stats.stallTime;
+		total.maxDepth = std::max(total.maxDepth, stats.maxDepth);
+	}
+	return total;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void AsyncWriter::Run() {
+	std::vector<Producer*> producers;
+	for(;;) {
+		// the stop flag is read before the last pass, so that no batch pushed before Close is lost
+		bool const stop = fStop.load(std::memory_order_acquire);
+		{
+			std::lock_guard<std::mutex> lock(fMutex);
+			producers.clear();
+			for(auto const& producer: fProducers)
+				producers.push_back(producer.get());
+		}
+		bool const written = Drain(producers);
+		if(stop)
+			break;
+		if(!written)
+			std::this_thread::sleep_for(IdleSleep);
+	}
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+bool AsyncWriter::Drain(const std::vector<Producer*>& producers) {
+	bool written = false;
+	std::string batch;
+	for(auto* producer: producers)
+		while(producer->Pop(batch)) {
+			if(!batch.empty() && std::fwrite(batch.data(), 1, batch.size(), fFile) != batch.size())
+				fFailed = true;
+			written = true;
+		}
+	return written;
+}
+
+}
@@ -0,0 +1,517 @@
+/// \file CellDoseScorer.cc
+/// \brief Implementation of the Common::CellDoseScorer class
+
+#include "CellDoseScorer.hh"
+#include "CellGeometry.hh"
+#include "OutputMerger.hh"
+#include "ParallelFor.hh"
+#include "PopulationLoader.hh"
+#include "PopulationXml.hh"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+#include <G4Event.hh>
+#include <G4LogicalVolume.hh>
+#include <G4VPhysicalVolume.hh>
+#include <G4VTouchable.hh>
+#include <G4EventManager.hh>
+#include <G4RunManager.hh>
+#include <G4Step.hh>
+#include <G4SystemOfUnits.hh>
+#include <G4UImanager.hh>
+#include <G4UserSteppingAction.hh>
+#include <G4ios.hh>
+
+namespace Common {
+
+namespace {
+
+/// Size from which the rows of the records of a tally are handed over to the writer
+constexpr std::size_t RecordBatchBytes = 64*1024;
+
+/// Batches of records queued per worker before the policy applies
+constexpr std::size_t RecordQueueCapacity = 64;
+
+/// Output file name set by /analysis/setFileName with its extension replaced by extension
+std::string OutputFileName(const std::string& extension) {
+	// output.root -> output<extension>
+	std::string const fileName = G4UImanager::GetUIpointer()->GetCurrentValues("/analysis/setFileName");
+	if(fileName.empty())
+		return extension.substr(1);
+	std::string const output = OutputMerger::ThreadFileName(fileName, -1);
+	return output.substr(0, output.find_last_of('.')) + extension;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/// Stepping action of a worker scoring its steps, after calling the one it replaces (owned)
+class ScoringSteppingAction: public G4UserSteppingAction {
+public:
+	ScoringSteppingAction(const CellDoseScorer& scorer, CellDoseTally& tally, G4UserSteppingAction* previous):
+		fScorer(scorer),
+		fTally(tally),
+		fPrevious(previous)
+	{
+	}
+
+	void SetSteppingManagerPointer(G4SteppingManager* manager) override {
+		G4UserSteppingAction::SetSteppingManagerPointer(manager);
+		if(fPrevious)
+			fPrevious->SetSteppingManagerPointer(manager);
+	}
+
+	void UserSteppingAction(const G4Step* step) override {
+		if(fPrevious)
+			fPrevious->UserSteppingAction(step);
+
+		if(!fScorer.enabled() || step->GetTotalEnergyDeposit() <= 0.)
+			return;
+		long const event = G4EventManager::GetEventManager()->GetConstCurrentEvent()->GetEventID();
+		fScorer.Score(fTally, event, *step);
+	}
+
+private:
+	const CellDoseScorer& fScorer;
+	CellDoseTally& fTally;
+	std::unique_ptr<G4UserSteppingAction> fPrevious;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/// Actions of the wrapped initialization, with its stepping action chained to the scoring
+class ScoringActionInitialization: public G4VUserActionInitialization {
+public:
+	ScoringActionInitialization(CellDoseScorer& scorer, G4VUserActionInitialization* actions):
+		fScorer(scorer),
+		fActions(actions)
+	{
+	}
+
+	void Build() const override {
+		fActions->Build();
+		// the actions are those of the run manager of the thread
+		auto* previous = const_cast<G4UserSteppingAction*>(G4RunManager::GetRunManager()->GetUserSteppingAction());
+		SetUserAction(new ScoringSteppingAction(fScorer, fScorer.NewTally(), previous));
+	}
+
+	void BuildForMaster() const override {
+		fActions->BuildForMaster();
+	}
+
+	G4VSteppingVerbose* InitializeSteppingVerbose() const override {
+		return fActions->InitializeSteppingVerbose();
+	}
+
+private:
+	CellDoseScorer& fScorer;
+	std::unique_ptr<G4VUserActionInitialization> fActions;
+};
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void CellDoseTally::Resize(std::size_t cellCount) {
+	for(auto* values: {&nucleusEnergy, &cellEnergy, &nucleusEnergy2, &cellEnergy2})
+		values->assign(cellCount, 0.);
+	hits.assign(cellCount, 0);
+	eventSlot.assign(cellCount, 0);
+	touched.clear();
+	event = -1;
+	hint = CellLocator::None;
+	comparedEnergy = 0.;
+	movedEnergy = 0.;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void CellDoseTally::Deposit(std::size_t cell, bool nucleus, double energy) {
+	if(eventSlot[cell] == 0) {
+		touched.push_back({static_cast<std::uint32_t>(cell), 0., 0.});
+		eventSlot[cell] = static_cast<std::uint32_t>(touched.size());
+	}
+	auto& deposit = touched[eventSlot[cell] - 1];
+	deposit.cellEnergy += energy;
+	if(nucleus)
+		deposit.nucleusEnergy += energy;
+	++hits[cell];
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void CellDoseTally::EndEvent() {
+	if(records) {
+		char row[96];
+		for(auto const& deposit: touched) {
+			int const size = std::snprintf(row, sizeof(row), "%ld,%" PRIu64 ",%.9g,%.9g\n", event, recordIds[deposit.cell],
+				deposit.nucleusEnergy/MeV, deposit.cellEnergy/MeV);
+			recordRows.append(row, static_cast<std::size_t>(size));
+		}
+		if(recordRows.size() >= RecordBatchBytes)
+			records->Push(std::move(recordRows));
+	}
+
+	for(auto const& deposit: touched) {
+		cellEnergy[deposit.cell] += deposit.cellEnergy;
+		cellEnergy2[deposit.cell] += deposit.cellEnergy*deposit.cellEnergy;
+		nucleusEnergy[deposit.cell] += deposit.nucleusEnergy;
+		nucleusEnergy2[deposit.cell] += deposit.nucleusEnergy*deposit.nucleusEnergy;
+		eventSlot[deposit.cell] = 0;
+	}
+	touched.clear();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void CellDoseTally::Reset() {
+	Resize(hits.size());
+	if(lookup)
+		lookup->Reset();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void CellDoseTally::FlushRecords() {
+	if(records && !recordRows.empty())
+		records->Push(std::move(recordRows));
+	recordRows.clear();
+	records = nullptr;
+	recordIds = nullptr;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+CellDoseScorer::CellDoseScorer():
+	fUnit(micrometer),
+	fDirectory("/cpop/scoring/", false),
+	fCellDoseCmd("/cpop/scoring/cellDose", this),
+	fPopulationCmd("/cpop/scoring/population", this),
+	fPopulationUnitCmd("/cpop/scoring/populationUnit", this),
+	fEventRecordsCmd("/cpop/scoring/eventRecords", this),
+	fRecordPolicyCmd("/cpop/scoring/recordPolicy", this),
+	fCompareLookupCmd("/cpop/scoring/compareLookup", this)
+{
+	fDirectory.SetGuidance("Scoring of the energy deposited in the cells");
+
+	fCellDoseCmd.SetGuidance("Score the energy deposited in every cell and nucleus, written at the end of each run");
+	fCellDoseCmd.SetParameterName("CellDose", false);
+
+	fPopulationCmd.SetGuidance("Population scored (xml or binary), the binary population by default");
+	fPopulationCmd.SetParameterName("PopulationFile", false);
+
+	fPopulationUnitCmd.SetGuidance("Length unit of the population file");
+	fPopulationUnitCmd.SetParameterName("Unit", false);
+	fPopulationUnitCmd.SetUnitCategory("Length");
+	fPopulationUnitCmd.SetDefaultUnit("um");
+
+	fEventRecordsCmd.SetGuidance("Also record the energy deposited by every event in every cell, written by a thread of its own");
+	fEventRecordsCmd.SetParameterName("EventRecords", false);
+
+	fRecordPolicyCmd.SetGuidance("Block the workers or drop their records when the writer of the records is behind");
+	fRecordPolicyCmd.SetParameterName("Policy", false);
+	fRecordPolicyCmd.SetCandidates("block drop");
+
+	fCompareLookupCmd.SetGuidance("With the cells placed as volumes, also score the steps with the population lookup,");
+	fCompareLookupCmd.SetGuidance("written to <output>.cellDoseLookup.csv, and print the energy given to other cells");
+	fCompareLookupCmd.SetParameterName("CompareLookup", false);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void CellDoseScorer::SetNewValue(G4UIcommand* command, G4String newValue)
+{
+	if(command == &fCellDoseCmd) {
+		fEnabled = fCellDoseCmd.GetNewBoolValue(newValue);
+		if(fEnabled)
+			BuildLocator();
+	} else if(command == &fPopulationCmd) {
+		fPopulationFile = newValue;
+		if(fEnabled)
+			BuildLocator();
+	} else if(command == &fPopulationUnitCmd) {
+		fUnit = fPopulationUnitCmd.GetNewDoubleValue(newValue);
+		if(fEnabled)
+			BuildLocator();
+	} else if(command == &fEventRecordsCmd) {
+		fEventRecords = fEventRecordsCmd.GetNewBoolValue(newValue);
+	} else if(command == &fRecordPolicyCmd) {
+		fRecordPolicy = newValue == "drop" ? AsyncWriter::Policy::Drop : AsyncWriter::Policy::Block;
+	} else if(command == &fCompareLookupCmd) {
+		fCompareLookup = fCompareLookupCmd.GetNewBoolValue(newValue);
+	}
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4VUserActionInitialization* CellDoseScorer::Wrap(G4VUserActionInitialization* actions)
+{
+	return new ScoringActionInitialization(*this, actions);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void CellDoseScorer::Score(CellDoseTally& tally, long event, const G4Step& step) const
+{
+	// the tally is reset by the master between the runs, where the event ids restart from 0
+	if(tally.hits.size() != fLocator.size())
+		tally.Resize(fLocator.size());
+	if(fEventRecords && !tally.records)
+		OpenRecords(tally);
+	if(event != tally.event) {
+		tally.EndEvent();
+		tally.event = event;
+	}
+
+	// the weight of the particle during the step (see Common::ImportanceSampling), 1 without biasing
+	double const energy = step.GetTotalEnergyDeposit()*step.GetPreStepPoint()->GetWeight();
+
+	// the step does not cross a boundary: it is in the volume of its pre step point
+	if(fGeometry && fGeometry->cellRegion()) {
+		auto const* pre = step.GetPreStepPoint();
+		auto const* region = pre->GetPhysicalVolume()->GetLogicalVolume()->GetRegion();
+		bool const nucleus = region == fGeometry->nucleusRegion();
+		std::size_t cell = CellLocator::None;
+		if(nucleus || region == fGeometry->cellRegion()) {
+			cell = static_cast<std::size_t>(pre->GetTouchable()->GetCopyNumber());
+			if(cell < tally.hits.size())
+				tally.Deposit(cell, nucleus, energy);
+		}
+		if(fCompareLookup)
+			ScoreLookup(tally, event, step, cell, nucleus, energy);
+		return;
+	}
+
+	auto const& pre = step.GetPreStepPoint()->GetPosition();
+	auto const& post = step.GetPostStepPoint()->GetPosition();
+	CellLocator::Point const middle{(pre.x() + post.x())/2., (pre.y() + post.y())/2., (pre.z() + post.z())/2.};
+	std::size_t const cell = fLocator.Locate(middle, tally.hint);
+	if(cell != CellLocator::None)
+		tally.Deposit(cell, fLocator.InNucleus(cell, middle), energy);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void CellDoseScorer::ScoreLookup(CellDoseTally& tally, long event, const G4Step& step, std::size_t cell, bool nucleus, double energy) const
+{
+	if(!tally.lookup)
+		tally.lookup = std::make_unique<CellDoseTally>();
+	auto& lookup = *tally.lookup;
+	if(lookup.hits.size() != fLocator.size())
+		lookup.Resize(fLocator.size());
+	if(event != lookup.event) {
+		lookup.EndEvent();
+		lookup.event = event;
+	}
+
+	auto const& pre = step.GetPreStepPoint()->GetPosition();
+	auto const& post = step.GetPostStepPoint()->GetPosition();
+	CellLocator::Point const middle{(pre.x() + post.x())/2., (pre.y() + post.y())/2., (pre.z() + post.z())/2.};
+	std::size_t const found = fLocator.Locate(middle, lookup.hint);
+	bool const inNucleus = found != CellLocator::None && fLocator.InNucleus(found, middle);
+	if(found != CellLocator::None)
+		lookup.Deposit(found, inNucleus, energy);
+
+	tally.comparedEnergy += energy;
+	if(found != cell || inNucleus != nucleus)
+		tally.movedEnergy += energy;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+CellDoseTally& CellDoseScorer::NewTally()
+{
+	std::lock_guard<std::mutex> lock(fMutex);
+	fTallies.push_back(std::make_unique<CellDoseTally>());
+	return *fTallies.back();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void CellDoseScorer::EndOfRun(int nEvent)
+{
+	std::lock_guard<std::mutex> lock(fMutex);
+	if(!fEnabled)
+		return;
+
+	// the workers are idle: their last events are closed here
+	std::size_t const cellCount = fLocator.size();
+	for(auto& tally: fTallies) {
+		tally->EndEvent();
+		tally->FlushRecords();
+		if(tally->lookup)
+			tally->lookup->EndEvent();
+	}
+	if(fRecordWriter) {
+		auto const stats = fRecordWriter->stats();
+		if(fRecordWriter->Close())
+			G4cout << "Event records written to " << fRecordWriter->filename() << ": " << stats.bytes/(1024.*1024.) << " MB in "
+				<< stats.batches << " batches, at most " << stats.maxDepth << " queued, " << stats.stalls << " full queues ("
+				<< stats.stallTime << " s waited, " << stats.dropped << " batches dropped)" << G4endl;
+		else
+			G4cerr << "Event records not written to " << fRecordWriter->filename() << G4endl;
+		fRecordWriter.reset();
+	}
+
+	// sum of the tallies of the threads, or of the tallies of their lookups
+	auto const sum = [&](CellDoseTally& total, bool lookup) {
+		total.Resize(cellCount);
+		ParallelFor(cellCount, ResolveThreadCount(0), [&](std::size_t begin, std::size_t end, unsigned) {
+			for(auto const& thread: fTallies) {
+				auto const* tally = lookup ? thread->lookup.get() : thread.get();
+				if(!tally || tally->hits.size() != cellCount)
+					continue;
+				for(std::size_t i = begin; i < end; ++i) {
+					total.nucleusEnergy[i] += tally->nucleusEnergy[i];
+					total.cellEnergy[i] += tally->cellEnergy[i];
+					total.nucleusEnergy2[i] += tally->nucleusEnergy2[i];
+					total.cellEnergy2[i] += tally->cellEnergy2[i];
+					total.hits[i] += tally->hits[i];
+				}
+			}
+		});
+	};
+	auto& total = fTotal;
+	sum(total, false);
+	bool const compared = fCompareLookup && std::any_of(std::begin(fTallies), std::end(fTallies), [](const std::unique_ptr<CellDoseTally>& tally) { return tally->lookup != nullptr; });
+	double comparedEnergy = 0.;
+	double movedEnergy = 0.;
+	if(compared) {
+		sum(fLookupTotal, true);
+		for(auto const& tally: fTallies) {
+			comparedEnergy += tally->comparedEnergy;
+			movedEnergy += tally->movedEnergy;
+		}
+	}
+	for(auto& tally: fTallies)
+		tally->Reset();
+
+	std::string const filename = OutputFileName(".cellDose.csv");
+
+	try {
+		Write(filename, nEvent, fIds, total);
+	} catch(const std::exception& e) {
+		G4cerr << "Cell doses not written: " << e.what() << G4endl;
+		return;
+	}
+	G4cout << "Cell doses of " << cellCount << " cells written to " << filename << G4endl;
+
+	if(!compared)
+		return;
+	std::string const lookupFilename = OutputFileName(".cellDoseLookup.csv");
+	try {
+		Write(lookupFilename, nEvent, fIds, fLookupTotal);
+	} catch(const std::exception& e) {
+		G4cerr << "Cell doses of the lookup not written: " << e.what() << G4endl;
+		return;
+	}
+	G4cout << "Cell doses of the population lookup written to " << lookupFilename << ": of the " << comparedEnergy/MeV
+		<< " MeV deposited, " << (comparedEnergy > 0. ? 100.*movedEnergy/comparedEnergy : 0.)
+		<< " % are given to another cell or compartment than by the volumes" << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void CellDoseScorer::OpenRecords(CellDoseTally& tally) const
+{
+	// the first worker of the run to score opens the records of the run
+	std::lock_guard<std::mutex> lock(fMutex);
+	if(!fRecordWriter) {
+		fRecordWriter = std::make_unique<AsyncWriter>(OutputFileName(".cellEvents.csv"), RecordQueueCapacity, fRecordPolicy);
+		fRecordWriter->NewProducer().Push("event,cellId,nucleusEnergy,cellEnergy\n");
+	}
+	tally.records = &fRecordWriter->NewProducer();
+	tally.recordIds = fIds.data();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void CellDoseScorer::BuildLocator()
+{
+	auto const build = [this](const CellArrays& cells, const std::uint64_t* nucleusOffset, const double* nucleusRadius) {
+		fLocator = CellLocator(cells, CellLocator::NucleusRadii(cells.count, nucleusOffset, nucleusRadius), fUnit);
+		fIds.resize(cells.count);
+		for(std::size_t i = 0; i < cells.count; ++i)
+			fIds[i] = cells.id ? cells.id[i] : i;
+	};
+
+	if(!fPopulationFile.empty()) {
+		PopulationData const population = ReadPopulation(fPopulationFile);
+		build(MakeCellArrays(population), population.nucleusOffset.data(), population.nucleusRadius.data());
+	} else if(fLoader && fLoader->population()) {
+		auto const& population = *fLoader->population();
+		build(MakeCellArrays(population), population.nucleusOffset(), population.nucleusRadius());
+	} else {
+		throw std::runtime_error("no population to score, use /cpop/scoring/population or /cpop/population/inputBinary first");
+	}
+	G4cout << "Scoring the energy deposited in " << fLocator.size() << " cells" << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void CellDoseScorer::Write(const std::string& filename, long nEvent, const std::vector<std::uint64_t>& ids, const CellDoseTally& total)
+{
+	std::ofstream file(filename);
+	if(!file)
+		throw std::runtime_error("cannot write " + filename);
+
+	file.precision(17);
+	file << "# events " << nEvent << '\n';
+	file << "cellId,nucleusEnergy,cellEnergy,hits,nucleusEnergy2,cellEnergy2\n";
+	for(std::size_t i = 0; i < total.hits.size(); ++i)
+		file << ids[i] << ',' << total.nucleusEnergy[i]/MeV << ',' << total.cellEnergy[i]/MeV << ',' << total.hits[i] << ','
+			<< total.nucleusEnergy2[i]/(MeV*MeV) << ',' << total.cellEnergy2[i]/(MeV*MeV) << '\n';
+
+	if(!file)
+		throw std::runtime_error("cannot write " + filename);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void CellDoseScorer::MergeFiles(const std::vector<std::string>& inputs, const std::string& output)
+{
+	// the tables of the runs of the same population have the same cells in the same order
+	long nEvent = 0;
+	std::vector<std::uint64_t> ids;
+	CellDoseTally total;
+	for(std::size_t f = 0; f < inputs.size(); ++f) {
+		auto const& input = inputs[f];
+		std::ifstream file(input);
+		std::string line;
+		long events = 0;
+		if(!std::getline(file, line) || std::sscanf(line.c_str(), "# events %ld", &events) != 1 || !std::getline(file, line))
+			throw std::runtime_error(input + ": not a cell dose table");
+		nEvent += events;
+
+		std::size_t cell = 0;
+		for(; std::getline(file, line); ++cell) {
+			std::uint64_t id = 0;
+			std::uint64_t hits = 0;
+			double values[4];
+			if(std::sscanf(line.c_str(), "%" SCNu64 ",%lf,%lf,%" SCNu64 ",%lf,%lf", &id, &values[0], &values[1], &hits, &values[2], &values[3]) != 6)
+				throw std::runtime_error(input + ": malformed row " + std::to_string(cell + 1));
+			if(f == 0) {
+				ids.push_back(id);
+				for(auto* column: {&total.nucleusEnergy, &total.cellEnergy, &total.nucleusEnergy2, &total.cellEnergy2})
+					column->push_back(0.);
+				total.hits.push_back(0);
+			} else if(cell >= ids.size() || ids[cell] != id) {
+				throw std::runtime_error(input + ": cells different from those of " + inputs.front());
+			}
+			total.nucleusEnergy[cell] += values[0]*MeV;
+			total.cellEnergy[cell] += values[1]*MeV;
+			total.hits[cell] += hits;
+			total.nucleusEnergy2[cell] += values[2]*MeV*MeV;
+			total.cellEnergy2[cell] += values[3]*MeV*MeV;
+		}
+		if(cell != ids.size())
+			throw std::runtime_error(input + ": cells different from those of " + inputs.front());
+	}
+
+	Write(output, nEvent, ids, total);
+}
+
+}
@@ -0,0 +1,254 @@
+/// \file CellExportMesh.cc
+/// \brief Implementation of the Common::CellExportMesh class
+
+#include "CellExportMesh.hh"
+#include "ParallelFor.hh"
+#include "PopulationBinary.hh"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace Common {
+
+namespace {
+
+/// Power plane between a cell and one of its neighbours: points x with dot(x - center, normal) = distance
+struct Plane {
+	std::array<double, 3> normal;
+	double distance;
+};
+
+/// Cells are handed out to the threads by blocks of this size to keep the scheduling cheap
+constexpr std::size_t CellGrain = 64;
+
+/// Append the bytes of value to buffer, in the host byte order
+template<typename T>
+void Append(std::vector<char>& buffer, T value) {
+	char bytes[sizeof(T)];
+	std::memcpy(bytes, &value, sizeof(T));
+	buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+bool IsHostLittleEndian() {
+	std::uint16_t const one = 1;
+	unsigned char first = 0;
+	std::memcpy(&first, &one, 1);
+	return first == 1;
+}
+
+std::ofstream OpenOutput(const std::string& filename, std::ios::openmode mode = std::ios::out) {
+	std::ofstream output(filename, mode);
+	if(!output)
+		throw std::runtime_error("unable to open " + filename);
+	return output;
+}
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+CellArrays MakeCellArrays(const MappedPopulation& population) {
+	return {population.cellCount(), population.positionX(), population.positionY(), population.positionZ(), population.membraneRadius(), population.cellId()};
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+CellArrays MakeCellArrays(const PopulationData& population) {
+	return {population.cellCount(), population.positionX.data(), population.positionY.data(), population.positionZ.data(), population.membraneRadius.data(), population.cellId.data()};
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::vector<std::uint8_t> CellRegions(const CellArrays& cells, const double center[3], double radius, double internalRatio, double intermediaryRatio) {
+	std::vector<std::uint8_t> regions(cells.count);
+	for(std::size_t i = 0; i < cells.count; ++i) {
+		double const dx = cells.x[i] - center[0];
+		double const dy = cells.y[i] - center[1];
+		double const dz = cells.z[i] - center[2];
+		double const distance = std::sqrt(dx*dx + dy*dy + dz*dz);
+		regions[i] = distance <= internalRatio*radius ? 0 : distance <= intermediaryRatio*radius ? 1 : 2;
+	}
+	return regions;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+CellExportMesh::CellExportMesh(const CellArrays& cells, int maxNumberOfFacetPerCell, int nbThread):
+	fCells(cells),
+	fNbThread(ResolveThreadCount(nbThread))
+{
+	BuildTemplate(maxNumberOfFacetPerCell);
+
+	double const maxRadius = cells.count == 0 ? 0. : *std::max_element(cells.radius, cells.radius + cells.count);
+	// two cells can only overlap if they are in adjacent grid cells
+	fGrid.Build(cells.count, [&cells](std::size_t i) { return UniformGrid::Point{cells.x[i], cells.y[i], cells.z[i]}; }, 2*maxRadius);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+int CellExportMesh::FacetsPerCellForBudget(std::size_t nbCell, std::size_t facetBudget, int maxNumberOfFacetPerCell) {
+	if(facetBudget == 0 || nbCell == 0)
+		return maxNumberOfFacetPerCell;
+	// the coarsest sphere (8 facets) is kept whatever the budget
+	auto const perCell = static_cast<long long>(facetBudget/nbCell);
+	return static_cast<int>(std::max(8LL, std::min<long long>(perCell, maxNumberOfFacetPerCell)));
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void CellExportMesh::MeshCells(std::size_t first, std::size_t last, double* vertices) const {
+	std::vector<std::vector<Plane>> planes(fNbThread);
+
+	ParallelForEach(last - first, fNbThread, CellGrain, [&](std::size_t index, unsigned worker) {
+		std::size_t const i = first + index;
+		UniformGrid::Point const center{fCells.x[i], fCells.y[i], fCells.z[i]};
+		double const radius = fCells.radius[i];
+
+		auto& cellPlanes = planes[worker];
+		cellPlanes.clear();
+		fGrid.ForEachCandidate(center, [&](std::size_t j) {
+			std::array<double, 3> const delta{fCells.x[j] - center[0], fCells.y[j] - center[1], fCells.z[j] - center[2]};
+			double const d = std::sqrt(delta[0]*delta[0] + delta[1]*delta[1] + delta[2]*delta[2]);
+			if(j == i || d == 0. || d >= radius + fCells.radius[j])
+				return;
+			double const h = (d*d + radius*radius - fCells.radius[j]*fCells.radius[j])/(2*d);
+			cellPlanes.push_back({{delta[0]/d, delta[1]/d, delta[2]/d}, h});
+		});
+
+		double* vertex = vertices + 3*index*vertexPerCell();
+		for(auto const& direction: fDirections) {
+			double t = radius;
+			for(auto const& plane: cellPlanes) {
+				double const cosine = direction[0]*plane.normal[0] + direction[1]*plane.normal[1] + direction[2]*plane.normal[2];
+				if(cosine > 0.)
+					t = std::min(t, plane.distance/cosine);
+			}
+			// a cell engulfed by its neighbours keeps a tiny but valid mesh
+			t = std::max(t, 1e-3*radius);
+			for(int axis = 0; axis < 3; ++axis)
+				*vertex++ = center[axis] + t*direction[axis];
+		}
+	});
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::vector<double> CellExportMesh::MeshAll() const {
+	std::vector<double> vertices(3*cellCount()*vertexPerCell());
+	MeshCells(0, cellCount(), vertices.data());
+	return vertices;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void CellExportMesh::BuildTemplate(int maxNumberOfFacetPerCell) {
+	// UV sphere of nLat bands and 2*nLat meridians: 4*nLat*(nLat-1) facets
+	int nLat = 2;
+	while(4*(nLat+1)*nLat <= maxNumberOfFacetPerCell)
+		++nLat;
+	int const nLon = 2*nLat;
+	double const pi = std::acos(-1.);
+
+	fDirections.clear();
+	fDirections.push_back({0., 0., 1.});
+	for(int k = 1; k < nLat; ++k) {
+		double const theta = pi*k/nLat;
+		for(int j = 0; j < nLon; ++j) {
+			double const phi = 2*pi*j/nLon;
+			fDirections.push_back({std::sin(theta)*std::cos(phi), std::sin(theta)*std::sin(phi), std::cos(theta)});
+		}
+	}
+	fDirections.push_back({0., 0., -1.});
+
+	auto const ring = [nLon](int k, int j) { return static_cast<std::uint32_t>(1 + (k-1)*nLon + j%nLon); };
+	auto const south = static_cast<std::uint32_t>(fDirections.size() - 1);
+
+	fFacets.clear();
+	for(int j = 0; j < nLon; ++j)
+		fFacets.push_back({0, ring(1, j), ring(1, j+1)});
+	for(int k = 1; k < nLat-1; ++k)
+		for(int j = 0; j < nLon; ++j) {
+			fFacets.push_back({ring(k, j), ring(k+1, j), ring(k+1, j+1)});
+			fFacets.push_back({ring(k, j), ring(k+1, j+1), ring(k, j+1)});
+		}
+	for(int j = 0; j < nLon; ++j)
+		fFacets.push_back({south, ring(nLat-1, j+1), ring(nLat-1, j)});
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void CellExportMesh::ExportOff(const std::string& filename) const {
+	auto output = OpenOutput(filename);
+
+	output.precision(9);
+	output << "OFF\n" << cellCount()*vertexPerCell() << ' ' << cellCount()*fFacets.size() << " 0\n";
+	ForEachBatch([&](std::size_t first, std::size_t last, const double* vertices) {
+		for(std::size_t v = 0; v < (last - first)*vertexPerCell(); ++v)
+			output << vertices[3*v] << ' ' << vertices[3*v+1] << ' ' << vertices[3*v+2] << '\n';
+	});
+	for(std::size_t i = 0; i < cellCount(); ++i) {
+		auto const offset = i*vertexPerCell();
+		for(auto const& facet: fFacets)
+			output << "3 " << offset + facet[0] << ' ' << offset + facet[1] << ' ' << offset + facet[2] << '\n';
+	}
+
+	if(!output)
+		throw std::runtime_error("unable to write " + filename);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void CellExportMesh::ExportPly(const std::string& filename, const std::uint8_t* regions) const {
+	if(cellCount()*vertexPerCell() > UINT32_MAX)
+		throw std::runtime_error("too many vertices for a PLY file: " + filename);
+
+	auto output = OpenOutput(filename, std::ios::out | std::ios::binary);
+
+	output << "ply\n"
+		<< "format " << (IsHostLittleEndian() ? "binary_little_endian" : "binary_big_endian") << " 1.0\n"
+		<< "comment CPOP population, one round cell tesselation per cell\n"
+		<< "element vertex " << cellCount()*vertexPerCell() << '\n'
+		<< "property float x\n"
+		<< "property float y\n"
+		<< "property float z\n"
+		<< "element face " << cellCount()*fFacets.size() << '\n'
+		<< "property list uchar uint vertex_indices\n"
+		<< "property uint cell_id\n";
+	if(regions)
+		output << "property uchar region\n";
+	output << "end_header\n";
+
+	// the vertices are written as soon as a batch of cells is meshed
+	std::vector<char> buffer;
+	ForEachBatch([&](std::size_t first, std::size_t last, const double* vertices) {
+		buffer.clear();
+		for(std::size_t c = 0; c < 3*(last - first)*vertexPerCell(); ++c)
+			Append(buffer, static_cast<float>(vertices[c]));
+		output.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+	});
+
+	// the faces only depend on the template and on the cell attributes
+	for(std::size_t first = 0; first < cellCount(); first += DefaultBatchSize) {
+		buffer.clear();
+		for(std::size_t i = first; i < std::min(cellCount(), first + DefaultBatchSize); ++i) {
+			auto const offset = static_cast<std::uint32_t>(i*vertexPerCell());
+			auto const id = static_cast<std::uint32_t>(fCells.id ? fCells.id[i] : i);
+			for(auto const& facet: fFacets) {
+				Append(buffer, std::uint8_t{3});
+				for(auto const vertex: facet)
+					Append(buffer, offset + vertex);
+				Append(buffer, id);
+				if(regions)
+					Append(buffer, regions[i]);
+			}
+		}
+		output.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+	}
+
+	if(!output)
+		throw std::runtime_error("unable to write " + filename);
+}
+
+}
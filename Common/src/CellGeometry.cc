@@ -0,0 +1,164 @@
+/// \file CellGeometry.cc
+/// \brief Implementation of the Common::CellGeometry class
+
+#include "CellGeometry.hh"
+#include "CellLocator.hh"
+#include "PopulationLoader.hh"
+#include "PopulationXml.hh"
+#include "CellExportMesh.hh"
+
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include <G4LogicalVolume.hh>
+#include <G4NistManager.hh>
+#include <G4Orb.hh>
+#include <G4PVPlacement.hh>
+#include <G4Region.hh>
+#include <G4RegionStore.hh>
+#include <G4SystemOfUnits.hh>
+#include <G4TessellatedSolid.hh>
+#include <G4TriangularFacet.hh>
+#include <G4ios.hh>
+
+namespace Common {
+
+namespace {
+
+G4Region* FindOrCreateRegion(const G4String& name) {
+	if(auto* region = G4RegionStore::GetInstance()->GetRegion(name, false))
+		return region;
+	return new G4Region(name);
+}
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+CellGeometry::CellGeometry():
+	fUnit(micrometer),
+	fDirectory("/cpop/geometry/", false),
+	fCellsCmd("/cpop/geometry/cells", this),
+	fPopulationCmd("/cpop/geometry/population", this),
+	fPopulationUnitCmd("/cpop/geometry/populationUnit", this),
+	fFacetsCmd("/cpop/geometry/facets", this),
+	fMaterialCmd("/cpop/geometry/material", this)
+{
+	fDirectory.SetGuidance("Cells and nuclei placed as Geant4 volumes");
+
+	fCellsCmd.SetGuidance("Place the cells and nuclei of the population in the world");
+	fCellsCmd.SetParameterName("Cells", false);
+	fCellsCmd.AvailableForStates(G4State_PreInit);
+
+	fPopulationCmd.SetGuidance("Population placed (xml or binary), the binary population by default");
+	fPopulationCmd.SetParameterName("PopulationFile", false);
+	fPopulationCmd.AvailableForStates(G4State_PreInit);
+
+	fPopulationUnitCmd.SetGuidance("Length unit of the population file");
+	fPopulationUnitCmd.SetParameterName("Unit", false);
+	fPopulationUnitCmd.SetUnitCategory("Length");
+	fPopulationUnitCmd.SetDefaultUnit("um");
+	fPopulationUnitCmd.AvailableForStates(G4State_PreInit);
+
+	fFacetsCmd.SetGuidance("Maximum number of facets per cell");
+	fFacetsCmd.SetParameterName("Facets", false);
+	fFacetsCmd.SetRange("Facets >= 8");
+	fFacetsCmd.AvailableForStates(G4State_PreInit);
+
+	fMaterialCmd.SetGuidance("Material of the cells and nuclei (NIST name)");
+	fMaterialCmd.SetParameterName("Material", false);
+	fMaterialCmd.AvailableForStates(G4State_PreInit);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void CellGeometry::SetNewValue(G4UIcommand* command, G4String newValue)
+{
+	if(command == &fCellsCmd)
+		fEnabled = fCellsCmd.GetNewBoolValue(newValue);
+	else if(command == &fPopulationCmd)
+		fPopulationFile = newValue;
+	else if(command == &fPopulationUnitCmd)
+		fUnit = fPopulationUnitCmd.GetNewDoubleValue(newValue);
+	else if(command == &fFacetsCmd)
+		fFacets = fFacetsCmd.GetNewIntValue(newValue);
+	else if(command == &fMaterialCmd)
+		fMaterial = newValue;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void CellGeometry::Place(G4LogicalVolume* world)
+{
+	if(!fEnabled)
+		return;
+
+	PopulationData population;
+	if(!fPopulationFile.empty())
+		population = ReadPopulation(fPopulationFile);
+	else if(fLoader && fLoader->population())
+		population = fLoader->population()->toData();
+	else
+		throw std::runtime_error("no population to place, use /cpop/geometry/population or /cpop/population/inputBinary first");
+
+	G4Material* material = G4NistManager::Instance()->FindOrBuildMaterial(fMaterial);
+	if(!material)
+		throw std::runtime_error("unknown material " + fMaterial);
+
+	fCellRegion = FindOrCreateRegion("Cells");
+	fNucleusRegion = FindOrCreateRegion("Nuclei");
+
+	auto const cells = MakeCellArrays(population);
+	auto const nucleusRadius = CellLocator::NucleusRadii(cells.count, population.nucleusOffset.data(), population.nucleusRadius.data());
+	CellExportMesh const mesh(cells, fFacets, 0);
+	std::size_t shrunk = 0;
+
+	mesh.ForEachBatch([&](std::size_t first, std::size_t last, const double* vertices) {
+		for(std::size_t i = first; i < last; ++i) {
+			const double* cellVertices = vertices + 3*(i - first)*mesh.vertexPerCell();
+			G4ThreeVector const center(cells.x[i], cells.y[i], cells.z[i]);
+			auto const vertex = [&](std::uint32_t k) {
+				return (G4ThreeVector(cellVertices[3*k], cellVertices[3*k+1], cellVertices[3*k+2]) - center)*fUnit;
+			};
+			std::string const name = std::to_string(population.cellId[i]);
+
+			// the vertices are relative to the center, which is inside the cell: the distance of the
+			// closest facet plane bounds the nucleus
+			auto* solid = new G4TessellatedSolid("S_Cell" + name);
+			double inscribed = std::numeric_limits<double>::max();
+			for(auto const& indices: mesh.facets()) {
+				auto* facet = new G4TriangularFacet(vertex(indices[0]), vertex(indices[1]), vertex(indices[2]), ABSOLUTE);
+				if(!facet->IsDefined()) {
+					delete facet;
+					continue;
+				}
+				solid->AddFacet(facet);
+				inscribed = std::min(inscribed, std::abs(facet->GetVertex(0).dot(facet->GetSurfaceNormal())));
+			}
+			solid->SetSolidClosed(true);
+
+			auto* cellVolume = new G4LogicalVolume(solid, material, "LV_Cell" + name);
+			fCellRegion->AddRootLogicalVolume(cellVolume);
+			new G4PVPlacement(nullptr, center*fUnit, cellVolume, "PV_Cell" + name, world, false, static_cast<G4int>(i), false);
+
+			double radius = nucleusRadius[i]*fUnit;
+			if(radius <= 0.)
+				continue;
+			if(radius >= inscribed) {
+				radius = 0.99*inscribed;
+				++shrunk;
+			}
+			auto* nucleusVolume = new G4LogicalVolume(new G4Orb("S_Nucleus" + name, radius), material, "LV_Nucleus" + name);
+			fNucleusRegion->AddRootLogicalVolume(nucleusVolume);
+			new G4PVPlacement(nullptr, G4ThreeVector(), nucleusVolume, "PV_Nucleus" + name, cellVolume, false, static_cast<G4int>(i), false);
+		}
+	});
+
+	G4cout << "Placed " << cells.count << " cells of at most " << mesh.facets().size() << " facets";
+	if(shrunk > 0)
+		G4cout << ", " << shrunk << " nuclei shrunk to fit their clipped cell";
+	G4cout << G4endl;
+}
+
+}
@@ -0,0 +1,106 @@
+/// \file CellLocator.cc
+/// \brief Implementation of the Common::CellLocator class
+
+#include "CellLocator.hh"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Common {
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+CellLocator::CellLocator(const CellArrays& cells, const std::vector<double>& nucleusRadius, double unit) {
+	fCenters.reserve(cells.count);
+	fRadius2.reserve(cells.count);
+	fNucleusRadius2.reserve(cells.count);
+	double maxRadius = 0.;
+	for(std::size_t i = 0; i < cells.count; ++i) {
+		fCenters.push_back({cells.x[i]*unit, cells.y[i]*unit, cells.z[i]*unit});
+		double const radius = cells.radius[i]*unit;
+		fRadius2.push_back(radius*radius);
+		double const nucleus = i < nucleusRadius.size() ? nucleusRadius[i]*unit : 0.;
+		fNucleusRadius2.push_back(nucleus*nucleus);
+		maxRadius = std::max(maxRadius, radius);
+	}
+
+	// a point can only be in a cell whose center is in one of the 27 grid cells around it
+	auto const center = [this](std::size_t i) -> const Point& { return fCenters[i]; };
+	fGrid.Build(fCenters.size(), center, maxRadius);
+
+	// two cells overlap if their centers are closer than the sum of their radii
+	UniformGrid const pairs(fCenters.size(), center, 2.*maxRadius);
+	fOverlapStart.assign(1, 0);
+	for(std::size_t i = 0; i < fCenters.size(); ++i) {
+		double const radius = std::sqrt(fRadius2[i]);
+		pairs.ForEachCandidate(fCenters[i], [&](std::size_t j) {
+			double const reach = radius + std::sqrt(fRadius2[j]);
+			if(j != i && Distance2(j, fCenters[i]) < reach*reach)
+				fOverlap.push_back(j);
+		});
+		fOverlapStart.push_back(fOverlap.size());
+	}
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::size_t CellLocator::Locate(const Point& p) const {
+	std::size_t found = None;
+	double best = 0.;
+	fGrid.ForEachCandidate(p, [&](std::size_t i) {
+		double const power = Distance2(i, p) - fRadius2[i];
+		if(power < 0. && (found == None || power < best || (power == best && i < found))) {
+			found = i;
+			best = power;
+		}
+	});
+	return found;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::size_t CellLocator::Locate(const Point& p, std::size_t& hint) const {
+	double const hintPower = hint < fCenters.size() ? Distance2(hint, p) - fRadius2[hint] : 0.;
+	if(hint >= fCenters.size() || hintPower >= 0.)
+		return hint = Locate(p);
+
+	// any other cell containing p overlaps the hint
+	std::size_t found = hint;
+	double best = hintPower;
+	for(std::size_t k = fOverlapStart[hint]; k < fOverlapStart[hint+1]; ++k) {
+		std::size_t const i = fOverlap[k];
+		double const power = Distance2(i, p) - fRadius2[i];
+		if(power < best || (power == best && i < found)) {
+			found = i;
+			best = power;
+		}
+	}
+	return hint = found;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+bool CellLocator::InNucleus(std::size_t i, const Point& p) const {
+	return Distance2(i, p) < fNucleusRadius2[i];
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::vector<double> CellLocator::NucleusRadii(std::size_t cellCount, const std::uint64_t* nucleusOffset, const double* nucleusRadius) {
+	std::vector<double> radii(cellCount, 0.);
+	for(std::size_t i = 0; i < cellCount; ++i)
+		if(nucleusOffset[i+1] > nucleusOffset[i])
+			radii[i] = nucleusRadius[nucleusOffset[i]];
+	return radii;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+double CellLocator::Distance2(std::size_t i, const Point& p) const {
+	double const dx = p[0] - fCenters[i][0];
+	double const dy = p[1] - fCenters[i][1];
+	double const dz = p[2] - fCenters[i][2];
+	return dx*dx + dy*dy + dz*dz;
+}
+
+}
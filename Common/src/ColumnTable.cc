@@ -0,0 +1,456 @@
+/// \file ColumnTable.cc
+/// \brief Implementation of the column table format
+
+#include "ColumnTable.hh"
+#include "PopulationBinary.hh"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Common {
+
+namespace ColumnTable {
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::size_t TypeSize(Type type) {
+	switch(type) {
+		case Int32: return sizeof(std::int32_t);
+		case Int64: return sizeof(std::int64_t);
+		case Float: return sizeof(float);
+		case Double: return sizeof(double);
+		case Text: return sizeof(std::uint32_t);
+		default: return 0;
+	}
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+const char* TypeName(Type type) {
+	switch(type) {
+		case Int32: return "int32";
+		case Int64: return "int64";
+		case Float: return "float";
+		case Double: return "double";
+		case Text: return "text";
+		default: return "unknown";
+	}
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+bool IsAdditive(const std::string& name, Type type) {
+	if(!IsReal(type))
+		return false;
+	// the ntuples of CPOP name their columns after its members (fEdepn, fEdepc, fEdep_sph)
+	bool const member = name.size() > 1 && name[0] == 'f' && std::isupper(static_cast<unsigned char>(name[1]));
+	std::string lower = name.substr(member ? 1 : 0, 4);
+	std::transform(std::begin(lower), std::end(lower), std::begin(lower), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+	return lower == "dose" || lower == "edep";
+}
+
+}
+
+namespace {
+
+std::size_t AlignUp(std::size_t value) {
+	return (value + ColumnTable::BlockAlignment - 1) & ~(ColumnTable::BlockAlignment - 1);
+}
+
+template<typename T>
+void AppendBytes(std::vector<unsigned char>& bytes, T value) {
+	auto const size = bytes.size();
+	bytes.resize(size + sizeof(T));
+	std::memcpy(bytes.data() + size, &value, sizeof(T));
+}
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ColumnTableBuilder::ColumnTableBuilder(std::string summaryMarker):
+	fSummaryMarker(std::move(summaryMarker))
+{
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::size_t ColumnTableBuilder::AddColumn(const std::string& name, ColumnTable::Type type) {
+	if(rowCount() > 0)
+		throw std::runtime_error("Column table: column " + name + " added after the rows");
+	if(name.empty() || name.size() >= ColumnTable::NameSize)
+		throw std::runtime_error("Column table: invalid column name " + name);
+	if(type >= ColumnTable::TypeCount)
+		throw std::runtime_error("Column table: invalid type for column " + name);
+	for(auto const& column: fColumns)
+		if(column.name == name)
+			throw std::runtime_error("Column table: column " + name + " added twice");
+
+	fColumns.push_back({name, type, {}, {}, {}});
+	fAdditive.push_back(ColumnTable::IsAdditive(name, type));
+	if(name == ColumnTable::ShardColumn)
+		fShardColumn = fColumns.size() - 1;
+	Value zero;
+	zero.integer = 0;
+	if(ColumnTable::IsReal(type))
+		zero.real = 0.;
+	fRow.push_back(zero);
+	// the empty text has the code 0 in every dictionary
+	if(type == ColumnTable::Text)
+		Code(fColumns.back(), std::string_view());
+	return fColumns.size() - 1;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ColumnTableBuilder::SetInteger(std::size_t column, std::int64_t value) {
+	if(ColumnTable::IsReal(fColumns[column].type))
+		fRow[column].real = static_cast<double>(value);
+	else if(fColumns[column].type == ColumnTable::Text)
+		SetText(column, std::to_string(value));
+	else
+		fRow[column].integer = value;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ColumnTableBuilder::SetReal(std::size_t column, double value) {
+	if(ColumnTable::IsReal(fColumns[column].type))
+		fRow[column].real = value;
+	else if(fColumns[column].type == ColumnTable::Text)
+		SetText(column, std::to_string(value));
+	else
+		fRow[column].integer = static_cast<std::int64_t>(value);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ColumnTableBuilder::SetText(std::size_t column, std::string_view value) {
+	if(fColumns[column].type != ColumnTable::Text)
+		throw std::runtime_error("Column table: text given to the " + std::string(ColumnTable::TypeName(fColumns[column].type))
+			+ " column " + fColumns[column].name);
+	fRow[column].integer = Code(fColumns[column], value);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ColumnTableBuilder::EndRow() {
+	bool summary = false;
+	if(!fSummaryMarker.empty())
+		for(std::size_t c = 0; c < fColumns.size() && !summary; ++c)
+			summary = fColumns[c].type == ColumnTable::Text
+				&& fColumns[c].texts[static_cast<std::size_t>(fRow[c].integer)] == fSummaryMarker;
+
+	if(!summary) {
+		for(std::size_t c = 0; c < fColumns.size(); ++c)
+			Append(fColumns[c], fRow[c]);
+		++fRowCount;
+	} else {
+		// a summary is identified by its columns which are not summed, but its shard
+		std::string key;
+		for(std::size_t c = 0; c < fColumns.size(); ++c)
+			if(!fAdditive[c] && c != fShardColumn)
+				key.append(reinterpret_cast<const char*>(&fRow[c]), sizeof(fRow[c]));
+
+		auto const found = fSummaryIndex.emplace(key, fSummaries.size());
+		if(found.second) {
+			fSummaries.push_back(fRow);
+			if(fShardColumn < fColumns.size())
+				fSummaries.back()[fShardColumn].integer = -1;
+		} else {
+			auto& total = fSummaries[found.first->second];
+			for(std::size_t c = 0; c < fColumns.size(); ++c)
+				if(fAdditive[c])
+					total[c].real += fRow[c].real;
+		}
+	}
+
+	for(std::size_t c = 0; c < fColumns.size(); ++c)
+		if(ColumnTable::IsReal(fColumns[c].type))
+			fRow[c].real = 0.;
+		else
+			fRow[c].integer = 0;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::uint32_t ColumnTableBuilder::Code(ColumnData& column, std::string_view text) {
+	auto found = column.codes.find(std::string(text));
+	if(found != std::end(column.codes))
+		return found->second;
+	auto const code = static_cast<std::uint32_t>(column.texts.size());
+	column.texts.emplace_back(text);
+	column.codes.emplace(column.texts.back(), code);
+	return code;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ColumnTableBuilder::Append(ColumnData& column, const Value& value) const {
+	switch(column.type) {
+		case ColumnTable::Int32: AppendBytes(column.values, static_cast<std::int32_t>(value.integer)); break;
+		case ColumnTable::Int64: AppendBytes(column.values, static_cast<std::int64_t>(value.integer)); break;
+		case ColumnTable::Float: AppendBytes(column.values, static_cast<float>(value.real)); break;
+		case ColumnTable::Double: AppendBytes(column.values, value.real); break;
+		default: AppendBytes(column.values, static_cast<std::uint32_t>(value.integer)); break;
+	}
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ColumnTableBuilder::Write(const std::string& filename) const {
+	// the summaries follow the rows
+	std::vector<std::vector<unsigned char>> summaryValues(fColumns.size());
+	for(std::size_t c = 0; c < fColumns.size(); ++c) {
+		ColumnData column{fColumns[c].name, fColumns[c].type, {}, {}, {}};
+		for(auto const& summary: fSummaries)
+			Append(column, summary[c]);
+		summaryValues[c] = std::move(column.values);
+	}
+
+	std::vector<std::vector<unsigned char>> dictionaries(fColumns.size());
+	for(std::size_t c = 0; c < fColumns.size(); ++c) {
+		if(fColumns[c].type != ColumnTable::Text)
+			continue;
+		std::uint64_t offset = 0;
+		AppendBytes(dictionaries[c], offset);
+		for(auto const& text: fColumns[c].texts) {
+			offset += text.size();
+			AppendBytes(dictionaries[c], offset);
+		}
+		for(auto const& text: fColumns[c].texts)
+			dictionaries[c].insert(std::end(dictionaries[c]), std::begin(text), std::end(text));
+	}
+
+	ColumnTable::Header header{};
+	std::memcpy(header.magic, ColumnTable::Magic, sizeof(header.magic));
+	header.version = ColumnTable::Version;
+	header.byteOrder = ColumnTable::ByteOrderMark;
+	header.rowCount = rowCount();
+	header.columnCount = fColumns.size();
+
+	// layout: the column directory, then the values and the dictionary of each column
+	std::vector<ColumnTable::Column> columns(fColumns.size());
+	std::size_t offset = AlignUp(sizeof(ColumnTable::Header));
+	header.columns = {offset, columns.size()*sizeof(ColumnTable::Column)};
+	offset = AlignUp(offset + header.columns.size);
+	for(std::size_t c = 0; c < fColumns.size(); ++c) {
+		auto& column = columns[c];
+		std::memcpy(column.name, fColumns[c].name.c_str(), fColumns[c].name.size() + 1);
+		column.type = fColumns[c].type;
+		column.textCount = static_cast<std::uint32_t>(fColumns[c].texts.size());
+		column.values = {offset, fColumns[c].values.size() + summaryValues[c].size()};
+		offset = AlignUp(offset + column.values.size);
+		column.dictionary = {offset, dictionaries[c].size()};
+		offset = AlignUp(offset + column.dictionary.size);
+	}
+
+	// the blocks in the file order, padding bytes are zeros and part of the checksum
+	struct BlockView {
+		std::uint64_t offset;
+		const void* data;
+		std::size_t size;
+	};
+	std::vector<BlockView> views{{header.columns.offset, columns.data(), header.columns.size}};
+	for(std::size_t c = 0; c < fColumns.size(); ++c) {
+		views.push_back({columns[c].values.offset, fColumns[c].values.data(), fColumns[c].values.size()});
+		views.push_back({columns[c].values.offset + fColumns[c].values.size(), summaryValues[c].data(), summaryValues[c].size()});
+		views.push_back({columns[c].dictionary.offset, dictionaries[c].data(), dictionaries[c].size()});
+	}
+
+	static const char padding[ColumnTable::BlockAlignment] = {};
+	std::uint64_t hash = PopulationBinary::checksum(nullptr, 0);
+	std::size_t position = sizeof(ColumnTable::Header);
+	auto const pad = [&](std::size_t to, std::ofstream* out) {
+		while(position < to) {
+			std::size_t const size = std::min(to - position, sizeof(padding));
+			hash = PopulationBinary::checksum(padding, size, hash);
+			if(out)
+				out->write(padding, static_cast<std::streamsize>(size));
+			position += size;
+		}
+	};
+	for(auto const& view: views) {
+		pad(view.offset, nullptr);
+		hash = PopulationBinary::checksum(view.data, view.size, hash);
+		position += view.size;
+	}
+	pad(offset, nullptr);
+	header.checksum = hash;
+
+	// write into a temporary file then rename it to never leave a truncated table
+	std::string const tmpFilename = filename + ".tmp";
+	{
+		std::ofstream out(tmpFilename, std::ios::binary | std::ios::trunc);
+		if(!out)
+			throw std::runtime_error("Column table: unable to open " + tmpFilename);
+
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		position = sizeof(header);
+		for(auto const& view: views) {
+			pad(view.offset, &out);
+			out.write(static_cast<const char*>(view.data), static_cast<std::streamsize>(view.size));
+			position += view.size;
+		}
+		pad(offset, &out);
+
+		if(!out)
+			throw std::runtime_error("Column table: unable to write " + tmpFilename);
+	}
+
+	if(std::rename(tmpFilename.c_str(), filename.c_str()) != 0)
+		throw std::runtime_error("Column table: unable to rename " + tmpFilename + " to " + filename);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+MappedColumnTable::MappedColumnTable(const std::string& filename, bool verify):
+	fFilename(filename)
+{
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if(fd < 0)
+		throw std::runtime_error("Column table: unable to open " + filename);
+
+	struct stat st{};
+	if(::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(ColumnTable::Header)) {
+		::close(fd);
+		throw std::runtime_error("Column table: " + filename + " is too small to be a column table");
+	}
+	fSize = static_cast<std::size_t>(st.st_size);
+
+	void* data = ::mmap(nullptr, fSize, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if(data == MAP_FAILED)
+		throw std::runtime_error("Column table: unable to map " + filename);
+
+	fData = static_cast<const unsigned char*>(data);
+	fHeader = reinterpret_cast<const ColumnTable::Header*>(fData);
+
+	auto fail = [this](const std::string& reason) {
+		::munmap(const_cast<unsigned char*>(fData), fSize);
+		throw std::runtime_error("Column table: " + fFilename + ": " + reason);
+	};
+
+	if(std::memcmp(fHeader->magic, ColumnTable::Magic, sizeof(ColumnTable::Magic)) != 0)
+		fail("not a column table");
+	if(fHeader->byteOrder != ColumnTable::ByteOrderMark)
+		fail("written with a different byte order");
+	if(fHeader->version != ColumnTable::Version)
+		fail("unsupported version " + std::to_string(fHeader->version));
+
+	auto const inside = [this](const ColumnTable::BlockEntry& block) {
+		return block.offset % ColumnTable::BlockAlignment == 0 && block.offset <= fSize && block.size <= fSize - block.offset;
+	};
+	if(!inside(fHeader->columns) || fHeader->columns.size != fHeader->columnCount*sizeof(ColumnTable::Column))
+		fail("corrupted column directory");
+	fColumns = reinterpret_cast<const ColumnTable::Column*>(fData + fHeader->columns.offset);
+
+	for(std::size_t c = 0; c < columnCount(); ++c) {
+		auto const& column = fColumns[c];
+		if(column.type >= ColumnTable::TypeCount || std::memchr(column.name, '\0', ColumnTable::NameSize) == nullptr)
+			fail("corrupted column directory");
+		if(!inside(column.values) || !inside(column.dictionary)
+			|| column.values.size != rowCount()*ColumnTable::TypeSize(type(c)))
+			fail("block sizes do not match the header");
+		if(column.type == ColumnTable::Text) {
+			std::uint64_t const offsetsSize = (column.textCount + 1ULL)*sizeof(std::uint64_t);
+			if(column.dictionary.size < offsetsSize)
+				fail("corrupted dictionary of " + name(c));
+			auto const* offsets = reinterpret_cast<const std::uint64_t*>(fData + column.dictionary.offset);
+			if(offsets[column.textCount] != column.dictionary.size - offsetsSize)
+				fail("corrupted dictionary of " + name(c));
+		}
+	}
+
+	if(verify) {
+		std::size_t const headerSize = sizeof(ColumnTable::Header);
+		if(PopulationBinary::checksum(fData + headerSize, fSize - headerSize) != fHeader->checksum)
+			fail("checksum mismatch");
+	}
+
+	// the codes are only checked against the dictionaries once the bytes are known to be those written
+	for(std::size_t c = 0; c < columnCount(); ++c)
+		if(type(c) == ColumnTable::Text) {
+			auto const* codes = reinterpret_cast<const std::uint32_t*>(fData + fColumns[c].values.offset);
+			for(std::size_t row = 0; row < rowCount(); ++row)
+				if(codes[row] >= fColumns[c].textCount)
+					fail("code out of the dictionary of " + name(c));
+		}
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+MappedColumnTable::~MappedColumnTable() {
+	if(fData)
+		::munmap(const_cast<unsigned char*>(fData), fSize);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::size_t MappedColumnTable::Find(const std::string& name) const {
+	for(std::size_t c = 0; c < columnCount(); ++c)
+		if(name == fColumns[c].name)
+			return c;
+	return None;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+double MappedColumnTable::real(std::size_t column, std::size_t row) const {
+	const unsigned char* const value = fData + fColumns[column].values.offset + row*ColumnTable::TypeSize(type(column));
+	switch(type(column)) {
+		case ColumnTable::Int32: return *reinterpret_cast<const std::int32_t*>(value);
+		case ColumnTable::Int64: return static_cast<double>(*reinterpret_cast<const std::int64_t*>(value));
+		case ColumnTable::Float: return *reinterpret_cast<const float*>(value);
+		case ColumnTable::Double: return *reinterpret_cast<const double*>(value);
+		default: throw std::runtime_error("Column table: " + name(column) + " is a text column");
+	}
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::string_view MappedColumnTable::text(std::size_t column, std::uint32_t code) const {
+	auto const& entry = fColumns[column];
+	auto const* offsets = reinterpret_cast<const std::uint64_t*>(fData + entry.dictionary.offset);
+	auto const* characters = reinterpret_cast<const char*>(offsets + entry.textCount + 1);
+	return {characters + offsets[code], static_cast<std::size_t>(offsets[code + 1] - offsets[code])};
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::size_t MappedColumnTable::Code(std::size_t column, std::string_view value) const {
+	for(std::uint32_t code = 0; code < textCount(column); ++code)
+		if(text(column, code) == value)
+			return code;
+	return None;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void MappedColumnTable::CheckType(std::size_t column, ColumnTable::Type type) const {
+	if(column >= columnCount())
+		throw std::runtime_error("Column table: " + fFilename + " has no column " + std::to_string(column));
+	if(this->type(column) != type)
+		throw std::runtime_error("Column table: " + name(column) + " is a " + ColumnTable::TypeName(this->type(column))
+			+ " column, not " + ColumnTable::TypeName(type));
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+bool IsColumnTable(const std::string& filename) {
+	std::ifstream in(filename, std::ios::binary);
+	char magic[sizeof(ColumnTable::Magic)] = {};
+	in.read(magic, sizeof(magic));
+	return in && std::memcmp(magic, ColumnTable::Magic, sizeof(magic)) == 0;
+}
+
+}
@@ -0,0 +1,78 @@
+/// \file ImportanceMap.cc
+/// \brief Implementation of the Common::ImportanceMap class
+
+#include "ImportanceMap.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace Common {
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ImportanceMap::ImportanceMap(const std::vector<Point>& centers, const std::vector<double>& radii, double zoneWidth, int levels):
+	fCenters(centers),
+	fRadii(radii),
+	fZoneWidth(zoneWidth > 0. ? zoneWidth : 1.),
+	fLevels(std::max(levels, 0))
+{
+	fImportance.resize(fLevels + 1);
+	for(int zone = 0; zone <= fLevels; ++zone)
+		fImportance[zone] = std::ldexp(1., -zone);
+
+	// a cell gives p a zone below levels if its center is closer than its radius plus levels widths
+	double maxRadius = 0.;
+	for(double const radius: fRadii)
+		maxRadius = std::max(maxRadius, radius);
+	auto const center = [this](std::size_t i) -> const Point& { return fCenters[i]; };
+	fGrid.Build(fCenters.size(), center, maxRadius + fLevels*fZoneWidth);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+int ImportanceMap::Zone(const Point& p) const {
+	if(fLevels == 0)
+		return 0;
+
+	double const reach = fLevels*fZoneWidth;
+	double nearest = reach;
+	fGrid.ForEachCandidate(p, [&](std::size_t i) {
+		double const dx = p[0] - fCenters[i][0];
+		double const dy = p[1] - fCenters[i][1];
+		double const dz = p[2] - fCenters[i][2];
+		double const bound = fRadii[i] + nearest;
+		double const distance2 = dx*dx + dy*dy + dz*dz;
+		// the square root is only taken for the cells which can be the nearest
+		if(distance2 < bound*bound)
+			nearest = std::max(0., std::sqrt(distance2) - fRadii[i]);
+	});
+	return nearest >= reach ? fLevels : static_cast<int>(nearest/fZoneWidth);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::vector<std::size_t> SampleCellsPerRegion(const std::vector<std::uint8_t>& regions, std::size_t perRegion, std::uint64_t seed) {
+	std::vector<std::vector<std::size_t>> byRegion;
+	for(std::size_t i = 0; i < regions.size(); ++i) {
+		if(regions[i] >= byRegion.size())
+			byRegion.resize(regions[i] + 1);
+		byRegion[regions[i]].push_back(i);
+	}
+
+	// partial Fisher-Yates shuffle of each region
+	std::mt19937_64 random(seed);
+	std::vector<std::size_t> sampled;
+	for(auto& cells: byRegion) {
+		std::size_t const count = std::min(perRegion, cells.size());
+		for(std::size_t k = 0; k < count; ++k) {
+			std::uniform_int_distribution<std::size_t> pick(k, cells.size() - 1);
+			std::swap(cells[k], cells[pick(random)]);
+		}
+		sampled.insert(sampled.end(), cells.begin(), cells.begin() + count);
+	}
+	std::sort(sampled.begin(), sampled.end());
+	return sampled;
+}
+
+}
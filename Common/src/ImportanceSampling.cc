@@ -0,0 +1,336 @@
+/// \file ImportanceSampling.cc
+/// \brief Implementation of the Common::ImportanceSampling class
+
+#include "ImportanceSampling.hh"
+#include "CellDoseScorer.hh"
+#include "PopulationLoader.hh"
+#include "CellExportMesh.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+#include <G4DynamicParticle.hh>
+#include <G4RunManager.hh>
+#include <G4ParticleDefinition.hh>
+#include <G4Step.hh>
+#include <G4SystemOfUnits.hh>
+#include <G4Track.hh>
+#include <G4UImanager.hh>
+#include <G4UserSteppingAction.hh>
+#include <G4ios.hh>
+#include <Randomize.hh>
+
+namespace Common {
+
+namespace {
+
+/// True if CPOP fills the ntuples of /cpop/population/stepInfo or eventInfo, whose energies ignore the weights
+bool CpopNtuplesFilled() {
+	auto* UImanager = G4UImanager::GetUIpointer();
+	for(auto const* command: {"/cpop/population/stepInfo", "/cpop/population/eventInfo"})
+		if(G4UIcommand::ConvertToBool(UImanager->GetCurrentValues(command).c_str()))
+			return true;
+	return false;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/// Stepping action of a worker applying the weight window after calling the one it replaces (owned)
+class WeightWindowSteppingAction: public G4UserSteppingAction {
+public:
+	WeightWindowSteppingAction(const ImportanceSampling& sampling, G4UserSteppingAction* previous):
+		fSampling(sampling),
+		fPrevious(previous)
+	{
+	}
+
+	void SetSteppingManagerPointer(G4SteppingManager* manager) override {
+		G4UserSteppingAction::SetSteppingManagerPointer(manager);
+		if(fPrevious)
+			fPrevious->SetSteppingManagerPointer(manager);
+	}
+
+	void UserSteppingAction(const G4Step* step) override {
+		if(fPrevious)
+			fPrevious->UserSteppingAction(step);
+
+		if(fSampling.enabled())
+			fSampling.Apply(*step);
+	}
+
+private:
+	const ImportanceSampling& fSampling;
+	std::unique_ptr<G4UserSteppingAction> fPrevious;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/// Actions of the wrapped initialization, with its stepping action chained to the weight window
+class WeightWindowActionInitialization: public G4VUserActionInitialization {
+public:
+	WeightWindowActionInitialization(const ImportanceSampling& sampling, G4VUserActionInitialization* actions):
+		fSampling(sampling),
+		fActions(actions)
+	{
+	}
+
+	void Build() const override {
+		fActions->Build();
+		// the actions are those of the run manager of the thread
+		auto* previous = const_cast<G4UserSteppingAction*>(G4RunManager::GetRunManager()->GetUserSteppingAction());
+		SetUserAction(new WeightWindowSteppingAction(fSampling, previous));
+	}
+
+	void BuildForMaster() const override {
+		fActions->BuildForMaster();
+	}
+
+	G4VSteppingVerbose* InitializeSteppingVerbose() const override {
+		return fActions->InitializeSteppingVerbose();
+	}
+
+private:
+	const ImportanceSampling& fSampling;
+	std::unique_ptr<G4VUserActionInitialization> fActions;
+};
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ImportanceSampling::ImportanceSampling(const CellDoseScorer& scorer):
+	fScorer(scorer),
+	fZoneWidth(10.*micrometer),
+	fDirectory("/cpop/importance/", false),
+	fObserveCmd("/cpop/importance/observe", this),
+	fRegionRatiosCmd("/cpop/importance/regionRatios", this),
+	fNeutralCmd("/cpop/importance/neutral", this),
+	fLevelsCmd("/cpop/importance/levels", this),
+	fZoneWidthCmd("/cpop/importance/zoneWidth", this),
+	fReportCmd("/cpop/importance/report", this)
+{
+	fDirectory.SetGuidance("Splitting and Russian roulette of the particles toward observed cells");
+
+	fObserveCmd.SetGuidance("Observe a number of cells per region of the population scored, drawn with a seed");
+	auto* perRegion = new G4UIparameter("NbCell", 'i', false);
+	perRegion->SetParameterRange("NbCell >= 0");
+	fObserveCmd.SetParameter(perRegion);
+	auto* seed = new G4UIparameter("Seed", 'i', true);
+	seed->SetDefaultValue(1);
+	fObserveCmd.SetParameter(seed);
+	fObserveCmd.AvailableForStates(G4State_PreInit, G4State_Idle);
+
+	fRegionRatiosCmd.SetGuidance("Set the internal and intermediary ratios defining the regions of the observed cells");
+	fRegionRatiosCmd.SetGuidance("(those of /cpop/population/internalRatio and intermediaryRatio by default)");
+	auto* internalRatio = new G4UIparameter("InternalRatio", 'd', false);
+	internalRatio->SetParameterRange("InternalRatio >= 0");
+	fRegionRatiosCmd.SetParameter(internalRatio);
+	auto* intermediaryRatio = new G4UIparameter("IntermediaryRatio", 'd', false);
+	intermediaryRatio->SetParameterRange("IntermediaryRatio >= 0");
+	fRegionRatiosCmd.SetParameter(intermediaryRatio);
+	fRegionRatiosCmd.AvailableForStates(G4State_PreInit, G4State_Idle);
+
+	fNeutralCmd.SetGuidance("Also split and roulette the neutral particles (false by default)");
+	fNeutralCmd.SetParameterName("Neutral", false);
+	fNeutralCmd.AvailableForStates(G4State_PreInit, G4State_Idle);
+
+	fLevelsCmd.SetGuidance("Set the number of zones of decreasing importance around the observed cells (0 for no biasing)");
+	fLevelsCmd.SetParameterName("NbLevel", false);
+	fLevelsCmd.SetRange("NbLevel >= 0 && NbLevel <= 16");
+	fLevelsCmd.AvailableForStates(G4State_PreInit, G4State_Idle);
+
+	fZoneWidthCmd.SetGuidance("Set the width of a zone of importance");
+	fZoneWidthCmd.SetParameterName("Width", false);
+	fZoneWidthCmd.SetRange("Width > 0");
+	fZoneWidthCmd.SetUnitCategory("Length");
+	fZoneWidthCmd.SetDefaultUnit("um");
+	fZoneWidthCmd.AvailableForStates(G4State_PreInit, G4State_Idle);
+
+	fReportCmd.SetGuidance("Append the figure of merit of the observed cells after each run to a CSV file");
+	fReportCmd.SetParameterName("ReportFile", false);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ImportanceSampling::SetNewValue(G4UIcommand* command, G4String newValue)
+{
+	if(command == &fObserveCmd) {
+		long perRegion = 0;
+		long seed = 1;
+		std::istringstream(newValue) >> perRegion >> seed;
+		fPerRegion = static_cast<std::size_t>(std::max(perRegion, 0L));
+		fSeed = static_cast<std::uint64_t>(seed);
+		Build();
+	} else if(command == &fRegionRatiosCmd) {
+		std::istringstream(newValue) >> fInternalRatio >> fIntermediaryRatio;
+		fRegionRatiosSet = true;
+		Build();
+	} else if(command == &fNeutralCmd) {
+		fNeutral = fNeutralCmd.GetNewBoolValue(newValue);
+	} else if(command == &fLevelsCmd) {
+		fLevels = fLevelsCmd.GetNewIntValue(newValue);
+		Build();
+	} else if(command == &fZoneWidthCmd) {
+		fZoneWidth = fZoneWidthCmd.GetNewDoubleValue(newValue);
+		Build();
+	} else if(command == &fReportCmd) {
+		fReportFile = newValue;
+	}
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4VUserActionInitialization* ImportanceSampling::Wrap(G4VUserActionInitialization* actions)
+{
+	return new WeightWindowActionInitialization(*this, actions);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ImportanceSampling::Build()
+{
+	fObserved.clear();
+	fMap = ImportanceMap();
+	if(fPerRegion == 0)
+		return;
+
+	auto const& locator = fScorer.locator();
+	if(!fScorer.enabled() || locator.size() == 0)
+		throw std::runtime_error("no cells scored to observe, use /cpop/scoring/cellDose true first");
+
+	// regions of CPOP, unless given by /cpop/importance/regionRatios
+	if(!fRegionRatiosSet && !PopulationLoader::RegionRatios(fInternalRatio, fIntermediaryRatio))
+		throw std::runtime_error("regions of the population unknown, use /cpop/importance/regionRatios");
+
+	// regions relative to the center of the cells and to the farthest membrane from it
+	std::size_t const count = locator.size();
+	std::vector<double> x(count), y(count), z(count), radius(count);
+	double center[3] = {0., 0., 0.};
+	for(std::size_t i = 0; i < count; ++i) {
+		auto const& c = locator.center(i);
+		x[i] = c[0];
+		y[i] = c[1];
+		z[i] = c[2];
+		radius[i] = locator.radius(i);
+		for(int axis = 0; axis < 3; ++axis)
+			center[axis] += c[axis]/count;
+	}
+	double spheroidRadius = 0.;
+	for(std::size_t i = 0; i < count; ++i)
+		spheroidRadius = std::max(spheroidRadius, std::hypot(x[i] - center[0], y[i] - center[1], z[i] - center[2]) + radius[i]);
+	CellArrays cells;
+	cells.count = count;
+	cells.x = x.data();
+	cells.y = y.data();
+	cells.z = z.data();
+	cells.radius = radius.data();
+	auto const regions = CellRegions(cells, center, spheroidRadius, fInternalRatio, fIntermediaryRatio);
+	fObserved = SampleCellsPerRegion(regions, fPerRegion, fSeed);
+
+	std::vector<ImportanceMap::Point> centers;
+	std::vector<double> radii;
+	for(std::size_t const i: fObserved) {
+		centers.push_back(locator.center(i));
+		radii.push_back(radius[i]);
+	}
+	ImportanceMap map(centers, radii, fZoneWidth, fLevels);
+	if(map.enabled() && CpopNtuplesFilled())
+		throw std::runtime_error("the ntuples of CPOP ignore the weights of the particles, set /cpop/population/stepInfo 0 and "
+			"/cpop/population/eventInfo 0 before splitting (/cpop/importance/levels 0 keeps the transport analog)");
+	fMap = std::move(map);
+	G4cout << "Observing " << fObserved.size() << " cells, " << fLevels << " zones of importance of " << fZoneWidth/um
+		<< " um around them" << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ImportanceSampling::Apply(const G4Step& step) const
+{
+	G4Track* track = step.GetTrack();
+	if(track->GetTrackStatus() != fAlive || track->GetKineticEnergy() <= 0.)
+		return;
+	if(!fNeutral && track->GetParticleDefinition()->GetPDGCharge() == 0.)
+		return;
+
+	auto const& position = track->GetPosition();
+	double const importance = fMap.Importance({position.x(), position.y(), position.z()});
+	auto const outcome = WeightWindow::Apply(track->GetWeight(), importance, G4UniformRand());
+	if(outcome.count == 0) {
+		track->SetTrackStatus(fStopAndKill);
+		return;
+	}
+	track->SetWeight(outcome.weight);
+
+	// the copies continue the track from the end of the step, as its secondaries, so that the
+	// stepping manager stacks them with their parent known
+	auto& secondaries = *const_cast<G4Step&>(step).GetfSecondary();
+	for(int copy = 1; copy < outcome.count; ++copy) {
+		auto* split = new G4Track(new G4DynamicParticle(*track->GetDynamicParticle()), track->GetGlobalTime(), position);
+		split->SetWeight(outcome.weight);
+		split->SetTouchableHandle(track->GetTouchableHandle());
+		split->SetParentID(track->GetTrackID());
+		split->SetCreatorProcess(track->GetCreatorProcess());
+		split->SetLocalTime(track->GetLocalTime());
+		split->SetProperTime(track->GetProperTime());
+		split->SetVertexPosition(track->GetVertexPosition());
+		split->SetVertexMomentumDirection(track->GetVertexMomentumDirection());
+		split->SetVertexKineticEnergy(track->GetVertexKineticEnergy());
+		split->SetLogicalVolumeAtVertex(track->GetLogicalVolumeAtVertex());
+		secondaries.push_back(split);
+	}
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ImportanceSampling::EndOfRun(int nEvent, double seconds) const
+{
+	auto const& total = fScorer.total();
+	if(fObserved.empty() || nEvent < 2 || total.hits.size() != fScorer.locator().size())
+		return;
+
+	// squared relative error of the mean energy per event of each observed cell reached
+	double relativeError2 = 0.;
+	std::size_t reached = 0;
+	for(std::size_t const i: fObserved) {
+		if(i >= total.hits.size())
+			continue;
+		bool const nucleus = total.nucleusEnergy[i] > 0.;
+		double const sum = nucleus ? total.nucleusEnergy[i] : total.cellEnergy[i];
+		double const sum2 = nucleus ? total.nucleusEnergy2[i] : total.cellEnergy2[i];
+		if(!(sum > 0.))
+			continue;
+		double const mean = sum/nEvent;
+		double const variance = std::max(0., sum2/nEvent - mean*mean)/(nEvent - 1);
+		relativeError2 += variance/(mean*mean);
+		++reached;
+	}
+	if(reached > 0)
+		relativeError2 /= reached;
+	double const figureOfMerit = reached > 0 && relativeError2 > 0. && seconds > 0. ? 1./(relativeError2*seconds) : 0.;
+
+	if(fMap.enabled() && CpopNtuplesFilled())
+		G4cerr << "The ntuples of CPOP were filled during this biased run: they ignore the weights of the particles and are"
+			<< " not valid, only the cell dose table of /cpop/scoring/cellDose is" << G4endl;
+	G4cout << "Observed cells (" << fLevels << " zones of importance of " << fZoneWidth/um << " um): " << reached << " of "
+		<< fObserved.size() << " reached, mean squared relative error " << relativeError2 << ", figure of merit "
+		<< figureOfMerit << " /s" << G4endl;
+
+	if(fReportFile.empty())
+		return;
+
+	std::ifstream const existing(fReportFile);
+	bool const header = !existing.good();
+	std::ofstream file(fReportFile, std::ios::app);
+	if(header)
+		file << "levels,zoneWidthUm,events,seconds,observed,reached,relativeError2,figureOfMerit\n";
+	file << fLevels << ',' << fZoneWidth/um << ',' << nEvent << ',' << seconds << ',' << fObserved.size() << ',' << reached << ','
+		<< relativeError2 << ',' << figureOfMerit << '\n';
+	if(!file)
+		G4cerr << "Importance report not written to " << fReportFile << G4endl;
+}
+
+}
@@ -0,0 +1,175 @@
+/// \file MacroWorker.cc
+/// \brief Implementation of the Common::MacroWorker class
+
+#include "MacroWorker.hh"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <sys/stat.h>
+
+#include <G4UImanager.hh>
+#include <G4UIcommandStatus.hh>
+
+namespace Common {
+
+namespace {
+
+std::string Trim(const std::string& line) {
+	auto const begin = line.find_first_not_of(" \t\r");
+	if(begin == std::string::npos)
+		return {};
+	return line.substr(begin, line.find_last_not_of(" \t\r") - begin + 1);
+}
+
+/// Macro file name without its directory and extension
+std::string Stem(const std::string& macro) {
+	auto const slash = macro.find_last_of('/');
+	std::string name = slash == std::string::npos ? macro : macro.substr(slash + 1);
+	auto const dot = name.find_last_of('.');
+	return dot == std::string::npos || dot == 0 ? name : name.substr(0, dot);
+}
+
+bool IsFifo(const std::string& filename) {
+	struct stat status{};
+	return ::stat(filename.c_str(), &status) == 0 && S_ISFIFO(status.st_mode);
+}
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+MacroWorker::MacroWorker(G4UImanager* manager):
+	fManager(manager)
+{
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void MacroWorker::Initialise(const std::string& macro) {
+	if(!Execute(macro))
+		throw std::runtime_error("initialisation macro " + macro + " failed");
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+bool MacroWorker::Run(const std::string& macro) {
+	auto const start = std::chrono::steady_clock::now();
+	++fJobs;
+	if(!std::ifstream(macro)) {
+		std::cerr << "Cannot open the job " << macro << std::endl;
+		return false;
+	}
+	if(!Reset(macro)) {
+		std::cerr << "Job " << macro << " not run: the sources of the previous jobs could not be disabled" << std::endl;
+		return false;
+	}
+	if(!Execute(macro))
+		return false;
+
+	std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+	std::cout << "Job " << macro << " : " << elapsed.count() << " s" << std::endl;
+	return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+bool MacroWorker::Execute(const std::string& macro) {
+	std::ifstream file(macro);
+	if(!file) {
+		std::cerr << "Cannot open the macro " << macro << std::endl;
+		return false;
+	}
+
+	// executed line by line (as G4UIbatch does) to catch the sources it adds
+	std::string command;
+	for(std::string line; std::getline(file, line);) {
+		line = Trim(line);
+		if(!line.empty() && line.back() == '_') {
+			command += line.substr(0, line.size() - 1);
+			continue;
+		}
+		command = Trim(command + line);
+		if(command.empty() || command[0] == '#') {
+			command.clear();
+			continue;
+		}
+
+		std::istringstream words(command);
+		std::string name, source;
+		words >> name >> source;
+		bool const uniform = name == "/cpop/source/addUniform";
+		bool const add = (uniform || name == "/cpop/source/addDistribution") && !source.empty();
+		auto const type = uniform ? SourceType::Uniform : SourceType::Distribution;
+		auto const existing = add ? fSources.find(source) : fSources.end();
+		if(existing != fSources.end()) {
+			if(existing->second != type) {
+				std::cerr << macro << " stopped: the source " << source << " already exists with another type" << std::endl;
+				return false;
+			}
+			// already created by a previous macro, its properties are set again by this one
+			command.clear();
+			continue;
+		}
+
+		if(!Apply(command)) {
+			std::cerr << macro << " stopped at: " << command << std::endl;
+			return false;
+		}
+		if(add)
+			fSources.emplace(source, type);
+		command.clear();
+	}
+	return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::size_t MacroWorker::Serve(const std::string& filename) {
+	bool const fifo = IsFifo(filename);
+	std::size_t failures = 0;
+	do {
+		// opening a FIFO waits for a writer, reading it ends when every writer closed it
+		std::ifstream jobs(filename);
+		if(!jobs)
+			throw std::runtime_error("cannot open the job list " + filename);
+		for(std::string line; std::getline(jobs, line);) {
+			line = Trim(line);
+			if(line.empty() || line[0] == '#')
+				continue;
+			if(line == "exit")
+				return failures;
+			if(!Run(line))
+				++failures;
+		}
+	} while(fifo);
+	return failures;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+bool MacroWorker::Reset(const std::string& macro) {
+	bool reset = true;
+	for(auto const& [source, type]: fSources) {
+		std::string const prefix = "/cpop/source/" + source + "/";
+		bool const disabled = type == SourceType::Uniform
+			? Apply(prefix + "totalParticle 0")
+			: Apply(prefix + "totalSource 0") && Apply(prefix + "distributionInRegion 0 0 0");
+		if(!disabled) {
+			std::cerr << "Cannot disable the source " << source << std::endl;
+			reset = false;
+		}
+	}
+	return Apply("/analysis/setFileName " + Stem(macro)) && reset;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+bool MacroWorker::Apply(const std::string& command) {
+	return fManager->ApplyCommand(command) == fCommandSucceeded;
+}
+
+}
@@ -0,0 +1,94 @@
+/// \file MemoryReport.cc
+/// \brief Implementation of the Common::MemoryReport class
+
+#include "MemoryReport.hh"
+
+#include <fstream>
+#include <sstream>
+
+#include <sys/resource.h>
+
+#include <G4ios.hh>
+
+namespace Common {
+
+namespace {
+
+constexpr double MB = 1024.*1024.;
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+MemoryUsage ReadMemoryUsage() {
+	MemoryUsage usage;
+
+	// lines as "VmRSS:     123456 kB"
+	std::ifstream status("/proc/self/status");
+	for(std::string line; std::getline(status, line);) {
+		std::istringstream words(line);
+		std::string key;
+		double kB = 0.;
+		if(!(words >> key >> kB))
+			continue;
+		if(key == "VmRSS:")
+			usage.resident = kB*1024.;
+		else if(key == "VmHWM:")
+			usage.peak = kB*1024.;
+	}
+
+	if(usage.peak == 0.) {
+		struct rusage resources{};
+		// ru_maxrss is in kB on Linux, in bytes on macOS
+		if(::getrusage(RUSAGE_SELF, &resources) == 0)
+#ifdef __APPLE__
+			usage.peak = static_cast<double>(resources.ru_maxrss);
+#else
+			usage.peak = static_cast<double>(resources.ru_maxrss)*1024.;
+#endif
+	}
+	return usage;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+MemoryReport::MemoryReport():
+	fDirectory("/cpop/memory/", false),
+	fReportCmd("/cpop/memory/report", this)
+{
+	fDirectory.SetGuidance("Memory of the process");
+
+	fReportCmd.SetGuidance("Append the resident memory after each run to a CSV file");
+	fReportCmd.SetParameterName("ReportFile", false);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void MemoryReport::SetNewValue(G4UIcommand* command, G4String newValue)
+{
+	if(command == &fReportCmd)
+		fFilename = newValue;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void MemoryReport::EndOfRun(int nEvent, int nThreads) const
+{
+	auto const usage = ReadMemoryUsage();
+	G4cout << "Memory after the run on " << nThreads << " threads: " << usage.resident/MB << " MB resident, "
+		<< usage.peak/MB << " MB peak" << G4endl;
+
+	if(fFilename.empty())
+		return;
+
+	std::ifstream const existing(fFilename);
+	bool const header = !existing.good();
+	std::ofstream file(fFilename, std::ios::app);
+	if(header)
+		file << "threads,events,residentMB,peakMB\n";
+	file << nThreads << ',' << nEvent << ',' << usage.resident/MB << ',' << usage.peak/MB << '\n';
+	if(!file)
+		G4cerr << "Memory report not written to " << fFilename << G4endl;
+}
+
+}
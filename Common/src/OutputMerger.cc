@@ -0,0 +1,721 @@
+/// \file OutputMerger.cc
+/// \brief Implementation of the Common::OutputMerger class
+
+#include "OutputMerger.hh"
+#include "ColumnTable.hh"
+#include "ParallelFor.hh"
+#include "Shard.hh"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <G4UImanager.hh>
+#include <G4ios.hh>
+
+#ifdef COMMON_WITH_ROOT
+#include <set>
+#include <unordered_map>
+
+#include <TFile.h>
+#include <TH1.h>
+#include <TKey.h>
+#include <TLeaf.h>
+#include <TROOT.h>
+#include <TTree.h>
+#endif
+
+namespace Common {
+
+namespace {
+
+bool Exists(const std::string& filename) {
+	struct stat status{};
+	return ::stat(filename.c_str(), &status) == 0;
+}
+
+bool EndsWith(const std::string& text, const std::string& suffix) {
+	return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+/// fileName without its extension
+std::string Stem(const std::string& fileName) {
+	auto const slash = fileName.find_last_of('/');
+	auto const dot = fileName.find_last_of('.');
+	bool const extension = dot != std::string::npos && (slash == std::string::npos || dot > slash);
+	return extension ? fileName.substr(0, dot) : fileName;
+}
+
+/// fileName without the suffix _t<id> of a thread, if any
+std::string WithoutThread(const std::string& fileName) {
+	auto const position = fileName.rfind("_t");
+	if(position == std::string::npos || position + 2 == fileName.size())
+		return fileName;
+	for(auto i = position + 2; i < fileName.size(); ++i)
+		if(fileName[i] < '0' || fileName[i] > '9')
+			return fileName;
+	return fileName.substr(0, position);
+}
+
+/// Tables of the ntuples read from the inputs, by ntuple name
+using Tables = std::map<std::string, std::unique_ptr<ColumnTableBuilder>>;
+
+/// Table of the ntuple name with columns, checked against those of the inputs already read
+ColumnTableBuilder& Table(Tables& tables, const std::string& name, const std::vector<std::pair<std::string, ColumnTable::Type>>& columns,
+	const std::string& input)
+{
+	auto& table = tables[name];
+	if(!table) {
+		table = std::make_unique<ColumnTableBuilder>();
+		for(auto const& column: columns)
+			table->AddColumn(column.first, column.second);
+	}
+	bool same = table->columnCount() == columns.size();
+	for(std::size_t c = 0; same && c < columns.size(); ++c)
+		same = table->name(c) == columns[c].first && table->type(c) == columns[c].second;
+	if(!same)
+		throw std::runtime_error("the columns of the ntuple " + name + " of " + input + " differ from those of the previous files");
+	return *table;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/// Shard of the rows of input if shards is true (the suffix of its name, see ShardFileName), -1 otherwise
+int InputShard(const std::string& input, bool shards) {
+	if(!shards)
+		return -1;
+	Shard shard;
+	if(!ParseShardFileName(input, shard))
+		throw std::runtime_error(input + " is not a shard (no _shard<i>of<N> suffix)");
+	return static_cast<int>(shard.index);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/// Add the shard column, last, to the columns of the rows of a shard (shard >= 0)
+void AddShardColumn(std::vector<std::pair<std::string, ColumnTable::Type>>& columns, int shard, const std::string& input) {
+	if(shard < 0)
+		return;
+	for(auto const& column: columns)
+		if(column.first == ColumnTable::ShardColumn)
+			throw std::runtime_error(input + " already has a column " + ColumnTable::ShardColumn);
+	columns.emplace_back(ColumnTable::ShardColumn, ColumnTable::Int32);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/// Type of the values of a csv ntuple column (#column <type> <name>), TypeCount if not supported
+ColumnTable::Type CsvType(const std::string& type) {
+	if(type.find("vector") != std::string::npos)
+		return ColumnTable::TypeCount;
+	if(type.find("string") != std::string::npos)
+		return ColumnTable::Text;
+	if(type == "float")
+		return ColumnTable::Float;
+	if(type == "double")
+		return ColumnTable::Double;
+	if(type.find("int64") != std::string::npos || type.find("long") != std::string::npos || type.find("unsigned") != std::string::npos)
+		return ColumnTable::Int64;
+	return ColumnTable::Int32;
+}
+
+/// Add the rows of a csv ntuple file, written by the csv output of the analysis (commented header),
+/// with their shard if shard >= 0
+void ReadCsv(const std::string& input, Tables& tables, int shard) {
+	std::ifstream in(input);
+	if(!in)
+		throw std::runtime_error("cannot read " + input);
+
+	// output_nt_<ntuple>_t<id>.csv
+	std::string const stem = WithoutThread(Stem(input));
+	auto const position = stem.rfind("_nt_");
+	std::string const name = position == std::string::npos ? stem.substr(stem.find_last_of('/') + 1) : stem.substr(position + 4);
+
+	std::vector<std::pair<std::string, ColumnTable::Type>> columns;
+	std::vector<bool> kept;
+	char separator = ',';
+	std::string line;
+	std::streampos data = in.tellg();
+	while(std::getline(in, line) && !line.empty() && line[0] == '#') {
+		std::istringstream header(line.substr(1));
+		std::string key;
+		header >> key;
+		if(key == "separator") {
+			int code = ',';
+			header >> code;
+			separator = static_cast<char>(code);
+		} else if(key == "column") {
+			// the type may be made of several words (unsigned int)
+			std::vector<std::string> words;
+			for(std::string word; header >> word;)
+				words.push_back(word);
+			if(words.size() < 2)
+				throw std::runtime_error(input + ": malformed header " + line);
+			std::string type = words.front();
+			for(std::size_t w = 1; w + 1 < words.size(); ++w)
+				type += " " + words[w];
+			auto const columnType = CsvType(type);
+			kept.push_back(columnType != ColumnTable::TypeCount);
+			if(kept.back())
+				columns.emplace_back(words.back(), columnType);
+			else
+				G4cerr << input << ": the column " << words.back() << " (" << type << ") is not written as a column" << G4endl;
+		}
+		data = in.tellg();
+	}
+	if(kept.empty())
+		throw std::runtime_error(input + " has no column header (csv ntuples written without header)");
+
+	auto& table = Table(tables, name, columns, input);
+	in.clear();
+	in.seekg(data);
+	long lineNumber = 0;
+	while(std::getline(in, line)) {
+		++lineNumber;
+		if(line.empty())
+			continue;
+		std::size_t begin = 0;
+		std::size_t column = 0;
+		for(std::size_t field = 0; field < kept.size(); ++field) {
+			auto end = line.find(separator, begin);
+			if(end == std::string::npos) {
+				if(field + 1 < kept.size())
+					throw std::runtime_error(input + ": row " + std::to_string(lineNumber) + " has too few values");
+				end = line.size();
+			}
+			if(kept[field]) {
+				std::string const value = line.substr(begin, end - begin);
+				auto const type = table.type(column);
+				char* parsed = nullptr;
+				if(type == ColumnTable::Text)
+					table.SetText(column, value);
+				else if(ColumnTable::IsReal(type))
+					table.SetReal(column, std::strtod(value.c_str(), &parsed));
+				else
+					table.SetInteger(column, std::strtoll(value.c_str(), &parsed, 10));
+				if(type != ColumnTable::Text && (parsed == value.c_str() || *parsed != '\0'))
+					throw std::runtime_error(input + ": invalid value " + value + " in row " + std::to_string(lineNumber));
+				++column;
+			}
+			begin = end + 1;
+		}
+		if(shard >= 0)
+			table.SetInteger(columns.size() - 1, shard);
+		table.EndRow();
+	}
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/// Add the rows of a column table file, <output>.<ntuple>.cpopc, with their shard if shard >= 0
+void ReadColumns(const std::string& input, Tables& tables, int shard) {
+	MappedColumnTable const mapped(input);
+	std::string const stem = Stem(input);
+	std::string const output = Stem(stem);
+	std::string const name = output != stem ? stem.substr(output.size() + 1) : stem.substr(stem.find_last_of('/') + 1);
+
+	std::vector<std::pair<std::string, ColumnTable::Type>> columns;
+	for(std::size_t c = 0; c < mapped.columnCount(); ++c)
+		columns.emplace_back(mapped.name(c), mapped.type(c));
+	AddShardColumn(columns, shard, input);
+	auto& table = Table(tables, name, columns, input);
+
+	for(std::size_t row = 0; row < mapped.rowCount(); ++row) {
+		for(std::size_t c = 0; c < mapped.columnCount(); ++c)
+			switch(mapped.type(c)) {
+				case ColumnTable::Int32: table.SetInteger(c, mapped.values<std::int32_t>(c)[row]); break;
+				case ColumnTable::Int64: table.SetInteger(c, mapped.values<std::int64_t>(c)[row]); break;
+				case ColumnTable::Text: table.SetText(c, mapped.text(c, mapped.values<std::uint32_t>(c)[row])); break;
+				default: table.SetReal(c, mapped.real(c, row)); break;
+			}
+		if(shard >= 0)
+			table.SetInteger(columns.size() - 1, shard);
+		table.EndRow();
+	}
+}
+
+#ifdef COMMON_WITH_ROOT
+
+/// Value written in the particle name of the per-cell summaries
+constexpr const char* SummaryName = "EndOfRun";
+
+/// Concatenate the event rows of the trees (having the same columns) and sum their summaries,
+/// the rows of the tree t being given the shard shards[t] if shards is not empty
+void MergeTrees(const std::vector<TTree*>& trees, const std::vector<int>& shards, TDirectory* output) {
+	TTree* const first = trees.front();
+	output->cd();
+	TTree* const merged = first->CloneTree(0);
+	// every tree is read in the buffers of the first one, which are also those of merged
+	for(std::size_t t = 1; t < trees.size(); ++t)
+		first->CopyAddresses(trees[t]);
+
+	// the shard of the rows, a column added to the trees of the shards or read from the merged ones
+	Int_t shard = -1;
+	TLeaf* const shardLeaf = first->GetLeaf(ColumnTable::ShardColumn);
+	bool const addShard = !shards.empty() && !shardLeaf;
+	if(addShard)
+		merged->Branch(ColumnTable::ShardColumn, &shard, (std::string(ColumnTable::ShardColumn) + "/I").c_str());
+
+	// the scalar additive columns of a summary (the doses, see ColumnTable::IsAdditive) are summed, the others identify it
+	std::vector<TLeaf*> sums;
+	std::vector<TLeaf*> keys;
+	std::vector<TLeaf*> texts;
+	for(auto* object: *first->GetListOfLeaves()) {
+		auto* leaf = static_cast<TLeaf*>(object);
+		// a summary is the sum of those of every shard
+		if(leaf == shardLeaf)
+			continue;
+		std::string const type = leaf->GetTypeName();
+		auto const columnType = type == "Double_t" ? ColumnTable::Double : type == "Float_t" ? ColumnTable::Float : ColumnTable::TypeCount;
+		if(ColumnTable::IsAdditive(leaf->GetName(), columnType) && leaf->GetLen() == 1 && !leaf->GetLeafCount())
+			sums.push_back(leaf);
+		else
+			keys.push_back(leaf);
+		if(type == "Char_t")
+			texts.push_back(leaf);
+	}
+
+	struct Summary {
+		std::size_t tree;
+		Long64_t entry;
+		std::vector<double> sums;
+	};
+	std::vector<Summary> summaries;
+	std::unordered_map<std::string, std::size_t> index;
+
+	for(std::size_t t = 0; t < trees.size(); ++t) {
+		for(Long64_t entry = 0; entry < trees[t]->GetEntries(); ++entry) {
+			trees[t]->GetEntry(entry);
+			bool const summary = std::any_of(std::begin(texts), std::end(texts), [](TLeaf* leaf) {
+				return std::string(static_cast<const char*>(leaf->GetValuePointer())) == SummaryName;
+			});
+			if(!summary) {
+				if(addShard)
+					shard = shards[t];
+				merged->Fill();
+				continue;
+			}
+
+			std::ostringstream key;
+			key.precision(17);
+			for(auto* leaf: keys) {
+				if(std::string(leaf->GetTypeName()) == "Char_t")
+					key << static_cast<const char*>(leaf->GetValuePointer());
+				else
+					for(Int_t i = 0; i < leaf->GetLen(); ++i)
+						key << leaf->GetValue(i) << ' ';
+				key << '\n';
+			}
+
+			auto const found = index.emplace(key.str(), summaries.size());
+			if(found.second)
+				summaries.push_back({t, entry, std::vector<double>(sums.size(), 0.)});
+			auto& total = summaries[found.first->second].sums;
+			for(std::size_t s = 0; s < sums.size(); ++s)
+				total[s] += sums[s]->GetValue();
+		}
+	}
+
+	// one row per summary, the first one read with its floating point columns replaced by the sums
+	for(auto const& summary: summaries) {
+		trees[summary.tree]->GetEntry(summary.entry);
+		for(std::size_t s = 0; s < sums.size(); ++s) {
+			void* value = sums[s]->GetValuePointer();
+			if(std::string(sums[s]->GetTypeName()) == "Double_t")
+				*static_cast<double*>(value) = summary.sums[s];
+			else
+				*static_cast<float*>(value) = static_cast<float>(summary.sums[s]);
+		}
+		shard = -1;
+		if(shardLeaf)
+			*static_cast<Int_t*>(shardLeaf->GetValuePointer()) = -1;
+		merged->Fill();
+	}
+
+	merged->Write("", TObject::kOverwrite);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/// Merge the content of the directories, objects being matched by name, the rows of the trees
+/// of the directory i being given the shard shards[i] if shards is not empty
+void MergeDirectories(const std::vector<TDirectory*>& inputs, const std::vector<int>& shards, TDirectory* output) {
+	std::vector<std::string> names;
+	std::set<std::string> known;
+	for(auto* directory: inputs)
+		for(auto* key: *directory->GetListOfKeys())
+			if(known.insert(key->GetName()).second)
+				names.emplace_back(key->GetName());
+
+	for(auto const& name: names) {
+		std::vector<TObject*> objects;
+		std::vector<int> objectShards;
+		for(std::size_t i = 0; i < inputs.size(); ++i)
+			if(auto* object = inputs[i]->Get(name.c_str())) {
+				objects.push_back(object);
+				if(!shards.empty())
+					objectShards.push_back(shards[i]);
+			}
+
+		TObject* const first = objects.front();
+		if(first->InheritsFrom(TTree::Class())) {
+			std::vector<TTree*> trees;
+			for(auto* object: objects)
+				trees.push_back(static_cast<TTree*>(object));
+			MergeTrees(trees, objectShards, output);
+		} else if(first->InheritsFrom(TDirectory::Class())) {
+			std::vector<TDirectory*> directories;
+			for(auto* object: objects)
+				directories.push_back(static_cast<TDirectory*>(object));
+			MergeDirectories(directories, objectShards, output->mkdir(name.c_str()));
+		} else if(first->InheritsFrom(TH1::Class())) {
+			output->cd();
+			auto* sum = static_cast<TH1*>(first->Clone());
+			sum->SetDirectory(output);
+			for(std::size_t o = 1; o < objects.size(); ++o)
+				sum->Add(static_cast<TH1*>(objects[o]));
+			sum->Write("", TObject::kOverwrite);
+		} else {
+			output->cd();
+			first->Write(name.c_str(), TObject::kOverwrite);
+		}
+	}
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/// Merge the files inputs into output, with the shards of their rows if shards is not empty
+void MergeGroup(const std::vector<std::string>& inputs, const std::vector<int>& shards, const std::string& output) {
+	std::vector<std::unique_ptr<TFile>> files;
+	std::vector<TDirectory*> directories;
+	for(auto const& input: inputs) {
+		files.emplace_back(TFile::Open(input.c_str(), "READ"));
+		if(!files.back() || files.back()->IsZombie())
+			throw std::runtime_error("cannot read " + input);
+		directories.push_back(files.back().get());
+	}
+
+	std::unique_ptr<TFile> merged(TFile::Open(output.c_str(), "RECREATE"));
+	if(!merged || merged->IsZombie())
+		throw std::runtime_error("cannot write " + output);
+	MergeDirectories(directories, shards, merged.get());
+	merged->Close();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/// Type of the values of a leaf, TypeCount if it is not written as a column
+ColumnTable::Type LeafType(TLeaf* leaf) {
+	std::string const type = leaf->GetTypeName();
+	if(type == "Char_t")
+		return ColumnTable::Text;
+	if(leaf->GetLen() != 1 || leaf->GetLeafCount())
+		return ColumnTable::TypeCount;
+	if(type == "Float_t")
+		return ColumnTable::Float;
+	if(type == "Double_t")
+		return ColumnTable::Double;
+	if(type == "Long64_t" || type == "ULong64_t" || type == "Long_t" || type == "ULong_t" || type == "UInt_t")
+		return ColumnTable::Int64;
+	if(type == "Int_t" || type == "Short_t" || type == "UShort_t" || type == "UChar_t" || type == "Bool_t")
+		return ColumnTable::Int32;
+	return ColumnTable::TypeCount;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/// Add the rows of the trees of directory and of its sub directories, with their shard if shard >= 0
+void ReadTrees(TDirectory* directory, const std::string& input, Tables& tables, int shard) {
+	for(auto* key: *directory->GetListOfKeys()) {
+		TObject* const object = directory->Get(key->GetName());
+		if(object->InheritsFrom(TDirectory::Class())) {
+			ReadTrees(static_cast<TDirectory*>(object), input, tables, shard);
+			continue;
+		}
+		if(!object->InheritsFrom(TTree::Class()))
+			continue;
+
+		auto* tree = static_cast<TTree*>(object);
+		std::vector<std::pair<std::string, ColumnTable::Type>> columns;
+		std::vector<TLeaf*> leaves;
+		for(auto* leafObject: *tree->GetListOfLeaves()) {
+			auto* leaf = static_cast<TLeaf*>(leafObject);
+			auto const type = LeafType(leaf);
+			if(type == ColumnTable::TypeCount) {
+				G4cerr << input << ": the column " << leaf->GetName() << " (" << leaf->GetTypeName() << ") is not written as a column" << G4endl;
+				continue;
+			}
+			columns.emplace_back(leaf->GetName(), type);
+			leaves.push_back(leaf);
+		}
+
+		AddShardColumn(columns, shard, input);
+		auto& table = Table(tables, tree->GetName(), columns, input);
+		for(Long64_t entry = 0; entry < tree->GetEntries(); ++entry) {
+			tree->GetEntry(entry);
+			for(std::size_t c = 0; c < leaves.size(); ++c)
+				if(columns[c].second == ColumnTable::Text)
+					table.SetText(c, static_cast<const char*>(leaves[c]->GetValuePointer()));
+				else if(ColumnTable::IsReal(columns[c].second))
+					table.SetReal(c, leaves[c]->GetValue());
+				else
+					table.SetInteger(c, leaves[c]->GetValueLong64());
+			if(shard >= 0)
+				table.SetInteger(columns.size() - 1, shard);
+			table.EndRow();
+		}
+	}
+}
+
+#endif
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+OutputMerger::OutputMerger():
+	fDirectory("/cpop/output/", false),
+	fMergeCmd("/cpop/output/merge", this),
+	fKeepThreadFilesCmd("/cpop/output/keepThreadFiles", this),
+	fFormatCmd("/cpop/output/format", this)
+{
+	fDirectory.SetGuidance("Output of the runs");
+
+	fMergeCmd.SetGuidance("Merge the files of the threads into the output file at the end of each run");
+	fMergeCmd.SetParameterName("Merge", false);
+
+	fKeepThreadFilesCmd.SetGuidance("Keep the files of the threads once merged");
+	fKeepThreadFilesCmd.SetParameterName("Keep", false);
+
+	fFormatCmd.SetGuidance("Files of the ntuples at the end of each run: those of the analysis (ROOT or csv),");
+	fFormatCmd.SetGuidance("column tables output.<ntuple>.cpopc in their place, or both");
+	fFormatCmd.SetParameterName("Format", false);
+	fFormatCmd.SetCandidates("analysis columns both");
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void OutputMerger::SetNewValue(G4UIcommand* command, G4String newValue)
+{
+	if(command == &fMergeCmd)
+		fMerge = fMergeCmd.GetNewBoolValue(newValue);
+	else if(command == &fKeepThreadFilesCmd)
+		fKeepThreadFiles = fKeepThreadFilesCmd.GetNewBoolValue(newValue);
+	else if(command == &fFormatCmd)
+		fFormat = newValue == "columns" ? Format::Columns : newValue == "both" ? Format::Both : Format::Analysis;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void OutputMerger::Merge(int nThreads) const
+{
+	std::string const fileName = G4UImanager::GetUIpointer()->GetCurrentValues("/analysis/setFileName");
+	if(fileName.empty())
+		return;
+
+	bool const merged = fMerge && MergeThreadFiles(fileName, nThreads);
+	if(fFormat != Format::Analysis)
+		ConvertToColumns(fileName, nThreads, merged);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void OutputMerger::MergeFiles(const std::vector<std::string>& inputs, const std::string& output, unsigned nThreads, bool shards)
+{
+#ifdef COMMON_WITH_ROOT
+	ROOT::EnableThreadSafety();
+
+	// the shards of the rows are added by the first level, the next ones reading them
+	std::vector<int> inputShards;
+	if(shards)
+		for(auto const& input: inputs)
+			inputShards.push_back(InputShard(input, shards));
+
+	// each level merges the files of the previous one by pairs, concurrently, until one is left
+	std::vector<std::string> level = inputs;
+	std::set<std::string> temporaries;
+	int depth = 0;
+	do {
+		std::vector<std::string> next((level.size() + 1)/2);
+		std::vector<std::vector<std::string>> groups(next.size());
+		std::vector<std::vector<int>> groupShards(next.size());
+		for(std::size_t k = 0; k < next.size(); ++k) {
+			groups[k].assign(std::begin(level) + 2*k, std::begin(level) + std::min(level.size(), 2*k + 2));
+			if(depth == 0 && shards)
+				groupShards[k].assign(std::begin(inputShards) + 2*k, std::begin(inputShards) + std::min(level.size(), 2*k + 2));
+			next[k] = output + ".merge" + std::to_string(depth) + "_" + std::to_string(k);
+		}
+		ParallelFor(next.size(), nThreads, [&](std::size_t begin, std::size_t end, unsigned) {
+			for(std::size_t k = begin; k < end; ++k)
+				MergeGroup(groups[k], groupShards[k], next[k]);
+		});
+
+		for(auto const& file: level)
+			if(temporaries.count(file))
+				std::remove(file.c_str());
+		temporaries.insert(std::begin(next), std::end(next));
+		level = next;
+		++depth;
+	} while(level.size() > 1);
+
+	if(std::rename(level.front().c_str(), output.c_str()) != 0)
+		throw std::runtime_error("cannot write " + output);
+#else
+	(void)inputs;
+	(void)nThreads;
+	(void)shards;
+	throw std::runtime_error("built without ROOT, merge them into " + output + " with hadd");
+#endif
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+bool OutputMerger::MergeThreadFiles(const std::string& fileName, int nThreads) const
+{
+	std::string const output = ThreadFileName(fileName, -1);
+	if(!EndsWith(output, ".root"))
+		return false;
+
+	// the master file holds the histograms filled by the master, if any
+	std::vector<std::string> inputs;
+	if(Exists(output))
+		inputs.push_back(output);
+	std::vector<std::string> threadFiles;
+	for(int thread = 0; thread < nThreads; ++thread)
+		if(Exists(ThreadFileName(fileName, thread)))
+			threadFiles.push_back(ThreadFileName(fileName, thread));
+	if(threadFiles.empty())
+		return false;
+	inputs.insert(std::end(inputs), std::begin(threadFiles), std::end(threadFiles));
+
+	try {
+		MergeFiles(inputs, output, ResolveThreadCount(0));
+	} catch(const std::exception& e) {
+		G4cerr << "Thread files not merged: " << e.what() << G4endl;
+		return false;
+	}
+
+	if(!fKeepThreadFiles)
+		for(auto const& threadFile: threadFiles)
+			std::remove(threadFile.c_str());
+	G4cout << "Merged " << threadFiles.size() << " thread files into " << output << G4endl;
+	return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void OutputMerger::ConvertToColumns(const std::string& fileName, int nThreads, bool merged) const
+{
+	std::string const output = ThreadFileName(fileName, -1);
+	std::vector<std::string> inputs;
+	if(EndsWith(output, ".csv")) {
+		// one file per ntuple and thread, output_nt_<ntuple>_t<id>.csv
+		std::string const stem = Stem(output);
+		auto const slash = stem.find_last_of('/');
+		std::string const directory = slash == std::string::npos ? std::string(".") : stem.substr(0, slash);
+		std::string const prefix = stem.substr(slash + 1) + "_nt_";
+
+		std::vector<std::string> ntuples;
+		if(DIR* entries = ::opendir(directory.c_str())) {
+			while(dirent* entry = ::readdir(entries)) {
+				std::string const name = entry->d_name;
+				if(name.compare(0, prefix.size(), prefix) == 0 && EndsWith(name, ".csv"))
+					ntuples.push_back(WithoutThread(Stem(name)).substr(prefix.size()));
+			}
+			::closedir(entries);
+		}
+		std::sort(std::begin(ntuples), std::end(ntuples));
+		ntuples.erase(std::unique(std::begin(ntuples), std::end(ntuples)), std::end(ntuples));
+
+		for(auto const& ntuple: ntuples) {
+			std::string const ntupleFile = stem + "_nt_" + ntuple + ".csv";
+			for(int thread = -1; thread < nThreads; ++thread)
+				if(Exists(ThreadFileName(ntupleFile, thread)))
+					inputs.push_back(ThreadFileName(ntupleFile, thread));
+		}
+	} else if(EndsWith(output, ".root")) {
+		// the merged file holds the rows of every thread
+		if(Exists(output))
+			inputs.push_back(output);
+		for(int thread = 0; thread < nThreads && !merged; ++thread)
+			if(Exists(ThreadFileName(fileName, thread)))
+				inputs.push_back(ThreadFileName(fileName, thread));
+	}
+	if(inputs.empty())
+		return;
+
+	std::vector<std::string> tables;
+	try {
+		tables = WriteColumns(inputs, output);
+	} catch(const std::exception& e) {
+		G4cerr << "Column tables not written: " << e.what() << G4endl;
+		return;
+	}
+
+	if(fFormat == Format::Columns)
+		for(auto const& input: inputs)
+			std::remove(input.c_str());
+	for(auto const& table: tables)
+		G4cout << "Column table " << table << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::vector<std::string> OutputMerger::WriteColumns(const std::vector<std::string>& inputs, const std::string& output, bool shards)
+{
+	Tables tables;
+	for(auto const& input: inputs) {
+		int const shard = InputShard(input, shards);
+		if(EndsWith(input, ".csv"))
+			ReadCsv(input, tables, shard);
+		else if(EndsWith(input, ColumnTable::Extension))
+			ReadColumns(input, tables, shard);
+		else {
+#ifdef COMMON_WITH_ROOT
+			std::unique_ptr<TFile> file(TFile::Open(input.c_str(), "READ"));
+			if(!file || file->IsZombie())
+				throw std::runtime_error("cannot read " + input);
+			ReadTrees(file.get(), input, tables, shard);
+#else
+			throw std::runtime_error("built without ROOT, " + input + " cannot be read (csv output: /analysis/setFileName output.csv)");
+#endif
+		}
+	}
+
+	std::vector<std::string> written;
+	for(auto const& table: tables) {
+		written.push_back(ColumnFileName(output, table.first));
+		table.second->Write(written.back());
+	}
+	return written;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::string OutputMerger::ColumnFileName(const std::string& fileName, const std::string& table)
+{
+	return Stem(fileName) + "." + table + ColumnTable::Extension;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::string OutputMerger::ThreadFileName(const std::string& fileName, int threadId)
+{
+	// Geant4 inserts _t<id> before the extension, .root by default
+	auto const slash = fileName.find_last_of('/');
+	auto const dot = fileName.find_last_of('.');
+	bool const extension = dot != std::string::npos && (slash == std::string::npos || dot > slash);
+	std::string const stem = extension ? fileName.substr(0, dot) : fileName;
+	std::string const suffix = extension ? fileName.substr(dot) : std::string(".root");
+	return stem + (threadId >= 0 ? "_t" + std::to_string(threadId) : std::string()) + suffix;
+}
+
+}
@@ -0,0 +1,169 @@
+/// \file ParallelFor.cc
+/// \brief Implementation of the Common::AvailableCores function and the Common::WorkerPool class
+
+#include "ParallelFor.hh"
+
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <sched.h>
+
+namespace Common {
+
+namespace {
+
+/// Cores allowed by a CPU quota of quota microseconds every period microseconds, 0 for no quota
+unsigned QuotaCores(double quota, double period) {
+	if(quota <= 0. || period <= 0.)
+		return 0;
+	return std::max(1u, static_cast<unsigned>(std::ceil(quota/period)));
+}
+
+/// Path of the cgroup of this process in the hierarchy controller ("" for the v2 unified one)
+std::string CgroupPath(const std::string& controller) {
+	// lines of /proc/self/cgroup are "id:controllers:path"
+	std::ifstream file("/proc/self/cgroup");
+	for(std::string line; std::getline(file, line);) {
+		auto const first = line.find(':');
+		auto const second = line.find(':', first + 1);
+		if(first == std::string::npos || second == std::string::npos)
+			continue;
+
+		std::string controllers = "," + line.substr(first + 1, second - first - 1) + ",";
+		if(controller.empty() ? controllers == ",," : controllers.find("," + controller + ",") != std::string::npos)
+			return line.substr(second + 1);
+	}
+	return {};
+}
+
+/// Cores allowed by the cgroup CPU quota, 0 if there is none
+unsigned CgroupCores() {
+	// cgroup v2: "max 100000" or "<quota> <period>", in the cgroup of the process or at the root
+	// of the mount when it is the namespace root
+	for(auto const& directory: {"/sys/fs/cgroup" + CgroupPath(""), std::string("/sys/fs/cgroup")}) {
+		std::ifstream file(directory + "/cpu.max");
+		std::string quota;
+		double period = 0.;
+		if(file >> quota >> period)
+			return quota == "max" ? 0 : QuotaCores(std::stod(quota), period);
+	}
+
+	// cgroup v1: a quota of -1 means no limit
+	for(auto const& directory: {"/sys/fs/cgroup/cpu" + CgroupPath("cpu"), std::string("/sys/fs/cgroup/cpu")}) {
+		std::ifstream quotaFile(directory + "/cpu.cfs_quota_us");
+		std::ifstream periodFile(directory + "/cpu.cfs_period_us");
+		double quota = 0.;
+		double period = 0.;
+		if(quotaFile >> quota && periodFile >> period)
+			return QuotaCores(quota, period);
+	}
+	return 0;
+}
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+unsigned AvailableCores() {
+	unsigned cores = std::thread::hardware_concurrency();
+
+	cpu_set_t affinity;
+	CPU_ZERO(&affinity);
+	if(sched_getaffinity(0, sizeof(affinity), &affinity) == 0)
+		cores = static_cast<unsigned>(CPU_COUNT(&affinity));
+
+	unsigned const quota = CgroupCores();
+	if(quota > 0)
+		cores = cores > 0 ? std::min(cores, quota) : quota;
+	return std::max(1u, cores);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+WorkerPool::WorkerPool(unsigned nThread):
+	fSize(std::max(1u, nThread)),
+	fErrors(fSize)
+{
+	fThreads.reserve(fSize-1);
+	for(unsigned chunk = 1; chunk < fSize; ++chunk)
+		fThreads.emplace_back(&WorkerPool::Work, this, chunk);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+WorkerPool::~WorkerPool() {
+	{
+		std::lock_guard<std::mutex> lock(fMutex);
+		fStop = true;
+	}
+	fStart.notify_all();
+	for(auto& thread: fThreads)
+		thread.join();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void WorkerPool::For(std::size_t n, const ChunkFn& fn) {
+	unsigned const nChunk = static_cast<unsigned>(std::max<std::size_t>(1, std::min<std::size_t>(fSize, n)));
+	if(nChunk == 1) {
+		fn(std::size_t{0}, n, 0u);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(fMutex);
+		fFn = &fn;
+		fN = n;
+		fChunks = nChunk;
+		fPending = nChunk-1;
+		std::fill(fErrors.begin(), fErrors.end(), nullptr);
+		++fGeneration;
+	}
+	fStart.notify_all();
+
+	RunChunk(0);
+
+	std::unique_lock<std::mutex> lock(fMutex);
+	fDone.wait(lock, [this] { return fPending == 0; });
+	fFn = nullptr;
+	for(auto const& error: fErrors)
+		if(error)
+			std::rethrow_exception(error);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void WorkerPool::RunChunk(unsigned chunk) {
+	std::size_t const begin = fN*chunk/fChunks;
+	std::size_t const end = fN*(chunk+1)/fChunks;
+	try {
+		(*fFn)(begin, end, chunk);
+	} catch(...) {
+		fErrors[chunk] = std::current_exception();
+	}
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void WorkerPool::Work(unsigned chunk) {
+	std::uint64_t seen = 0;
+	std::unique_lock<std::mutex> lock(fMutex);
+	for(;;) {
+		fStart.wait(lock, [&] { return fStop || fGeneration != seen; });
+		if(fStop)
+			return;
+		seen = fGeneration;
+		if(chunk >= fChunks)
+			continue;
+
+		lock.unlock();
+		RunChunk(chunk);
+		lock.lock();
+		if(--fPending == 0)
+			fDone.notify_one();
+	}
+}
+
+}
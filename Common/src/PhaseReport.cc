@@ -0,0 +1,168 @@
+/// \file PhaseReport.cc
+/// \brief Implementation of the Common::PhaseReport class
+
+#include "PhaseReport.hh"
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace Common {
+
+namespace {
+
+/// JSON string literal
+std::string Quote(const std::string& text) {
+	std::string quoted = "\"";
+	for(auto const c: text) {
+		if(c == '"' || c == '\\')
+			quoted += '\\';
+		if(static_cast<unsigned char>(c) >= 0x20)
+			quoted += c;
+	}
+	return quoted + "\"";
+}
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+PhaseReport::Phase::Phase(PhaseReport& report, std::string name):
+	fReport(&report),
+	fStart(std::chrono::steady_clock::now()),
+	fCpuStart(CpuTime())
+{
+	fRecord.name = std::move(name);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+PhaseReport::Phase::Phase(Phase&& other) noexcept:
+	fReport(other.fReport),
+	fRecord(std::move(other.fRecord)),
+	fStart(other.fStart),
+	fCpuStart(other.fCpuStart)
+{
+	other.fReport = nullptr;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+PhaseReport::Phase::~Phase() {
+	if(!fReport)
+		return;
+	fRecord.wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - fStart).count();
+	fRecord.cpuTime = CpuTime() - fCpuStart;
+	fRecord.rss = Rss();
+	fRecord.peakRss = PeakRss();
+	fReport->fRecords.push_back(std::move(fRecord));
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PhaseReport::Phase::Count(const std::string& item, std::uint64_t count) {
+	fRecord.counts.emplace_back(item, count);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PhaseReport::EnableTrace(const std::string& name, std::vector<std::string> columns) {
+	fTraceName = name;
+	fTraceColumns = std::move(columns);
+	fTrace.clear();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PhaseReport::Trace(std::vector<double> row) {
+	if(tracing())
+		fTrace.push_back(std::move(row));
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PhaseReport::WriteJson(const std::string& filename) const {
+	std::string const tmpFilename = filename + ".tmp";
+	{
+		std::ofstream out(tmpFilename, std::ios::trunc);
+		if(!out)
+			throw std::runtime_error("Phase report: unable to open " + tmpFilename);
+		out.precision(9);
+
+		double wallTime = 0.;
+		double cpuTime = 0.;
+		for(auto const& record: fRecords) {
+			wallTime += record.wallTime;
+			cpuTime += record.cpuTime;
+		}
+
+		out << "{\n";
+		out << "  \"wallTime\": " << wallTime << ",\n";
+		out << "  \"cpuTime\": " << cpuTime << ",\n";
+		out << "  \"peakRss\": " << PeakRss() << ",\n";
+		out << "  \"phases\": [";
+		for(std::size_t i = 0; i < fRecords.size(); ++i) {
+			auto const& record = fRecords[i];
+			out << (i ? "," : "") << "\n    {\"name\": " << Quote(record.name)
+				<< ", \"wallTime\": " << record.wallTime << ", \"cpuTime\": " << record.cpuTime
+				<< ", \"rss\": " << record.rss << ", \"peakRss\": " << record.peakRss << ", \"counts\": {";
+			for(std::size_t c = 0; c < record.counts.size(); ++c)
+				out << (c ? ", " : "") << Quote(record.counts[c].first) << ": " << record.counts[c].second;
+			out << "}}";
+		}
+		out << "\n  ]";
+
+		if(tracing()) {
+			out << ",\n  \"trace\": {\"phase\": " << Quote(fTraceName) << ", \"columns\": [";
+			for(std::size_t c = 0; c < fTraceColumns.size(); ++c)
+				out << (c ? ", " : "") << Quote(fTraceColumns[c]);
+			out << "], \"rows\": [";
+			for(std::size_t r = 0; r < fTrace.size(); ++r) {
+				out << (r ? "," : "") << "\n    [";
+				for(std::size_t c = 0; c < fTrace[r].size(); ++c)
+					out << (c ? ", " : "") << fTrace[r][c];
+				out << "]";
+			}
+			out << "\n  ]}";
+		}
+		out << "\n}\n";
+
+		if(!out)
+			throw std::runtime_error("Phase report: unable to write " + tmpFilename);
+	}
+	if(std::rename(tmpFilename.c_str(), filename.c_str()) != 0)
+		throw std::runtime_error("Phase report: unable to rename " + tmpFilename + " to " + filename);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+double PhaseReport::CpuTime() {
+	rusage usage{};
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec*1e-6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec*1e-6;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+long PhaseReport::Rss() {
+	// second field of /proc/self/statm, in pages
+	long size = 0;
+	long resident = 0;
+	std::ifstream statm("/proc/self/statm");
+	if(!(statm >> size >> resident))
+		return 0;
+	return resident*(sysconf(_SC_PAGESIZE)/1024);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+long PhaseReport::PeakRss() {
+	rusage usage{};
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+}
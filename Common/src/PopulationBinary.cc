@@ -0,0 +1,278 @@
+/// \file PopulationBinary.cc
+/// \brief Implementation of the binary population format
+
+#include "PopulationBinary.hh"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Common {
+
+namespace PopulationBinary {
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::uint64_t checksum(const void* data, std::size_t size, std::uint64_t seed) {
+	auto const* bytes = static_cast<const unsigned char*>(data);
+	std::uint64_t hash = seed;
+	for(std::size_t i = 0; i < size; ++i) {
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+}
+
+namespace {
+
+std::size_t AlignUp(std::size_t value) {
+	return (value + PopulationBinary::BlockAlignment - 1) & ~(PopulationBinary::BlockAlignment - 1);
+}
+
+/// Raw bytes of each block, in the file order
+struct BlockView {
+	const void* data;
+	std::size_t size;
+};
+
+template<typename T>
+BlockView View(const std::vector<T>& values) {
+	return {values.data(), values.size()*sizeof(T)};
+}
+
+BlockView View(const std::string& value) {
+	return {value.data(), value.size()};
+}
+
+void CheckSize(std::size_t size, std::size_t expected, const char* what) {
+	if(size != expected)
+		throw std::runtime_error(std::string("Population binary: inconsistent size for ") + what);
+}
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void WritePopulationBinary(const PopulationData& population, const std::string& filename) {
+	std::size_t const nCell = population.cellCount();
+	std::size_t const nNucleus = population.nucleusCount();
+
+	CheckSize(population.positionX.size(), nCell, "positionX");
+	CheckSize(population.positionY.size(), nCell, "positionY");
+	CheckSize(population.positionZ.size(), nCell, "positionZ");
+	CheckSize(population.membraneRadius.size(), nCell, "membraneRadius");
+	CheckSize(population.mass.size(), nCell, "mass");
+	CheckSize(population.cellPropertiesId.size(), nCell, "cellPropertiesId");
+	CheckSize(population.lifeCycle.size(), nCell, "lifeCycle");
+	CheckSize(population.nucleusOffset.size(), nCell+1, "nucleusOffset");
+	CheckSize(population.nucleusOffset.back(), nNucleus, "nucleusOffset");
+	CheckSize(population.nucleusPositionType.size(), nNucleus, "nucleusPositionType");
+	CheckSize(population.nucleusType.size(), nNucleus, "nucleusType");
+
+	BlockView const views[PopulationBinary::Block::Count] = {
+		View(population.cellId),
+		View(population.positionX),
+		View(population.positionY),
+		View(population.positionZ),
+		View(population.membraneRadius),
+		View(population.mass),
+		View(population.cellPropertiesId),
+		View(population.lifeCycle),
+		View(population.nucleusOffset),
+		View(population.nucleusRadius),
+		View(population.nucleusPositionType),
+		View(population.nucleusType),
+		View(population.containedAgent),
+		View(population.environmentName),
+		View(population.subEnvironmentName),
+		View(population.cellProperties),
+	};
+
+	PopulationBinary::Header header{};
+	std::memcpy(header.magic, PopulationBinary::Magic, sizeof(header.magic));
+	header.version = PopulationBinary::Version;
+	header.byteOrder = PopulationBinary::ByteOrderMark;
+	header.cellCount = nCell;
+	header.nucleusCount = nNucleus;
+	header.containedCount = population.containedAgent.size();
+	header.internalRadius = population.internalRadius;
+	header.externalRadius = population.externalRadius;
+	for(int i = 0; i < 3; ++i)
+		header.center[i] = population.center[i];
+
+	// compute the layout and the checksum, padding bytes are zeros and part of the checksum
+	static const char padding[PopulationBinary::BlockAlignment] = {};
+	std::size_t offset = AlignUp(sizeof(PopulationBinary::Header));
+	std::uint64_t hash = PopulationBinary::checksum(padding, offset - sizeof(PopulationBinary::Header));
+	for(std::uint32_t id = 0; id < PopulationBinary::Block::Count; ++id) {
+		header.blocks[id] = {offset, views[id].size};
+		hash = PopulationBinary::checksum(views[id].data, views[id].size, hash);
+
+		std::size_t const next = AlignUp(offset + views[id].size);
+		hash = PopulationBinary::checksum(padding, next - offset - views[id].size, hash);
+		offset = next;
+	}
+	header.checksum = hash;
+
+	// write into a temporary file then rename it to never leave a truncated population
+	std::string const tmpFilename = filename + ".tmp";
+	{
+		std::ofstream out(tmpFilename, std::ios::binary | std::ios::trunc);
+		if(!out)
+			throw std::runtime_error("Population binary: unable to open " + tmpFilename);
+
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		std::size_t written = sizeof(header);
+		for(std::uint32_t id = 0; id < PopulationBinary::Block::Count; ++id) {
+			out.write(padding, header.blocks[id].offset - written);
+			out.write(static_cast<const char*>(views[id].data), views[id].size);
+			written = header.blocks[id].offset + views[id].size;
+		}
+		out.write(padding, offset - written);
+
+		if(!out)
+			throw std::runtime_error("Population binary: unable to write " + tmpFilename);
+	}
+
+	if(std::rename(tmpFilename.c_str(), filename.c_str()) != 0)
+		throw std::runtime_error("Population binary: unable to rename " + tmpFilename + " to " + filename);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+MappedPopulation::MappedPopulation(const std::string& filename, bool verify):
+	fFilename(filename)
+{
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if(fd < 0)
+		throw std::runtime_error("Population binary: unable to open " + filename);
+
+	struct stat st{};
+	if(::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(PopulationBinary::Header)) {
+		::close(fd);
+		throw std::runtime_error("Population binary: " + filename + " is too small to be a population");
+	}
+	fSize = static_cast<std::size_t>(st.st_size);
+
+	void* data = ::mmap(nullptr, fSize, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if(data == MAP_FAILED)
+		throw std::runtime_error("Population binary: unable to map " + filename);
+
+	fData = static_cast<const unsigned char*>(data);
+	fHeader = reinterpret_cast<const PopulationBinary::Header*>(fData);
+
+	auto fail = [this](const std::string& reason) {
+		::munmap(const_cast<unsigned char*>(fData), fSize);
+		throw std::runtime_error("Population binary: " + fFilename + ": " + reason);
+	};
+
+	if(std::memcmp(fHeader->magic, PopulationBinary::Magic, sizeof(PopulationBinary::Magic)) != 0)
+		fail("not a binary population");
+	if(fHeader->byteOrder != PopulationBinary::ByteOrderMark)
+		fail("written with a different byte order");
+	if(fHeader->version != PopulationBinary::Version)
+		fail("unsupported version " + std::to_string(fHeader->version));
+
+	for(auto const& block: fHeader->blocks)
+		if(block.offset % PopulationBinary::BlockAlignment != 0 || block.size > fSize || block.offset > fSize - block.size)
+			fail("corrupted block table");
+
+	// expected size of the array blocks, text blocks have a free size
+	std::uint64_t const nCell = fHeader->cellCount;
+	std::uint64_t const nNucleus = fHeader->nucleusCount;
+	// counts larger than the file would wrap the expected sizes around
+	if(nCell >= fSize || nNucleus >= fSize || fHeader->containedCount >= fSize)
+		fail("counts larger than the file");
+	std::uint64_t const expectedSizes[PopulationBinary::EnvironmentName] = {
+		nCell*sizeof(std::uint64_t),
+		nCell*sizeof(double),
+		nCell*sizeof(double),
+		nCell*sizeof(double),
+		nCell*sizeof(double),
+		nCell*sizeof(double),
+		nCell*sizeof(std::uint32_t),
+		nCell*sizeof(std::uint32_t),
+		(nCell+1)*sizeof(std::uint64_t),
+		nNucleus*sizeof(double),
+		nNucleus*sizeof(std::uint32_t),
+		nNucleus*sizeof(std::uint32_t),
+		fHeader->containedCount*sizeof(std::uint64_t),
+	};
+	for(std::uint32_t id = 0; id < PopulationBinary::EnvironmentName; ++id)
+		if(fHeader->blocks[id].size != expectedSizes[id])
+			fail("block sizes do not match the header");
+	if(nucleusOffset()[nCell] != nNucleus)
+		fail("nucleus offsets do not match the header");
+
+	if(verify) {
+		std::size_t const headerSize = sizeof(PopulationBinary::Header);
+		if(PopulationBinary::checksum(fData + headerSize, fSize - headerSize) != fHeader->checksum)
+			fail("checksum mismatch");
+	}
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+MappedPopulation::~MappedPopulation() {
+	if(fData)
+		::munmap(const_cast<unsigned char*>(fData), fSize);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::string MappedPopulation::text(PopulationBinary::Block id) const {
+	auto const& block = fHeader->blocks[id];
+	return {reinterpret_cast<const char*>(fData + block.offset), block.size};
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+PopulationData MappedPopulation::toData() const {
+	std::size_t const nCell = cellCount();
+	std::size_t const nNucleus = nucleusCount();
+
+	PopulationData data;
+	data.environmentName = environmentName();
+	data.subEnvironmentName = subEnvironmentName();
+	data.internalRadius = fHeader->internalRadius;
+	data.externalRadius = fHeader->externalRadius;
+	for(int i = 0; i < 3; ++i)
+		data.center[i] = fHeader->center[i];
+
+	data.cellId.assign(cellId(), cellId() + nCell);
+	data.positionX.assign(positionX(), positionX() + nCell);
+	data.positionY.assign(positionY(), positionY() + nCell);
+	data.positionZ.assign(positionZ(), positionZ() + nCell);
+	data.membraneRadius.assign(membraneRadius(), membraneRadius() + nCell);
+	data.mass.assign(mass(), mass() + nCell);
+	data.cellPropertiesId.assign(cellPropertiesId(), cellPropertiesId() + nCell);
+	data.lifeCycle.assign(lifeCycle(), lifeCycle() + nCell);
+	data.nucleusOffset.assign(nucleusOffset(), nucleusOffset() + nCell + 1);
+	data.nucleusRadius.assign(nucleusRadius(), nucleusRadius() + nNucleus);
+	data.nucleusPositionType.assign(nucleusPositionType(), nucleusPositionType() + nNucleus);
+	data.nucleusType.assign(nucleusType(), nucleusType() + nNucleus);
+	data.containedAgent.assign(containedAgent(), containedAgent() + containedCount());
+	data.cellProperties = cellProperties();
+
+	return data;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+bool IsPopulationBinary(const std::string& filename) {
+	std::ifstream in(filename, std::ios::binary);
+	char magic[sizeof(PopulationBinary::Magic)] = {};
+	in.read(magic, sizeof(magic));
+	return in && std::memcmp(magic, PopulationBinary::Magic, sizeof(magic)) == 0;
+}
+
+}
@@ -0,0 +1,175 @@
+/// \file PopulationLoader.cc
+/// \brief Implementation of the Common::PopulationLoader class
+
+#include "PopulationLoader.hh"
+#include "PopulationXml.hh"
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <sstream>
+#include <stdexcept>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <G4UImanager.hh>
+
+namespace Common {
+
+namespace {
+
+/// True if target exists and is at least as recent as source
+bool IsUpToDate(const std::string& target, const std::string& source) {
+	struct stat targetStat{};
+	struct stat sourceStat{};
+	if(::stat(target.c_str(), &targetStat) != 0 || ::stat(source.c_str(), &sourceStat) != 0)
+		return false;
+	return targetStat.st_mtime >= sourceStat.st_mtime;
+}
+
+/// Xml given to CPOP for the binary file: next to it if its directory is writable, in directory
+/// if not empty or in the temporary directory otherwise, named after the full path of the binary
+std::string XmlCacheFilename(const std::string& binaryFilename, const std::string& directory) {
+	namespace fs = std::filesystem;
+	fs::path const binary = fs::absolute(binaryFilename);
+	if(directory.empty() && ::access(binary.parent_path().c_str(), W_OK) == 0)
+		return binaryFilename + ".cache.xml";
+
+	// FNV-1a of the path, so that binaries of the same name in different directories do not share a cache
+	std::uint64_t hash = 0xcbf29ce484222325ULL;
+	for(char const c: binary.string()) {
+		hash ^= static_cast<unsigned char>(c);
+		hash *= 0x100000001b3ULL;
+	}
+	char suffix[32];
+	std::snprintf(suffix, sizeof(suffix), "-%016llx.cache.xml", static_cast<unsigned long long>(hash));
+	fs::path const cacheDirectory = directory.empty() ? fs::temp_directory_path() : fs::path(directory);
+	return (cacheDirectory/(binary.filename().string() + suffix)).string();
+}
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+PopulationLoader::PopulationLoader():
+	fInputBinaryCmd("/cpop/population/inputBinary", this),
+	fXmlCacheCmd("/cpop/population/xmlCache", this),
+	fMeshThreadsCmd("/cpop/population/meshThreads", this),
+	fMeshFacetsCmd("/cpop/population/meshFacets", this),
+	fMeshFacetBudgetCmd("/cpop/population/meshFacetBudget", this),
+	fMeshRegionRatiosCmd("/cpop/population/meshRegionRatios", this),
+	fExportMeshCmd("/cpop/population/exportMesh", this)
+{
+	fInputBinaryCmd.SetGuidance("Set the population file in the binary format (see populationConverter)");
+	fInputBinaryCmd.SetParameterName("PopulationFile", false);
+	fInputBinaryCmd.AvailableForStates(G4State_PreInit);
+
+	fXmlCacheCmd.SetGuidance("Set the directory of the xml given to CPOP for a binary population (next to it by default)");
+	fXmlCacheCmd.SetParameterName("Directory", false);
+	fXmlCacheCmd.AvailableForStates(G4State_PreInit);
+
+	fMeshThreadsCmd.SetGuidance("Set the number of threads meshing the cells (0 for all of them)");
+	fMeshThreadsCmd.SetParameterName("NbThread", false);
+	fMeshThreadsCmd.SetRange("NbThread >= 0");
+
+	fMeshFacetsCmd.SetGuidance("Set the maximum number of facets per cell of the mesh");
+	fMeshFacetsCmd.SetParameterName("NbFacet", false);
+	fMeshFacetsCmd.SetRange("NbFacet >= 8");
+
+	fMeshFacetBudgetCmd.SetGuidance("Set the maximum number of facets of an exported mesh (0 for no limit)");
+	fMeshFacetBudgetCmd.SetParameterName("NbFacet", false);
+	fMeshFacetBudgetCmd.SetRange("NbFacet >= 0");
+
+	fMeshRegionRatiosCmd.SetGuidance("Set the internal and intermediary ratios tagging the cells of an exported mesh");
+	auto* internalRatio = new G4UIparameter("InternalRatio", 'd', false);
+	internalRatio->SetParameterRange("InternalRatio >= 0");
+	fMeshRegionRatiosCmd.SetParameter(internalRatio);
+	auto* intermediaryRatio = new G4UIparameter("IntermediaryRatio", 'd', false);
+	intermediaryRatio->SetParameterRange("IntermediaryRatio >= 0");
+	fMeshRegionRatiosCmd.SetParameter(intermediaryRatio);
+
+	fExportMeshCmd.SetGuidance("Mesh the binary population and export it (binary PLY if the file ends with .ply, OFF otherwise)");
+	fExportMeshCmd.SetParameterName("MeshFile", false);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PopulationLoader::SetNewValue(G4UIcommand* command, G4String newValue)
+{
+	if(command == &fInputBinaryCmd) {
+		fPopulation = std::make_unique<MappedPopulation>(newValue);
+
+		// CPOP only reads its xml: it is written once with every digit of the binary and parsed at each load
+		std::string const xmlFilename = XmlCacheFilename(newValue, fXmlCacheDirectory);
+		if(!IsUpToDate(xmlFilename, newValue))
+			WritePopulationXml(fPopulation->toData(), xmlFilename, 17);
+
+		G4UImanager::GetUIpointer()->ApplyCommand("/cpop/population/input " + xmlFilename);
+		fMesh.reset();
+	} else if(command == &fXmlCacheCmd) {
+		fXmlCacheDirectory = newValue;
+	} else if(command == &fMeshThreadsCmd) {
+		fMeshThreads = fMeshThreadsCmd.GetNewIntValue(newValue);
+		fMesh.reset();
+	} else if(command == &fMeshFacetsCmd) {
+		fMeshFacets = fMeshFacetsCmd.GetNewIntValue(newValue);
+		fMesh.reset();
+	} else if(command == &fMeshFacetBudgetCmd) {
+		fMeshFacetBudget = fMeshFacetBudgetCmd.GetNewIntValue(newValue);
+	} else if(command == &fMeshRegionRatiosCmd) {
+		std::istringstream(newValue) >> fInternalRatio >> fIntermediaryRatio;
+	} else if(command == &fExportMeshCmd) {
+		ExportMesh(newValue);
+	}
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+const CellExportMesh& PopulationLoader::mesh()
+{
+	if(!fPopulation)
+		throw std::runtime_error("no binary population, use /cpop/population/inputBinary first");
+	if(!fMesh)
+		fMesh = std::make_unique<CellExportMesh>(MakeCellArrays(*fPopulation), fMeshFacets, fMeshThreads);
+	return *fMesh;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+bool PopulationLoader::RegionRatios(double& internalRatio, double& intermediaryRatio)
+{
+	auto* UImanager = G4UImanager::GetUIpointer();
+	double internal = 0.;
+	double intermediary = 0.;
+	if(!(std::istringstream(UImanager->GetCurrentValues("/cpop/population/internalRatio")) >> internal)
+		|| !(std::istringstream(UImanager->GetCurrentValues("/cpop/population/intermediaryRatio")) >> intermediary))
+		return false;
+	internalRatio = internal;
+	intermediaryRatio = intermediary;
+	return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PopulationLoader::ExportMesh(const std::string& filename) const
+{
+	if(!fPopulation)
+		throw std::runtime_error("no binary population, use /cpop/population/inputBinary first");
+
+	// the mesh is streamed, a coarser one being used to fit in the facet budget
+	auto const cells = MakeCellArrays(*fPopulation);
+	int const nbFacet = CellExportMesh::FacetsPerCellForBudget(cells.count, fMeshFacetBudget, fMeshFacets);
+	CellExportMesh const exported(cells, nbFacet, fMeshThreads);
+
+	bool const ply = filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".ply") == 0;
+	if(ply) {
+		auto const& header = fPopulation->header();
+		auto const regions = CellRegions(cells, header.center, header.externalRadius, fInternalRatio, fIntermediaryRatio);
+		exported.ExportPly(filename, regions.data());
+	} else {
+		exported.ExportOff(filename);
+	}
+}
+
+}
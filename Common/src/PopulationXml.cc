@@ -0,0 +1,319 @@
+/// \file PopulationXml.cc
+/// \brief Implementation of the CPOP_SAVE xml reader/writer
+
+#include "PopulationXml.hh"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <locale>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+namespace Common {
+
+namespace {
+
+constexpr std::string_view CellPropertiesTag = "ALL_CELL_PROPERTIES";
+
+[[noreturn]] void Fail(const std::string& filename, const std::string& reason) {
+	throw std::runtime_error("Population xml: " + filename + ": " + reason);
+}
+
+std::string_view Trim(std::string_view text) {
+	auto const first = text.find_first_not_of(" \t\r\n");
+	if(first == std::string_view::npos)
+		return {};
+	auto const last = text.find_last_not_of(" \t\r\n");
+	return text.substr(first, last - first + 1);
+}
+
+double ToDouble(std::string_view text) {
+	std::string const value(text);
+	return std::strtod(value.c_str(), nullptr);
+}
+
+std::uint64_t ToUInt(std::string_view text) {
+	std::string const value(text);
+	return std::strtoull(value.c_str(), nullptr, 10);
+}
+
+/// Attributes of a start tag, in their file order
+class Attributes {
+public:
+	explicit Attributes(std::string_view tag) {
+		std::size_t pos = 0;
+		while(true) {
+			auto const eq = tag.find('=', pos);
+			if(eq == std::string_view::npos)
+				break;
+			auto const quoteOpen = tag.find('"', eq);
+			auto const quoteClose = tag.find('"', quoteOpen+1);
+			if(quoteOpen == std::string_view::npos || quoteClose == std::string_view::npos)
+				break;
+			fValues.emplace_back(Trim(tag.substr(pos, eq - pos)), tag.substr(quoteOpen+1, quoteClose - quoteOpen - 1));
+			pos = quoteClose + 1;
+		}
+	}
+
+	[[nodiscard]] std::string_view get(std::string_view name) const {
+		for(auto const& [key, value]: fValues)
+			if(key == name)
+				return value;
+		return {};
+	}
+
+private:
+	std::vector<std::pair<std::string_view, std::string_view>> fValues;
+};
+
+/// Format numbers like CPOP (Qt) does, ie %g with 6 significant digits by default
+class NumberWriter {
+public:
+	explicit NumberWriter(int precision) {
+		fStream.imbue(std::locale::classic());
+		fStream.precision(precision);
+	}
+
+	const std::string& operator()(double value) {
+		fStream.str({});
+		fStream << value;
+		fBuffer = fStream.str();
+		return fBuffer;
+	}
+
+private:
+	std::ostringstream fStream;
+	std::string fBuffer;
+};
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+PopulationData ReadPopulationXml(const std::string& filename) {
+	std::ifstream in(filename, std::ios::binary);
+	if(!in)
+		Fail(filename, "unable to open");
+	std::string const content{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+	std::string_view const xml(content);
+
+	PopulationData population;
+	population.nucleusOffset.clear();
+	population.nucleusOffset.push_back(0);
+
+	bool hasDelimitation = false;
+	std::vector<std::string_view> stack;
+	auto parent = [&stack](std::size_t depth) -> std::string_view {
+		return stack.size() > depth ? stack[stack.size() - 1 - depth] : std::string_view{};
+	};
+
+	std::size_t pos = 0;
+	while(true) {
+		auto const open = xml.find('<', pos);
+		if(open == std::string_view::npos)
+			break;
+
+		// text node of the current element
+		std::string_view const text = Trim(xml.substr(pos, open - pos));
+		if(!text.empty() && !stack.empty()) {
+			std::string_view const current = parent(0);
+			if(current == "ID" && parent(1) == "contained_agent")
+				population.containedAgent.push_back(ToUInt(text));
+			else if((current == "x" || current == "y" || current == "z") && parent(1) == "position") {
+				int const axis = current[0] - 'x';
+				if(parent(2) == "SpheresSDelimitation")
+					population.center[axis] = ToDouble(text);
+				else if(parent(2) == "CELL") {
+					auto& positions = axis == 0 ? population.positionX : axis == 1 ? population.positionY : population.positionZ;
+					positions.back() = ToDouble(text);
+				}
+			}
+			else if(current == "radius" && parent(1) == "CELL")
+				population.membraneRadius.back() = ToDouble(text);
+		}
+
+		if(xml.compare(open, 4, "<!--") == 0) {
+			pos = xml.find("-->", open);
+			if(pos == std::string_view::npos)
+				Fail(filename, "unterminated comment");
+			pos += 3;
+			continue;
+		}
+
+		auto const close = xml.find('>', open);
+		if(close == std::string_view::npos)
+			Fail(filename, "unterminated tag");
+		pos = close + 1;
+
+		std::string_view tag = xml.substr(open+1, close - open - 1);
+		if(tag.empty() || tag[0] == '?')
+			continue;
+
+		if(tag[0] == '/') {
+			std::string_view const name = Trim(tag.substr(1));
+			if(stack.empty() || stack.back() != name)
+				Fail(filename, "unexpected closing tag " + std::string(name));
+			if(name == "CELL")
+				population.nucleusOffset.push_back(population.nucleusRadius.size());
+			stack.pop_back();
+			continue;
+		}
+
+		bool const selfClosing = tag.back() == '/';
+		if(selfClosing)
+			tag.remove_suffix(1);
+
+		auto const nameEnd = tag.find_first_of(" \t\r\n");
+		std::string_view const name = tag.substr(0, nameEnd);
+		Attributes const attributes(nameEnd == std::string_view::npos ? std::string_view{} : tag.substr(nameEnd));
+
+		if(name == "ENVIRONMENT")
+			population.environmentName = attributes.get("name");
+		else if(name == "SIMULATED_SUB_ENVIRONMENT")
+			population.subEnvironmentName = attributes.get("name");
+		else if(name == "SpheresSDelimitation")
+			hasDelimitation = true;
+		else if(name == "InternalDelimitation")
+			population.internalRadius = ToDouble(attributes.get("radius"));
+		else if(name == "ExternalDelimitation")
+			population.externalRadius = ToDouble(attributes.get("radius"));
+		else if(name == "CELL") {
+			population.cellId.push_back(ToUInt(attributes.get("ID")));
+			population.mass.push_back(ToDouble(attributes.get("mass")));
+			population.cellPropertiesId.push_back(ToUInt(attributes.get("cell_properties_ID")));
+			population.lifeCycle.push_back(ToUInt(attributes.get("life_cycle")));
+			population.positionX.push_back(0.);
+			population.positionY.push_back(0.);
+			population.positionZ.push_back(0.);
+			population.membraneRadius.push_back(0.);
+		}
+		else if(name == "Nucleus") {
+			population.nucleusRadius.push_back(ToDouble(attributes.get("radius")));
+			population.nucleusPositionType.push_back(ToUInt(attributes.get("position_type")));
+			population.nucleusType.push_back(ToUInt(attributes.get("nucleus_type")));
+		}
+		else if(name == CellPropertiesTag && !selfClosing) {
+			// kept verbatim, see WritePopulationXml
+			std::string const closing = "</" + std::string(CellPropertiesTag) + ">";
+			auto const end = xml.find(closing, pos);
+			if(end == std::string_view::npos)
+				Fail(filename, "unterminated " + std::string(CellPropertiesTag));
+			population.cellProperties = xml.substr(pos, end - pos);
+			pos = end + closing.size();
+			continue;
+		}
+		else if(name.find("Delimitation") != std::string_view::npos && parent(0) == "SIMULATED_SUB_ENVIRONMENT")
+			Fail(filename, "unsupported delimitation " + std::string(name));
+
+		if(!selfClosing)
+			stack.push_back(name);
+	}
+
+	if(!stack.empty())
+		Fail(filename, "unterminated element " + std::string(stack.back()));
+	if(!hasDelimitation)
+		Fail(filename, "no SpheresSDelimitation found");
+
+	return population;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void WritePopulationXml(const PopulationData& population, const std::string& filename, int precision) {
+	std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+	if(!out)
+		Fail(filename, "unable to open");
+
+	NumberWriter number(precision);
+	std::string const i1(4, ' ');
+	std::string const i2(8, ' ');
+	std::string const i3(12, ' ');
+	std::string const i4(16, ' ');
+	std::string const i5(20, ' ');
+
+	out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+	out << "<!--XML defining a cell porpulation, generated by CPOP-->\n";
+	out << "<CPOP_SAVE>\n";
+	out << i1 << "<ENVIRONMENT dimension=\"3\" name=\"" << population.environmentName << "\">\n";
+	out << i2 << "<SIMULATED_SUB_ENVIRONMENT name=\"" << population.subEnvironmentName << "\">\n";
+	out << i3 << "<SpheresSDelimitation>\n";
+	out << i4 << "<InternalDelimitation radius=\"" << number(population.internalRadius) << "\"/>\n";
+	out << i4 << "<ExternalDelimitation radius=\"" << number(population.externalRadius) << "\"/>\n";
+	out << i4 << "<position>\n";
+	out << i5 << "<x>" << number(population.center[0]) << "</x>\n";
+	out << i5 << "<y>" << number(population.center[1]) << "</y>\n";
+	out << i5 << "<z>" << number(population.center[2]) << "</z>\n";
+	out << i4 << "</position>\n";
+	out << i3 << "</SpheresSDelimitation>\n";
+	if(population.containedAgent.empty())
+		out << i3 << "<contained_agent/>\n";
+	else {
+		out << i3 << "<contained_agent>\n";
+		for(auto const id: population.containedAgent)
+			out << i4 << "<ID>" << id << "</ID>\n";
+		out << i3 << "</contained_agent>\n";
+	}
+	out << i2 << "</SIMULATED_SUB_ENVIRONMENT>\n";
+	out << i1 << "</ENVIRONMENT>\n";
+
+	out << i1 << "<CELLS>\n";
+	for(std::size_t i = 0; i < population.cellCount(); ++i) {
+		out << i2 << "<CELL dimension=\"3\" ID=\"" << population.cellId[i]
+			<< "\" mass=\"" << number(population.mass[i])
+			<< "\" cell_properties_ID=\"" << population.cellPropertiesId[i]
+			<< "\" life_cycle=\"" << population.lifeCycle[i] << "\">\n";
+		out << i3 << "<position>\n";
+		out << i4 << "<x>" << number(population.positionX[i]) << "</x>\n";
+		out << i4 << "<y>" << number(population.positionY[i]) << "</y>\n";
+		out << i4 << "<z>" << number(population.positionZ[i]) << "</z>\n";
+		out << i3 << "</position>\n";
+		out << i3 << "<radius>" << number(population.membraneRadius[i]) << "</radius>\n";
+
+		auto const first = population.nucleusOffset[i];
+		auto const last = population.nucleusOffset[i+1];
+		if(first == last)
+			out << i3 << "<Nuclei/>\n";
+		else {
+			out << i3 << "<Nuclei>\n";
+			for(auto n = first; n < last; ++n)
+				out << i4 << "<Nucleus position_type=\"" << population.nucleusPositionType[n]
+					<< "\" nucleus_type=\"" << population.nucleusType[n]
+					<< "\" radius=\"" << number(population.nucleusRadius[n]) << "\"/>\n";
+			out << i3 << "</Nuclei>\n";
+		}
+		out << i2 << "</CELL>\n";
+	}
+	out << i1 << "</CELLS>\n";
+
+	out << i1 << "<" << CellPropertiesTag << ">" << population.cellProperties << "</" << CellPropertiesTag << ">\n";
+	out << "</CPOP_SAVE>\n";
+
+	if(!out)
+		Fail(filename, "unable to write");
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+PopulationData ReadPopulation(const std::string& filename) {
+	if(IsPopulationBinary(filename))
+		return MappedPopulation(filename).toData();
+	return ReadPopulationXml(filename);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ConvertXmlToBinary(const std::string& xmlFilename, const std::string& binaryFilename) {
+	WritePopulationBinary(ReadPopulationXml(xmlFilename), binaryFilename);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ConvertBinaryToXml(const std::string& binaryFilename, const std::string& xmlFilename) {
+	MappedPopulation const population(binaryFilename);
+	WritePopulationXml(population.toData(), xmlFilename);
+}
+
+}
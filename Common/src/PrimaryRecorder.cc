@@ -0,0 +1,246 @@
+/// \file PrimaryRecorder.cc
+/// \brief Implementation of the Common::PrimaryRecorder class
+
+#include "PrimaryRecorder.hh"
+
+#include <sstream>
+#include <stdexcept>
+
+#include <G4Event.hh>
+#include <G4PrimaryParticle.hh>
+#include <G4PrimaryVertex.hh>
+#include <G4RunManager.hh>
+#include <G4SystemOfUnits.hh>
+#include <G4VUserPrimaryGeneratorAction.hh>
+#include <G4ios.hh>
+
+namespace Common {
+
+namespace {
+
+/// Primary generator action of a worker replaying and recording the primaries generated
+/// by the one it replaces (owned)
+class RecorderPrimaryGeneratorAction: public G4VUserPrimaryGeneratorAction {
+public:
+	RecorderPrimaryGeneratorAction(const PrimaryRecorder& recorder, PrimaryRecorder::Slot& slot, G4VUserPrimaryGeneratorAction* previous):
+		fRecorder(recorder),
+		fSlot(slot),
+		fPrevious(previous)
+	{
+	}
+
+	void GeneratePrimaries(G4Event* event) override {
+		fPrevious->GeneratePrimaries(event);
+		fRecorder.Process(*event, fSlot);
+	}
+
+private:
+	const PrimaryRecorder& fRecorder;
+	PrimaryRecorder::Slot& fSlot;
+	std::unique_ptr<G4VUserPrimaryGeneratorAction> fPrevious;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/// Actions of the wrapped initialization, with its primary generator action wrapped
+class RecorderActionInitialization: public G4VUserActionInitialization {
+public:
+	RecorderActionInitialization(PrimaryRecorder& recorder, G4VUserActionInitialization* actions):
+		fRecorder(recorder),
+		fActions(actions)
+	{
+	}
+
+	void Build() const override {
+		fActions->Build();
+		// the actions are those of the run manager of the thread
+		auto* previous = const_cast<G4VUserPrimaryGeneratorAction*>(G4RunManager::GetRunManager()->GetUserPrimaryGeneratorAction());
+		if(previous)
+			SetUserAction(new RecorderPrimaryGeneratorAction(fRecorder, fRecorder.NewSlot(), previous));
+	}
+
+	void BuildForMaster() const override {
+		fActions->BuildForMaster();
+	}
+
+	G4VSteppingVerbose* InitializeSteppingVerbose() const override {
+		return fActions->InitializeSteppingVerbose();
+	}
+
+private:
+	PrimaryRecorder& fRecorder;
+	std::unique_ptr<G4VUserActionInitialization> fActions;
+};
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+PrimaryRecorder::PrimaryRecorder(const Shard& shard):
+	fShard(shard),
+	fRecordCmd("/cpop/primaries/record", this),
+	fReplayCmd("/cpop/primaries/replay", this)
+{
+	fRecordCmd.SetGuidance("Record the primaries of the events of the next runs in a binary file (none to stop)");
+	fRecordCmd.SetParameterName("File", false);
+	fRecordCmd.AvailableForStates(G4State_PreInit, G4State_Idle);
+
+	fReplayCmd.SetGuidance("Give the primaries of each event the positions and directions recorded for the event (none to stop)");
+	fReplayCmd.SetParameter(new G4UIparameter("File", 's', false));
+	auto* method = new G4UIparameter("Method", 's', true);
+	method->SetDefaultValue("same");
+	method->SetParameterCandidates("same opposite");
+	fReplayCmd.SetParameter(method);
+	auto* energies = new G4UIparameter("Energies", 'b', true);
+	energies->SetDefaultValue("false");
+	fReplayCmd.SetParameter(energies);
+	fReplayCmd.AvailableForStates(G4State_PreInit, G4State_Idle);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PrimaryRecorder::SetNewValue(G4UIcommand* command, G4String newValue)
+{
+	if(command == &fRecordCmd)
+		fRecordFile = newValue == "none" ? std::string() : ShardFileName(newValue, fShard);
+	else if(command == &fReplayCmd) {
+		std::string filename;
+		std::string method = "same";
+		std::string energies = "false";
+		std::istringstream(newValue) >> filename >> method >> energies;
+		fReplay.reset();
+		if(filename == "none")
+			return;
+
+		filename = ShardFileName(filename, fShard);
+		fReplay = std::make_unique<MappedPrimaryRecords>(filename);
+		fOpposite = method == "opposite";
+		fReplayEnergies = G4UIcommand::ConvertToBool(energies.c_str());
+		G4cout << "Replaying the " << fReplay->recordCount() << " primaries of " << fReplay->eventCount() << " events of "
+			<< filename << G4endl;
+	}
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4VUserActionInitialization* PrimaryRecorder::Wrap(G4VUserActionInitialization* actions)
+{
+	return new RecorderActionInitialization(*this, actions);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+PrimaryRecorder::Slot& PrimaryRecorder::NewSlot()
+{
+	std::lock_guard<std::mutex> lock(fMutex);
+	fSlots.push_back(std::make_unique<Slot>());
+	return *fSlots.back();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PrimaryRecorder::Process(G4Event& event, Slot& slot) const
+{
+	if(fReplay)
+		Replay(event);
+	if(!fRecordFile.empty())
+		Record(event, slot);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PrimaryRecorder::Replay(G4Event& event) const
+{
+	auto const span = fReplay->Find(event.GetEventID());
+	if(span.count == 0) {
+		++fMissing;
+		return;
+	}
+
+	// the primaries are replayed in the order they were recorded, vertex by vertex
+	std::size_t r = 0;
+	for(G4int v = 0; v < event.GetNumberOfPrimaryVertex(); ++v) {
+		auto* vertex = event.GetPrimaryVertex(v);
+		for(auto* primary = vertex->GetPrimary(); primary && r < span.count; primary = primary->GetNext(), ++r) {
+			auto const& record = span.records[r];
+			vertex->SetPosition(record.position[0]*mm, record.position[1]*mm, record.position[2]*mm);
+			G4ThreeVector const direction(record.direction[0], record.direction[1], record.direction[2]);
+			primary->SetMomentumDirection(fOpposite ? -direction : direction);
+			if(fReplayEnergies)
+				primary->SetKineticEnergy(record.energy*MeV);
+		}
+	}
+
+	++fReplayed;
+	std::size_t primaries = 0;
+	for(G4int v = 0; v < event.GetNumberOfPrimaryVertex(); ++v)
+		for(auto* primary = event.GetPrimaryVertex(v)->GetPrimary(); primary; primary = primary->GetNext())
+			++primaries;
+	if(primaries != span.count)
+		++fMismatched;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PrimaryRecorder::Record(const G4Event& event, Slot& slot) const
+{
+	if(!slot.buffer) {
+		std::lock_guard<std::mutex> lock(fMutex);
+		if(!fWriter)
+			fWriter = std::make_unique<PrimaryRecordWriter>(fRecordFile);
+		slot.buffer = &fWriter->NewBuffer();
+	}
+
+	slot.records.clear();
+	for(G4int v = 0; v < event.GetNumberOfPrimaryVertex(); ++v) {
+		auto const* vertex = event.GetPrimaryVertex(v);
+		G4ThreeVector const position = vertex->GetPosition()/mm;
+		for(auto const* primary = vertex->GetPrimary(); primary; primary = primary->GetNext()) {
+			auto const& direction = primary->GetMomentumDirection();
+			PrimaryRecords::Record record{};
+			record.position[0] = position.x();
+			record.position[1] = position.y();
+			record.position[2] = position.z();
+			record.direction[0] = direction.x();
+			record.direction[1] = direction.y();
+			record.direction[2] = direction.z();
+			record.energy = primary->GetKineticEnergy()/MeV;
+			record.event = event.GetEventID();
+			record.pdg = primary->GetPDGcode();
+			record.vertex = static_cast<std::uint32_t>(v);
+			slot.records.push_back(record);
+		}
+	}
+	slot.buffer->AddEvent(event.GetEventID(), slot.records.data(), slot.records.size());
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PrimaryRecorder::EndOfRun()
+{
+	if(fWriter) {
+		try {
+			fWriter->Close();
+			G4cout << "Primaries recorded to " << fWriter->filename() << ": " << fWriter->recordCount() << " primaries" << G4endl;
+		} catch(const std::exception& e) {
+			G4cerr << "Primaries not recorded: " << e.what() << G4endl;
+		}
+		fWriter.reset();
+		for(auto& slot: fSlots)
+			slot->buffer = nullptr;
+	}
+
+	if(fReplay) {
+		G4cout << "Primaries replayed from " << fReplay->filename() << " for " << fReplayed << " events";
+		if(fMissing > 0)
+			G4cout << ", " << fMissing << " events without records kept as generated";
+		if(fMismatched > 0)
+			G4cout << ", " << fMismatched << " events with a different number of primaries";
+		G4cout << G4endl;
+	}
+	fReplayed = 0;
+	fMissing = 0;
+	fMismatched = 0;
+}
+
+}
@@ -0,0 +1,327 @@
+/// \file PrimaryRecords.cc
+/// \brief Implementation of the primary records format
+
+#include "PrimaryRecords.hh"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Common {
+
+namespace {
+
+std::uint64_t AlignUp(std::uint64_t value) {
+	return (value + PrimaryRecords::BlockAlignment - 1) & ~static_cast<std::uint64_t>(PrimaryRecords::BlockAlignment - 1);
+}
+
+/// The records follow the header
+constexpr std::uint64_t RecordsOffset = (sizeof(PrimaryRecords::Header) + PrimaryRecords::BlockAlignment - 1)
+	& ~static_cast<std::uint64_t>(PrimaryRecords::BlockAlignment - 1);
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+PrimaryRecordWriter::Buffer::Buffer(PrimaryRecordWriter& writer, std::size_t chunkRecords):
+	fWriter(writer),
+	fChunkRecords(chunkRecords)
+{
+	fRecords.reserve(chunkRecords);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PrimaryRecordWriter::Buffer::AddEvent(std::int64_t event, const PrimaryRecords::Record* records, std::size_t count) {
+	// the records of an event are never split between chunks
+	fEvents.push_back({event, fRecords.size(), count});
+	fRecords.insert(std::end(fRecords), records, records + count);
+	if(fRecords.size() >= fChunkRecords)
+		Flush();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PrimaryRecordWriter::Buffer::Flush() {
+	if(fEvents.empty())
+		return;
+	std::uint64_t const first = fWriter.Reserve(fRecords.size());
+	fWriter.WriteAt(fRecords.data(), fRecords.size()*sizeof(PrimaryRecords::Record), RecordsOffset + first*sizeof(PrimaryRecords::Record));
+	for(auto entry: fEvents) {
+		entry.first += first;
+		fWritten.push_back(entry);
+	}
+	fRecords.clear();
+	fEvents.clear();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+PrimaryRecordWriter::PrimaryRecordWriter(const std::string& filename, std::size_t chunkRecords):
+	fFilename(filename),
+	fChunkRecords(std::max<std::size_t>(chunkRecords, 1)),
+	fFile(::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644))
+{
+	if(fFile < 0)
+		throw std::runtime_error("Primary records: unable to open " + filename);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+PrimaryRecordWriter::~PrimaryRecordWriter() {
+	// a file which is not closed keeps an invalid header
+	if(fFile >= 0)
+		::close(fFile);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+PrimaryRecordWriter::Buffer& PrimaryRecordWriter::NewBuffer() {
+	std::lock_guard<std::mutex> lock(fMutex);
+	fBuffers.push_back(std::make_unique<Buffer>(*this, fChunkRecords));
+	return *fBuffers.back();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::uint64_t PrimaryRecordWriter::Reserve(std::size_t count) {
+	std::lock_guard<std::mutex> lock(fMutex);
+	std::uint64_t const first = fRecordCount;
+	fRecordCount += count;
+	++fChunkCount;
+	return first;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PrimaryRecordWriter::WriteAt(const void* data, std::size_t size, std::uint64_t offset) {
+	auto const* bytes = static_cast<const char*>(data);
+	while(size > 0) {
+		ssize_t const written = ::pwrite(fFile, bytes, size, static_cast<off_t>(offset));
+		if(written < 0 && errno == EINTR)
+			continue;
+		if(written <= 0) {
+			fFailed = true;
+			return;
+		}
+		bytes += written;
+		size -= static_cast<std::size_t>(written);
+		offset += static_cast<std::uint64_t>(written);
+	}
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PrimaryRecordWriter::Close() {
+	if(fFile < 0)
+		return;
+
+	std::vector<PrimaryRecords::EventEntry> events;
+	for(auto const& buffer: fBuffers) {
+		buffer->Flush();
+		events.insert(std::end(events), std::begin(buffer->fWritten), std::end(buffer->fWritten));
+	}
+	fBuffers.clear();
+
+	std::sort(std::begin(events), std::end(events), [](const PrimaryRecords::EventEntry& a, const PrimaryRecords::EventEntry& b) {
+		return a.event < b.event;
+	});
+	auto const twice = std::adjacent_find(std::begin(events), std::end(events), [](const PrimaryRecords::EventEntry& a, const PrimaryRecords::EventEntry& b) {
+		return a.event == b.event;
+	});
+
+	PrimaryRecords::Header header{};
+	std::memcpy(header.magic, PrimaryRecords::Magic, sizeof(header.magic));
+	header.version = PrimaryRecords::Version;
+	header.byteOrder = PrimaryRecords::ByteOrderMark;
+	header.recordCount = fRecordCount;
+	header.eventCount = events.size();
+	header.chunkCount = fChunkCount;
+	header.recordsOffset = RecordsOffset;
+	header.indexOffset = AlignUp(RecordsOffset + fRecordCount*sizeof(PrimaryRecords::Record));
+
+	if(twice == std::end(events)) {
+		WriteAt(events.data(), events.size()*sizeof(PrimaryRecords::EventEntry), header.indexOffset);
+		// the header, written last, makes the file valid
+		if(!fFailed)
+			WriteAt(&header, sizeof(header), 0);
+	}
+	bool const failed = ::close(fFile) != 0 || fFailed;
+	fFile = -1;
+
+	if(twice != std::end(events))
+		throw std::runtime_error("Primary records: event " + std::to_string(twice->event) + " given twice to " + fFilename);
+	if(failed)
+		throw std::runtime_error("Primary records: unable to write " + fFilename);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+MappedPrimaryRecords::MappedPrimaryRecords(const std::string& filename):
+	fFilename(filename)
+{
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if(fd < 0)
+		throw std::runtime_error("Primary records: unable to open " + filename);
+
+	struct stat st{};
+	if(::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(PrimaryRecords::Header)) {
+		::close(fd);
+		throw std::runtime_error("Primary records: " + filename + " is too small to hold primary records");
+	}
+	fSize = static_cast<std::size_t>(st.st_size);
+
+	void* data = ::mmap(nullptr, fSize, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if(data == MAP_FAILED)
+		throw std::runtime_error("Primary records: unable to map " + filename);
+
+	fData = static_cast<const unsigned char*>(data);
+	fHeader = reinterpret_cast<const PrimaryRecords::Header*>(fData);
+
+	auto fail = [this](const std::string& reason) {
+		::munmap(const_cast<unsigned char*>(fData), fSize);
+		throw std::runtime_error("Primary records: " + fFilename + ": " + reason);
+	};
+
+	if(std::memcmp(fHeader->magic, PrimaryRecords::Magic, sizeof(PrimaryRecords::Magic)) != 0)
+		fail("not primary records, or their writing did not end");
+	if(fHeader->byteOrder != PrimaryRecords::ByteOrderMark)
+		fail("written with a different byte order");
+	if(fHeader->version != PrimaryRecords::Version)
+		fail("unsupported version " + std::to_string(fHeader->version));
+
+	std::uint64_t const recordsSize = fHeader->recordCount*sizeof(PrimaryRecords::Record);
+	std::uint64_t const indexSize = fHeader->eventCount*sizeof(PrimaryRecords::EventEntry);
+	if(fHeader->recordsOffset % PrimaryRecords::BlockAlignment != 0 || fHeader->indexOffset % PrimaryRecords::BlockAlignment != 0
+		|| fHeader->recordsOffset + recordsSize > fHeader->indexOffset || fHeader->indexOffset + indexSize > fSize)
+		fail("blocks out of the file");
+
+	fRecords = reinterpret_cast<const PrimaryRecords::Record*>(fData + fHeader->recordsOffset);
+	fEvents = reinterpret_cast<const PrimaryRecords::EventEntry*>(fData + fHeader->indexOffset);
+	for(std::size_t e = 0; e < eventCount(); ++e)
+		if(fEvents[e].first + fEvents[e].count > recordCount() || (e > 0 && fEvents[e - 1].event >= fEvents[e].event))
+			fail("corrupted event index");
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+MappedPrimaryRecords::~MappedPrimaryRecords() {
+	if(fData)
+		::munmap(const_cast<unsigned char*>(fData), fSize);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+MappedPrimaryRecords::Span MappedPrimaryRecords::Find(std::int64_t event) const {
+	auto const* end = fEvents + eventCount();
+	auto const* found = std::lower_bound(fEvents, end, event, [](const PrimaryRecords::EventEntry& entry, std::int64_t id) {
+		return entry.event < id;
+	});
+	if(found == end || found->event != event)
+		return {};
+	return {fRecords + found->first, static_cast<std::size_t>(found->count)};
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+bool IsPrimaryRecords(const std::string& filename) {
+	std::ifstream in(filename, std::ios::binary);
+	char magic[sizeof(PrimaryRecords::Magic)] = {};
+	in.read(magic, sizeof(magic));
+	return in && std::memcmp(magic, PrimaryRecords::Magic, sizeof(magic)) == 0;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ConvertPrimaryRecordsToText(const std::string& input, const std::string& output, bool withEvents) {
+	MappedPrimaryRecords const records(input);
+	std::FILE* file = std::fopen(output.c_str(), "w");
+	if(!file)
+		throw std::runtime_error("Primary records: unable to open " + output);
+
+	for(std::size_t e = 0; e < records.eventCount(); ++e) {
+		auto const span = records.Find(records.events()[e].event);
+		for(std::size_t r = 0; r < span.count; ++r) {
+			auto const& record = span.records[r];
+			if(withEvents)
+				std::fprintf(file, "%lld %d ", static_cast<long long>(record.event), record.pdg);
+			std::fprintf(file, "%.17g %.17g %.17g %.17g %.17g %.17g %.17g\n", record.position[0], record.position[1], record.position[2],
+				record.direction[0], record.direction[1], record.direction[2], record.energy);
+		}
+	}
+
+	if(std::fclose(file) != 0)
+		throw std::runtime_error("Primary records: unable to write " + output);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ConvertTextToPrimaryRecords(const std::string& input, const std::string& output) {
+	std::ifstream in(input);
+	if(!in)
+		throw std::runtime_error("Primary records: unable to open " + input);
+
+	PrimaryRecordWriter writer(output);
+	auto& buffer = writer.NewBuffer();
+	std::vector<PrimaryRecords::Record> event;
+	auto const endEvent = [&]() {
+		if(!event.empty())
+			buffer.AddEvent(event.front().event, event.data(), event.size());
+		event.clear();
+	};
+
+	std::string line;
+	long lineNumber = 0;
+	std::int64_t primaries = 0;
+	while(std::getline(in, line)) {
+		++lineNumber;
+		double values[9];
+		int count = 0;
+		const char* position = line.c_str();
+		for(char* end = nullptr; count < 10; ++count, position = end) {
+			double const value = std::strtod(position, &end);
+			if(end == position)
+				break;
+			if(count < 9)
+				values[count] = value;
+		}
+		if(count == 0 && line.find_first_not_of(" \t\r") == std::string::npos)
+			continue;
+		if(count != 7 && count != 9)
+			throw std::runtime_error("Primary records: " + input + ": line " + std::to_string(lineNumber) + " has not 7 or 9 values");
+
+		// x y z dx dy dz E, one event per line, or event pdg x y z dx dy dz E
+		PrimaryRecords::Record record{};
+		double const* primary = values + (count - 7);
+		std::copy(primary, primary + 3, record.position);
+		std::copy(primary + 3, primary + 6, record.direction);
+		record.energy = primary[6];
+		record.event = count == 9 ? static_cast<std::int64_t>(values[0]) : primaries;
+		record.pdg = count == 9 ? static_cast<std::int32_t>(values[1]) : 0;
+
+		if(!event.empty() && event.back().event != record.event)
+			endEvent();
+		// the primaries of a vertex share its position
+		if(!event.empty()) {
+			auto const& previous = event.back();
+			bool const same = std::equal(record.position, record.position + 3, previous.position);
+			record.vertex = previous.vertex + (same ? 0 : 1);
+		}
+		event.push_back(record);
+		++primaries;
+	}
+	endEvent();
+	writer.Close();
+}
+
+}
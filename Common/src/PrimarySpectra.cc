@@ -0,0 +1,203 @@
+/// \file PrimarySpectra.cc
+/// \brief Implementation of the Common::PrimarySpectra class
+
+#include "PrimarySpectra.hh"
+
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+#include <G4Event.hh>
+#include <G4ParticleDefinition.hh>
+#include <G4PrimaryParticle.hh>
+#include <G4PrimaryVertex.hh>
+#include <G4RunManager.hh>
+#include <G4SystemOfUnits.hh>
+#include <G4UImanager.hh>
+#include <G4VUserPrimaryGeneratorAction.hh>
+#include <G4ios.hh>
+#include <Randomize.hh>
+
+namespace Common {
+
+namespace {
+
+/// Primary generator action of a worker drawing the energies of the primaries generated
+/// by the one it replaces (owned)
+class SpectrumPrimaryGeneratorAction: public G4VUserPrimaryGeneratorAction {
+public:
+	SpectrumPrimaryGeneratorAction(const PrimarySpectra& spectra, G4VUserPrimaryGeneratorAction* previous):
+		fSpectra(spectra),
+		fPrevious(previous)
+	{
+	}
+
+	void GeneratePrimaries(G4Event* event) override {
+		using Clock = std::chrono::steady_clock;
+		auto const start = Clock::now();
+		fPrevious->GeneratePrimaries(event);
+		auto const generated = Clock::now();
+		std::size_t const drawn = fSpectra.Sample(*event);
+		std::chrono::duration<double> const generation = generated - start;
+		std::chrono::duration<double> const sampling = Clock::now() - generated;
+		fSpectra.AddTimes(generation.count(), sampling.count(), drawn);
+	}
+
+private:
+	const PrimarySpectra& fSpectra;
+	std::unique_ptr<G4VUserPrimaryGeneratorAction> fPrevious;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/// Actions of the wrapped initialization, with its primary generator action wrapped
+class SpectrumActionInitialization: public G4VUserActionInitialization {
+public:
+	SpectrumActionInitialization(const PrimarySpectra& spectra, G4VUserActionInitialization* actions):
+		fSpectra(spectra),
+		fActions(actions)
+	{
+	}
+
+	void Build() const override {
+		fActions->Build();
+		// the actions are those of the run manager of the thread
+		auto* previous = const_cast<G4VUserPrimaryGeneratorAction*>(G4RunManager::GetRunManager()->GetUserPrimaryGeneratorAction());
+		if(previous)
+			SetUserAction(new SpectrumPrimaryGeneratorAction(fSpectra, previous));
+	}
+
+	void BuildForMaster() const override {
+		fActions->BuildForMaster();
+	}
+
+	G4VSteppingVerbose* InitializeSteppingVerbose() const override {
+		return fActions->InitializeSteppingVerbose();
+	}
+
+private:
+	const PrimarySpectra& fSpectra;
+	std::unique_ptr<G4VUserActionInitialization> fActions;
+};
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+PrimarySpectra::PrimarySpectra():
+	fDirectory("/cpop/primaries/", false),
+	fSpectrumCmd("/cpop/primaries/spectrum", this)
+{
+	fDirectory.SetGuidance("Energies of the primaries");
+
+	fSpectrumCmd.SetGuidance("Draw the energies of the primaries of a source from a spectrum file");
+	fSpectrumCmd.SetParameter(new G4UIparameter("Source", 's', false));
+	fSpectrumCmd.SetParameter(new G4UIparameter("SpectrumFile", 's', false));
+	auto* mode = new G4UIparameter("Mode", 's', true);
+	mode->SetDefaultValue("auto");
+	mode->SetParameterCandidates("auto lines histogram");
+	fSpectrumCmd.SetParameter(mode);
+	auto* particle = new G4UIparameter("Particle", 's', true);
+	particle->SetDefaultValue("");
+	fSpectrumCmd.SetParameter(particle);
+	fSpectrumCmd.AvailableForStates(G4State_PreInit, G4State_Idle);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PrimarySpectra::SetNewValue(G4UIcommand* command, G4String newValue)
+{
+	if(command == &fSpectrumCmd) {
+		std::string source;
+		std::string filename;
+		std::string modeName = "auto";
+		std::string particle;
+		std::istringstream(newValue) >> source >> filename >> modeName >> particle;
+
+		if(particle.empty()) {
+			std::istringstream(G4UImanager::GetUIpointer()->GetCurrentValues(("/cpop/source/" + source + "/particle").c_str())) >> particle;
+			if(particle.empty())
+				throw std::runtime_error("particle of the source " + source + " unknown, give it after the spectrum mode");
+		}
+		for(auto const& entry: fSpectra)
+			if(entry.source != source && entry.particle == particle)
+				throw std::runtime_error("the sources " + entry.source + " and " + source + " with a spectrum both emit " + particle);
+
+		Spectrum::Mode mode;
+		if(!Spectrum::ParseMode(modeName, mode))
+			throw std::runtime_error("unknown spectrum mode " + modeName);
+		Spectrum spectrum = Spectrum::Read(filename, mode);
+		G4cout << "Primaries of " << source << " (" << particle << "): " << spectrum.size()
+			<< (spectrum.histogram() ? " bins" : " lines") << " from " << filename
+			<< ", /cpop/population/writeInfoPrimariesTxt keeping the energies of CPOP" << G4endl;
+
+		for(auto& entry: fSpectra)
+			if(entry.source == source) {
+				entry.particle = particle;
+				entry.spectrum = std::move(spectrum);
+				return;
+			}
+		fSpectra.push_back({source, particle, std::move(spectrum)});
+	}
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4VUserActionInitialization* PrimarySpectra::Wrap(G4VUserActionInitialization* actions)
+{
+	return new SpectrumActionInitialization(*this, actions);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::size_t PrimarySpectra::Sample(G4Event& event) const
+{
+	if(fSpectra.empty())
+		return 0;
+
+	std::size_t drawn = 0;
+	for(G4int v = 0; v < event.GetNumberOfPrimaryVertex(); ++v)
+		for(auto* primary = event.GetPrimaryVertex(v)->GetPrimary(); primary; primary = primary->GetNext()) {
+			auto const& name = primary->GetParticleDefinition()->GetParticleName();
+			for(auto const& entry: fSpectra)
+				if(entry.particle == name) {
+					double const u1 = G4UniformRand();
+					double const u2 = G4UniformRand();
+					primary->SetKineticEnergy(entry.spectrum.Sample(u1, u2)*MeV);
+					++drawn;
+					break;
+				}
+		}
+	return drawn;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PrimarySpectra::AddTimes(double generation, double sampling, std::size_t nDrawn) const
+{
+	fEvents += 1;
+	fGenerationTime += static_cast<std::uint64_t>(generation*1e9);
+	fDrawn += nDrawn;
+	fSamplingTime += static_cast<std::uint64_t>(sampling*1e9);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void PrimarySpectra::EndOfRun() const
+{
+	std::uint64_t const events = fEvents.exchange(0);
+	std::uint64_t const generationTime = fGenerationTime.exchange(0);
+	std::uint64_t const drawn = fDrawn.exchange(0);
+	std::uint64_t const samplingTime = fSamplingTime.exchange(0);
+	if(events == 0)
+		return;
+
+	G4cout << "Primaries: " << 1e-3*generationTime/events << " us per event generated by CPOP";
+	if(drawn > 0)
+		G4cout << ", " << 1e-3*samplingTime/drawn << " us per energy drawn again from the spectra (" << drawn << " primaries)";
+	G4cout << G4endl;
+}
+
+}
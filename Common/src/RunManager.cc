@@ -0,0 +1,138 @@
+/// \file RunManager.cc
+/// \brief Implementation of the Common::CreateRunManager function
+
+#include "RunManager.hh"
+#include "ParallelFor.hh"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <type_traits>
+#include <utility>
+
+#include <G4MTRunManager.hh>
+#include <G4TaskRunManager.hh>
+#include <G4UImanager.hh>
+#include <G4ios.hh>
+
+namespace Common {
+
+namespace {
+
+/// Run manager timing its runs, and sizing the chunks of events of the multithreaded ones
+template<typename Base>
+class ChunkedRunManager: public Base {
+public:
+	ChunkedRunManager(std::function<void(int, int, double)> endOfRun, const Shard& shard):
+		fEndOfRun(std::move(endOfRun)),
+		fShard(shard)
+	{
+	}
+
+	void BeamOn(G4int nEvent, const char* macroFile = nullptr, G4int nSelect = -1) override {
+		// BeamOn(0) is used by the multithreaded managers to start their threads
+		if(nEvent <= 0) {
+			Base::BeamOn(nEvent, macroFile, nSelect);
+			return;
+		}
+
+		int nThreads = 1;
+		if constexpr(std::is_base_of_v<G4MTRunManager, Base>) {
+			nThreads = this->GetNumberOfThreads();
+			// keep a chunk size set by /run/eventModulo
+			if(fEventCost > 0. && (this->GetEventModulo() == 0 || this->GetEventModulo() == fEventModulo)) {
+				fEventModulo = EventChunk(nEvent, nThreads, fEventCost);
+				this->SetEventModulo(fEventModulo);
+			}
+		}
+
+		if(fShard.split())
+			ShardOutput();
+
+		auto const start = std::chrono::steady_clock::now();
+		Base::BeamOn(nEvent, macroFile, nSelect);
+		std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+
+		fEventCost = elapsed.count()*nThreads/nEvent;
+		G4cout << "Run of " << nEvent << " events on " << nThreads << " threads";
+		if(fShard.split())
+			G4cout << " (shard " << fShard.index << "/" << fShard.count << ")";
+		G4cout << ": " << elapsed.count() << " s, " << nEvent/elapsed.count() << " events/s" << G4endl;
+
+		if(fEndOfRun)
+			fEndOfRun(nEvent, nThreads, elapsed.count());
+	}
+
+private:
+	/// Add the suffix of the shard to the output file, unless it is the one already set
+	void ShardOutput() {
+		auto* UImanager = G4UImanager::GetUIpointer();
+		std::string const fileName = UImanager->GetCurrentValues("/analysis/setFileName");
+		if(fileName.empty() || fileName == fShardFileName)
+			return;
+		fShardFileName = ShardFileName(fileName, fShard);
+		// broadcast to the workers at the start of the run
+		UImanager->ApplyCommand("/analysis/setFileName " + fShardFileName);
+	}
+
+	std::function<void(int, int, double)> fEndOfRun;
+	Shard fShard;
+	std::string fShardFileName;
+	double fEventCost{0.};
+	int fEventModulo{0};
+};
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+bool ParseRunManagerType(const std::string& name, RunManagerType& type) {
+	std::string input = name;
+	// transforms the input string to lowercase to be case insensitive
+	std::transform(std::begin(input), std::end(input), std::begin(input), ::tolower);
+
+	if(input == "serial")
+		type = RunManagerType::Serial;
+	else if(input == "mt")
+		type = RunManagerType::MT;
+	else if(input == "tasking")
+		type = RunManagerType::Tasking;
+	else
+		return false;
+	return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::unique_ptr<G4RunManager> CreateRunManager(RunManagerType type, int nThreads, std::function<void(int, int, double)> endOfRun, const Shard& shard) {
+	// the default of Geant4 is kept unless a number of threads is asked for
+	int const threads = nThreads < 0 ? static_cast<int>(AvailableCores()) : nThreads;
+	switch(type) {
+		case RunManagerType::Serial:
+			return std::make_unique<ChunkedRunManager<G4RunManager>>(std::move(endOfRun), shard);
+		case RunManagerType::MT: {
+			auto runManager = std::make_unique<ChunkedRunManager<G4MTRunManager>>(std::move(endOfRun), shard);
+			if(threads > 0)
+				runManager->SetNumberOfThreads(threads);
+			return runManager;
+		}
+		case RunManagerType::Tasking: {
+			auto runManager = std::make_unique<ChunkedRunManager<G4TaskRunManager>>(std::move(endOfRun), shard);
+			if(threads > 0)
+				runManager->SetNumberOfThreads(threads);
+			return runManager;
+		}
+	}
+	return nullptr;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+int EventChunk(long nEvent, int nThreads, double eventCost) {
+	long const maxChunk = std::max(1L, nEvent/(static_cast<long>(std::max(1, nThreads))*ChunksPerThread));
+	long const chunk = eventCost > 0. ? std::lround(ChunkDuration/eventCost) : maxChunk;
+	return static_cast<int>(std::clamp(chunk, 1L, maxChunk));
+}
+
+}
@@ -0,0 +1,120 @@
+/// \file Shard.cc
+/// \brief Implementation of the Common::Shard functions
+
+#include "Shard.hh"
+
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+
+namespace Common {
+
+namespace {
+
+/// Bijection of [0, 2^31) with Scramble(0) = 0: consecutive indices give unrelated values
+std::uint32_t Scramble(std::uint32_t x) {
+	constexpr std::uint32_t mask = 0x7fffffffU;
+	// products by odd numbers and xorshifts are invertible modulo 2^31
+	x = (x*0x5bd1e995U) & mask;
+	x ^= x >> 15;
+	x = (x*0x27d4eb2dU) & mask;
+	x ^= x >> 13;
+	x = (x*0x165667b1U) & mask;
+	return x ^ (x >> 16);
+}
+
+/// Position of the extension of fileName (its size if none)
+std::size_t ExtensionPosition(const std::string& fileName) {
+	auto const slash = fileName.find_last_of('/');
+	auto const dot = fileName.find_last_of('.');
+	bool const extension = dot != std::string::npos && (slash == std::string::npos || dot > slash);
+	return extension ? dot : fileName.size();
+}
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+bool ParseShard(const std::string& text, Shard& shard) {
+	std::istringstream in(text);
+	long index = -1;
+	long count = 0;
+	char slash = 0;
+	if(!(in >> index >> slash >> count) || slash != '/' || !(in >> std::ws).eof())
+		return false;
+	// the seeds of the shards are those of 2 count engines in 31 bits
+	if(count < 1 || count > (1L << 30) || index < 0 || index >= count)
+		return false;
+	shard.index = static_cast<unsigned>(index);
+	shard.count = static_cast<unsigned>(count);
+	return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+long ShardSeed(ShardEngine engine, unsigned index) {
+	// seeds of a run without --shard
+	constexpr std::uint32_t seeds[2] = {123456, 456123};
+
+	// MTwistEngine only uses 32 bits of its seed: (index, engine) is scrambled in 31 bits,
+	// then the values of the shard 0 are swapped with its seeds, which keeps a bijection
+	auto const e = static_cast<unsigned>(engine);
+	std::uint32_t const x = Scramble(((index << 1) | e) & 0x7fffffffU);
+	for(unsigned k = 0; k < 2; ++k) {
+		if(x == Scramble(k))
+			return seeds[k];
+		if(x == seeds[k])
+			return Scramble(k);
+	}
+	return x;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::string ShardFileName(const std::string& fileName, const Shard& shard) {
+	if(!shard.split() || fileName.empty())
+		return fileName;
+	auto const dot = ExtensionPosition(fileName);
+	return fileName.substr(0, dot) + "_shard" + std::to_string(shard.index) + "of" + std::to_string(shard.count) + fileName.substr(dot);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+bool ParseShardFileName(const std::string& fileName, Shard& shard) {
+	// the suffix may be followed by other ones (.cellDose.csv)
+	auto const slash = fileName.find_last_of('/');
+	auto const position = fileName.rfind("_shard");
+	if(position == std::string::npos || (slash != std::string::npos && position < slash))
+		return false;
+	std::string text = fileName.substr(position + 6);
+	text = text.substr(0, text.find('.'));
+	auto const of = text.find("of");
+	if(of == std::string::npos)
+		return false;
+	return ParseShard(text.substr(0, of) + "/" + text.substr(of + 2), shard);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void CheckShardFiles(const std::vector<std::string>& files) {
+	std::vector<int> seen;
+	unsigned count = 0;
+	for(auto const& file: files) {
+		Shard shard;
+		if(!ParseShardFileName(file, shard))
+			throw std::runtime_error(file + " is not a shard (no _shard<i>of<N> suffix)");
+		if(count == 0) {
+			count = shard.count;
+			seen.assign(count, 0);
+		}
+		if(shard.count != count)
+			throw std::runtime_error(file + " is a shard of " + std::to_string(shard.count) + ", not " + std::to_string(count));
+		if(seen[shard.index]++)
+			throw std::runtime_error("shard " + std::to_string(shard.index) + " given twice");
+	}
+	for(unsigned index = 0; index < count; ++index)
+		if(!seen[index])
+			throw std::runtime_error("shard " + std::to_string(index) + " of " + std::to_string(count) + " missing");
+}
+
+}
@@ -0,0 +1,248 @@
+/// \file SourcePlacement.cc
+/// \brief Implementation of the Common::SourcePlacement class
+
+#include "SourcePlacement.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "ParallelFor.hh"
+
+namespace Common {
+
+namespace {
+
+/// Finalizer of SplitMix64, a bijection of the 64 bits integers
+std::uint64_t Mix(std::uint64_t x) {
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	return x ^ (x >> 31);
+}
+
+std::uint64_t Hash(std::uint64_t a, std::uint64_t b) {
+	return Mix(a ^ Mix(b + 0x9e3779b97f4a7c15ULL));
+}
+
+/// SplitMix64 generator: a state of 8 bytes, so that every cell and every split has a stream
+/// of its own for the price of a hash (a std::mt19937_64 takes 2.5 kB and 312 steps to seed)
+class Stream {
+public:
+	using result_type = std::uint64_t;
+
+	explicit Stream(std::uint64_t seed): fState(seed) {}
+
+	static constexpr result_type min() { return 0; }
+	static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+	result_type operator()() {
+		fState += 0x9e3779b97f4a7c15ULL;
+		return Mix(fState);
+	}
+
+	/// Uniform in [0, 1)
+	double Uniform() { return ((*this)() >> 11)*0x1.0p-53; }
+
+private:
+	std::uint64_t fState;
+};
+
+// tags of the streams of the passes
+constexpr std::uint64_t LabelTag = 1;
+constexpr std::uint64_t SplitTag = 2;
+constexpr std::uint64_t PositionTag = 3;
+
+/// Add to counts[cells[k]] the n sources drawn over cells[begin, end) with the probabilities
+/// of their weights (weight[k] - weight[k-1], weight being cumulated, weight[-1] = 0), by
+/// binomial splits of the range, each from a stream of the seed and of the range
+void Split(const std::vector<std::size_t>& cells, const std::vector<double>& weight, std::size_t begin, std::size_t end,
+	std::uint64_t n, std::uint64_t seed, std::vector<std::uint64_t>& counts)
+{
+	while(n > 0) {
+		if(end - begin == 1) {
+			counts[cells[begin]] += n;
+			return;
+		}
+		std::size_t const middle = begin + (end - begin)/2;
+		double const base = begin == 0 ? 0. : weight[begin - 1];
+		double const p = (weight[middle - 1] - base)/(weight[end - 1] - base);
+		Stream stream(Hash(seed, begin*0x100000001ULL ^ end));
+		std::uint64_t const left = std::binomial_distribution<std::uint64_t>(n, std::clamp(p, 0., 1.))(stream);
+		Split(cells, weight, begin, middle, left, seed, counts);
+		begin = middle;
+		n -= left;
+	}
+}
+
+/// Point of the sphere of radius r around center, from u and v uniform in [0, 1)
+void OnSphere(const double center[3], double r, double u, double v, float position[3]) {
+	double const cosTheta = 2.*u - 1.;
+	double const sinTheta = std::sqrt(std::max(0., 1. - cosTheta*cosTheta));
+	double const phi = 2.*M_PI*v;
+	position[0] = static_cast<float>(center[0] + r*sinTheta*std::cos(phi));
+	position[1] = static_cast<float>(center[1] + r*sinTheta*std::sin(phi));
+	position[2] = static_cast<float>(center[2] + r*cosTheta);
+}
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+SourcePlacement::SourcePlacement(const CellArrays& cells, const std::vector<double>& nucleusRadius, std::vector<std::uint8_t> regions):
+	fRegions(std::move(regions))
+{
+	if(fRegions.size() != cells.count)
+		throw std::invalid_argument("the regions are not those of the cells");
+	if(cells.count > std::numeric_limits<std::uint32_t>::max())
+		throw std::invalid_argument("too many cells to place sources in");
+
+	fSamplers.resize(cells.count);
+	for(std::size_t i = 0; i < cells.count; ++i) {
+		auto& sampler = fSamplers[i];
+		sampler.center[0] = cells.x[i];
+		sampler.center[1] = cells.y[i];
+		sampler.center[2] = cells.z[i];
+		sampler.membrane = cells.radius[i];
+		sampler.nucleus = i < nucleusRadius.size() ? std::min(nucleusRadius[i], sampler.membrane) : 0.;
+		sampler.nucleus3 = sampler.nucleus*sampler.nucleus*sampler.nucleus;
+		sampler.membrane3 = sampler.membrane*sampler.membrane*sampler.membrane;
+	}
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::vector<std::uint64_t> SourcePlacement::Counts(const SourceSettings& settings) const
+{
+	std::vector<std::uint64_t> counts(fSamplers.size(), 0);
+	for(std::uint8_t region = 0; region < 3; ++region) {
+		std::uint64_t const sources = settings.distributionInRegion[region];
+		std::uint64_t const cap = settings.maxSourcesPerCell[region];
+		double const percentage = std::clamp(settings.cellLabelingPercentagePerRegion[region], 0., 100.);
+
+		// labelled cells: those of the smallest keys, in the order of the cells
+		std::vector<std::pair<std::uint64_t, std::size_t>> keys;
+		for(std::size_t i = 0; i < fRegions.size(); ++i)
+			if(fRegions[i] == region)
+				keys.emplace_back(Hash(Hash(settings.seed, LabelTag), i), i);
+		auto const labelled = static_cast<std::size_t>(std::llround(percentage/100.*keys.size()));
+		std::nth_element(keys.begin(), keys.begin() + labelled, keys.end());
+		std::vector<std::size_t> cells(labelled);
+		for(std::size_t k = 0; k < labelled; ++k)
+			cells[k] = keys[k].second;
+		std::sort(cells.begin(), cells.end());
+
+		if(sources == 0)
+			continue;
+		std::string const name = "region " + std::to_string(region) + ": ";
+		if(cells.empty())
+			throw std::invalid_argument(name + std::to_string(sources) + " sources and no labelled cell");
+		if((sources + cells.size() - 1)/cells.size() > cap)
+			throw std::invalid_argument(name + std::to_string(sources) + " sources for " + std::to_string(cells.size())
+				+ " labelled cells of at most " + std::to_string(cap) + " sources");
+
+		std::vector<double> weight(cells.size());
+		std::iota(weight.begin(), weight.end(), 1.);
+		Split(cells, weight, 0, cells.size(), sources, Hash(Hash(settings.seed, SplitTag), region), counts);
+		if(cap == SourceSettings::NoLimit)
+			continue;
+
+		// the sources above the limit are drawn again over the cells below it, in proportion
+		// to the sources they can still hold, until none is left over
+		for(std::uint64_t round = 1;; ++round) {
+			std::uint64_t overflow = 0;
+			std::vector<std::size_t> open;
+			for(std::size_t const cell: cells) {
+				if(counts[cell] > cap) {
+					overflow += counts[cell] - cap;
+					counts[cell] = cap;
+				} else if(counts[cell] < cap) {
+					open.push_back(cell);
+				}
+			}
+			if(overflow == 0)
+				break;
+			weight.resize(open.size());
+			double room = 0.;
+			for(std::size_t k = 0; k < open.size(); ++k)
+				weight[k] = room += static_cast<double>(cap - counts[open[k]]);
+			Split(open, weight, 0, open.size(), overflow, Hash(Hash(settings.seed, SplitTag + (round << 8)), region), counts);
+		}
+	}
+	return counts;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::vector<PlacedSource> SourcePlacement::Place(const SourceSettings& settings, int nThread) const
+{
+	double organelle[4];
+	double sum = 0.;
+	for(std::size_t k = 0; k < 4; ++k) {
+		if(!(settings.distributionInCell[k] >= 0.))
+			throw std::invalid_argument("negative distribution in the cell");
+		organelle[k] = sum += settings.distributionInCell[k];
+	}
+	if(!(sum > 0.))
+		throw std::invalid_argument("no organelle to place the sources in");
+	for(double& o: organelle)
+		o /= sum;
+
+	// slots of the sources of each cell
+	auto const counts = Counts(settings);
+	std::vector<std::uint64_t> offset(counts.size() + 1, 0);
+	std::partial_sum(counts.begin(), counts.end(), offset.begin() + 1);
+	if(offset.back() > std::numeric_limits<std::uint32_t>::max())
+		throw std::invalid_argument("too many sources");
+
+	std::vector<PlacedSource> sources(offset.back());
+	std::uint64_t const seed = Hash(settings.seed, PositionTag);
+	ParallelForEach(fSamplers.size(), ResolveThreadCount(nThread), 256, [&](std::size_t i, unsigned) {
+		if(counts[i] == 0)
+			return;
+		auto const& cell = fSamplers[i];
+		Stream stream(Hash(seed, i));
+		for(std::uint64_t s = offset[i]; s < offset[i + 1]; ++s) {
+			auto& source = sources[s];
+			source.cell = static_cast<std::uint32_t>(i);
+			double const o = stream.Uniform();
+			double const u = stream.Uniform();
+			double const v = stream.Uniform();
+			double r;
+			if(o < organelle[0])
+				r = cell.membrane;
+			else if(o < organelle[1])
+				r = std::cbrt(cell.nucleus3*stream.Uniform());
+			else if(o < organelle[2])
+				r = cell.nucleus;
+			else
+				r = std::cbrt(cell.nucleus3 + (cell.membrane3 - cell.nucleus3)*stream.Uniform());
+			OnSphere(cell.center, r, u, v, source.position);
+		}
+	});
+	return sources;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::size_t SourceOfEvent(std::uint64_t event, std::uint64_t particlesPerSource, std::size_t count)
+{
+	if(count <= 1)
+		return 0;
+	std::uint64_t const n = count;
+	std::uint64_t const s = (event/std::max<std::uint64_t>(1, particlesPerSource)) % n;
+	// s -> a s + c mod n is a bijection of [0, n) for a coprime with n, a near n/phi spreading
+	// consecutive indices over the whole range (n < 2^32, so that a s does not overflow)
+	std::uint64_t a = n*0x9e3779b9ULL >> 32 | 1;
+	while(std::gcd(a, n) != 1)
+		a += 2;
+	return static_cast<std::size_t>((a*s + n/2) % n);
+}
+
+}
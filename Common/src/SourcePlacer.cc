@@ -0,0 +1,288 @@
+/// \file SourcePlacer.cc
+/// \brief Implementation of the Common::SourcePlacer class
+
+#include "SourcePlacer.hh"
+#include "CellLocator.hh"
+#include "ParallelFor.hh"
+#include "PopulationBinary.hh"
+#include "PopulationLoader.hh"
+#include "PopulationXml.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <G4Event.hh>
+#include <G4PrimaryVertex.hh>
+#include <G4RunManager.hh>
+#include <G4SystemOfUnits.hh>
+#include <G4VUserPrimaryGeneratorAction.hh>
+#include <G4ios.hh>
+
+namespace Common {
+
+namespace {
+
+/// Primary generator action of a worker moving the vertices generated by the one it
+/// replaces (owned) to the sources
+class SourcePrimaryGeneratorAction: public G4VUserPrimaryGeneratorAction {
+public:
+	SourcePrimaryGeneratorAction(const SourcePlacer& placer, G4VUserPrimaryGeneratorAction* previous):
+		fPlacer(placer),
+		fPrevious(previous)
+	{
+	}
+
+	void GeneratePrimaries(G4Event* event) override {
+		fPrevious->GeneratePrimaries(event);
+		fPlacer.Emit(*event);
+	}
+
+private:
+	const SourcePlacer& fPlacer;
+	std::unique_ptr<G4VUserPrimaryGeneratorAction> fPrevious;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/// Actions of the wrapped initialization, with its primary generator action wrapped
+class SourceActionInitialization: public G4VUserActionInitialization {
+public:
+	SourceActionInitialization(const SourcePlacer& placer, G4VUserActionInitialization* actions):
+		fPlacer(placer),
+		fActions(actions)
+	{
+	}
+
+	void Build() const override {
+		fActions->Build();
+		// the actions are those of the run manager of the thread
+		auto* previous = const_cast<G4VUserPrimaryGeneratorAction*>(G4RunManager::GetRunManager()->GetUserPrimaryGeneratorAction());
+		if(previous)
+			SetUserAction(new SourcePrimaryGeneratorAction(fPlacer, previous));
+	}
+
+	void BuildForMaster() const override {
+		fActions->BuildForMaster();
+	}
+
+	G4VSteppingVerbose* InitializeSteppingVerbose() const override {
+		return fActions->InitializeSteppingVerbose();
+	}
+
+private:
+	const SourcePlacer& fPlacer;
+	std::unique_ptr<G4VUserActionInitialization> fActions;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/// Command of one parameter of type per region, or per organelle
+void SetParameters(G4UIcommand& command, char type, const std::vector<const char*>& names, const char* range) {
+	for(const char* name: names) {
+		auto* parameter = new G4UIparameter(name, type, false);
+		parameter->SetParameterRange((std::string(name) + range).c_str());
+		command.SetParameter(parameter);
+	}
+	command.AvailableForStates(G4State_PreInit, G4State_Idle);
+}
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+SourcePlacer::SourcePlacer():
+	fUnit(micrometer),
+	fDirectory("/cpop/sources/", false),
+	fPopulationCmd("/cpop/sources/population", this),
+	fPopulationUnitCmd("/cpop/sources/populationUnit", this),
+	fRegionRatiosCmd("/cpop/sources/regionRatios", this),
+	fTotalSourceCmd("/cpop/sources/totalSource", this),
+	fDistributionInRegionCmd("/cpop/sources/distributionInRegion", this),
+	fDistributionInCellCmd("/cpop/sources/distributionInCell", this),
+	fMaxSourcesPerCellCmd("/cpop/sources/maxSourcesPerCell", this),
+	fLabelingCmd("/cpop/sources/cellLabelingPercentagePerRegion", this),
+	fParticlesPerSourceCmd("/cpop/sources/particlesPerSource", this),
+	fSeedCmd("/cpop/sources/seed", this),
+	fThreadsCmd("/cpop/sources/threads", this),
+	fInitCmd("/cpop/sources/init", this),
+	fClearCmd("/cpop/sources/clear", this)
+{
+	fDirectory.SetGuidance("Parallel placement of the sources of a distribution in the cells");
+
+	fPopulationCmd.SetGuidance("Population of the sources (xml or binary), the binary population by default");
+	fPopulationCmd.SetParameterName("PopulationFile", false);
+	fPopulationCmd.AvailableForStates(G4State_PreInit, G4State_Idle);
+
+	fPopulationUnitCmd.SetGuidance("Set the length unit of the population file");
+	fPopulationUnitCmd.SetParameterName("Unit", false);
+	fPopulationUnitCmd.SetUnitCategory("Length");
+	fPopulationUnitCmd.SetDefaultUnit("um");
+	fPopulationUnitCmd.AvailableForStates(G4State_PreInit, G4State_Idle);
+
+	fRegionRatiosCmd.SetGuidance("Set the internal and intermediary ratios defining the regions of the cells");
+	fRegionRatiosCmd.SetGuidance("(those of /cpop/population/internalRatio and intermediaryRatio by default)");
+	SetParameters(fRegionRatiosCmd, 'd', {"InternalRatio", "IntermediaryRatio"}, " >= 0");
+
+	fTotalSourceCmd.SetGuidance("Set the number of sources in the spheroid");
+	fTotalSourceCmd.SetParameterName("NbSource", false);
+	fTotalSourceCmd.SetRange("NbSource >= 0");
+	fTotalSourceCmd.AvailableForStates(G4State_PreInit, G4State_Idle);
+
+	fDistributionInRegionCmd.SetGuidance("Set the number of sources of the necrosis, intermediary and external regions");
+	SetParameters(fDistributionInRegionCmd, 'i', {"Necrosis", "Intermediary", "External"}, " >= 0");
+
+	fDistributionInCellCmd.SetGuidance("Set the proportions of the sources on the cell membrane, in the nucleus, on the nucleus membrane and in the cytoplasm");
+	SetParameters(fDistributionInCellCmd, 'd', {"CellMembrane", "Nucleus", "NucleusMembrane", "Cytoplasm"}, " >= 0");
+
+	fMaxSourcesPerCellCmd.SetGuidance("Set the maximum number of sources in a cell of the necrosis, intermediary and external regions");
+	SetParameters(fMaxSourcesPerCellCmd, 'i', {"Necrosis", "Intermediary", "External"}, " >= 0");
+
+	fLabelingCmd.SetGuidance("Set the percentage of labelled cells of the necrosis, intermediary and external regions");
+	SetParameters(fLabelingCmd, 'd', {"Necrosis", "Intermediary", "External"}, " >= 0");
+
+	fParticlesPerSourceCmd.SetGuidance("Set the number of events emitted from each source");
+	fParticlesPerSourceCmd.SetParameterName("NbParticle", false);
+	fParticlesPerSourceCmd.SetRange("NbParticle >= 1");
+	fParticlesPerSourceCmd.AvailableForStates(G4State_PreInit, G4State_Idle);
+
+	fSeedCmd.SetGuidance("Set the seed of the placement of the sources");
+	fSeedCmd.SetParameterName("Seed", false);
+	fSeedCmd.AvailableForStates(G4State_PreInit, G4State_Idle);
+
+	fThreadsCmd.SetGuidance("Set the number of threads placing the sources (0 for all the cores)");
+	fThreadsCmd.SetParameterName("NbThread", false);
+	fThreadsCmd.SetRange("NbThread >= 0");
+	fThreadsCmd.AvailableForStates(G4State_PreInit, G4State_Idle);
+
+	fInitCmd.SetGuidance("Place the sources, which the primaries of the next runs are emitted from");
+	fInitCmd.AvailableForStates(G4State_PreInit, G4State_Idle);
+
+	fClearCmd.SetGuidance("Emit the primaries from the positions of the CPOP sources again");
+	fClearCmd.AvailableForStates(G4State_PreInit, G4State_Idle);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SourcePlacer::SetNewValue(G4UIcommand* command, G4String newValue)
+{
+	std::istringstream values(newValue);
+	if(command == &fPopulationCmd) {
+		fPopulationFile = newValue;
+		fPlacement.reset();
+	} else if(command == &fPopulationUnitCmd) {
+		fUnit = fPopulationUnitCmd.GetNewDoubleValue(newValue);
+	} else if(command == &fRegionRatiosCmd) {
+		values >> fInternalRatio >> fIntermediaryRatio;
+		fRegionRatiosSet = true;
+		fPlacement.reset();
+	} else if(command == &fTotalSourceCmd) {
+		fTotalSource = static_cast<std::uint64_t>(fTotalSourceCmd.GetNewIntValue(newValue));
+	} else if(command == &fDistributionInRegionCmd) {
+		for(auto& sources: fSettings.distributionInRegion)
+			values >> sources;
+	} else if(command == &fDistributionInCellCmd) {
+		for(auto& proportion: fSettings.distributionInCell)
+			values >> proportion;
+	} else if(command == &fMaxSourcesPerCellCmd) {
+		for(auto& max: fSettings.maxSourcesPerCell)
+			values >> max;
+	} else if(command == &fLabelingCmd) {
+		for(auto& percentage: fSettings.cellLabelingPercentagePerRegion)
+			values >> percentage;
+	} else if(command == &fParticlesPerSourceCmd) {
+		fParticlesPerSource = static_cast<std::uint64_t>(fParticlesPerSourceCmd.GetNewIntValue(newValue));
+	} else if(command == &fSeedCmd) {
+		fSettings.seed = static_cast<std::uint64_t>(fSeedCmd.GetNewIntValue(newValue));
+	} else if(command == &fThreadsCmd) {
+		fThreads = fThreadsCmd.GetNewIntValue(newValue);
+	} else if(command == &fInitCmd) {
+		Init();
+	} else if(command == &fClearCmd) {
+		fSources.clear();
+		fSources.shrink_to_fit();
+	}
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4VUserActionInitialization* SourcePlacer::Wrap(G4VUserActionInitialization* actions)
+{
+	return new SourceActionInitialization(*this, actions);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SourcePlacer::BuildSamplers()
+{
+	auto const build = [this](const CellArrays& cells, const std::uint64_t* nucleusOffset, const double* nucleusRadius,
+		const double center[3], double externalRadius)
+	{
+		// the regions of CPOP are relative to the delimitation of the spheroid
+		auto regions = CellRegions(cells, center, externalRadius, fInternalRatio, fIntermediaryRatio);
+		fPlacement = std::make_unique<SourcePlacement>(cells, CellLocator::NucleusRadii(cells.count, nucleusOffset, nucleusRadius),
+			std::move(regions));
+	};
+
+	if(!fPopulationFile.empty()) {
+		PopulationData const population = ReadPopulation(fPopulationFile);
+		build(MakeCellArrays(population), population.nucleusOffset.data(), population.nucleusRadius.data(),
+			population.center, population.externalRadius);
+	} else if(fLoader && fLoader->population()) {
+		auto const& population = *fLoader->population();
+		build(MakeCellArrays(population), population.nucleusOffset(), population.nucleusRadius(),
+			population.header().center, population.header().externalRadius);
+	} else {
+		throw std::runtime_error("no population to place the sources in, use /cpop/sources/population or /cpop/population/inputBinary first");
+	}
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SourcePlacer::Init()
+{
+	std::uint64_t inRegions = 0;
+	for(auto const sources: fSettings.distributionInRegion)
+		inRegions += sources;
+	if(inRegions != fTotalSource)
+		throw std::runtime_error("the sum of /cpop/sources/distributionInRegion (" + std::to_string(inRegions)
+			+ ") must be equal to /cpop/sources/totalSource (" + std::to_string(fTotalSource) + ")");
+
+	// regions of CPOP, unless given by /cpop/sources/regionRatios
+	double internalRatio = fInternalRatio;
+	double intermediaryRatio = fIntermediaryRatio;
+	if(!fRegionRatiosSet && !PopulationLoader::RegionRatios(internalRatio, intermediaryRatio))
+		throw std::runtime_error("regions of the population unknown, use /cpop/sources/regionRatios");
+	if(internalRatio != fInternalRatio || intermediaryRatio != fIntermediaryRatio) {
+		fInternalRatio = internalRatio;
+		fIntermediaryRatio = intermediaryRatio;
+		fPlacement.reset();
+	}
+
+	if(!fPlacement)
+		BuildSamplers();
+
+	auto const start = std::chrono::steady_clock::now();
+	fSources = fPlacement->Place(fSettings, fThreads);
+	std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+	G4cout << "Placed " << fSources.size() << " sources in the " << fPlacement->size() << " cells on "
+		<< ResolveThreadCount(fThreads) << " threads in " << elapsed.count() << " s, emitting " << fParticlesPerSource
+		<< " events each" << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SourcePlacer::Emit(G4Event& event) const
+{
+	if(fSources.empty())
+		return;
+
+	auto const& source = fSources[SourceOfEvent(static_cast<std::uint64_t>(event.GetEventID()), fParticlesPerSource, fSources.size())];
+	for(G4int v = 0; v < event.GetNumberOfPrimaryVertex(); ++v)
+		event.GetPrimaryVertex(v)->SetPosition(source.position[0]*fUnit, source.position[1]*fUnit, source.position[2]*fUnit);
+}
+
+}
@@ -0,0 +1,116 @@
+/// \file Spectrum.cc
+/// \brief Implementation of the Common::Spectrum class
+
+#include "Spectrum.hh"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+
+namespace Common {
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+Spectrum::Spectrum(std::vector<double> energies, std::vector<double> intensities, Mode mode) {
+	if(energies.size() != intensities.size())
+		throw std::invalid_argument("spectrum: as many energies as intensities expected");
+
+	// rows sorted by energy
+	std::vector<std::size_t> order(energies.size());
+	std::iota(std::begin(order), std::end(order), 0);
+	std::stable_sort(std::begin(order), std::end(order), [&](std::size_t a, std::size_t b) { return energies[a] < energies[b]; });
+	fEnergies.reserve(order.size());
+	std::vector<double> weights;
+	weights.reserve(order.size());
+	for(std::size_t const i: order) {
+		fEnergies.push_back(energies[i]);
+		weights.push_back(intensities[i]);
+	}
+	fTable = AliasTable(weights);
+
+	double const sum = std::accumulate(std::begin(weights), std::end(weights), 0.);
+	double cumulative = 0.;
+	for(double const weight: weights) {
+		fProbabilities.push_back(weight/sum);
+		cumulative += weight/sum;
+		fCumulative.push_back(cumulative);
+	}
+
+	std::size_t const n = fEnergies.size();
+	if(mode == Mode::Auto) {
+		bool even = n >= 3;
+		double const step = n >= 2 ? (fEnergies.back() - fEnergies.front())/(n - 1) : 0.;
+		for(std::size_t i = 1; even && i < n; ++i)
+			even = step > 0. && std::abs(fEnergies[i] - fEnergies[i-1] - step) <= 1e-6*step;
+		mode = even ? Mode::Histogram : Mode::Lines;
+	}
+
+	fHistogram = mode == Mode::Histogram;
+	if(fHistogram) {
+		fLow.resize(n);
+		fHigh.resize(n);
+		for(std::size_t i = 0; i < n; ++i) {
+			double const below = i > 0 ? fEnergies[i] - fEnergies[i-1] : (n > 1 ? fEnergies[1] - fEnergies[0] : 0.);
+			double const above = i + 1 < n ? fEnergies[i+1] - fEnergies[i] : below;
+			fLow[i] = std::max(0., fEnergies[i] - below/2.);
+			fHigh[i] = fEnergies[i] + above/2.;
+		}
+	}
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+Spectrum Spectrum::Read(const std::string& filename, Mode mode) {
+	std::ifstream in(filename);
+	if(!in)
+		throw std::runtime_error("spectrum " + filename + ": unable to open");
+
+	std::size_t count = 0;
+	double type = 0.;
+	double energy = 0.;
+	if(!(in >> count >> type >> energy))
+		throw std::runtime_error("spectrum " + filename + ": malformed header");
+
+	std::vector<double> energies(count);
+	std::vector<double> intensities(count);
+	for(std::size_t i = 0; i < count; ++i)
+		if(!(in >> energies[i] >> intensities[i]))
+			throw std::runtime_error("spectrum " + filename + ": " + std::to_string(count) + " rows expected, " + std::to_string(i) + " read");
+
+	try {
+		return Spectrum(std::move(energies), std::move(intensities), mode);
+	} catch(const std::invalid_argument& e) {
+		throw std::runtime_error("spectrum " + filename + ": " + e.what());
+	}
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+bool Spectrum::ParseMode(const std::string& name, Mode& mode) {
+	std::string input = name;
+	// transforms the input string to lowercase to be case insensitive
+	std::transform(std::begin(input), std::end(input), std::begin(input), ::tolower);
+
+	if(input == "auto")
+		mode = Mode::Auto;
+	else if(input == "lines")
+		mode = Mode::Lines;
+	else if(input == "histogram")
+		mode = Mode::Histogram;
+	else
+		return false;
+	return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+double Spectrum::SampleInverse(double u1, double u2) const {
+	auto const found = std::upper_bound(std::begin(fCumulative), std::end(fCumulative), u1*fCumulative.back());
+	std::size_t const i = std::min<std::size_t>(found - std::begin(fCumulative), fCumulative.size() - 1);
+	return fHistogram ? fLow[i] + u2*(fHigh[i] - fLow[i]) : fEnergies[i];
+}
+
+}
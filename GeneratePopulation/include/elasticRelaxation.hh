@@ -0,0 +1,84 @@
+/// \file elasticRelaxation.hh
+/// \brief Definition of the B6::ElasticRelaxation class
+
+#ifndef B6_ELASTIC_RELAXATION_H
+#define B6_ELASTIC_RELAXATION_H
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include "neighbourSearch.hh"
+
+/// ElasticRelaxation class
+///
+/// Parallel alternative to MASPlatform::startSimulation for the elastic force.
+/// Each step is done in two passes:
+///  1) the displacement of every cell is computed from the current positions, concurrently;
+///  2) the displacements are applied, concurrently.
+/// As no cell is moved while another one is being computed, the result does not
+/// depend on the number of threads: nbThread = 1 gives the serial reference of this engine.
+/// The threads (a Common::WorkerPool) are created once per Run and shared by all the steps.
+///
+/// The neighbours are given by a B6::NeighbourSearch, rebuilt at each step.
+/// Between two neighbour cells in contact (distance < sum of the radii), the elastic force is
+/// rigidity * (stableLength - distance) along the line joining their centers, with
+/// stableLength = ratioToStableLength * sum of the radii. This is this engine's reading of the
+/// [ForceProperties] parameters, not the t_ElasticForce_3 of the MASPlatform, whose cells also
+/// move one after another: both engines do not give the same positions, and relaxationCompare
+/// compares the packings they produce.
+///
+/// A run can be interrupted and continued: given the positions and the Progress
+/// reported after a step which is not the last one, Run continues exactly as the
+/// uninterrupted run.
+
+namespace B6 {
+
+class ElasticRelaxation {
+public:
+	using Point = std::array<double, 3>;
+
+	struct Parameters {
+		double rigidity{0.};
+		double ratioToStableLength{1.};
+		double stepDuration{1.};
+		double duration{0.};              // <= 0 : until the displacement threshold is reached
+		int maxStep{1000};                // <= 0 : no limit
+		double displacementThreshold{0.}; // stop when no cell moved more than this during a step
+		double internalRadius{0.};        // cells centers are kept between the two spheres
+		double externalRadius{0.};
+		int nbThread{0};                  // <= 0 : all the hardware threads
+		NeighbourSearch::Type spatialDataStructure{NeighbourSearch::Type::Delaunay};
+	};
+
+	/// Steps done and simulated time the next step starts from
+	struct Progress {
+		std::size_t step{0};
+		double time{0.};
+		double maxDisplacement{0.};  // largest move of the last step
+		bool done{false};            // no step follows
+	};
+
+	/// Called after each step, with the positions after the step
+	using StepCallback = std::function<void(const std::vector<Point>& positions, const Progress& progress)>;
+
+	explicit ElasticRelaxation(const Parameters& parameters);
+
+	/// Relax the cells in place, returns the number of steps done
+	std::size_t Run(std::vector<Point>& positions, const std::vector<double>& radii) const {
+		return Run(positions, radii, Progress{}, nullptr);
+	}
+
+	/// Relax the cells in place from start, returns the number of steps done (start.step included)
+	std::size_t Run(
+		std::vector<Point>& positions, const std::vector<double>& radii, const Progress& start, const StepCallback& onStep
+	) const;
+
+private:
+	Parameters fParameters;
+};
+
+}
+
+#endif
@@ -0,0 +1,62 @@
+/// \file initialPlacement.hh
+/// \brief Definition of the B6::InitialPlacement class
+
+#ifndef B6_INITIAL_PLACEMENT_H
+#define B6_INITIAL_PLACEMENT_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// InitialPlacement class
+///
+/// Positions of the cells before the relaxation, in the shell between two
+/// spheres centered on the origin (the SpheresSDelimitation of the spheroid).
+///
+/// Available placements (distribution key of [SpheroidProperties]):
+///  - random      : CPOP Distribution::RANDOM, cells are heavily overlapped;
+///  - poissonDisk : dart throwing, a cell being accepted only if its distance to every
+///                  placed cell is at least spacing * (sum of their radii). The spacing
+///                  starts at 1 and is lowered each time a cell can not be placed, so
+///                  that overpacked spheroids still get all their cells;
+///  - lattice     : face centered cubic (close-packed) lattice sized to hold the cells,
+///                  clipped to the shell, each site moved randomly by up to
+///                  jitter * lattice spacing.
+/// Both are deterministic for a given seed.
+
+namespace B6 {
+
+class InitialPlacement {
+public:
+	using Point = std::array<double, 3>;
+
+	enum class Type { Random, PoissonDisk, Lattice };
+
+	/// Placement from its configuration name, false if unknown
+	static bool Parse(const std::string& name, Type& type);
+
+	InitialPlacement(double internalRadius, double externalRadius, std::uint64_t seed = 1234567);
+
+	/// One position per radius, cells are placed by decreasing radius
+	[[nodiscard]] std::vector<Point> PoissonDisk(const std::vector<double>& radii);
+
+	/// nbCell lattice sites, jitter being a fraction of the lattice spacing
+	[[nodiscard]] std::vector<Point> JitteredLattice(std::size_t nbCell, double jitter) const;
+
+	/// Spacing of the last PoissonDisk call (1 if no cell overlaps)
+	[[nodiscard]] double spacing() const { return fSpacing; }
+
+private:
+	[[nodiscard]] bool InShell(const Point& p) const;
+
+	double fInternalRadius;
+	double fExternalRadius;
+	std::uint64_t fSeed;
+	double fSpacing{1.};
+};
+
+}
+
+#endif
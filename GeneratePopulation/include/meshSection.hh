@@ -30,7 +30,9 @@
 #ifndef B6_MESH_SECTION_H
 #define B6_MESH_SECTION_H
 
-#include <cReader/sectionreader.hh>
+#include <string>
+
+#include "optionalSectionReader.hh"
 
 // How to create your own configuration reader to build a T object
 /* 1) Declare a ConfigReader object
@@ -70,18 +72,34 @@
 /// MeshSection
 ///
 /// It contains the mesh properties for the cell population.
+///
+/// Optional keys:
+///  - meshEngine : "cpop" (default, Round_Cell_Tesselation) or "export" (Common::CellExportMesh, an approximate mesh of its own)
+///  - nbThread   : threads used by the export mesher (0, the default, for all of them)
+///  - visFormat  : file written by --vis, "off" (default) or "ply" (binary, always export mesher)
+///  - maxNumberOfFacet : facet budget of the whole population for the export mesher (0, the default, for no limit)
+///  - internalRatio, intermediaryRatio : regions written in the ply file (default 0.01 and 0.52)
 
 namespace B6 {
 
 template <typename T>
-class MeshSection: public conf::SectionReader<T> {
+class MeshSection: public OptionalSectionReader<T> {
 public:
 	void fill() override {
 		const char sectionName[] = "MeshProperties";
 
 		int maxNumberOfFacetPerCell = this->template load<int>(sectionName, "maxNumberOfFacetPerCell");
 
+		std::string meshEngine = this->template loadOr<std::string>(sectionName, "meshEngine", "cpop");
+		int nbThread = this->template loadOr<int>(sectionName, "nbThread", 0);
 		this->objToFill->SetMeshProperties(maxNumberOfFacetPerCell);
+		std::string visFormat = this->template loadOr<std::string>(sectionName, "visFormat", "off");
+		int maxNumberOfFacet = this->template loadOr<int>(sectionName, "maxNumberOfFacet", 0);
+		double internalRatio = this->template loadOr<double>(sectionName, "internalRatio", 0.01);
+		double intermediaryRatio = this->template loadOr<double>(sectionName, "intermediaryRatio", 0.52);
+
+		this->objToFill->SetMeshEngine(meshEngine, nbThread);
+		this->objToFill->SetVisProperties(visFormat, maxNumberOfFacet, internalRatio, intermediaryRatio);
 	}
 };
 
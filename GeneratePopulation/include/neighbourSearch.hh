@@ -0,0 +1,80 @@
+/// \file neighbourSearch.hh
+/// \brief Definition of the B6::NeighbourSearch class and its implementations
+
+#ifndef B6_NEIGHBOUR_SEARCH_H
+#define B6_NEIGHBOUR_SEARCH_H
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "UniformGrid.hh"
+
+/// NeighbourSearch class
+///
+/// Spatial data structure used by B6::ElasticRelaxation to find the neighbours of
+/// each cell. It is rebuilt at each step and then queried concurrently.
+///
+/// Available structures (spatialDataStructure key of [SimulationProperties], parallel engine only,
+/// the MASPlatform always searching with its own Delaunay_3D_SDS):
+///  - delaunay : neighbours in the 3D Delaunay triangulation of the cells centers, a CGAL
+///               triangulation of this class, not the Delaunay_3D_SDS of the MASPlatform;
+///  - grid     : uniform grid (cell list) whose cells are the size of the
+///               largest contact distance, ie twice the maximum membrane radius.
+///
+/// Both do not give the same neighbours: the grid gives every cell in contact (and more), the
+/// triangulation only the adjacent ones, which may leave out a cell in contact when the cells
+/// overlap much and include cells which are not in contact. As the force only acts between cells in
+/// contact, a relaxation with the grid is not the same as one with the triangulation.
+
+namespace B6 {
+
+class NeighbourSearch {
+public:
+	using Point = std::array<double, 3>;
+
+	enum class Type { Delaunay, Grid };
+
+	virtual ~NeighbourSearch() = default;
+
+	/// Index the cells, maxRadius being the largest membrane radius
+	virtual void Build(const std::vector<Point>& positions, double maxRadius) = 0;
+
+	/// Neighbours of the cell i (i excluded), sorted by index. Thread safe.
+	virtual void Neighbours(std::size_t i, std::vector<std::size_t>& neighbours) const = 0;
+
+	[[nodiscard]] virtual const char* Name() const = 0;
+
+	/// Build a structure from its configuration name, nullptr if unknown
+	static std::unique_ptr<NeighbourSearch> Create(const std::string& name);
+	static std::unique_ptr<NeighbourSearch> Create(Type type);
+};
+
+class GridNeighbourSearch: public NeighbourSearch {
+public:
+	void Build(const std::vector<Point>& positions, double maxRadius) override;
+	void Neighbours(std::size_t i, std::vector<std::size_t>& neighbours) const override;
+	[[nodiscard]] const char* Name() const override { return "grid"; }
+
+private:
+	const std::vector<Point>* fPositions{nullptr};
+	Common::UniformGrid fGrid;
+};
+
+class DelaunayNeighbourSearch: public NeighbourSearch {
+public:
+	void Build(const std::vector<Point>& positions, double maxRadius) override;
+	void Neighbours(std::size_t i, std::vector<std::size_t>& neighbours) const override;
+	[[nodiscard]] const char* Name() const override { return "delaunay"; }
+
+private:
+	// adjacency lists extracted from the triangulation, CGAL is only used in Build
+	std::vector<std::size_t> fStart;
+	std::vector<std::size_t> fAdjacent;
+};
+
+}
+
+#endif
@@ -0,0 +1,31 @@
+/// \file optionalSectionReader.hh
+/// \brief Definition of the B6::OptionalSectionReader class
+
+#ifndef B6_OPTIONAL_SECTION_READER_H
+#define B6_OPTIONAL_SECTION_READER_H
+
+#include <cReader/sectionreader.hh>
+
+/// OptionalSectionReader class
+///
+/// SectionReader with a loadOr method, used for the keys which can be omitted
+/// in the configuration file (so that older configuration files remain valid).
+
+namespace B6 {
+
+template<typename T>
+class OptionalSectionReader: public conf::SectionReader<T> {
+protected:
+	template<typename V>
+	V loadOr(const char* sectionName, const char* keyName, const V& defaultValue) {
+		try {
+			return this->template load<V>(sectionName, keyName);
+		} catch(...) {
+			return defaultValue;
+		}
+	}
+};
+
+}
+
+#endif
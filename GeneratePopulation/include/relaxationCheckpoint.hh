@@ -0,0 +1,55 @@
+/// \file relaxationCheckpoint.hh
+/// \brief Definition of the B6::RelaxationCheckpoint class
+
+#ifndef B6_RELAXATION_CHECKPOINT_H
+#define B6_RELAXATION_CHECKPOINT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "elasticRelaxation.hh"
+
+/// RelaxationCheckpoint class
+///
+/// State of an interrupted B6::ElasticRelaxation run: the cells positions and the
+/// progress after a step. The cells themselves (properties, radii, nuclei) are
+/// not saved: resuming parses the configuration again, which creates the same
+/// cells as long as the seed is the same, then moves them to the saved positions.
+/// The relaxation draws no random number, so the random engines need no more than
+/// the seed to be in the same state as in the interrupted run.
+///
+/// The parameters the positions depend on (engine, neighbour search, rigidity, ratio to the
+/// stable length, step duration and shell radii) are saved too, and a resume with other
+/// values is refused (Mismatch). The number of threads and the stop criteria (duration,
+/// maxStep, displacement threshold) are not: they do not change the positions of a step, so
+/// a run can be resumed on another number of threads or continued further.
+/// Only the parallel engine is checkpointed, the MASPlatform does not expose its steps.
+///
+/// The file is written in a temporary file, synced, then renamed over the
+/// previous checkpoint, so a checkpoint on disk is always complete.
+
+namespace B6 {
+
+class RelaxationCheckpoint {
+public:
+	std::uint64_t seed{0};           // seed the cells were created with
+	std::uint64_t radiiChecksum{0};  // Checksum of the radii, to detect another population
+	ElasticRelaxation::Progress progress;
+	std::vector<ElasticRelaxation::Point> positions;
+	ElasticRelaxation::Parameters parameters;
+
+	/// Name of the first parameter of the checkpoint differing from those of parameters, empty if none
+	[[nodiscard]] std::string Mismatch(const ElasticRelaxation::Parameters& current) const;
+
+	void Write(const std::string& filename) const;
+
+	/// False if filename does not exist, throws if it is not a valid checkpoint
+	static bool Read(const std::string& filename, RelaxationCheckpoint& checkpoint);
+
+	static std::uint64_t Checksum(const std::vector<double>& radii);
+};
+
+}
+
+#endif
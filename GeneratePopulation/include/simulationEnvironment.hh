@@ -31,12 +31,19 @@
 #define B6_SIMULATION_ENVIRONMENT_H
 
 #include <algorithm>
+#include <memory>
 #include <string>
+#include <type_traits>
+#include <vector>
 
 #include <CellFactory.hh>     // needed to call the mesh factory, creating the mesh
 #include <ElasticForce.hh>    // The type of force we want to apply
 #include <MASPlatform.hh>     // THe platform used to manage agent ( cell ) execution
 #include <File_CPOP_Data.hh>  // CPOP tools for saving files
+#include <MeshFactory.hh>     // Round cell tesselation of the population
+
+#include "PhaseReport.hh"
+#include "neighbourSearch.hh"
 
 /// SimulationEnvironment class
 ///
@@ -51,6 +58,10 @@ using namespace Settings::nEnvironment;
 class SimulationEnvironment {
 public:
   using t_ElasticForce_3 = ElasticForce<double, Point_3, Vector_3>;
+  // type of the mesh built by MeshFactory::create_3DMesh
+  using t_Mesh_3 = std::remove_pointer_t<decltype(MeshFactory::getInstance()->create_3DMesh(
+    nullptr, std::declval<t_SimulatedSubEnv_3*>(), MeshTypes::Round_Cell_Tesselation, 0
+  ))>;
 
 private:
   double fMetricSystem{1.0};
@@ -61,11 +72,48 @@ private:
   // automatically deleted
   t_SimulatedSubEnv_3* fSimulatedEnv{nullptr};
 
+  double fInternalRadius{0.};
+  double fExternalRadius{0.};
+  int fSeed{1234567};
+
   // Mesh properties
   int fNumberOfFacetPerCell{50};
+  // built on demand by GetMesh, reset whenever the cells are created or moved
+  std::unique_ptr<t_Mesh_3> fMesh;
+  // Mesh engine: MeshFactory or the approximate Common::CellExportMesh
+  bool fExportMesh{false};
+  int fMeshNbThread{0};
+  // --vis output: binary PLY (always streamed by the export mesher) or OFF
+  bool fVisPly{false};
+  int fVisFacetBudget{0};
+  double fInternalRatio{0.01};
+  double fIntermediaryRatio{0.52};
+
+  // Force properties, cells of the simulated sub environment (EnumerateCells)
+  std::vector<t_Cell_3*> fCells;
+  double fRigidity{0.};
+  double fRatioToStableLength{1.};
 
   // Simulation properties
   MASPlatform fPlatform;
+  double fDuration{0.};
+  double fDisplacementThreshold{0.};
+  double fStepDuration{1.};
+
+  // Relaxation engine: MASPlatform or the parallel ElasticRelaxation
+  bool fParallelRelaxation{false};
+  int fNbThread{0};
+  int fMaxNumberOfStep{1000};
+  NeighbourSearch::Type fSpatialDataStructure{NeighbourSearch::Type::Delaunay};
+
+  // Checkpoints of the parallel engine (see relaxationCheckpoint.hh)
+  std::string fCheckpointFile;
+  bool fResume{false};
+  double fCheckpointPeriod{0.};
+
+  // timing and memory of the generation phases
+  Common::PhaseReport fReport;
+  int fNumberOfAgentToExecute{0};
 
 public:
   // Setter used by the xxxSection class
@@ -74,10 +122,23 @@ public:
     double minRadiusNucleus, double maxRadiusNucleus, double minRadiusMembrane,
     double maxRadiusMembrane, const std::string& cytoplasmMaterials, const std::string& nucleusMaterials
   );
-  void SetSpheroidProperties(double internalRadius, double externalRadius, int nbCell);
+  void SetSpheroidProperties(
+    double internalRadius, double externalRadius, int nbCell, const std::string& distribution, double latticeJitter, int seed
+  );
   void SetMeshProperties(int nOfFacetPerCell);
+  void SetMeshEngine(const std::string& engine, int nbThread);
+  void SetVisProperties(const std::string& format, int maxNumberOfFacet, double internalRatio, double intermediaryRatio);
   void SetForceProperties(double ratioToStableLength, double rigidity);
   void SetSimulationProperties(double duration, int numberOfAgentToExecute, double displacementThreshold, double stepDuration);
+  void SetRelaxationEngine(const std::string& engine, int nbThread, int maxNumberOfStep);
+  void SetSpatialDataStructure(const std::string& name);
+  void SetCheckpointPeriod(double seconds);
+
+  // checkpoints are written to filename, resume continues from it if it exists
+  void SetCheckpoint(const std::string& filename, bool resume);
+
+  // build the materials once, so that forked generations share them (see B6::Sweep)
+  static void PrepareMaterials();
 
   // start the simulation
   void StartSimulation();
@@ -85,10 +146,30 @@ public:
   // save the population
   void SavePopulation(const char* filename);
 
-  // export to off format to visualise the population
-  void ExportToVis(const char* filename);
+  // save the population saved as xmlFilename in the binary format, the positions and radii of the
+  // cells being those of the simulation rather than the 6 digits of the xml
+  void SavePopulationBinary(const std::string& xmlFilename, const std::string& binaryFilename);
+
+  // export to off or ply format to visualise the population, returns the name of the generated file
+  std::string ExportToVis(const char* filename);
+
+  // phases of the generation, the caller adds its own and writes the report
+  Common::PhaseReport& Report() { return fReport; }
 
 private:
+  // cells of the simulated sub environment, listed once by the round cell tesselation
+  const std::vector<t_Cell_3*>& EnumerateCells();
+
+  // round cell tesselation of the current cells positions
+  t_Mesh_3& GetMesh();
+  void InvalidateMesh();
+
+  // move the cells created by Distribution::RANDOM to a B6::InitialPlacement
+  void PlaceCells(const std::string& distribution, double latticeJitter);
+
+  // apply the elastic forces with B6::ElasticRelaxation instead of the platform
+  void StartParallelRelaxation();
+
   static G4Material* ParseMaterial(const char* material);
 };
 
@@ -30,7 +30,9 @@
 #ifndef B6_SIMULATION_SECTION_H
 #define B6_SIMULATION_SECTION_H
 
-#include <cReader/sectionreader.hh>
+#include <string>
+
+#include "optionalSectionReader.hh"
 
 // How to create your own configuration reader to build a T object
 /* 1) Declare a ConfigReader object
@@ -70,11 +72,19 @@
 /// SimulationSection class
 ///
 /// It contains the simulation properties for the cell population
+///
+/// Optional keys:
+///  - relaxationEngine : "mas" (default, MASPlatform) or "parallel" (B6::ElasticRelaxation, experimental:
+///    its force law is not the one of the MASPlatform, it does not replace it)
+///  - nbThread         : threads used by the parallel engine (0, the default, for all of them)
+///  - maxNumberOfStep  : steps limit of the parallel engine (default 1000, 0 for no limit)
+///  - spatialDataStructure : neighbour search, "delaunay" (default) or "grid" (parallel engine only, an error with the MASPlatform)
+///  - checkpointPeriod : seconds between two checkpoints of the parallel engine (default 0, no checkpoint)
 
 namespace B6 {
 
 template<typename T>
-class SimulationSection: public conf::SectionReader<T> {
+class SimulationSection: public OptionalSectionReader<T> {
 public:
 	void fill() override {
 		const char sectionName[] = "SimulationProperties";
@@ -84,8 +94,16 @@ public:
 		double displacementThreshold = this->template load<double>(sectionName, "displacementThreshold");
 		double stepDuration = this->template load<double>(sectionName, "stepDuration");
 
+		std::string relaxationEngine = this->template loadOr<std::string>(sectionName, "relaxationEngine", "mas");
+		int nbThread = this->template loadOr<int>(sectionName, "nbThread", 0);
+		int maxNumberOfStep = this->template loadOr<int>(sectionName, "maxNumberOfStep", 1000);
+		std::string spatialDataStructure = this->template loadOr<std::string>(sectionName, "spatialDataStructure", "delaunay");
+		double checkpointPeriod = this->template loadOr<double>(sectionName, "checkpointPeriod", 0.);
 
 		this->objToFill->SetSimulationProperties(duration, numberOfAgentToExecute, displacementThreshold, stepDuration);
+		this->objToFill->SetRelaxationEngine(relaxationEngine, nbThread, maxNumberOfStep);
+		this->objToFill->SetSpatialDataStructure(spatialDataStructure);
+		this->objToFill->SetCheckpointPeriod(checkpointPeriod);
 	}
 };
 
@@ -30,7 +30,9 @@
 #ifndef B6_SPHEROID_SECTION_H
 #define B6_SPHEROID_SECTION_H
 
-#include <cReader/sectionreader.hh>
+#include <string>
+
+#include "optionalSectionReader.hh"
 
 // How to create your own configuration reader to build a T object
 /* 1) Declare a ConfigReader object
@@ -70,11 +72,17 @@
 /// SpheroidSection class
 ///
 /// It contains the spheroid properties.
+///
+/// Optional keys:
+///  - distribution  : initial placement of the cells, "random" (default, CPOP Distribution::RANDOM),
+///                    "poissonDisk" or "lattice" (see initialPlacement.hh)
+///  - latticeJitter : moves of the lattice sites, as a fraction of the lattice spacing (default 0.1)
+///  - seed          : seed of the random engines used to create and place the cells (default 1234567)
 
 namespace B6 {
 
 template<typename T>
-class SpheroidSection: public conf::SectionReader<T> {
+class SpheroidSection: public OptionalSectionReader<T> {
 public:
 	void fill() override {
 		const char sectionName[] = "SpheroidProperties";
@@ -83,7 +91,11 @@ public:
 		double externalRadius = this->template load<double>(sectionName, "externalRadius");
 		int nbCell = this->template load<int>(sectionName, "nbCell");
 
-		this->objToFill->SetSpheroidProperties(internalRadius, externalRadius, nbCell);
+		std::string distribution = this->template loadOr<std::string>(sectionName, "distribution", "random");
+		double latticeJitter = this->template loadOr<double>(sectionName, "latticeJitter", 0.1);
+		int seed = this->template loadOr<int>(sectionName, "seed", 1234567);
+
+		this->objToFill->SetSpheroidProperties(internalRadius, externalRadius, nbCell, distribution, latticeJitter, seed);
 	}
 };
 
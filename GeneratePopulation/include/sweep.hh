@@ -0,0 +1,72 @@
+/// \file sweep.hh
+/// \brief Definition of the B6::Sweep class
+
+#ifndef B6_SWEEP_H
+#define B6_SWEEP_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+/// Sweep class
+///
+/// Families of populations described by a single configuration file: a key
+/// given several values is a sweep axis, and one population is generated for
+/// each combination of the values (cartesian product), for example
+///   nbCell = 18124 36000 60000
+///   seed   = 1 2
+/// gives 6 populations. Keys which already take two values (nucleusRadius and
+/// membraneRadius) separate their alternatives with '|':
+///   membraneRadius = 6.9 6.9 | 7.5 7.5
+///
+/// Each combination is written as its own configuration file, named after the
+/// swept values (exampleConfig_nbCell-18124_seed-1.cfg), so that its outputs are
+/// <that file>.xml, .cpopb and .off as for a single generation. The combinations
+/// are generated concurrently by forked processes, which share everything set up
+/// before the fork (materials, units) instead of starting a new process each.
+
+namespace B6 {
+
+class Sweep {
+public:
+	struct Combination {
+		std::string configFile;  // derived configuration file
+		std::string parameters;  // swept values, "[Section] key = value" separated by ", "
+		std::string content;     // content of configFile
+	};
+
+	explicit Sweep(const std::string& configFile);
+
+	/// True if at least one key has several values
+	[[nodiscard]] bool IsSweep() const { return !fAxes.empty(); }
+
+	/// Number of combinations, 1 if the file is not a sweep
+	[[nodiscard]] std::size_t size() const;
+
+	[[nodiscard]] Combination Get(std::size_t index) const;
+
+	/// Write every combination and call generate(configFile, parameters) for each of them in a
+	/// child process, at most nbCore at once. Returns the number of failed combinations
+	std::size_t Run(unsigned nbCore, const std::function<int(const std::string&, const std::string&)>& generate) const;
+
+	/// Record the parameters of a combination in a comment of the generated xml
+	static void RecordParameters(const std::string& xmlFile, const std::string& parameters);
+
+private:
+	struct Axis {
+		std::size_t line;                 // index in fLines of the key
+		std::string section;
+		std::string key;
+		std::string prefix;               // "key = " as written in the file
+		std::vector<std::string> values;
+	};
+
+	std::string fConfigFile;
+	std::vector<std::string> fLines;
+	std::vector<Axis> fAxes;
+};
+
+}
+
+#endif
@@ -0,0 +1,109 @@
+#include "elasticRelaxation.hh"
+
+#include <algorithm>
+#include <cmath>
+
+#include "ParallelFor.hh"
+#include "neighbourSearch.hh"
+
+namespace B6 {
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ElasticRelaxation::ElasticRelaxation(const Parameters& parameters):
+	fParameters(parameters)
+{
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::size_t ElasticRelaxation::Run(
+	std::vector<Point>& positions, const std::vector<double>& radii, const Progress& start, const StepCallback& onStep
+) const {
+	std::size_t const nCell = positions.size();
+	if(nCell == 0)
+		return 0;
+
+	unsigned const nThread = Common::ResolveThreadCount(fParameters.nbThread);
+	double const maxRadius = *std::max_element(std::begin(radii), std::end(radii));
+	double const dt = fParameters.stepDuration;
+
+	std::vector<Point> displacements(nCell);
+	std::vector<double> chunkMaxDisplacement(nThread);
+	// the threads are created once for all the steps, two passes a step being too short to create them each time
+	Common::WorkerPool pool(nThread);
+	auto search = NeighbourSearch::Create(fParameters.spatialDataStructure);
+
+	std::size_t step = start.step;
+	for(double time = start.time; fParameters.duration <= 0. || time < fParameters.duration; time += dt) {
+		search->Build(positions, maxRadius);
+
+		// 1) displacement of each cell, positions are read only
+		pool.For(nCell, [&](std::size_t begin, std::size_t end, unsigned) {
+			std::vector<std::size_t> neighbours;
+			for(std::size_t i = begin; i < end; ++i) {
+				Point const& pi = positions[i];
+				Point force{0., 0., 0.};
+				search->Neighbours(i, neighbours);
+				for(auto const j: neighbours) {
+					Point const& pj = positions[j];
+					double const dx = pi[0] - pj[0];
+					double const dy = pi[1] - pj[1];
+					double const dz = pi[2] - pj[2];
+					double const distance = std::sqrt(dx*dx + dy*dy + dz*dz);
+					double const contact = radii[i] + radii[j];
+					if(distance >= contact || distance == 0.)
+						continue;
+
+					double const stableLength = fParameters.ratioToStableLength*contact;
+					double const intensity = fParameters.rigidity*(stableLength - distance)/distance;
+					force[0] += intensity*dx;
+					force[1] += intensity*dy;
+					force[2] += intensity*dz;
+				}
+
+				for(int axis = 0; axis < 3; ++axis)
+					displacements[i][axis] = force[axis]*dt;
+			}
+		});
+
+		// 2) move the cells, keeping them inside the spheroid shell
+		std::fill(std::begin(chunkMaxDisplacement), std::end(chunkMaxDisplacement), 0.);
+		pool.For(nCell, [&](std::size_t begin, std::size_t end, unsigned chunk) {
+			double maxDisplacement = 0.;
+			for(std::size_t i = begin; i < end; ++i) {
+				Point const old = positions[i];
+				Point p{old[0] + displacements[i][0], old[1] + displacements[i][1], old[2] + displacements[i][2]};
+
+				double const r = std::sqrt(p[0]*p[0] + p[1]*p[1] + p[2]*p[2]);
+				double const clamped = std::clamp(r, fParameters.internalRadius, fParameters.externalRadius);
+				if(r > 0. && clamped != r)
+					for(auto& coordinate: p)
+						coordinate *= clamped/r;
+
+				double const dx = p[0] - old[0];
+				double const dy = p[1] - old[1];
+				double const dz = p[2] - old[2];
+				maxDisplacement = std::max(maxDisplacement, std::sqrt(dx*dx + dy*dy + dz*dz));
+				positions[i] = p;
+			}
+			chunkMaxDisplacement[chunk] = maxDisplacement;
+		});
+
+		++step;
+		double const maxDisplacement = *std::max_element(std::begin(chunkMaxDisplacement), std::end(chunkMaxDisplacement));
+		bool const done = (fParameters.maxStep > 0 && step >= static_cast<std::size_t>(fParameters.maxStep))
+			|| maxDisplacement < fParameters.displacementThreshold
+			|| (fParameters.duration > 0. && time + dt >= fParameters.duration);
+
+		// the time is the one the next iteration starts from
+		if(onStep)
+			onStep(positions, {step, time + dt, maxDisplacement, done});
+		if(done)
+			break;
+	}
+
+	return step;
+}
+
+}
@@ -0,0 +1,171 @@
+#include "initialPlacement.hh"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <iterator>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+
+namespace B6 {
+
+namespace {
+
+/// Failed attempts before a cell lowers the Poisson disk spacing
+constexpr int MaxAttempt = 30;
+/// Spacing factor applied after MaxAttempt failed attempts
+constexpr double SpacingDecrease = 0.97;
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+bool InitialPlacement::Parse(const std::string& name, Type& type) {
+	std::string input = name;
+	// transforms the input string to lowercase to be case insensitive
+	std::transform(std::begin(input), std::end(input), std::begin(input), ::tolower);
+
+	if(input == "random")
+		type = Type::Random;
+	else if(input == "poissondisk")
+		type = Type::PoissonDisk;
+	else if(input == "lattice")
+		type = Type::Lattice;
+	else
+		return false;
+	return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+InitialPlacement::InitialPlacement(double internalRadius, double externalRadius, std::uint64_t seed):
+	fInternalRadius(internalRadius),
+	fExternalRadius(externalRadius),
+	fSeed(seed)
+{
+	if(externalRadius <= internalRadius)
+		throw std::runtime_error("the external radius of the spheroid must be greater than its internal radius");
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+bool InitialPlacement::InShell(const Point& p) const {
+	double const r2 = p[0]*p[0] + p[1]*p[1] + p[2]*p[2];
+	return r2 >= fInternalRadius*fInternalRadius && r2 <= fExternalRadius*fExternalRadius;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::vector<InitialPlacement::Point> InitialPlacement::PoissonDisk(const std::vector<double>& radii) {
+	std::vector<Point> positions(radii.size());
+	fSpacing = 1.;
+	if(radii.empty())
+		return positions;
+
+	std::mt19937_64 engine(fSeed);
+	std::uniform_real_distribution<double> uniform(-fExternalRadius, fExternalRadius);
+
+	// spatial hash: with cubes of the largest contact distance, the cells closer than
+	// spacing * (ri + rj) to a point are in the 27 cubes around it
+	double const cubeSize = std::max(2.*(*std::max_element(std::begin(radii), std::end(radii))), 1e-9);
+	long const dim = static_cast<long>(2.*fExternalRadius/cubeSize) + 1;
+	std::vector<std::vector<std::size_t>> cubes(dim*dim*dim);
+	auto const coordinate = [&](double x) { return std::clamp(static_cast<long>((x + fExternalRadius)/cubeSize), 0L, dim-1); };
+
+	// the largest cells are the hardest to place
+	std::vector<std::size_t> order(radii.size());
+	std::iota(std::begin(order), std::end(order), 0);
+	std::stable_sort(std::begin(order), std::end(order), [&radii](std::size_t a, std::size_t b) { return radii[a] > radii[b]; });
+
+	for(auto const i: order) {
+		int attempt = 0;
+		while(true) {
+			Point const p{uniform(engine), uniform(engine), uniform(engine)};
+			if(!InShell(p))
+				continue;
+
+			long const c[3] = {coordinate(p[0]), coordinate(p[1]), coordinate(p[2])};
+			bool free = true;
+			for(long x = std::max(0L, c[0]-1); free && x <= std::min(dim-1, c[0]+1); ++x)
+				for(long y = std::max(0L, c[1]-1); free && y <= std::min(dim-1, c[1]+1); ++y)
+					for(long z = std::max(0L, c[2]-1); free && z <= std::min(dim-1, c[2]+1); ++z)
+						for(auto const j: cubes[(x*dim + y)*dim + z]) {
+							double const dx = p[0] - positions[j][0];
+							double const dy = p[1] - positions[j][1];
+							double const dz = p[2] - positions[j][2];
+							double const minDistance = fSpacing*(radii[i] + radii[j]);
+							if(dx*dx + dy*dy + dz*dz < minDistance*minDistance) {
+								free = false;
+								break;
+							}
+						}
+
+			if(free) {
+				positions[i] = p;
+				cubes[(c[0]*dim + c[1])*dim + c[2]].push_back(i);
+				break;
+			}
+			if(++attempt == MaxAttempt) {
+				fSpacing *= SpacingDecrease;
+				attempt = 0;
+			}
+		}
+	}
+	return positions;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::vector<InitialPlacement::Point> InitialPlacement::JitteredLattice(std::size_t nbCell, double jitter) const {
+	std::vector<Point> sites;
+	if(nbCell == 0)
+		return sites;
+
+	// face centered cubic lattice: 4 sites per cube of side a, a being lowered until the shell holds nbCell sites
+	double const pi = std::acos(-1.);
+	double const shellVolume = 4./3.*pi*(std::pow(fExternalRadius, 3) - std::pow(fInternalRadius, 3));
+	double a = std::cbrt(4.*shellVolume/nbCell);
+	Point const basis[4] = {Point{0., 0., 0.}, Point{0., .5, .5}, Point{.5, 0., .5}, Point{.5, .5, 0.}};
+
+	while(true) {
+		sites.clear();
+		long const n = static_cast<long>(fExternalRadius/a) + 1;
+		for(long x = -n; x <= n; ++x)
+			for(long y = -n; y <= n; ++y)
+				for(long z = -n; z <= n; ++z)
+					for(auto const& offset: basis) {
+						Point const p{(x + offset[0])*a, (y + offset[1])*a, (z + offset[2])*a};
+						if(InShell(p))
+							sites.push_back(p);
+					}
+		if(sites.size() >= nbCell)
+			break;
+		a *= 0.99;
+	}
+
+	// keep nbCell sites taken at random, in lattice order
+	std::mt19937_64 engine(fSeed);
+	std::vector<std::size_t> chosen(sites.size());
+	std::iota(std::begin(chosen), std::end(chosen), 0);
+	std::shuffle(std::begin(chosen), std::end(chosen), engine);
+	chosen.resize(nbCell);
+	std::sort(std::begin(chosen), std::end(chosen));
+
+	std::uniform_real_distribution<double> uniform(-1., 1.);
+	std::vector<Point> positions;
+	positions.reserve(nbCell);
+	for(auto const s: chosen) {
+		// uniform move in a ball, the site is kept if the move leaves the shell
+		Point move;
+		do {
+			move = {uniform(engine), uniform(engine), uniform(engine)};
+		} while(move[0]*move[0] + move[1]*move[1] + move[2]*move[2] > 1.);
+
+		Point const p{sites[s][0] + jitter*a*move[0], sites[s][1] + jitter*a*move[1], sites[s][2] + jitter*a*move[2]};
+		positions.push_back(InShell(p) ? p : sites[s]);
+	}
+	return positions;
+}
+
+}
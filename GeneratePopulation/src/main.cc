@@ -11,38 +11,21 @@
 #include "forceSection.hh"
 #include "simulationSection.hh"
 
+// Binary population format
+#include "PopulationBinary.hh"
+
 // Header containing everything required to create a population
 #include "simulationEnvironment.hh"
 
-using namespace zz;
-
-int main(int argc, char** argv) {
-	// First we add an argument parser to simplify the use of the population generator
-	zz::cfg::ArgParser argparser;
-
-	// Generate visualization file. Specify option --vis in the command line. This is an optional flag
-	bool vis = false;
-	argparser.add_opt_flag(-1,"vis","generate off file to visualize population", &vis);
-
-	// Get the configuration file from the command line. Specify option -f <fileName>
-	std::string input;
-	auto inputArg = argparser.add_opt_value('f', "", input, std::string("input_filename.cfg"), "configuration file", "file").require();
-
-	//Retrieve arguments from command line
-	argparser.parse(argc, argv);
+// Several populations from a single configuration file
+#include "ParallelFor.hh"
+#include "sweep.hh"
 
-	// check errors
-	if (argparser.count_error() > 0)
-	{
-		std::cout << argparser.get_error() << std::endl;
-		std::cout << argparser.get_help() << std::endl;
-		return 1;
-	}
-
-	// Extract the basename of the input file in order to create output files
-	// Example : ../config.cfg will produce config.xml (and config.off if --vis is used)
-	std::string basename =  zz::os::path_split_basename(input);
+using namespace zz;
 
+/// Generate the population described by the configuration file input,
+/// parameters being the swept values recorded in the xml (empty outside of a sweep)
+int Generate(const std::string& input, bool vis, bool resume, bool trace, const std::string& parameters) {
 	// Create the configuration file
 	// Each section read one part of the configuration file
 
@@ -73,20 +56,95 @@ int main(int argc, char** argv) {
 	// (documentation in simulationEnvironment.hh and simulationEnvironment.cc)
 	auto* simulationEnv = reader.parse(input.c_str());
 
+	// Checkpoints of the relaxation are written next to the configuration file,
+	// --resume continues from the last one instead of starting over
+	simulationEnv->SetCheckpoint(input + ".checkpoint", resume);
+
+	// Record the displacement of every relaxation step in the report (parallel engine only)
+	auto& report = simulationEnv->Report();
+	if(trace)
+		report.EnableTrace("relaxation", {"step", "time", "maxDisplacement"});
+
 	// Start the simulation to apply elastic force
 	simulationEnv->StartSimulation();
 
 	// Save the generated cell population in an xml file
 	std::string outputPop = input + ".xml";
 	simulationEnv->SavePopulation(outputPop.c_str());
+	if(!parameters.empty())
+		B6::Sweep::RecordParameters(outputPop, parameters);
 	std::cout << "Generated : "<< outputPop << std::endl;
 
-	// If vis flag is used, create an off file
+	// Save it again in the binary format, which can be memory mapped by the radiation examples
+	// (/cpop/population/inputBinary) instead of parsing the xml, with the cells of the simulation
+	std::string outputBin = input + Common::PopulationBinary::Extension;
+	simulationEnv->SavePopulationBinary(outputPop, outputBin);
+	std::cout << "Generated : "<< outputBin << std::endl;
+
+	// If vis flag is used, create an off (or ply) file
 	if (vis) {
-		std::string outputOff = input + ".off";
-		simulationEnv->ExportToVis(input.c_str());
-		std::cout << "Generated : "<< outputOff << std::endl;
+		std::string outputVis = simulationEnv->ExportToVis(input.c_str());
+		std::cout << "Generated : "<< outputVis << std::endl;
 	}
 
+	// Wall time, CPU time and memory of each phase of the generation
+	std::string outputReport = input + ".report.json";
+	report.WriteJson(outputReport);
+	std::cout << "Generated : "<< outputReport << std::endl;
+
 	delete simulationEnv;
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	// First we add an argument parser to simplify the use of the population generator
+	zz::cfg::ArgParser argparser;
+
+	// Generate visualization file. Specify option --vis in the command line. This is an optional flag
+	bool vis = false;
+	argparser.add_opt_flag(-1,"vis","generate off file to visualize population", &vis);
+
+	// Continue an interrupted relaxation from its last checkpoint. This is an optional flag
+	bool resume = false;
+	argparser.add_opt_flag(-1,"resume","continue from the last checkpoint", &resume);
+
+	// Trace every relaxation step in the json report. This is an optional flag
+	bool trace = false;
+	argparser.add_opt_flag(-1,"trace","trace the relaxation steps in the report", &trace);
+
+	// Get the configuration file from the command line. Specify option -f <fileName>
+	std::string input;
+	auto inputArg = argparser.add_opt_value('f', "", input, std::string("input_filename.cfg"), "configuration file", "file").require();
+
+	// Number of populations generated at once when the configuration file is a sweep (0 for one per core)
+	int nbCore = 0;
+	argparser.add_opt_value('j', "cores", nbCore, 0, "core budget of a sweep", "int");
+
+	//Retrieve arguments from command line
+	argparser.parse(argc, argv);
+
+	// check errors
+	if (argparser.count_error() > 0)
+	{
+		std::cout << argparser.get_error() << std::endl;
+		std::cout << argparser.get_help() << std::endl;
+		return 1;
+	}
+
+	// Extract the basename of the input file in order to create output files
+	// Example : ../config.cfg will produce config.xml (and config.off if --vis is used)
+	std::string basename =  zz::os::path_split_basename(input);
+
+	// A key given several values makes a sweep: one population per combination of values
+	// (documentation in sweep.hh)
+	B6::Sweep sweep(input);
+	if(!sweep.IsSweep())
+		return Generate(input, vis, resume, trace, "");
+
+	// materials are built once, before the generations are forked
+	B6::SimulationEnvironment::PrepareMaterials();
+	auto generate = [vis, resume, trace](const std::string& configFile, const std::string& parameters) {
+		return Generate(configFile, vis, resume, trace, parameters);
+	};
+	return sweep.Run(Common::ResolveThreadCount(nbCore), generate) == 0 ? 0 : 1;
 }
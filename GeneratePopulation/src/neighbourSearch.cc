@@ -0,0 +1,100 @@
+#include "neighbourSearch.hh"
+
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+
+#include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
+#include <CGAL/Delaunay_triangulation_3.h>
+#include <CGAL/Delaunay_triangulation_cell_base_3.h>
+#include <CGAL/Triangulation_vertex_base_with_info_3.h>
+
+namespace B6 {
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::unique_ptr<NeighbourSearch> NeighbourSearch::Create(const std::string& name) {
+	std::string input = name;
+	// transforms the input string to lowercase to be case insensitive
+	std::transform(std::begin(input), std::end(input), std::begin(input), ::tolower);
+
+	if(input == "delaunay")
+		return Create(Type::Delaunay);
+	if(input == "grid")
+		return Create(Type::Grid);
+	return nullptr;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::unique_ptr<NeighbourSearch> NeighbourSearch::Create(Type type) {
+	switch(type) {
+		case Type::Delaunay: return std::make_unique<DelaunayNeighbourSearch>();
+		case Type::Grid: return std::make_unique<GridNeighbourSearch>();
+	}
+	return nullptr;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void GridNeighbourSearch::Build(const std::vector<Point>& positions, double maxRadius) {
+	fPositions = &positions;
+	// two cells can only be in contact if they are in adjacent grid cells
+	fGrid.Build(positions.size(), [&positions](std::size_t i) -> const Point& { return positions[i]; }, 2*maxRadius);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void GridNeighbourSearch::Neighbours(std::size_t i, std::vector<std::size_t>& neighbours) const {
+	neighbours.clear();
+	fGrid.ForEachCandidate((*fPositions)[i], [&](std::size_t j) {
+		if(j != i)
+			neighbours.push_back(j);
+	});
+	std::sort(std::begin(neighbours), std::end(neighbours));
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DelaunayNeighbourSearch::Build(const std::vector<Point>& positions, double) {
+	using Kernel = CGAL::Exact_predicates_inexact_constructions_kernel;
+	using Vb = CGAL::Triangulation_vertex_base_with_info_3<std::size_t, Kernel>;
+	using Cb = CGAL::Delaunay_triangulation_cell_base_3<Kernel>;
+	using Tds = CGAL::Triangulation_data_structure_3<Vb, Cb>;
+	using Delaunay = CGAL::Delaunay_triangulation_3<Kernel, Tds>;
+
+	std::vector<std::pair<Delaunay::Point, std::size_t>> points;
+	points.reserve(positions.size());
+	for(std::size_t i = 0; i < positions.size(); ++i)
+		points.emplace_back(Delaunay::Point(positions[i][0], positions[i][1], positions[i][2]), i);
+
+	Delaunay const triangulation(std::begin(points), std::end(points));
+
+	// adjacency lists, cells sharing a position with another one have no vertex and so no neighbour
+	std::vector<std::vector<std::size_t>> adjacent(positions.size());
+	std::vector<Delaunay::Vertex_handle> vertices;
+	for(auto v = triangulation.finite_vertices_begin(); v != triangulation.finite_vertices_end(); ++v) {
+		vertices.clear();
+		triangulation.finite_adjacent_vertices(v, std::back_inserter(vertices));
+
+		auto& list = adjacent[v->info()];
+		for(auto const& w: vertices)
+			list.push_back(w->info());
+		std::sort(std::begin(list), std::end(list));
+	}
+
+	fStart.assign(1, 0);
+	fAdjacent.clear();
+	for(auto const& list: adjacent) {
+		fAdjacent.insert(std::end(fAdjacent), std::begin(list), std::end(list));
+		fStart.push_back(fAdjacent.size());
+	}
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DelaunayNeighbourSearch::Neighbours(std::size_t i, std::vector<std::size_t>& neighbours) const {
+	neighbours.assign(std::begin(fAdjacent) + fStart[i], std::begin(fAdjacent) + fStart[i+1]);
+}
+
+}
@@ -0,0 +1,119 @@
+// Number of relaxation steps needed from each initial placement (see initialPlacement.hh).
+//
+// For each population size, the cells (all of the same membrane radius) are placed
+// in a spheroid keeping the density of exampleConfig.cfg, then relaxed by
+// B6::ElasticRelaxation (grid neighbour search) until no cell moves more than the
+// displacement threshold (or maxStep steps, reported as "> maxStep").
+// "random" draws the centers uniformly in the spheroid, as Distribution::RANDOM does.
+//
+// It prints, for each placement:
+//  - place : time to compute the initial positions;
+//  - steps : relaxation steps needed to reach the threshold;
+//  - relax : wall time of the relaxation.
+
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+
+// CPOP headers
+#include <cReader/zupply.hpp>
+
+#include "elasticRelaxation.hh"
+#include "initialPlacement.hh"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double Seconds(Clock::time_point start) {
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+std::vector<B6::InitialPlacement::Point> UniformCells(std::size_t nbCell, double externalRadius) {
+	std::mt19937_64 engine(1234567);
+	std::uniform_real_distribution<double> uniform(-externalRadius, externalRadius);
+
+	std::vector<B6::InitialPlacement::Point> positions;
+	positions.reserve(nbCell);
+	while(positions.size() < nbCell) {
+		B6::InitialPlacement::Point p{uniform(engine), uniform(engine), uniform(engine)};
+		if(p[0]*p[0] + p[1]*p[1] + p[2]*p[2] <= externalRadius*externalRadius)
+			positions.push_back(p);
+	}
+	return positions;
+}
+
+}
+
+int main(int argc, char** argv) {
+	zz::cfg::ArgParser argparser;
+
+	std::string sizes;
+	argparser.add_opt_value('n', "nbCell", sizes, std::string("2000 5000"), "population sizes", "\"int ...\"");
+	int nbThread = 0;
+	argparser.add_opt_value('t', "thread", nbThread, 0, "number of threads (0 for all of them)", "int");
+	double threshold = 0.1;
+	argparser.add_opt_value('d', "displacementThreshold", threshold, 0.1, "displacement threshold (um)", "double");
+	double density = 0.5;
+	argparser.add_opt_value('c', "compaction", density, 0.5, "cells volume over spheroid volume", "double");
+	double rigidity = 0.05;
+	argparser.add_opt_value('r', "rigidity", rigidity, 0.05, "rigidity of the elastic force", "double");
+	int maxStep = 5000;
+	argparser.add_opt_value('m', "maxStep", maxStep, 5000, "maximum number of relaxation steps", "int");
+
+	argparser.parse(argc, argv);
+
+	if(argparser.count_error() > 0) {
+		std::cout << argparser.get_error() << std::endl;
+		std::cout << argparser.get_help() << std::endl;
+		return 1;
+	}
+
+	double const membraneRadius = 6.9;
+
+	std::cout << std::setw(10) << "nbCell" << std::setw(14) << "placement"
+		<< std::setw(12) << "place (s)" << std::setw(10) << "steps" << std::setw(12) << "relax (s)" << std::endl;
+
+	std::istringstream sizeStream(sizes);
+	std::size_t nbCell = 0;
+	while(sizeStream >> nbCell) {
+		double const externalRadius = membraneRadius*std::cbrt(nbCell/density);
+		std::vector<double> const radii(nbCell, membraneRadius);
+
+		for(auto const name: {"random", "poissonDisk", "lattice"}) {
+			B6::InitialPlacement::Type type = B6::InitialPlacement::Type::Random;
+			B6::InitialPlacement::Parse(name, type);
+			B6::InitialPlacement placement(0., externalRadius);
+
+			auto start = Clock::now();
+			std::vector<B6::InitialPlacement::Point> positions;
+			switch(type) {
+				case B6::InitialPlacement::Type::Random: positions = UniformCells(nbCell, externalRadius); break;
+				case B6::InitialPlacement::Type::PoissonDisk: positions = placement.PoissonDisk(radii); break;
+				case B6::InitialPlacement::Type::Lattice: positions = placement.JitteredLattice(nbCell, 0.1); break;
+			}
+			double const placeTime = Seconds(start);
+
+			B6::ElasticRelaxation::Parameters parameters;
+			parameters.rigidity = rigidity;
+			parameters.ratioToStableLength = 0.7;
+			parameters.maxStep = maxStep;
+			parameters.displacementThreshold = threshold;
+			parameters.externalRadius = externalRadius;
+			parameters.nbThread = nbThread;
+			parameters.spatialDataStructure = B6::NeighbourSearch::Type::Grid;
+
+			start = Clock::now();
+			std::size_t const nbStep = B6::ElasticRelaxation(parameters).Run(positions, radii);
+			double const relaxTime = Seconds(start);
+
+			std::string const steps = (nbStep >= static_cast<std::size_t>(maxStep) ? "> " : "") + std::to_string(nbStep);
+			std::cout << std::setw(10) << nbCell << std::setw(14) << name
+				<< std::setw(12) << placeTime << std::setw(10) << steps << std::setw(12) << relaxTime << std::endl;
+		}
+	}
+}
@@ -0,0 +1,116 @@
+// Compare the spatial data structures available to the parallel relaxation engine
+// (see neighbourSearch.hh) on random spheroids of increasing size.
+//
+// For each population size and structure, it prints:
+//  - build   : time to build the structure once;
+//  - queries : neighbour queries per second (one query per cell, on nbThread threads);
+//  - relax   : wall time of nbStep relaxation steps (structure rebuilt at each step).
+
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+// CPOP headers
+#include <cReader/zupply.hpp>
+
+#include "ParallelFor.hh"
+#include "elasticRelaxation.hh"
+#include "neighbourSearch.hh"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double Seconds(Clock::time_point start) {
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+/// Uniform random cells in a sphere whose radius keeps the density of Radius95um_50CP.cfg.xml
+std::vector<B6::NeighbourSearch::Point> RandomCells(std::size_t nbCell, double& externalRadius) {
+	externalRadius = 95.*std::cbrt(nbCell/5000.);
+
+	std::mt19937_64 engine(1234567);
+	std::uniform_real_distribution<double> uniform(-externalRadius, externalRadius);
+
+	std::vector<B6::NeighbourSearch::Point> positions;
+	positions.reserve(nbCell);
+	while(positions.size() < nbCell) {
+		B6::NeighbourSearch::Point p{uniform(engine), uniform(engine), uniform(engine)};
+		if(p[0]*p[0] + p[1]*p[1] + p[2]*p[2] <= externalRadius*externalRadius)
+			positions.push_back(p);
+	}
+	return positions;
+}
+
+}
+
+int main(int argc, char** argv) {
+	zz::cfg::ArgParser argparser;
+
+	std::string sizes;
+	argparser.add_opt_value('n', "nbCell", sizes, std::string("10000 60000 250000"), "population sizes", "\"int ...\"");
+	int nbThread = 0;
+	argparser.add_opt_value('t', "thread", nbThread, 0, "number of threads (0 for all of them)", "int");
+	int nbStep = 10;
+	argparser.add_opt_value('s', "step", nbStep, 10, "number of relaxation steps", "int");
+
+	argparser.parse(argc, argv);
+
+	if(argparser.count_error() > 0) {
+		std::cout << argparser.get_error() << std::endl;
+		std::cout << argparser.get_help() << std::endl;
+		return 1;
+	}
+
+	double const membraneRadius = 6.9;
+	unsigned const nThread = Common::ResolveThreadCount(nbThread);
+
+	std::cout << std::setw(10) << "nbCell" << std::setw(10) << "structure"
+		<< std::setw(12) << "build (s)" << std::setw(16) << "queries (/s)" << std::setw(12) << "relax (s)" << std::endl;
+
+	std::istringstream sizeStream(sizes);
+	std::size_t nbCell = 0;
+	while(sizeStream >> nbCell) {
+		double externalRadius = 0.;
+		auto const cells = RandomCells(nbCell, externalRadius);
+		std::vector<double> const radii(nbCell, membraneRadius);
+
+		for(auto const type: {B6::NeighbourSearch::Type::Delaunay, B6::NeighbourSearch::Type::Grid}) {
+			auto search = B6::NeighbourSearch::Create(type);
+
+			auto start = Clock::now();
+			search->Build(cells, membraneRadius);
+			double const buildTime = Seconds(start);
+
+			start = Clock::now();
+			std::vector<std::size_t> found(nThread, 0);
+			Common::ParallelFor(nbCell, nThread, [&](std::size_t begin, std::size_t end, unsigned chunk) {
+				std::vector<std::size_t> neighbours;
+				for(std::size_t i = begin; i < end; ++i) {
+					search->Neighbours(i, neighbours);
+					found[chunk] += neighbours.size();
+				}
+			});
+			double const queryTime = Seconds(start);
+
+			B6::ElasticRelaxation::Parameters parameters;
+			parameters.rigidity = 0.002;
+			parameters.ratioToStableLength = 0.7;
+			parameters.maxStep = nbStep;
+			parameters.externalRadius = externalRadius;
+			parameters.nbThread = nbThread;
+			parameters.spatialDataStructure = type;
+
+			auto positions = cells;
+			start = Clock::now();
+			B6::ElasticRelaxation(parameters).Run(positions, radii);
+			double const relaxTime = Seconds(start);
+
+			std::cout << std::setw(10) << nbCell << std::setw(10) << search->Name()
+				<< std::setw(12) << buildTime << std::setw(16) << nbCell/queryTime << std::setw(12) << relaxTime << std::endl;
+		}
+	}
+}
@@ -0,0 +1,161 @@
+#include "relaxationCheckpoint.hh"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "PopulationBinary.hh"
+
+namespace B6 {
+
+namespace {
+
+constexpr char Magic[8] = {'C', 'P', 'O', 'P', 'C', 'K', 'P', 'T'};
+constexpr std::uint32_t Version = 2;
+// only B6::ElasticRelaxation writes checkpoints
+constexpr std::uint32_t ParallelEngine = 1;
+
+/// Fixed size part of the file, followed by the positions and the checksum of everything before it
+struct Header {
+	char magic[8];
+	std::uint32_t version;
+	std::uint32_t pointSize;
+	std::uint64_t cellCount;
+	std::uint64_t step;
+	double time;
+	std::uint64_t seed;
+	std::uint64_t radiiChecksum;
+	std::uint32_t engine;
+	std::uint32_t spatialDataStructure;
+	double rigidity;
+	double ratioToStableLength;
+	double stepDuration;
+	double internalRadius;
+	double externalRadius;
+};
+
+template<typename T>
+void Append(std::vector<char>& buffer, const T& value) {
+	auto const* bytes = reinterpret_cast<const char*>(&value);
+	buffer.insert(std::end(buffer), bytes, bytes + sizeof(T));
+}
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void RelaxationCheckpoint::Write(const std::string& filename) const {
+	Header header{};
+	std::memcpy(header.magic, Magic, sizeof(Magic));
+	header.version = Version;
+	header.pointSize = sizeof(ElasticRelaxation::Point);
+	header.cellCount = positions.size();
+	header.step = progress.step;
+	header.time = progress.time;
+	header.seed = seed;
+	header.radiiChecksum = radiiChecksum;
+	header.engine = ParallelEngine;
+	header.spatialDataStructure = static_cast<std::uint32_t>(parameters.spatialDataStructure);
+	header.rigidity = parameters.rigidity;
+	header.ratioToStableLength = parameters.ratioToStableLength;
+	header.stepDuration = parameters.stepDuration;
+	header.internalRadius = parameters.internalRadius;
+	header.externalRadius = parameters.externalRadius;
+
+	std::vector<char> buffer;
+	buffer.reserve(sizeof(Header) + positions.size()*sizeof(ElasticRelaxation::Point) + sizeof(std::uint64_t));
+	Append(buffer, header);
+	for(auto const& p: positions)
+		Append(buffer, p);
+	Append(buffer, Common::PopulationBinary::checksum(buffer.data(), buffer.size()));
+
+	// the previous checkpoint is only replaced by a complete one
+	std::string const tmpFilename = filename + ".tmp";
+	int const fd = ::open(tmpFilename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(fd < 0)
+		throw std::runtime_error("Checkpoint: unable to open " + tmpFilename);
+	std::size_t written = 0;
+	while(written < buffer.size()) {
+		ssize_t const n = ::write(fd, buffer.data() + written, buffer.size() - written);
+		if(n <= 0)
+			break;
+		written += static_cast<std::size_t>(n);
+	}
+	bool const synced = written == buffer.size() && ::fsync(fd) == 0;
+	::close(fd);
+	if(!synced)
+		throw std::runtime_error("Checkpoint: unable to write " + tmpFilename);
+
+	if(std::rename(tmpFilename.c_str(), filename.c_str()) != 0)
+		throw std::runtime_error("Checkpoint: unable to rename " + tmpFilename + " to " + filename);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+bool RelaxationCheckpoint::Read(const std::string& filename, RelaxationCheckpoint& checkpoint) {
+	std::ifstream in(filename, std::ios::binary);
+	if(!in)
+		return false;
+	std::vector<char> const buffer{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+
+	Header header{};
+	if(buffer.size() < sizeof(Header) + sizeof(std::uint64_t))
+		throw std::runtime_error("Checkpoint: " + filename + " is truncated");
+	std::memcpy(&header, buffer.data(), sizeof(Header));
+	if(std::memcmp(header.magic, Magic, sizeof(Magic)) != 0)
+		throw std::runtime_error("Checkpoint: " + filename + " is not a relaxation checkpoint");
+	if(header.version != Version || header.pointSize != sizeof(ElasticRelaxation::Point))
+		throw std::runtime_error("Checkpoint: " + filename + " has an unsupported version");
+	if(header.engine != ParallelEngine)
+		throw std::runtime_error("Checkpoint: " + filename + " was written by an unknown relaxation engine");
+	if(buffer.size() != sizeof(Header) + header.cellCount*sizeof(ElasticRelaxation::Point) + sizeof(std::uint64_t))
+		throw std::runtime_error("Checkpoint: " + filename + " is truncated");
+
+	std::uint64_t stored = 0;
+	std::memcpy(&stored, buffer.data() + buffer.size() - sizeof(stored), sizeof(stored));
+	if(stored != Common::PopulationBinary::checksum(buffer.data(), buffer.size() - sizeof(stored)))
+		throw std::runtime_error("Checkpoint: " + filename + " is corrupted");
+
+	checkpoint.seed = header.seed;
+	checkpoint.radiiChecksum = header.radiiChecksum;
+	checkpoint.progress = {header.step, header.time};
+	checkpoint.parameters.spatialDataStructure = static_cast<NeighbourSearch::Type>(header.spatialDataStructure);
+	checkpoint.parameters.rigidity = header.rigidity;
+	checkpoint.parameters.ratioToStableLength = header.ratioToStableLength;
+	checkpoint.parameters.stepDuration = header.stepDuration;
+	checkpoint.parameters.internalRadius = header.internalRadius;
+	checkpoint.parameters.externalRadius = header.externalRadius;
+	checkpoint.positions.resize(header.cellCount);
+	std::memcpy(checkpoint.positions.data(), buffer.data() + sizeof(Header), header.cellCount*sizeof(ElasticRelaxation::Point));
+	return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::string RelaxationCheckpoint::Mismatch(const ElasticRelaxation::Parameters& current) const {
+	// the values come from the same configuration file, so they are compared exactly
+	if(parameters.spatialDataStructure != current.spatialDataStructure)
+		return "spatialDataStructure";
+	if(parameters.rigidity != current.rigidity)
+		return "rigidity";
+	if(parameters.ratioToStableLength != current.ratioToStableLength)
+		return "ratioToStableLength";
+	if(parameters.stepDuration != current.stepDuration)
+		return "stepDuration";
+	if(parameters.internalRadius != current.internalRadius || parameters.externalRadius != current.externalRadius)
+		return "spheroid radii";
+	return {};
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::uint64_t RelaxationCheckpoint::Checksum(const std::vector<double>& radii) {
+	return Common::PopulationBinary::checksum(radii.data(), radii.size()*sizeof(double));
+}
+
+}
@@ -0,0 +1,142 @@
+// Compare two relaxed populations of the same configuration, typically one relaxed by the CPOP
+// MASPlatform (relaxationEngine = mas) and one by the parallel engine (relaxationEngine = parallel).
+//
+// The engines do not move the cells identically, so the populations are compared through
+// statistics of their packing rather than cell by cell:
+//  - overlapping pairs per cell (centers closer than the sum of the membrane radii);
+//  - mean and maximum overlap of these pairs, (sum of the radii - distance) / sum of the radii;
+//  - mean distance to the nearest cell, relative to the sum of the radii;
+//  - fraction of the cells in each of nbShell shells of equal volume of the spheroid.
+//
+// The exit code is 1 if a statistic differs by more than the tolerance (absolute for the
+// fractions and overlaps, relative for the others).
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+// CPOP headers
+#include <cReader/zupply.hpp>
+
+#include "PopulationXml.hh"
+#include "UniformGrid.hh"
+
+namespace {
+
+struct Statistics {
+	double overlapsPerCell{0.};
+	double meanOverlap{0.};
+	double maxOverlap{0.};
+	double nearest{0.};
+	std::vector<double> shells;
+};
+
+Statistics Compute(const Common::PopulationData& population, int nbShell) {
+	std::size_t const n = population.cellCount();
+	auto const position = [&](std::size_t i) {
+		return Common::UniformGrid::Point{population.positionX[i], population.positionY[i], population.positionZ[i]};
+	};
+	double const maxRadius = n == 0 ? 0. : *std::max_element(population.membraneRadius.begin(), population.membraneRadius.end());
+	Common::UniformGrid const grid(n, position, 2.*maxRadius);
+
+	Statistics statistics;
+	statistics.shells.assign(nbShell, 0.);
+	std::size_t pairs = 0;
+	double overlapSum = 0.;
+	double nearestSum = 0.;
+	std::size_t withNeighbour = 0;
+	for(std::size_t i = 0; i < n; ++i) {
+		auto const pi = position(i);
+		double nearest = std::numeric_limits<double>::infinity();
+		grid.ForEachCandidate(pi, [&](std::size_t j) {
+			if(j == i)
+				return;
+			auto const pj = position(j);
+			double const distance = std::hypot(pi[0] - pj[0], pi[1] - pj[1], pi[2] - pj[2]);
+			double const contact = population.membraneRadius[i] + population.membraneRadius[j];
+			nearest = std::min(nearest, distance/contact);
+			if(j > i && distance < contact) {
+				double const overlap = (contact - distance)/contact;
+				++pairs;
+				overlapSum += overlap;
+				statistics.maxOverlap = std::max(statistics.maxOverlap, overlap);
+			}
+		});
+		// cells farther than the cubes of the grid are not in contact: their nearest distance is not counted
+		if(nearest < std::numeric_limits<double>::infinity()) {
+			nearestSum += nearest;
+			++withNeighbour;
+		}
+
+		double const r = std::hypot(pi[0] - population.center[0], pi[1] - population.center[1], pi[2] - population.center[2]);
+		double const fraction = std::pow(std::min(1., r/population.externalRadius), 3.);
+		statistics.shells[std::min(nbShell - 1, static_cast<int>(fraction*nbShell))] += 1.;
+	}
+
+	statistics.overlapsPerCell = n == 0 ? 0. : 2.*pairs/n;
+	statistics.meanOverlap = pairs == 0 ? 0. : overlapSum/pairs;
+	statistics.nearest = withNeighbour == 0 ? 0. : nearestSum/withNeighbour;
+	for(auto& shell: statistics.shells)
+		shell /= std::max<std::size_t>(1, n);
+	return statistics;
+}
+
+}
+
+int main(int argc, char** argv) {
+	zz::cfg::ArgParser argparser;
+
+	std::string reference;
+	argparser.add_opt_value('r', "reference", reference, std::string(), "reference population, xml or binary (MASPlatform)", "file").require();
+	std::string compared;
+	argparser.add_opt_value('c', "compared", compared, std::string(), "compared population, xml or binary (parallel engine)", "file").require();
+	int nbShell = 5;
+	argparser.add_opt_value('s', "shell", nbShell, 5, "number of shells of equal volume", "int");
+	double tolerance = 0.05;
+	argparser.add_opt_value('e', "tolerance", tolerance, 0.05, "largest difference accepted", "double");
+
+	argparser.parse(argc, argv);
+
+	if(argparser.count_error() > 0 || nbShell < 1) {
+		std::cout << argparser.get_error() << std::endl;
+		std::cout << argparser.get_help() << std::endl;
+		return 1;
+	}
+
+	Statistics a, b;
+	std::size_t nA = 0, nB = 0;
+	try {
+		auto const populationA = Common::ReadPopulation(reference);
+		auto const populationB = Common::ReadPopulation(compared);
+		nA = populationA.cellCount();
+		nB = populationB.cellCount();
+		a = Compute(populationA, nbShell);
+		b = Compute(populationB, nbShell);
+	} catch(const std::exception& e) {
+		std::cout << e.what() << std::endl;
+		return 1;
+	}
+
+	bool passed = true;
+	std::cout << std::setw(22) << "statistic" << std::setw(14) << "reference" << std::setw(14) << "compared" << std::endl;
+	auto const print = [&](const std::string& name, double x, double y, bool relative) {
+		double const difference = relative ? std::abs(y - x)/std::max(std::abs(x), 1e-12) : std::abs(y - x);
+		bool const differs = difference > tolerance;
+		passed = passed && !differs;
+		std::cout << std::setw(22) << name << std::setw(14) << x << std::setw(14) << y << (differs ? "  DIFFERS" : "") << std::endl;
+	};
+	print("cells", nA, nB, true);
+	print("overlaps per cell", a.overlapsPerCell, b.overlapsPerCell, true);
+	print("mean overlap", a.meanOverlap, b.meanOverlap, false);
+	print("max overlap", a.maxOverlap, b.maxOverlap, false);
+	print("nearest / contact", a.nearest, b.nearest, true);
+	for(int shell = 0; shell < nbShell; ++shell)
+		print("shell " + std::to_string(shell), a.shells[shell], b.shells[shell], false);
+
+	std::cout << (passed ? "same packing within the tolerance" : "PACKINGS DIFFER") << std::endl;
+	return passed ? 0 : 1;
+}
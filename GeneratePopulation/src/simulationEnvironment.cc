@@ -25,6 +25,11 @@
 //
 
 #include "simulationEnvironment.hh"
+#include "elasticRelaxation.hh"
+#include "initialPlacement.hh"
+#include "relaxationCheckpoint.hh"
+#include "CellExportMesh.hh"
+#include "PopulationXml.hh"
 
 #include <CellProperties.hh>
 #include <CLHEP/Random/MTwistEngine.h>
@@ -35,6 +40,14 @@
 #include <SpheresSDelimitation.hh>
 #include <UnitSystemManager.hh>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+#include <unordered_map>
+
 namespace B6 {
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -80,50 +93,125 @@ void SimulationEnvironment::SetCellProperties(
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-void SimulationEnvironment::SetSpheroidProperties(double internalRadius, double externalRadius, int nbCell) {
+void SimulationEnvironment::SetSpheroidProperties(
+  double internalRadius, double externalRadius, int nbCell, const std::string& distribution, double latticeJitter, int seed
+) {
   // setup the main environment
   Point_3 center(0., 0., 0.);
   // tell where the cells should be created (here in a spheroid)
-  auto* subEnvSD = new SpheresSDelimitation(internalRadius*fMetricSystem, externalRadius*fMetricSystem, center);
+  InvalidateMesh();
+  fCells.clear();
+  fInternalRadius = internalRadius*fMetricSystem;
+  fExternalRadius = externalRadius*fMetricSystem;
+  fSeed = seed;
+  auto* subEnvSD = new SpheresSDelimitation(fInternalRadius, fExternalRadius, center);
 
   // environment to simulate
   delete fSimulatedEnv;
   fSimulatedEnv = new t_SimulatedSubEnv_3(&fEnv, "MySimulatedSubEnv", static_cast<t_SpatialDelimitation_3*>(subEnvSD));
 
   // generate cells
-  CLHEP::MTwistEngine defaultEngine(1234567);
+  CLHEP::MTwistEngine defaultEngine(fSeed);
   RandomEngineManager::getInstance()->setEngine(&defaultEngine);
 
-  std::map<LifeCycles::LifeCycle, double> rates = Utils::generateUniformLifeCycle();
-  /// 3.1 get the distribution
-  auto* distribution = DistributionFactory::getInstance()->getDistribution<double, Point_3, Vector_3>(Distribution::RANDOM);
-  /// 3.2 distribute
-  distribution->distribute(fSimulatedEnv, &fCellProperties, nbCell, rates);
+  {
+    auto phase = fReport.Start("distribute");
+    std::map<LifeCycles::LifeCycle, double> rates = Utils::generateUniformLifeCycle();
+    /// 3.1 get the distribution
+    auto* randomDistribution = DistributionFactory::getInstance()->getDistribution<double, Point_3, Vector_3>(Distribution::RANDOM);
+    /// 3.2 distribute
+    randomDistribution->distribute(fSimulatedEnv, &fCellProperties, nbCell, rates);
+
+    delete randomDistribution;
+    phase.Count("cells", static_cast<std::uint64_t>(nbCell));
+  }
+
+  /// 3.3 move them to the requested initial placement
+  PlaceCells(distribution, latticeJitter);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SimulationEnvironment::PlaceCells(const std::string& distribution, double latticeJitter) {
+  InitialPlacement::Type type = InitialPlacement::Type::Random;
+  if(!InitialPlacement::Parse(distribution, type))
+    std::cerr << "Unknown distribution " << distribution << ", using random" << std::endl;
+  if(type == InitialPlacement::Type::Random)
+    return;
+
+  auto phase = fReport.Start("placement");
+  // the cells keep the radius and properties given by the random distribution, only their position changes
+  auto const& cells = EnumerateCells();
+  phase.Count("cells", cells.size());
+  InitialPlacement placement(fInternalRadius, fExternalRadius, static_cast<std::uint64_t>(fSeed));
+
+  std::vector<InitialPlacement::Point> positions;
+  if(type == InitialPlacement::Type::PoissonDisk) {
+    std::vector<double> radii;
+    radii.reserve(cells.size());
+    for(auto const* cell: cells)
+      radii.push_back(cell->getRadius());
+    positions = placement.PoissonDisk(radii);
+    std::cout << "Poisson disk placement : spacing " << placement.spacing() << std::endl;
+  } else {
+    positions = placement.JitteredLattice(cells.size(), latticeJitter);
+  }
 
-  delete distribution;
+  for(std::size_t i = 0; i < cells.size(); ++i)
+    cells[i]->setPosition(Point_3(positions[i][0], positions[i][1], positions[i][2]));
+  // the tesselation listing the cells is the one of their random positions
+  InvalidateMesh();
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 void SimulationEnvironment::SetMeshProperties(int nOfFacetPerCell) {
+  if(nOfFacetPerCell != fNumberOfFacetPerCell)
+    InvalidateMesh();
   fNumberOfFacetPerCell = nOfFacetPerCell;
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-void SimulationEnvironment::SetForceProperties(double ratioToStableLength, double rigidity) {
-  int error = 0;
+void SimulationEnvironment::SetMeshEngine(const std::string& engine, int nbThread) {
+  std::string input = engine;
+  // transforms the input string to lowercase to be case insensitive
+  std::transform(std::begin(input), std::end(input), std::begin(input), ::tolower);
+
+  fExportMesh = input == "export";
+  fMeshNbThread = nbThread;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SimulationEnvironment::SetVisProperties(const std::string& format, int maxNumberOfFacet, double internalRatio, double intermediaryRatio) {
+  std::string input = format;
+  // transforms the input string to lowercase to be case insensitive
+  std::transform(std::begin(input), std::end(input), std::begin(input), ::tolower);
+
+  fVisPly = input == "ply";
+  fVisFacetBudget = maxNumberOfFacet;
+  fInternalRatio = internalRatio;
+  fIntermediaryRatio = intermediaryRatio;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
+void SimulationEnvironment::SetForceProperties(double ratioToStableLength, double rigidity) {
+  auto phase = fReport.Start("forces");
   // get the generated cells
-  auto* voronoiMesh = MeshFactory::getInstance()->create_3DMesh(&error, fSimulatedEnv, MeshTypes::Round_Cell_Tesselation, fNumberOfFacetPerCell);
-  auto lCells = voronoiMesh->getCells();
-  delete voronoiMesh;
+  EnumerateCells();
+  phase.Count("cells", fCells.size());
 
   // apply elastic forces to each cells
-  for(auto itCell = std::begin(lCells); itCell != std::end(lCells); ++itCell) {
+  for(auto itCell = std::begin(fCells); itCell != std::end(fCells); ++itCell) {
     auto* elasForce = new t_ElasticForce_3(*itCell, rigidity, ratioToStableLength);
     (*itCell)->addForce(elasForce);
   }
+
+  // kept for the parallel relaxation engine
+  fRigidity = rigidity;
+  fRatioToStableLength = ratioToStableLength;
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -137,32 +225,273 @@ void SimulationEnvironment::SetSimulationProperties(
   fPlatform.setDuration(duration);
   fPlatform.setDisplacementThreshold(displacementThreshold);
   fPlatform.limiteNbAgentToSimulate(numberOfAgentToExecute);
+  fNumberOfAgentToExecute = numberOfAgentToExecute;
+
+  fDuration = duration;
+  fDisplacementThreshold = displacementThreshold;
+  fStepDuration = stepDuration;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SimulationEnvironment::SetRelaxationEngine(const std::string& engine, int nbThread, int maxNumberOfStep) {
+  std::string input = engine;
+  // transforms the input string to lowercase to be case insensitive
+  std::transform(std::begin(input), std::end(input), std::begin(input), ::tolower);
+
+  fParallelRelaxation = input == "parallel";
+  fNbThread = nbThread;
+  fMaxNumberOfStep = maxNumberOfStep;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SimulationEnvironment::SetSpatialDataStructure(const std::string& name) {
+  auto const search = NeighbourSearch::Create(name);
+  if(!search) {
+    std::cerr << "Unknown spatialDataStructure " << name << ", using delaunay" << std::endl;
+    return;
+  }
+  fSpatialDataStructure = search->Name() == std::string("grid") ? NeighbourSearch::Type::Grid : NeighbourSearch::Type::Delaunay;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SimulationEnvironment::SetCheckpointPeriod(double seconds) {
+  fCheckpointPeriod = seconds;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SimulationEnvironment::SetCheckpoint(const std::string& filename, bool resume) {
+  fCheckpointFile = filename;
+  fResume = resume;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SimulationEnvironment::PrepareMaterials() {
+  ParseMaterial("G4_WATER");
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 void SimulationEnvironment::StartSimulation() {
+  // the cells are going to move
+  InvalidateMesh();
+
+  if(fParallelRelaxation) {
+    StartParallelRelaxation();
+    return;
+  }
+
+  // the platform needs a CPOP spatial data structure, the grid would silently be replaced by Delaunay_3D_SDS
+  if(fSpatialDataStructure != NeighbourSearch::Type::Delaunay)
+    throw std::runtime_error("spatialDataStructure = grid needs relaxationEngine = parallel, the MASPlatform only supports delaunay");
+  // the platform does not expose its steps, its relaxation can neither be saved nor resumed
+  if(fResume)
+    throw std::runtime_error("--resume needs relaxationEngine = parallel, the MASPlatform cannot be checkpointed");
+  if(fCheckpointPeriod > 0.)
+    std::cerr << "Checkpoints are only supported by the parallel relaxation engine" << std::endl;
+
+  auto phase = fReport.Start("relaxation");
   /// 4.3 set the adapted spatial data structure permitting agent to know their neighbors)
   fSimulatedEnv->addSpatialDataStructure(new Delaunay_3D_SDS( " my spatial data structure"));
   fPlatform.startSimulation();
+  // the platform does not expose its step counter
+  phase.Count("cells", fCells.size());
+  phase.Count("agentsPerStep", static_cast<std::uint64_t>(fNumberOfAgentToExecute));
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SimulationEnvironment::StartParallelRelaxation() {
+  std::cerr << "relaxationEngine = parallel is experimental: its force law is not the one of the MASPlatform,"
+    << " the population differs from the one of relaxationEngine = mas" << std::endl;
+
+  ElasticRelaxation::Parameters parameters;
+  parameters.rigidity = fRigidity;
+  parameters.ratioToStableLength = fRatioToStableLength;
+  parameters.stepDuration = fStepDuration;
+  parameters.duration = fDuration;
+  parameters.maxStep = fMaxNumberOfStep;
+  // the threshold is given in the metric system of the configuration file
+  parameters.displacementThreshold = fDisplacementThreshold*fMetricSystem;
+  parameters.internalRadius = fInternalRadius;
+  parameters.externalRadius = fExternalRadius;
+  parameters.nbThread = fNbThread;
+  parameters.spatialDataStructure = fSpatialDataStructure;
+
+  // copy the cells in contiguous arrays, relax them and move the cells to their new positions
+  std::vector<ElasticRelaxation::Point> positions;
+  std::vector<double> radii;
+  positions.reserve(fCells.size());
+  radii.reserve(fCells.size());
+  for(auto const* cell: fCells) {
+    auto const position = cell->getPosition();
+    positions.push_back({position.x(), position.y(), position.z()});
+    radii.push_back(cell->getRadius());
+  }
+
+  // continue from the last checkpoint, if any
+  std::uint64_t const radiiChecksum = RelaxationCheckpoint::Checksum(radii);
+  ElasticRelaxation::Progress start;
+  RelaxationCheckpoint checkpoint;
+  if(fResume && RelaxationCheckpoint::Read(fCheckpointFile, checkpoint)) {
+    if(checkpoint.seed != static_cast<std::uint64_t>(fSeed) || checkpoint.radiiChecksum != radiiChecksum
+      || checkpoint.positions.size() != positions.size())
+      throw std::runtime_error(fCheckpointFile + " was written for another population");
+    auto const mismatch = checkpoint.Mismatch(parameters);
+    if(!mismatch.empty())
+      throw std::runtime_error(fCheckpointFile + " was written with another " + mismatch + ", resume with the same configuration");
+    positions = checkpoint.positions;
+    start = checkpoint.progress;
+    std::cout << "Resumed from " << fCheckpointFile << " at step " << start.step << std::endl;
+  }
+
+  // trace the progress if requested, and write a checkpoint every fCheckpointPeriod seconds
+  bool const checkpointing = fCheckpointPeriod > 0. && !fCheckpointFile.empty();
+  ElasticRelaxation::StepCallback onStep;
+  auto lastCheckpoint = std::chrono::steady_clock::now();
+  if(checkpointing || fReport.tracing()) {
+    onStep = [&](const std::vector<ElasticRelaxation::Point>& current, const ElasticRelaxation::Progress& progress) {
+      fReport.Trace({static_cast<double>(progress.step), progress.time, progress.maxDisplacement});
+      if(!checkpointing || progress.done)
+        return;
+      auto const now = std::chrono::steady_clock::now();
+      if(std::chrono::duration<double>(now - lastCheckpoint).count() < fCheckpointPeriod)
+        return;
+      RelaxationCheckpoint{static_cast<std::uint64_t>(fSeed), radiiChecksum, progress, current, parameters}.Write(fCheckpointFile);
+      lastCheckpoint = now;
+    };
+  }
+
+  auto phase = fReport.Start("relaxation");
+  std::size_t nbStep = ElasticRelaxation(parameters).Run(positions, radii, start, onStep);
+
+  for(std::size_t i = 0; i < fCells.size(); ++i)
+    fCells[i]->setPosition(Point_3(positions[i][0], positions[i][1], positions[i][2]));
+
+  phase.Count("cells", fCells.size());
+  phase.Count("steps", nbStep - start.step);
+  std::cout << "Parallel relaxation : " << nbStep << " steps" << std::endl;
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 void SimulationEnvironment::SavePopulation(const char* filename) {
+  auto phase = fReport.Start("save");
   IO::CPOP::save(static_cast<Writable*>(&fEnv), filename);
+  phase.Count("cells", EnumerateCells().size());
+
+  // the relaxation is over and saved, its checkpoint is no longer needed
+  if(!fCheckpointFile.empty())
+    std::remove(fCheckpointFile.c_str());
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-void SimulationEnvironment::ExportToVis(const char* filename) {
-  int error = 0;
-  auto* voronoiMesh = MeshFactory::getInstance()->create_3DMesh(&error, fSimulatedEnv, MeshTypes::Round_Cell_Tesselation, fNumberOfFacetPerCell);
-  QString outputName = filename;
-  voronoiMesh->exportToFile(outputName, MeshOutFormats::OFF);
+void SimulationEnvironment::SavePopulationBinary(const std::string& xmlFilename, const std::string& binaryFilename) {
+  auto phase = fReport.Start("binary");
+  // the nuclei, masses and properties of the cells are only known through the xml of CPOP
+  Common::PopulationData population = Common::ReadPopulationXml(xmlFilename);
+
+  std::unordered_map<std::uint64_t, std::size_t> index;
+  for(std::size_t i = 0; i < population.cellId.size(); ++i)
+    index.emplace(population.cellId[i], i);
+
+  std::size_t updated = 0;
+  for(auto const* cell: EnumerateCells()) {
+    auto const found = index.find(cell->getID());
+    if(found == index.end())
+      continue;
+    std::size_t const i = found->second;
+    auto const position = cell->getPosition();
+    double const exact[4] = {position.x(), position.y(), position.z(), cell->getRadius()};
+    double* const saved[4] = {&population.positionX[i], &population.positionY[i], &population.positionZ[i], &population.membraneRadius[i]};
+    for(int k = 0; k < 4; ++k) {
+      // the xml holds the same values rounded to 6 digits, in the same unit
+      if(std::abs(exact[k] - *saved[k]) > 1e-5*std::max(std::abs(exact[k]), 1.))
+        throw std::runtime_error(xmlFilename + ": cell " + std::to_string(cell->getID()) + " is not the one of the simulation");
+      *saved[k] = exact[k];
+    }
+    ++updated;
+  }
+  if(updated != population.cellId.size())
+    throw std::runtime_error(xmlFilename + ": " + std::to_string(population.cellId.size() - updated) + " cells are not in the simulation");
+
+  Common::WritePopulationBinary(population, binaryFilename);
+  phase.Count("cells", updated);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::string SimulationEnvironment::ExportToVis(const char* filename) {
+  auto phase = fReport.Start("vis");
+  if(!fExportMesh && !fVisPly) {
+    QString outputName = filename;
+    GetMesh().exportToFile(outputName, MeshOutFormats::OFF);
+    phase.Count("cells", EnumerateCells().size());
+    return std::string(filename) + ".off";
+  }
+
+  // copy the cells in contiguous arrays, then mesh them concurrently while the file is written
+  std::vector<double> x, y, z, radius;
+  std::vector<std::uint64_t> id;
+  for(auto const* cell: EnumerateCells()) {
+    auto const position = cell->getPosition();
+    x.push_back(position.x());
+    y.push_back(position.y());
+    z.push_back(position.z());
+    radius.push_back(cell->getRadius());
+    id.push_back(cell->getID());
+  }
+
+  Common::CellArrays const cells{x.size(), x.data(), y.data(), z.data(), radius.data(), id.data()};
+  int const nbFacet = Common::CellExportMesh::FacetsPerCellForBudget(cells.count, fVisFacetBudget, fNumberOfFacetPerCell);
+  Common::CellExportMesh const mesh(cells, nbFacet, fMeshNbThread);
+  phase.Count("cells", cells.count);
+  phase.Count("facetsPerCell", static_cast<std::uint64_t>(nbFacet));
+
+  if(!fVisPly) {
+    std::string const outputName = std::string(filename) + ".off";
+    mesh.ExportOff(outputName);
+    return outputName;
+  }
+
+  double const center[3] = {0., 0., 0.};
+  auto const regions = Common::CellRegions(cells, center, fExternalRadius, fInternalRatio, fIntermediaryRatio);
+  std::string const outputName = std::string(filename) + ".ply";
+  mesh.ExportPly(outputName, regions.data());
+  return outputName;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+const std::vector<t_Cell_3*>& SimulationEnvironment::EnumerateCells() {
+  // the cells do not change once distributed, only their positions: they are listed once, by the
+  // tesselation as CPOP gives them, which is kept until they move
+  if(fCells.empty()) {
+    auto const lCells = GetMesh().getCells();
+    fCells.assign(std::begin(lCells), std::end(lCells));
+  }
+  return fCells;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+SimulationEnvironment::t_Mesh_3& SimulationEnvironment::GetMesh() {
+  if(!fMesh) {
+    int error = 0;
+    fMesh.reset(MeshFactory::getInstance()->create_3DMesh(&error, fSimulatedEnv, MeshTypes::Round_Cell_Tesselation, fNumberOfFacetPerCell));
+  }
+  return *fMesh;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-  // delete mesh used
-  delete voronoiMesh;
+void SimulationEnvironment::InvalidateMesh() {
+  fMesh.reset();
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,224 @@
+#include "sweep.hh"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace B6 {
+
+namespace {
+
+/// Keys of a single configuration taking several values
+bool IsVectorKey(const std::string& section, const std::string& key) {
+	return section == "CellProperties" && (key == "nucleusRadius" || key == "membraneRadius");
+}
+
+std::string Trim(const std::string& text) {
+	auto const begin = text.find_first_not_of(" \t\r");
+	if(begin == std::string::npos)
+		return {};
+	auto const end = text.find_last_not_of(" \t\r");
+	return text.substr(begin, end - begin + 1);
+}
+
+std::vector<std::string> Split(const std::string& text, char separator) {
+	std::vector<std::string> parts;
+	std::istringstream stream(text);
+	std::string part;
+	while(std::getline(stream, part, separator))
+		if(!Trim(part).empty())
+			parts.push_back(Trim(part));
+	return parts;
+}
+
+std::vector<std::string> SplitWords(const std::string& text) {
+	std::vector<std::string> words;
+	std::istringstream stream(text);
+	std::string word;
+	while(stream >> word)
+		words.push_back(word);
+	return words;
+}
+
+/// Value usable in a file name
+std::string FileNamePart(const std::string& value) {
+	std::string part;
+	for(auto const c: value)
+		part += std::isalnum(static_cast<unsigned char>(c)) || c == '.' || c == '-' ? c : '_';
+	return part;
+}
+
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+Sweep::Sweep(const std::string& configFile):
+	fConfigFile(configFile)
+{
+	std::ifstream input(configFile);
+	if(!input)
+		throw std::runtime_error("unable to open " + configFile);
+
+	std::string section;
+	for(std::string line; std::getline(input, line);) {
+		fLines.push_back(line);
+
+		std::string const text = Trim(line);
+		if(text.empty() || text[0] == '#' || text[0] == ';')
+			continue;
+		if(text.front() == '[' && text.back() == ']') {
+			section = text.substr(1, text.size() - 2);
+			continue;
+		}
+
+		auto const equal = line.find('=');
+		if(equal == std::string::npos)
+			continue;
+
+		Axis axis{fLines.size() - 1, section, Trim(line.substr(0, equal)), line.substr(0, equal + 1) + ' ', {}};
+		std::string const value = line.substr(equal + 1);
+		if(value.find('|') != std::string::npos)
+			axis.values = Split(value, '|');
+		else if(!IsVectorKey(section, axis.key))
+			axis.values = SplitWords(value);
+
+		if(axis.values.size() > 1)
+			fAxes.push_back(axis);
+	}
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::size_t Sweep::size() const {
+	std::size_t count = 1;
+	for(auto const& axis: fAxes)
+		count *= axis.values.size();
+	return count;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+Sweep::Combination Sweep::Get(std::size_t index) const {
+	auto lines = fLines;
+	std::string suffix;
+	Combination combination;
+
+	// the last axis varies the fastest
+	std::vector<std::string> values(fAxes.size());
+	for(std::size_t a = fAxes.size(); a-- > 0;) {
+		values[a] = fAxes[a].values[index % fAxes[a].values.size()];
+		index /= fAxes[a].values.size();
+	}
+
+	for(std::size_t a = 0; a < fAxes.size(); ++a) {
+		lines[fAxes[a].line] = fAxes[a].prefix + values[a];
+		suffix += "_" + fAxes[a].key + "-" + FileNamePart(values[a]);
+		if(!combination.parameters.empty())
+			combination.parameters += ", ";
+		combination.parameters += "[" + fAxes[a].section + "] " + fAxes[a].key + " = " + values[a];
+	}
+
+	// data/exampleConfig.cfg -> data/exampleConfig_nbCell-18124.cfg
+	auto const dot = fConfigFile.rfind('.');
+	auto const slash = fConfigFile.rfind('/');
+	bool const hasExtension = dot != std::string::npos && (slash == std::string::npos || dot > slash);
+	combination.configFile = hasExtension
+		? fConfigFile.substr(0, dot) + suffix + fConfigFile.substr(dot)
+		: fConfigFile + suffix;
+
+	for(auto const& line: lines)
+		combination.content += line + '\n';
+	return combination;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::size_t Sweep::Run(unsigned nbCore, const std::function<int(const std::string&, const std::string&)>& generate) const {
+	nbCore = std::max(1u, nbCore);
+	std::cout << "Sweep : " << size() << " populations, " << std::min<std::size_t>(nbCore, size()) << " at once" << std::endl;
+
+	std::map<pid_t, Combination> running;
+	std::size_t failures = 0;
+	std::size_t next = 0;
+	while(next < size() || !running.empty()) {
+		while(next < size() && running.size() < nbCore) {
+			auto combination = Get(next++);
+			std::ofstream(combination.configFile) << combination.content;
+
+			std::cout.flush();
+			std::cerr.flush();
+			pid_t const pid = fork();
+			if(pid < 0)
+				throw std::runtime_error("unable to fork the generation of " + combination.configFile);
+			if(pid == 0) {
+				int code = 1;
+				try {
+					code = generate(combination.configFile, combination.parameters);
+				} catch(const std::exception& e) {
+					std::cerr << combination.configFile << ": " << e.what() << std::endl;
+				}
+				std::cout.flush();
+				std::cerr.flush();
+				_exit(code);
+			}
+			running.emplace(pid, std::move(combination));
+		}
+
+		int status = 0;
+		pid_t const pid = waitpid(-1, &status, 0);
+		if(pid < 0)
+			throw std::runtime_error("waiting for the sweep failed");
+		auto const done = running.find(pid);
+		if(done == running.end())
+			continue;
+		if(!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			std::cerr << "Sweep : generation of " << done->second.configFile << " failed" << std::endl;
+			++failures;
+		}
+		running.erase(done);
+	}
+	return failures;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void Sweep::RecordParameters(const std::string& xmlFile, const std::string& parameters) {
+	std::ifstream input(xmlFile);
+	if(!input)
+		throw std::runtime_error("unable to open " + xmlFile);
+	std::ostringstream content;
+	content << input.rdbuf();
+	input.close();
+
+	// "--" is not allowed inside a comment
+	std::string text = parameters;
+	for(auto dash = text.find("--"); dash != std::string::npos; dash = text.find("--", dash))
+		text.replace(dash, 2, "- -");
+	std::string const comment = "<!--generatePopulation sweep: " + text + "-->\n";
+
+	// the comment goes after the xml declaration and CPOP's own comment
+	std::string xml = content.str();
+	std::size_t position = 0;
+	while(true) {
+		auto const start = xml.find_first_not_of(" \t\r\n", position);
+		if(start == std::string::npos || (xml.compare(start, 2, "<?") != 0 && xml.compare(start, 4, "<!--") != 0))
+			break;
+		auto const end = xml.find('\n', start);
+		if(end == std::string::npos)
+			break;
+		position = end + 1;
+	}
+	xml.insert(position, comment);
+
+	std::ofstream(xmlFile) << xml;
+}
+
+}
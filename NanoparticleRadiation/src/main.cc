@@ -24,12 +24,7 @@
 // ********************************************************************
 //
 
-#define G4MULTITHREADED // TODO hack
-#ifdef G4MULTITHREADED
-#include <G4MTRunManager.hh>
-#else
 #include <G4RunManager.hh>
-#endif
 
 #include <cReader/zupply.hpp>
 #include <Population.hh>
@@ -52,8 +47,20 @@
 #include <ctime>
 #include <chrono>
 #include <memory>
+#include <sstream>
 
 #include "DetectorConstruction.hh"
+#include "PopulationLoader.hh"
+#include "MacroWorker.hh"
+#include "RunManager.hh"
+#include "OutputMerger.hh"
+#include "CellDoseScorer.hh"
+#include "ImportanceSampling.hh"
+#include "PrimarySpectra.hh"
+#include "PrimaryRecorder.hh"
+#include "SourcePlacer.hh"
+#include "MemoryReport.hh"
+#include "Shard.hh"
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
@@ -61,26 +68,34 @@ int main(int argc, char** argv)
 {
 	auto start = std::chrono::high_resolution_clock::now();
 
-	CLHEP::MTwistEngine defaultEngine(123456);
-	G4Random::setTheEngine(&defaultEngine);
-
-	CLHEP::MTwistEngine defaultEngineCPOP(456123);
-	RandomEngineManager::getInstance()->setEngine(&defaultEngineCPOP);
-
 	// Command line arguments
 	// First we add an argument parser to add parameters
 	zz::cfg::ArgParser parser;
 
-#ifdef G4MULTITHREADED
-	// Get the spectrum file. Specify option -t nbThread or --thread nbThread
-	int nThreads = 1;
-	parser.add_opt_value('t', "thread", nThreads, 0, "number of threads", "int");
-#endif
+	// Get the number of threads (0 for the Geant4 default, -1 for the available cores). Specify option -t nbThread or --thread nbThread
+	int nThreads = 0;
+	parser.add_opt_value('t', "thread", nThreads, 0, "number of threads (0 for the Geant4 default, -1 for the available cores)", "int");
+
+	// Get the run manager: serial, mt or tasking. Specify option -r <type> or --runManager <type>
+	std::string runManagerName;
+	parser.add_opt_value('r', "runManager", runManagerName, std::string("mt"), "run manager (serial, mt, tasking)", "type");
 
 	// Get the macro file. Specify option -m <fileName> or --macro <filename>
 	std::string macro;
 	parser.add_opt_value('m', "macro", macro, std::string("input_filename.mac"), "macro file", "file").require();
 
+	// Run job macros against the population and physics initialised once by the macro.
+	// Specify option -j "<job1> <job2>" and/or --jobs-from <file or FIFO> (one job per line)
+	std::string jobs;
+	parser.add_opt_value('j', "jobs", jobs, std::string(""), "job macros run after the macro", "files");
+	std::string jobList;
+	parser.add_opt_value(-1, "jobs-from", jobList, std::string(""), "file or FIFO listing job macros", "file");
+
+	// Run the shard i of N processes, with its own random streams and output files.
+	// Specify option --shard i/N (documentation in Shard.hh)
+	std::string shardName;
+	parser.add_opt_value(-1, "shard", shardName, std::string(""), "shard of a run split over N processes", "i/N");
+
 	parser.parse(argc, argv);
 
 	// check errors
@@ -91,48 +106,109 @@ int main(int argc, char** argv)
 		return 1;
 	}
 
-	// Construct the default run manager
-#ifdef G4MULTITHREADED
-	G4MTRunManager runManager;
-	if(nThreads > 0)
-		runManager.SetNumberOfThreads(nThreads);
-#else
-	G4RunManager runManager;
-#endif
+	Common::RunManagerType runManagerType;
+	if(!Common::ParseRunManagerType(runManagerName, runManagerType))
+	{
+		std::cout << "Unknown run manager " << runManagerName << std::endl;
+		std::cout << parser.get_help() << std::endl;
+		return 1;
+	}
+
+	Common::Shard shard;
+	if(!shardName.empty() && !Common::ParseShard(shardName, shard))
+	{
+		std::cout << "Invalid shard " << shardName << std::endl;
+		std::cout << parser.get_help() << std::endl;
+		return 1;
+	}
+
+	// The seeds of the shards are all different and reproducible, those of the shard 0 being the default ones
+	CLHEP::MTwistEngine defaultEngine(Common::ShardSeed(Common::ShardEngine::Geant4, shard.index));
+	G4Random::setTheEngine(&defaultEngine);
+
+	CLHEP::MTwistEngine defaultEngineCPOP(Common::ShardSeed(Common::ShardEngine::CPOP, shard.index));
+	RandomEngineManager::getInstance()->setEngine(&defaultEngineCPOP);
+
+	// Construct the run manager, the memory is reported, the files of its threads are merged and the doses
+	// of the cells summed at the end of each run (documentation in RunManager.hh, MemoryReport.hh,
+	// OutputMerger.hh and CellDoseScorer.hh)
+	Common::MemoryReport memoryReport;
+	Common::OutputMerger outputMerger;
+	Common::CellDoseScorer cellDoseScorer;
+	// particles split and rouletted toward observed cells (documentation in ImportanceSampling.hh)
+	Common::ImportanceSampling importanceSampling(cellDoseScorer);
+	// energies of the primaries drawn from alias tables (documentation in PrimarySpectra.hh)
+	Common::PrimarySpectra primarySpectra;
+	// primaries recorded and replayed in a binary format (documentation in PrimaryRecorder.hh)
+	Common::PrimaryRecorder primaryRecorder(shard);
+	// sources placed in parallel and emitted without locks (documentation in SourcePlacer.hh)
+	Common::SourcePlacer sourcePlacer;
+	auto runManager = Common::CreateRunManager(runManagerType, nThreads, [&](int events, int threads, double seconds) {
+		memoryReport.EndOfRun(events, threads);
+		cellDoseScorer.EndOfRun(events);
+		importanceSampling.EndOfRun(events, seconds);
+		primaryRecorder.EndOfRun();
+		primarySpectra.EndOfRun();
+		outputMerger.Merge(threads);
+	}, shard);
 
 	// Create a population
 	cpop::Population population;
 	population.messenger().BuildCommands("/cpop");
+	// Allow a binary population file (/cpop/population/inputBinary)
+	Common::PopulationLoader populationLoader;
+	cellDoseScorer.SetPopulationLoader(populationLoader);
+	sourcePlacer.SetPopulationLoader(populationLoader);
 
 	// Set mandatory initialization classes
 	//
 
 	// Set the geometry ie a box filled with G4_WATER
 	auto* detector = new B8::DetectorConstruction;
-	runManager.SetUserInitialization(detector);
+	detector->cellGeometry().SetPopulationLoader(populationLoader);
+	cellDoseScorer.SetCellGeometry(detector->cellGeometry());
+	runManager->SetUserInitialization(detector);
 
 	// Set the physics list
 	auto* physicsList = new cpop::PhysicsList;
 	physicsList->messenger().BuildCommands("/cpop/physics");
-	runManager.SetUserInitialization(physicsList);
+	runManager->SetUserInitialization(physicsList);
 
 	G4cout << "Physics List" << G4endl;
 
 	// Set custom action to extract informations from the simulation
 	auto* actionInitialisation = new cpop::ActionInitialization(population);
-	runManager.SetUserInitialization(actionInitialisation);
+	// the stepping actions of the threads also score the cells (/cpop/scoring/cellDose) and split or
+	// roulette the particles (/cpop/importance), and their primaries are given the energies of
+	// /cpop/primaries/spectrum and the positions of /cpop/sources/init
+	runManager->SetUserInitialization(cellDoseScorer.Wrap(importanceSampling.Wrap(primaryRecorder.Wrap(sourcePlacer.Wrap(primarySpectra.Wrap(actionInitialisation))))));
 
 	G4cout << "Action Initialization" << G4endl;
 
 	// Get the pointer to the User Interface manager
 	G4UImanager* UImanager = G4UImanager::GetUIpointer();
-	G4String command = "/control/execute ";
-	UImanager->ApplyCommand(command+macro);
+	std::size_t failures = 0;
+	if(jobs.empty() && jobList.empty()) {
+		G4String command = "/control/execute ";
+		UImanager->ApplyCommand(command+macro);
+	} else {
+		// the population and physics tables are built once for every job (documentation in MacroWorker.hh)
+		Common::MacroWorker worker(UImanager);
+		worker.Initialise(macro);
+		std::istringstream jobNames(jobs);
+		for(std::string job; jobNames >> job;)
+			if(!worker.Run(job))
+				++failures;
+		if(!jobList.empty())
+			failures += worker.Serve(jobList);
+		std::cout << worker.jobs() << " jobs, " << failures << " failed" << std::endl;
+	}
 
 	auto end = std::chrono::high_resolution_clock::now();
 	std::chrono::duration<double> elapsed_seconds = end - start;
 
 	std::cout << "elapsed time: " << elapsed_seconds.count() << " s\n";
+	return failures == 0 ? 0 : 1;
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo.....
@@ -0,0 +1,47 @@
+#include <iostream>
+#include <stdexcept>
+
+// CPOP headers
+#include <cReader/zupply.hpp>
+
+#include "PopulationBinary.hh"
+#include "PopulationXml.hh"
+
+int main(int argc, char** argv) {
+	zz::cfg::ArgParser argparser;
+
+	// Get the population to convert. Specify option -i <fileName>
+	std::string input;
+	argparser.add_opt_value('i', "input", input, std::string("population.xml"), "population file (xml or binary)", "file").require();
+
+	// Get the converted population. Specify option -o <fileName>
+	std::string output;
+	argparser.add_opt_value('o', "output", output, std::string(""), "converted population file", "file");
+
+	argparser.parse(argc, argv);
+
+	// check errors
+	if(argparser.count_error() > 0) {
+		std::cout << argparser.get_error() << std::endl;
+		std::cout << argparser.get_help() << std::endl;
+		return 1;
+	}
+
+	// The direction is given by the input file content:
+	// binary -> xml if it starts with the binary magic number, xml -> binary otherwise
+	bool const toXml = Common::IsPopulationBinary(input);
+	if(output.empty())
+		output = input + (toXml ? ".xml" : Common::PopulationBinary::Extension);
+
+	try {
+		if(toXml)
+			Common::ConvertBinaryToXml(input, output);
+		else
+			Common::ConvertXmlToBinary(input, output);
+	} catch(std::exception const& e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	std::cout << "Generated : " << output << std::endl;
+}
@@ -0,0 +1,50 @@
+#include <iostream>
+#include <stdexcept>
+
+// CPOP headers
+#include <cReader/zupply.hpp>
+
+#include "PrimaryRecords.hh"
+
+int main(int argc, char** argv) {
+	zz::cfg::ArgParser argparser;
+
+	// Get the primaries to convert. Specify option -i <fileName>
+	std::string input;
+	argparser.add_opt_value('i', "input", input, std::string("primaries.cpopp"), "primaries file (text or binary)", "file").require();
+
+	// Get the converted primaries. Specify option -o <fileName>
+	std::string output;
+	argparser.add_opt_value('o', "output", output, std::string(""), "converted primaries file", "file");
+
+	// Write the event and the particle of each primary in the text. This is an optional flag
+	bool events = false;
+	argparser.add_opt_flag(-1, "events", "write the event and the PDG code of each primary in the text", &events);
+
+	argparser.parse(argc, argv);
+
+	// check errors
+	if(argparser.count_error() > 0) {
+		std::cout << argparser.get_error() << std::endl;
+		std::cout << argparser.get_help() << std::endl;
+		return 1;
+	}
+
+	// The direction is given by the input file content:
+	// binary -> text if it starts with the primary records magic number, text -> binary otherwise
+	bool const toText = Common::IsPrimaryRecords(input);
+	if(output.empty())
+		output = input + (toText ? ".txt" : Common::PrimaryRecords::Extension);
+
+	try {
+		if(toText)
+			Common::ConvertPrimaryRecordsToText(input, output, events);
+		else
+			Common::ConvertTextToPrimaryRecords(input, output);
+	} catch(std::exception const& e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	std::cout << "Generated : " << output << std::endl;
+}
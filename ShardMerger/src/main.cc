@@ -0,0 +1,70 @@
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+// CPOP headers
+#include <cReader/zupply.hpp>
+
+#include "CellDoseScorer.hh"
+#include "ColumnTable.hh"
+#include "OutputMerger.hh"
+#include "ParallelFor.hh"
+#include "Shard.hh"
+
+int main(int argc, char** argv) {
+	zz::cfg::ArgParser argparser;
+
+	// Get the files of the shards. Specify option -i "<shard0> <shard1> ..."
+	std::string inputs;
+	argparser.add_opt_value('i', "input", inputs, std::string(""), "files of the shards, separated by spaces", "files").require();
+
+	// Get the merged file. Specify option -o <fileName>
+	std::string output;
+	argparser.add_opt_value('o', "output", output, std::string(""), "merged file (.root, .csv or .cpopc)", "file").require();
+
+	// Get the number of threads merging ROOT files (0 for the available cores). Specify option -t nbThread
+	int nThreads = 0;
+	argparser.add_opt_value('t', "thread", nThreads, 0, "number of threads (0 for all of them)", "int");
+
+	// Merge a subset of the shards. This is an optional flag
+	bool partial = false;
+	argparser.add_opt_flag(-1, "partial", "merge the files given even if shards are missing", &partial);
+
+	argparser.parse(argc, argv);
+
+	// check errors
+	if(argparser.count_error() > 0) {
+		std::cout << argparser.get_error() << std::endl;
+		std::cout << argparser.get_help() << std::endl;
+		return 1;
+	}
+
+	std::vector<std::string> files;
+	std::istringstream names(inputs);
+	for(std::string name; names >> name;)
+		files.push_back(name);
+
+	// The format is given by the output file name: per-cell doses if it ends with .csv,
+	// column tables (output.<ntuple>.cpopc) if it ends with .cpopc, ROOT files otherwise
+	auto const endsWith = [&output](const std::string& extension) {
+		return output.size() >= extension.size() && output.compare(output.size() - extension.size(), extension.size(), extension) == 0;
+	};
+	std::vector<std::string> outputs{output};
+	try {
+		if(!partial)
+			Common::CheckShardFiles(files);
+		if(endsWith(".csv"))
+			Common::CellDoseScorer::MergeFiles(files, output);
+		else if(endsWith(Common::ColumnTable::Extension))
+			outputs = Common::OutputMerger::WriteColumns(files, output, true);
+		else
+			Common::OutputMerger::MergeFiles(files, output, Common::ResolveThreadCount(nThreads), true);
+	} catch(std::exception const& e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	for(auto const& merged: outputs)
+		std::cout << "Merged " << files.size() << " shards into " << merged << std::endl;
+}
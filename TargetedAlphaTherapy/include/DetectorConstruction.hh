@@ -31,6 +31,8 @@
 
 #include <G4VUserDetectorConstruction.hh>
 
+#include "CellGeometry.hh"
+
 class G4VPhysicalVolume;
 
 namespace cpop {
@@ -55,9 +57,13 @@ public:
 	[[nodiscard]] double getWorldSize() const;
 	void setWorldSize(double value);
 
+	/// Cells and nuclei placed in the world (documentation in CellGeometry.hh)
+	Common::CellGeometry& cellGeometry() { return fCellGeometry; }
+
 private:
 	double fWorldSize;
 	std::unique_ptr<DetectorConstructionMessenger> fMessenger;
+	Common::CellGeometry fCellGeometry;
 	const cpop::Population* fPopulation;
 
 };
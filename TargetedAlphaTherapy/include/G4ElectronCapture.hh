@@ -50,18 +50,23 @@
 #include "globals.hh"
 #include "G4ParticleChangeForGamma.hh"
 
+#include <vector>
+
 class G4Region;
 
 /// G4ElectronCapture class
 ///
-/// G4ElectronCapture allows to remove unwanted e- from simulation in
-/// order to improve CPU performance. There are two parameters:
+/// G4ElectronCapture allows to remove unwanted particles from simulation in
+/// order to improve CPU performance. Each cut has three parameters:
 ///
-/// 1) low energy threshold for e- kinetic energy (default 0)
-/// 2) the name of G4Region where process is active
+/// 1) the particle type it applies to (e- by default)
+/// 2) low energy threshold for the kinetic energy of the particle
+/// 3) the name of G4Region where the cut is active
 ///
+/// The process is only attached to the particle types having a cut, so the
+/// other particles do not pay for it.
 ///
-/// If an electron track is killed then energy deposition is added to the step
+/// If a track is killed then its kinetic energy is deposited at the step
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
@@ -69,12 +74,17 @@ class G4ElectronCapture : public G4VDiscreteProcess
 {
 public:
 
+  G4ElectronCapture();
+
   G4ElectronCapture(const G4String& regName, G4double ekinlimit);
 
   virtual ~G4ElectronCapture();
 
   void SetKinEnergyLimit(G4double);
 
+  /// Kill the particles of the given name below ekinlimit in the region regName
+  void AddCut(const G4String& particleName, const G4String& regName, G4double ekinlimit);
+
   virtual void BuildPhysicsTable(const G4ParticleDefinition&);
 
   virtual G4bool IsApplicable(const G4ParticleDefinition&);
@@ -91,13 +101,19 @@ protected:
 
 private:
 
+  struct Cut {
+    G4String particleName;
+    G4String regionName;
+    G4double kinEnergyThreshold;
+    const G4ParticleDefinition* particle;
+    const G4Region* region;
+  };
+
   // hide assignment operator as private
   G4ElectronCapture(const G4ElectronCapture&);
   G4ElectronCapture& operator = (const G4ElectronCapture &right);
 
-  G4double fKinEnergyThreshold;
-  G4String fRegionName;
-  G4Region* fpRegion;
+  std::vector<Cut> fCuts;
   G4ParticleChangeForGamma fParticleChange;
 };
 
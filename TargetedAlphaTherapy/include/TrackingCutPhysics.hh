@@ -0,0 +1,89 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file TrackingCutPhysics.hh
+/// \brief Definition of the B9::TrackingCutPhysics class
+
+#ifndef B9_TRACKING_CUT_PHYSICS_HH
+#define B9_TRACKING_CUT_PHYSICS_HH
+
+#include <memory>
+#include <vector>
+
+#include <G4VPhysicsConstructor.hh>
+
+// CPOP headers
+#include <PhysicsList.hh>
+
+namespace B9 {
+
+class TrackingCutPhysicsMessenger;
+
+/// Tracking cuts added to the physics list: the particles of a type are killed
+/// below an energy in a region, their energy deposited where they stop (see
+/// G4ElectronCapture). Set by /cpop/physics/trackingCut before /run/initialize.
+
+class TrackingCutPhysics: public G4VPhysicsConstructor
+{
+public:
+	struct Cut {
+		G4String particle;
+		G4double energy;
+		G4String region;
+	};
+
+	TrackingCutPhysics();
+	~TrackingCutPhysics() override;
+
+	void ConstructParticle() override;
+	void ConstructProcess() override;
+
+	void AddCut(const Cut& cut);
+
+private:
+	std::vector<Cut> fCuts;
+	std::unique_ptr<TrackingCutPhysicsMessenger> fMessenger;
+};
+
+/// TrackingCutPhysicsList class
+///
+/// CPOP physics list with the processes of a TrackingCutPhysics constructed after its own.
+/// cpop::PhysicsList is only relied upon being a G4VUserPhysicsList: the cuts are added by
+/// overriding ConstructProcess, G4VModularPhysicsList::RegisterPhysics being unavailable
+/// if it is not modular.
+
+class TrackingCutPhysicsList: public cpop::PhysicsList
+{
+public:
+	void ConstructParticle() override;
+	void ConstructProcess() override;
+
+private:
+	TrackingCutPhysics fTrackingCut;
+};
+
+}
+
+#endif
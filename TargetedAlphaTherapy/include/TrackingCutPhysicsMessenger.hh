@@ -0,0 +1,57 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+/// \file TrackingCutPhysicsMessenger.hh
+/// \brief Definition of the B9::TrackingCutPhysicsMessenger class
+
+#ifndef B9_TRACKING_CUT_PHYSICS_MESSENGER_HH
+#define B9_TRACKING_CUT_PHYSICS_MESSENGER_HH
+
+#include <G4UImessenger.hh>
+#include <G4UIcommand.hh>
+
+namespace B9 {
+
+class TrackingCutPhysics;
+
+/// Tracking cut physics messenger class to set the cuts via a .mac file:
+///  /cpop/physics/trackingCut <particle> <energy> <unit> <region>
+/// the region being world for the whole geometry
+
+class TrackingCutPhysicsMessenger: public G4UImessenger
+{
+public:
+	TrackingCutPhysicsMessenger(TrackingCutPhysics* physics);
+
+	void SetNewValue(G4UIcommand* command, G4String newValue) override;
+
+private:
+	TrackingCutPhysics* fPhysics;
+	G4UIcommand fTrackingCutCmd;
+};
+
+}
+
+#endif
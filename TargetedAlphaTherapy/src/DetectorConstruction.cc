@@ -56,6 +56,9 @@ G4VPhysicalVolume *DetectorConstruction::Construct()
 	auto* solidWorld = new G4Box("sWorld", this->getWorldSize(), this->getWorldSize(), this->getWorldSize());
 	auto* logicWorld = new G4LogicalVolume( solidWorld, lWater, "LV_World", nullptr, nullptr, nullptr);
 
+	// cells and nuclei as volumes (/cpop/geometry/cells)
+	fCellGeometry.Place(logicWorld);
+
 	auto world = new G4PVPlacement(  G4Transform3D(),// no rotation
 															 logicWorld,     // its logical volume
 															 "PV_World",     // its name
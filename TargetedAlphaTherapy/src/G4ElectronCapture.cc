@@ -50,22 +50,27 @@
 #include "G4Region.hh"
 #include "G4RegionStore.hh"
 #include "G4Electron.hh"
+#include "G4LogicalVolume.hh"
+#include "G4VPhysicalVolume.hh"
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-G4ElectronCapture::G4ElectronCapture(const G4String& regName, G4double ekinlim)
-: G4VDiscreteProcess("eCapture", fElectromagnetic),
-  fKinEnergyThreshold(ekinlim),
-  fRegionName(regName), fpRegion(0)
+G4ElectronCapture::G4ElectronCapture()
+: G4VDiscreteProcess("eCapture", fElectromagnetic)
 {
-  if(regName == "" || regName == "world") { 
-    fRegionName = "DefaultRegionForTheWorld";
-  }
   pParticleChange = &fParticleChange;
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
+G4ElectronCapture::G4ElectronCapture(const G4String& regName, G4double ekinlim)
+: G4ElectronCapture()
+{
+  AddCut(G4Electron::Electron()->GetParticleName(), regName, ekinlim);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
 G4ElectronCapture::~G4ElectronCapture() 
 {}
 
@@ -73,30 +78,55 @@ G4ElectronCapture::~G4ElectronCapture()
 
 void G4ElectronCapture::SetKinEnergyLimit(G4double val)
 {
-  fKinEnergyThreshold = val;
+  for(auto& cut : fCuts) {
+    cut.kinEnergyThreshold = val;
+  }
   if(verboseLevel > 0) {
     G4cout << "### G4ElectronCapture: Tracking cut E(MeV) = " 
-        << fKinEnergyThreshold/MeV << G4endl;
+        << val/MeV << G4endl;
   }
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-void G4ElectronCapture::BuildPhysicsTable(const G4ParticleDefinition&)
+void G4ElectronCapture::AddCut(const G4String& particleName, 
+    const G4String& regName, G4double ekinlim)
 {
-  fpRegion = (G4RegionStore::GetInstance())->GetRegion(fRegionName);
-  if(fpRegion && verboseLevel > 0) {
-    G4cout << "### G4ElectronCapture: Tracking cut E(MeV) = " 
-        << fKinEnergyThreshold/MeV << " is assigned to " << fRegionName
-        << G4endl;
+  G4String regionName = regName;
+  if(regName == "" || regName == "world") { 
+    regionName = "DefaultRegionForTheWorld";
+  }
+  fCuts.push_back({particleName, regionName, ekinlim, nullptr, nullptr});
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void G4ElectronCapture::BuildPhysicsTable(const G4ParticleDefinition& part)
+{
+  // the regions exist once the geometry is built
+  for(auto& cut : fCuts) {
+    if(cut.particleName != part.GetParticleName()) { continue; }
+    cut.particle = &part;
+    cut.region = (G4RegionStore::GetInstance())->GetRegion(cut.regionName, false);
+    if(!cut.region) {
+      G4cout << "### G4ElectronCapture: no region " << cut.regionName
+          << ", the cut of " << cut.particleName << " is ignored" << G4endl;
+    } else if(verboseLevel > 0) {
+      G4cout << "### G4ElectronCapture: Tracking cut E(MeV) = " 
+          << cut.kinEnergyThreshold/MeV << " of " << cut.particleName
+          << " is assigned to " << cut.regionName << G4endl;
+    }
   }
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-G4bool G4ElectronCapture::IsApplicable(const G4ParticleDefinition&)
+G4bool G4ElectronCapture::IsApplicable(const G4ParticleDefinition& part)
 {
-  return true;
+  for(auto const& cut : fCuts) {
+    if(cut.particleName == part.GetParticleName()) { return true; }
+  }
+  return false;
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -109,12 +139,13 @@ G4ElectronCapture::PostStepGetPhysicalInteractionLength(const G4Track& aTrack,
   // condition is set to "Not Forced"
   *condition = NotForced;
 
-  G4double limit = DBL_MAX; 
-  if(fpRegion) {
-    if(aTrack.GetVolume()->GetLogicalVolume()->GetRegion() == fpRegion && 
-        aTrack.GetKineticEnergy() < fKinEnergyThreshold) { limit = 0.0; }
+  const G4ParticleDefinition* part = aTrack.GetParticleDefinition();
+  const G4Region* region = aTrack.GetVolume()->GetLogicalVolume()->GetRegion();
+  for(auto const& cut : fCuts) {
+    if(cut.particle == part && cut.region == region && 
+        aTrack.GetKineticEnergy() < cut.kinEnergyThreshold) { return 0.0; }
   }
-  return limit;
+  return DBL_MAX;
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -136,4 +167,3 @@ G4double G4ElectronCapture::GetMeanFreePath(const G4Track&,G4double,
 {
   return DBL_MAX;
 }
-
@@ -0,0 +1,111 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+
+#include "TrackingCutPhysics.hh"
+#include "TrackingCutPhysicsMessenger.hh"
+#include "G4ElectronCapture.hh"
+
+#include <algorithm>
+
+#include <G4ParticleDefinition.hh>
+#include <G4ParticleTable.hh>
+#include <G4ProcessManager.hh>
+#include <G4SystemOfUnits.hh>
+
+namespace B9 {
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+TrackingCutPhysics::TrackingCutPhysics():
+	G4VPhysicsConstructor("TrackingCut"),
+	fMessenger(std::make_unique<TrackingCutPhysicsMessenger>(this))
+{
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+TrackingCutPhysics::~TrackingCutPhysics() = default;
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void TrackingCutPhysics::ConstructParticle()
+{
+	// the particles are those of the other constructors
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void TrackingCutPhysics::ConstructProcess()
+{
+	if(fCuts.empty())
+		return;
+
+	// a single process for every particle type having a cut, the other types do not get it
+	auto* capture = new G4ElectronCapture;
+	for(auto const& cut: fCuts)
+		capture->AddCut(cut.particle, cut.region, cut.energy);
+
+	auto* particleTable = G4ParticleTable::GetParticleTable();
+	std::vector<G4String> added;
+	for(auto const& cut: fCuts) {
+		if(std::find(std::begin(added), std::end(added), cut.particle) != std::end(added))
+			continue;
+		added.push_back(cut.particle);
+
+		G4ParticleDefinition* particle = particleTable->FindParticle(cut.particle);
+		if(!particle || !particle->GetProcessManager()) {
+			G4cerr << "Tracking cut of " << cut.particle << " ignored: unknown particle" << G4endl;
+			continue;
+		}
+		particle->GetProcessManager()->AddDiscreteProcess(capture);
+	}
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void TrackingCutPhysics::AddCut(const Cut& cut)
+{
+	fCuts.push_back(cut);
+	G4cout << "Tracking cut: " << cut.particle << " below " << cut.energy/keV << " keV killed in " << cut.region << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void TrackingCutPhysicsList::ConstructParticle()
+{
+	cpop::PhysicsList::ConstructParticle();
+	fTrackingCut.ConstructParticle();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void TrackingCutPhysicsList::ConstructProcess()
+{
+	cpop::PhysicsList::ConstructProcess();
+	fTrackingCut.ConstructProcess();
+}
+
+}
@@ -0,0 +1,77 @@
+//
+// ********************************************************************
+// * License and Disclaimer                                           *
+// *                                                                  *
+// * The  Geant4 software  is  copyright of the Copyright Holders  of *
+// * the Geant4 Collaboration.  It is provided  under  the terms  and *
+// * conditions of the Geant4 Software License,  included in the file *
+// * LICENSE and available at  http://cern.ch/geant4/license .  These *
+// * include a list of copyright holders.                             *
+// *                                                                  *
+// * Neither the authors of this software system, nor their employing *
+// * institutes,nor the agencies providing financial support for this *
+// * work  make  any representation or  warranty, express or implied, *
+// * regarding  this  software system or assume any liability for its *
+// * use.  Please see the license in the file  LICENSE  and URL above *
+// * for the full disclaimer and the limitation of liability.         *
+// *                                                                  *
+// * This  code  implementation is the result of  the  scientific and *
+// * technical work of the GEANT4 collaboration.                      *
+// * By using,  copying,  modifying or  distributing the software (or *
+// * any work based  on the software)  you  agree  to acknowledge its *
+// * use  in  resulting  scientific  publications,  and indicate your *
+// * acceptance of all terms of the Geant4 Software license.          *
+// ********************************************************************
+//
+
+#include "TrackingCutPhysicsMessenger.hh"
+
+#include "TrackingCutPhysics.hh"
+
+#include <sstream>
+
+namespace B9 {
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+TrackingCutPhysicsMessenger::TrackingCutPhysicsMessenger(TrackingCutPhysics *physics):
+	fPhysics(physics),
+	fTrackingCutCmd("/cpop/physics/trackingCut", this)
+{
+	fTrackingCutCmd.SetGuidance("Kill the particles of a type below an energy in a region, their energy being deposited");
+	fTrackingCutCmd.SetGuidance("The region world is the whole geometry; Cells and Nuclei exist with /cpop/geometry/cells");
+
+	auto* particle = new G4UIparameter("Particle", 's', false);
+	fTrackingCutCmd.SetParameter(particle);
+
+	auto* energy = new G4UIparameter("Energy", 'd', false);
+	energy->SetParameterRange("Energy >= 0");
+	fTrackingCutCmd.SetParameter(energy);
+
+	auto* unit = new G4UIparameter("Unit", 's', true);
+	unit->SetDefaultValue("keV");
+	fTrackingCutCmd.SetParameter(unit);
+
+	auto* region = new G4UIparameter("Region", 's', true);
+	region->SetDefaultValue("world");
+	fTrackingCutCmd.SetParameter(region);
+
+	fTrackingCutCmd.AvailableForStates(G4State_PreInit);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void TrackingCutPhysicsMessenger::SetNewValue(G4UIcommand *command, G4String newValue)
+{
+	if(command == &fTrackingCutCmd) {
+		std::istringstream values(newValue);
+		TrackingCutPhysics::Cut cut;
+		G4double energy;
+		G4String unit;
+		values >> cut.particle >> energy >> unit >> cut.region;
+		cut.energy = energy*G4UIcommand::ValueOf(unit);
+		fPhysics->AddCut(cut);
+	}
+}
+
+}